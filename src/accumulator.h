@@ -93,6 +93,7 @@ public:
 	CSphVector<ReplicationCommand_t *> m_dCmd;
 
 	bool						m_bKeywordDict {true};
+	bool						m_bBulk {false};	///< bulk load txn, commit writes accumulated docs as a new disk chunk
 	DictRefPtr_c				m_pDict;
 	CSphDict *					m_pRefDict = nullptr; // not owned, used only for ==-matching
 
@@ -107,6 +108,7 @@ public:
 	void			Cleanup();
 
 	void			AddDocument ( ISphHits * pHits, const CSphMatch & tDoc, bool bReplace, int iRowSize, const char ** ppStr, const VecTraits_T<int64_t> & dMvas, const DocstoreBuilder_i::Doc_t * pStoredDoc );
+	void			Append ( RtAccum_t & tSrc );
 	RtSegment_t *	CreateSegment ( int iRowSize, int iWordsCheckpoint, ESphHitless eHitless, const VecTraits_T<SphWordID_t> & dHitlessWords );
 	void			CleanupDuplicates ( int iRowSize );
 	void			GrabLastWarning ( CSphString & sWarning );
@@ -125,6 +127,7 @@ public:
 
 	const BYTE *	GetPackedKeywords() const;
 	int				GetPackedLen() const;
+	int64_t			GetUsedRam() const;
 
 	bool			SetupDocstore ( RtIndex_i & tIndex, CSphString & sError );
 
@@ -44,6 +44,17 @@ protected:
 
 	inline bool	GetValue ( RowID_t tRowID, SphAttr_t & tValue ) const;
 	inline bool	GetValue ( RowID_t tRowID, ByteBlob_t & tData ) const;
+
+	// rowids in a batch are ascending, so the iterator only moves forward
+	template <typename FN>
+	int			EvalValueBatch ( const RowID_t * pRowIDs, int * pSelected, int iSelected, FN && fnEvalValue ) const
+	{
+		return SelectRows ( pSelected, iSelected, [&]( int iRow )
+		{
+			SphAttr_t tValue;
+			return GetValue ( pRowIDs[iRow], tValue ) && fnEvalValue(tValue);
+		} );
+	}
 };
 
 
@@ -100,6 +111,7 @@ class Filter_SingleValueColumnar_c : public ColumnarFilter_c
 public:
 	void	SetValues ( const SphAttr_t * pStorage, int iCount ) final;
 	bool	Eval ( const CSphMatch & tMatch ) const override;
+	int		EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const override;
 	bool	Test ( const columnar::MinMaxVec_t & dMinMax ) const final;
 
 protected:
@@ -125,6 +137,13 @@ bool Filter_SingleValueColumnar_c::Eval ( const CSphMatch & tMatch ) const
 }
 
 
+int Filter_SingleValueColumnar_c::EvalBatch ( CSphMatch &, const RowID_t * pRowIDs, const CSphRowitem * const *, int * pSelected, int iSelected ) const
+{
+	SphAttr_t tRefValue = m_tRefValue;
+	return EvalValueBatch ( pRowIDs, pSelected, iSelected, [tRefValue]( SphAttr_t tValue ){ return tValue==tRefValue; } );
+}
+
+
 bool Filter_SingleValueColumnar_c::Test ( const columnar::MinMaxVec_t & dMinMax ) const
 {
 	if ( m_iColumnarCol<0 )
@@ -141,6 +160,7 @@ class Filter_ValuesColumnar_c : public ColumnarFilter_c
 
 public:
 	bool		Eval ( const CSphMatch & tMatch ) const final;
+	int			EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final;
 	bool		Test ( const columnar::MinMaxVec_t & dMinMax ) const final;
 	void		SetValues ( const SphAttr_t * pValues, int iNumValues ) final;
 
@@ -172,6 +192,15 @@ bool Filter_ValuesColumnar_c::Eval ( const CSphMatch & tMatch ) const
 }
 
 
+int Filter_ValuesColumnar_c::EvalBatch ( CSphMatch &, const RowID_t * pRowIDs, const CSphRowitem * const *, int * pSelected, int iSelected ) const
+{
+	if ( m_bDegenerate )
+		return iSelected;
+
+	return EvalValueBatch ( pRowIDs, pSelected, iSelected, [this]( SphAttr_t tValue ){ return (*this.*m_fnEval)(tValue); } );
+}
+
+
 bool Filter_ValuesColumnar_c::Test ( const columnar::MinMaxVec_t & dMinMax ) const
 {
 	if ( m_iColumnarCol<0 || m_bDegenerate )
@@ -375,6 +404,7 @@ class Filter_RangeColumnar_T : public ColumnarFilter_c
 
 public:
 	bool	Eval ( const CSphMatch & tMatch ) const final;
+	int		EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final;
 	bool	Test ( const columnar::MinMaxVec_t & dMinMax ) const final;
 	void	SetRange ( SphAttr_t tMin, SphAttr_t tMax ) final;
 	void	SetRangeFloat ( float fMin, float fMax ) final;
@@ -384,6 +414,14 @@ private:
 	T m_tMaxValue;
 };
 
+template <typename T, bool HAS_EQUAL_MIN, bool HAS_EQUAL_MAX, bool OPEN_LEFT, bool OPEN_RIGHT>
+int Filter_RangeColumnar_T<T, HAS_EQUAL_MIN, HAS_EQUAL_MAX, OPEN_LEFT, OPEN_RIGHT>::EvalBatch ( CSphMatch &, const RowID_t * pRowIDs, const CSphRowitem * const *, int * pSelected, int iSelected ) const
+{
+	T tMin = m_tMinValue;
+	T tMax = m_tMaxValue;
+	return EvalValueBatch ( pRowIDs, pSelected, iSelected, [tMin, tMax]( SphAttr_t tValue ){ return EvalRange<HAS_EQUAL_MIN,HAS_EQUAL_MAX,OPEN_LEFT,OPEN_RIGHT> ( ConvertType<T>(tValue), tMin, tMax ); } );
+}
+
 template <typename T, bool HAS_EQUAL_MIN, bool HAS_EQUAL_MAX, bool OPEN_LEFT, bool OPEN_RIGHT>
 bool Filter_RangeColumnar_T<T, HAS_EQUAL_MIN, HAS_EQUAL_MAX, OPEN_LEFT, OPEN_RIGHT>::Eval ( const CSphMatch & tMatch ) const
 {
@@ -463,6 +501,11 @@ public:
 		VecTraits_T<const T> tCheck ( (const T*)tData.first, tData.second/sizeof(T) );
 		return FUNC::Eval ( tCheck, m_tRefValue );
 	}
+
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		return ISphFilter::EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+	}
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -152,12 +152,19 @@ SphOffset_t	ThinMMapReader_c::GetOffset()
 
 DWORD ThinMMapReader_c::UnzipInt()
 {
+	// fast path: far enough from the end of mapping
+	if ( m_pPointer>=m_pBase && m_pPointer+sphMaxZippedLen<DWORD>()<=m_pBase+m_iSize )
+		return sphUnzipInMemory<DWORD> ( m_pPointer );
+
 	SPH_VARINT_DECODE ( DWORD, GetByte() );
 }
 
 
 uint64_t ThinMMapReader_c::UnzipOffset()
 {
+	if ( m_pPointer>=m_pBase && m_pPointer+sphMaxZippedLen<uint64_t>()<=m_pBase+m_iSize )
+		return sphUnzipInMemory<uint64_t> ( m_pPointer );
+
 	SPH_VARINT_DECODE ( uint64_t, GetByte() );
 }
 
@@ -178,6 +185,7 @@ public:
 	DWORD		UnzipInt() final		{ return FileReader_c::UnzipInt(); }
 	uint64_t	UnzipOffset() final		{ return FileReader_c::UnzipOffset(); }
 	void		Reset() final			{ FileReader_c::Reset(); }
+	void		ReadAhead ( SphOffset_t iPos, int iSizeHint ) final { FileReader_c::ReadAhead ( iPos, iSizeHint ); }
 
 protected:
 	explicit DirectFileReader_c ( BYTE * pBuf, int iSize, const char * szFileName )
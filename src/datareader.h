@@ -31,6 +31,7 @@ public:
 	virtual RowID_t		UnzipRowid() = 0;
 	virtual SphWordID_t	UnzipWordid() = 0;
 	virtual void		Reset () = 0;
+	virtual void		ReadAhead ( SphOffset_t, int ) {} ///< hint that data at given pos will be read soon
 };
 
 
@@ -15,6 +15,9 @@
 #include "fileutils.h"
 #include "attribute.h"
 #include "indexcheck.h"
+// bundled lz4 is linked statically, so its experimental api (attaching a loaded dictionary) is safe to use
+#define LZ4_STATIC_LINKING_ONLY
+#define LZ4_HC_STATIC_LINKING_ONLY
 #include "lz4/lz4.h"
 #include "lz4/lz4hc.h"
 
@@ -43,7 +46,8 @@ enum FieldFlags_e : BYTE
 	FIELD_FLAG_EMPTY		= 1 << 1
 };
 
-static const int STORAGE_VERSION = 1;
+static const int STORAGE_VERSION = 2;	// v.2 adds compression dictionary
+static const DWORD MAX_DICT_SIZE = 65536;	// LZ4 doesn't look further back anyway
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -115,30 +119,62 @@ public:
 };
 
 
+// LZ4 compressors use an (optional) dictionary; it is a shared context for all the blocks which are compressed independently
+// the dictionary is loaded into its own stream once, and attached to the working stream for every block
+// compression reuses the streams and is not thread-safe; decompression is
 class Compressor_LZ4_c : public Compressor_i
 {
 public:
+					Compressor_LZ4_c ( const VecTraits_T<BYTE> & dDict );
+					~Compressor_LZ4_c() override;
+
 	bool			Compress ( const VecTraits_T<BYTE> & dUncompressed, CSphVector<BYTE> & dCompressed ) const override;
 	bool			Decompress ( const VecTraits_T<BYTE> & dCompressed, VecTraits_T<BYTE> & dDecompressed ) const final;
 
 protected:
+	CSphFixedVector<BYTE>	m_dDict {0};
+
 	virtual int		DoCompression ( const VecTraits_T<BYTE> & dUncompressed, CSphVector<BYTE> & dCompressed ) const;
+
+private:
+	// compression streams are only needed by writers, so they are created on first compress
+	mutable LZ4_stream_t *	m_pStream = nullptr;
+	mutable LZ4_stream_t *	m_pDictStream = nullptr;
 };
 
 
 class Compressor_LZ4HC_c : public Compressor_LZ4_c
 {
 public:
-					Compressor_LZ4HC_c ( int iCompressionLevel );
+					Compressor_LZ4HC_c ( int iCompressionLevel, const VecTraits_T<BYTE> & dDict );
+					~Compressor_LZ4HC_c() override;
 
 protected:
 	int				DoCompression ( const VecTraits_T<BYTE> & dUncompressed, CSphVector<BYTE> & dCompressed ) const final;
 
 private:
-	int				m_iCompressionLevel = DEFAULT_COMPRESSION_LEVEL;
+	int						m_iCompressionLevel = DEFAULT_COMPRESSION_LEVEL;
+	mutable LZ4_streamHC_t *	m_pStreamHC = nullptr;
+	mutable LZ4_streamHC_t *	m_pDictStreamHC = nullptr;
 };
 
 
+Compressor_LZ4_c::Compressor_LZ4_c ( const VecTraits_T<BYTE> & dDict )
+{
+	m_dDict.CopyFrom(dDict);
+}
+
+
+Compressor_LZ4_c::~Compressor_LZ4_c()
+{
+	if ( m_pStream )
+		LZ4_freeStream(m_pStream);
+
+	if ( m_pDictStream )
+		LZ4_freeStream(m_pDictStream);
+}
+
+
 bool Compressor_LZ4_c::Compress ( const VecTraits_T<BYTE> & dUncompressed, CSphVector<BYTE> & dCompressed ) const
 {
 	const int MIN_COMPRESSIBLE_SIZE = 64;
@@ -159,38 +195,171 @@ bool Compressor_LZ4_c::Compress ( const VecTraits_T<BYTE> & dUncompressed, CSphV
 
 bool Compressor_LZ4_c::Decompress ( const VecTraits_T<BYTE> & dCompressed, VecTraits_T<BYTE> & dDecompressed ) const
 {
-	int iRes = LZ4_decompress_safe ( (const char *)dCompressed.Begin(), (char *)dDecompressed.Begin(), dCompressed.GetLength(), dDecompressed.GetLength() );
+	int iRes = LZ4_decompress_safe_usingDict ( (const char *)dCompressed.Begin(), (char *)dDecompressed.Begin(), dCompressed.GetLength(), dDecompressed.GetLength(), (const char *)m_dDict.Begin(), m_dDict.GetLength() );
 	return iRes==dDecompressed.GetLength();
 }
 
 
 int	Compressor_LZ4_c::DoCompression ( const VecTraits_T<BYTE> & dUncompressed, CSphVector<BYTE> & dCompressed ) const
 {
-	return LZ4_compress_default ( (const char *)dUncompressed.Begin(), (char *)dCompressed.Begin(), dUncompressed.GetLength(), dCompressed.GetLength() );
+	if ( m_dDict.IsEmpty() )
+		return LZ4_compress_default ( (const char *)dUncompressed.Begin(), (char *)dCompressed.Begin(), dUncompressed.GetLength(), dCompressed.GetLength() );
+
+	if ( !m_pStream )
+	{
+		m_pStream = LZ4_createStream();
+		m_pDictStream = LZ4_createStream();
+		LZ4_loadDict ( m_pDictStream, (const char *)m_dDict.Begin(), m_dDict.GetLength() );
+	}
+
+	// every block starts from the dictionary alone, so that blocks can be decompressed independently
+	LZ4_resetStream_fast(m_pStream);
+	LZ4_attach_dictionary ( m_pStream, m_pDictStream );
+	return LZ4_compress_fast_continue ( m_pStream, (const char *)dUncompressed.Begin(), (char *)dCompressed.Begin(), dUncompressed.GetLength(), dCompressed.GetLength(), 1 );
 }
 
 
-Compressor_LZ4HC_c::Compressor_LZ4HC_c ( int iCompressionLevel )
-	: m_iCompressionLevel ( iCompressionLevel )
+Compressor_LZ4HC_c::Compressor_LZ4HC_c ( int iCompressionLevel, const VecTraits_T<BYTE> & dDict )
+	: Compressor_LZ4_c ( dDict )
+	, m_iCompressionLevel ( iCompressionLevel )
 {}
 
 
+Compressor_LZ4HC_c::~Compressor_LZ4HC_c()
+{
+	if ( m_pStreamHC )
+		LZ4_freeStreamHC(m_pStreamHC);
+
+	if ( m_pDictStreamHC )
+		LZ4_freeStreamHC(m_pDictStreamHC);
+}
+
+
 int	Compressor_LZ4HC_c::DoCompression ( const VecTraits_T<BYTE> & dUncompressed, CSphVector<BYTE> & dCompressed ) const
 {
-	return LZ4_compress_HC ( (const char *)dUncompressed.Begin(), (char *)dCompressed.Begin(), dUncompressed.GetLength(), dCompressed.GetLength(), m_iCompressionLevel );
+	if ( m_dDict.IsEmpty() )
+		return LZ4_compress_HC ( (const char *)dUncompressed.Begin(), (char *)dCompressed.Begin(), dUncompressed.GetLength(), dCompressed.GetLength(), m_iCompressionLevel );
+
+	if ( !m_pStreamHC )
+	{
+		m_pStreamHC = LZ4_createStreamHC();
+		m_pDictStreamHC = LZ4_createStreamHC();
+		LZ4_resetStreamHC_fast ( m_pDictStreamHC, m_iCompressionLevel );
+		LZ4_loadDictHC ( m_pDictStreamHC, (const char *)m_dDict.Begin(), m_dDict.GetLength() );
+	}
+
+	LZ4_resetStreamHC_fast ( m_pStreamHC, m_iCompressionLevel );
+	LZ4_attach_HC_dictionary ( m_pStreamHC, m_pDictStreamHC );
+	return LZ4_compress_HC_continue ( m_pStreamHC, (const char *)dUncompressed.Begin(), (char *)dCompressed.Begin(), dUncompressed.GetLength(), dCompressed.GetLength() );
 }
 
 
-Compressor_i * CreateCompressor ( Compression_e eComp, int iCompressionLevel )
+Compressor_i * CreateCompressor ( Compression_e eComp, int iCompressionLevel, const VecTraits_T<BYTE> & dDict )
 {
 	switch (  eComp )
 	{
-		case Compression_e::LZ4:	return new Compressor_LZ4_c;
-		case Compression_e::LZ4HC:	return new Compressor_LZ4HC_c ( iCompressionLevel );
+		case Compression_e::LZ4:	return new Compressor_LZ4_c ( dDict );
+		case Compression_e::LZ4HC:	return new Compressor_LZ4HC_c ( iCompressionLevel, dDict );
 		default:					return new Compressor_None_c;
 	}
 }
 
+//////////////////////////////////////////////////////////////////////////
+
+// LZ4 has no dictionary builder of its own, so this is a much simplified version of zstd's "cover" algorithm:
+// the sample is split into segments, and every segment is scored by how often its k-mers occur in the whole sample.
+// best segments are picked greedily; k-mers that are already in the dictionary don't count anymore
+static void TrainDictionary ( const VecTraits_T<BYTE> & dSample, int iMaxDictSize, CSphVector<BYTE> & dDict )
+{
+	const int KMER_LEN = sizeof(uint64_t);
+	const int SEGMENT_LEN = 64;
+
+	dDict.Resize(0);
+	int iSegments = dSample.GetLength()/SEGMENT_LEN;
+
+	// sample is too small to be worth it (the dictionary would just be a copy of it)
+	if ( (int64_t)iSegments*SEGMENT_LEN < (int64_t)iMaxDictSize*2 )
+		return;
+
+	auto fnKmer = [&dSample] ( int iOffset )
+	{
+		uint64_t uKmer;
+		memcpy ( &uKmer, dSample.Begin()+iOffset, sizeof(uKmer) );
+		return uKmer;
+	};
+
+	OpenHash_T<int, uint64_t> hKmers ( dSample.GetLength() );
+	for ( int i = 0; i <= dSample.GetLength()-KMER_LEN; i++ )
+	{
+		int * pCount = hKmers.Find ( fnKmer(i) );
+		if ( pCount )
+			(*pCount)++;
+		else
+			hKmers.Add ( fnKmer(i), 1 );
+	}
+
+	CSphVector<uint64_t> dSegmentKmers;
+	auto fnScore = [&] ( int iSegment )
+	{
+		dSegmentKmers.Resize(0);
+		for ( int i = 0; i <= SEGMENT_LEN-KMER_LEN; i++ )
+			dSegmentKmers.Add ( fnKmer ( iSegment*SEGMENT_LEN+i ) );
+
+		dSegmentKmers.Uniq();
+
+		int64_t iScore = 0;
+		for ( auto uKmer : dSegmentKmers )
+		{
+			int iCount = *hKmers.Find(uKmer);
+			if ( iCount>1 )
+				iScore += iCount;
+		}
+
+		return iScore;
+	};
+
+	using Segment_t = std::pair<int64_t,int>;
+	struct BestSegment_fn
+	{
+		static bool IsLess ( const Segment_t & tA, const Segment_t & tB ) { return tA.first > tB.first; }
+	};
+
+	CSphQueue<Segment_t, BestSegment_fn> qSegments ( iSegments );
+	for ( int i = 0; i < iSegments; i++ )
+	{
+		int64_t iScore = fnScore(i);
+		if ( iScore )
+			qSegments.Push ( { iScore, i } );
+	}
+
+	// lazy greedy: segment scores only go down as the dictionary grows
+	CSphVector<int> dPicked;
+	while ( qSegments.GetLength() && ( dPicked.GetLength()+1 )*SEGMENT_LEN<=iMaxDictSize )
+	{
+		int iSegment = qSegments.Root().second;
+		qSegments.Pop();
+
+		int64_t iScore = fnScore(iSegment);
+		if ( !iScore )
+			continue;
+
+		if ( qSegments.GetLength() && iScore < qSegments.Root().first )
+		{
+			qSegments.Push ( { iScore, iSegment } );
+			continue;
+		}
+
+		dPicked.Add(iSegment);
+		for ( int i = 0; i <= SEGMENT_LEN-KMER_LEN; i++ )
+			*hKmers.Find ( fnKmer ( iSegment*SEGMENT_LEN+i ) ) = 0;
+	}
+
+	// LZ4 only looks 64K back, so the best segments go to the end of the dictionary (closest to the data)
+	dDict.Reserve ( dPicked.GetLength()*SEGMENT_LEN );
+	for ( int i = dPicked.GetLength()-1; i>=0; i-- )
+		dDict.Append ( dSample.Slice ( dPicked[i]*SEGMENT_LEN, SEGMENT_LEN ) );
+}
+
 //////////////////////////////////////////////////////////////////////////
 class DocstoreFields_c : public DocstoreFields_i
 {
@@ -264,6 +433,9 @@ void DocstoreFields_c::Save ( CSphWriter & tWriter )
 
 //////////////////////////////////////////////////////////////////////////
 
+class BlockCacheShard_c;
+
+// block cache is split into shards (by block key hash), each one with its own lock
 class BlockCache_c
 {
 public:
@@ -282,12 +454,31 @@ public:
 	bool					Add ( DWORD uUID, SphOffset_t tOffset, BlockData_t & tData );
 	void					Release ( DWORD uUID, SphOffset_t tOffset );
 	void					DeleteAll ( DWORD uUID );
+	void					GetStats ( CSphVector<DocstoreCacheStats_t> & dStats ) const;
 
 	static void				Init ( int64_t iCacheSize );
 	static void				Done();
 	static BlockCache_c *	Get();
 
 private:
+	static const int		MAX_SHARDS = 16;
+	static const int64_t	MIN_SHARD_SIZE = 1048576;
+
+	static BlockCache_c *	m_pBlockCache;
+
+	CSphVector<BlockCacheShard_c *>	m_dShards;
+
+	BlockCacheShard_c &		GetShard ( DWORD uUID, SphOffset_t tOffset ) const;
+};
+
+// every shard is a 2Q cache. new blocks are put to a small FIFO probationary segment, and hits don't move them there,
+// so a single long scan (that also hits the same block for every document in it) only cycles that segment.
+// keys evicted from it are remembered for a while; a block that is requested again after that goes to the main LRU segment
+class BlockCacheShard_c
+{
+public:
+	using BlockData_t = BlockCache_c::BlockData_t;
+
 	struct HashKey_t
 	{
 		DWORD		m_uUID;
@@ -297,112 +488,146 @@ private:
 		static DWORD Hash ( const HashKey_t & tKey );
 	};
 
+							BlockCacheShard_c ( int64_t iCacheSize, int64_t iMaxBlockSize );
+							~BlockCacheShard_c();
+
+	bool					Find ( const HashKey_t & tKey, BlockData_t & tData );
+	bool					Add ( const HashKey_t & tKey, BlockData_t & tData );
+	void					Release ( const HashKey_t & tKey );
+	void					DeleteAll ( DWORD uUID );
+	DocstoreCacheStats_t	GetStats() const;
+
+private:
+	enum
+	{
+		PROBATION = 0,
+		MAIN,
+		TOTAL_SEGMENTS
+	};
+
 	struct LinkedBlock_t : BlockData_t
 	{
 		int				m_iRefcount = 0;
+		int				m_iSegment = PROBATION;
 		LinkedBlock_t *	m_pPrev = nullptr;
 		LinkedBlock_t *	m_pNext = nullptr;
 		HashKey_t		m_tKey;
 	};
 
-	static BlockCache_c *	m_pBlockCache;
+	struct Segment_t
+	{
+		LinkedBlock_t *	m_pHead = nullptr;
+		LinkedBlock_t *	m_pTail = nullptr;
+		int64_t			m_iMemUsed = 0;
+	};
 
-	LinkedBlock_t *			m_pHead = nullptr;
-	LinkedBlock_t *			m_pTail = nullptr;
-	int64_t					m_iCacheSize = 0;
-	int64_t					m_iMemUsed = 0;
-	CSphMutex				m_tLock;
-	CSphOrderedHash<LinkedBlock_t *, HashKey_t, HashKey_t, 32768> m_tHash;
+	static const int		PROBATION_PERCENT = 25;
+	static const int		GHOST_BLOCK_SIZE = 16384;	// to size the list of evicted keys
 
-	void					MoveToHead ( LinkedBlock_t * pBlock );
-	void					Add ( LinkedBlock_t * pBlock );
+	Segment_t				m_dSegments[TOTAL_SEGMENTS];
+	int64_t					m_iCacheSize = 0;
+	int64_t					m_iProbationSize = 0;
+	int64_t					m_iMaxBlockSize = 0;
+	mutable CSphMutex		m_tLock;
+	CSphOrderedHash<LinkedBlock_t *, HashKey_t, HashKey_t, 4096> m_tHash;
+
+	// keys recently evicted from the probationary segment
+	CSphFixedVector<uint64_t>	m_dGhosts {0};
+	CSphOrderedHash<int, uint64_t, IdentityHash_fn, 4096> m_hGhosts;	///< occurrences of every key in the ring
+	int						m_iGhost = 0;
+
+	int64_t					m_iHits = 0;
+	int64_t					m_iMisses = 0;
+	int64_t					m_iEvictions = 0;
+
+	void					Link ( LinkedBlock_t * pBlock, int iSegment );
+	void					Unlink ( LinkedBlock_t * pBlock );
 	void					Delete ( LinkedBlock_t * pBlock );
-	void					SweepUnused ( DWORD uSpaceNeeded );
-	bool					HaveSpaceFor ( DWORD uSpaceNeeded ) const;
+	void					SweepUnused ( int64_t iSpaceNeeded );
+	void					SweepSegment ( int iSegment, int64_t iSpaceNeeded );
+	bool					HaveSpaceFor ( int64_t iSpaceNeeded ) const;
+	int64_t					GetMemUsed() const;
+
+	void					AddGhost ( const HashKey_t & tKey );
+	bool					IsGhost ( const HashKey_t & tKey ) const;
+	static uint64_t			GhostKey ( const HashKey_t & tKey );
+	static int64_t			GetBlockSize ( const LinkedBlock_t * pBlock );
 };
 
-BlockCache_c * BlockCache_c::m_pBlockCache = nullptr;
-
 
-bool BlockCache_c::HashKey_t::operator == ( const HashKey_t & tKey ) const
+bool BlockCacheShard_c::HashKey_t::operator == ( const HashKey_t & tKey ) const
 {
 	return m_uUID==tKey.m_uUID && m_tOffset==tKey.m_tOffset;
 }
 
 
-DWORD BlockCache_c::HashKey_t::Hash ( const HashKey_t & tKey )
+DWORD BlockCacheShard_c::HashKey_t::Hash ( const HashKey_t & tKey )
 {
 	DWORD uCRC32 = sphCRC32 ( &tKey.m_uUID, sizeof(tKey.m_uUID) );
 	return sphCRC32 ( &tKey.m_tOffset, sizeof(tKey.m_tOffset), uCRC32 );
 }
 
 
-BlockCache_c::BlockCache_c ( int64_t iCacheSize )
+BlockCacheShard_c::BlockCacheShard_c ( int64_t iCacheSize, int64_t iMaxBlockSize )
 	: m_iCacheSize ( iCacheSize )
-{}
-
-
-BlockCache_c::~BlockCache_c()
+	, m_iProbationSize ( iCacheSize*PROBATION_PERCENT/100 )
+	, m_iMaxBlockSize ( iMaxBlockSize )
 {
-	LinkedBlock_t * pBlock = m_pHead;
-	while ( pBlock )
-	{
-		LinkedBlock_t * pToDelete = pBlock;
-		pBlock = pBlock->m_pNext;
-		Delete(pToDelete);
-	}
+	m_dGhosts.Reset ( Max ( iCacheSize/GHOST_BLOCK_SIZE, 64 ) );
+	for ( auto & i : m_dGhosts )
+		i = 0;
 }
 
 
-void BlockCache_c::MoveToHead ( LinkedBlock_t * pBlock )
+BlockCacheShard_c::~BlockCacheShard_c()
 {
-	assert ( pBlock );
-
-	if ( pBlock==m_pHead )
-		return;
+	for ( auto & tSegment : m_dSegments )
+		while ( tSegment.m_pHead )
+			Delete ( tSegment.m_pHead );
+}
 
-	if ( m_pTail==pBlock )
-		m_pTail = pBlock->m_pPrev;
 
-	if ( pBlock->m_pPrev )
-		pBlock->m_pPrev->m_pNext = pBlock->m_pNext;
+uint64_t BlockCacheShard_c::GhostKey ( const HashKey_t & tKey )
+{
+	// 0 marks an empty slot
+	uint64_t uKey = sphFNV64 ( &tKey.m_tOffset, sizeof(tKey.m_tOffset), sphFNV64 ( &tKey.m_uUID, sizeof(tKey.m_uUID) ) );
+	return uKey ? uKey : 1;
+}
 
-	if ( pBlock->m_pNext )
-		pBlock->m_pNext->m_pPrev = pBlock->m_pPrev;
 
-	pBlock->m_pPrev = nullptr;
-	pBlock->m_pNext = m_pHead;
-	m_pHead->m_pPrev = pBlock;
-	m_pHead = pBlock;
+int64_t BlockCacheShard_c::GetBlockSize ( const LinkedBlock_t * pBlock )
+{
+	return pBlock->m_uSize + sizeof(LinkedBlock_t);
 }
 
 
-void BlockCache_c::Add ( LinkedBlock_t * pBlock )
+void BlockCacheShard_c::Link ( LinkedBlock_t * pBlock, int iSegment )
 {
-	pBlock->m_pNext = m_pHead;
-	if ( m_pHead )
-		m_pHead->m_pPrev = pBlock;
-
-	if ( !m_pTail )
-		m_pTail = pBlock;
+	Segment_t & tSegment = m_dSegments[iSegment];
 
-	m_pHead = pBlock;
+	pBlock->m_iSegment = iSegment;
+	pBlock->m_pPrev = nullptr;
+	pBlock->m_pNext = tSegment.m_pHead;
+	if ( tSegment.m_pHead )
+		tSegment.m_pHead->m_pPrev = pBlock;
 
-	Verify ( m_tHash.Add ( pBlock, pBlock->m_tKey ) );
+	if ( !tSegment.m_pTail )
+		tSegment.m_pTail = pBlock;
 
-	m_iMemUsed += pBlock->m_uSize + sizeof(LinkedBlock_t);
+	tSegment.m_pHead = pBlock;
+	tSegment.m_iMemUsed += GetBlockSize(pBlock);
 }
 
 
-void BlockCache_c::Delete ( LinkedBlock_t * pBlock )
+void BlockCacheShard_c::Unlink ( LinkedBlock_t * pBlock )
 {
-	Verify ( m_tHash.Delete ( pBlock->m_tKey ) );
+	Segment_t & tSegment = m_dSegments[pBlock->m_iSegment];
 
-	if ( m_pHead == pBlock )
-		m_pHead = pBlock->m_pNext;
+	if ( tSegment.m_pHead==pBlock )
+		tSegment.m_pHead = pBlock->m_pNext;
 
-	if ( m_pTail==pBlock )
-		m_pTail = pBlock->m_pPrev;
+	if ( tSegment.m_pTail==pBlock )
+		tSegment.m_pTail = pBlock->m_pPrev;
 
 	if ( pBlock->m_pPrev )
 		pBlock->m_pPrev->m_pNext = pBlock->m_pNext;
@@ -410,35 +635,54 @@ void BlockCache_c::Delete ( LinkedBlock_t * pBlock )
 	if ( pBlock->m_pNext )
 		pBlock->m_pNext->m_pPrev = pBlock->m_pPrev;
 
-	m_iMemUsed -= pBlock->m_uSize + sizeof(LinkedBlock_t);
-	assert ( m_iMemUsed>=0 );
+	pBlock->m_pPrev = pBlock->m_pNext = nullptr;
+	tSegment.m_iMemUsed -= GetBlockSize(pBlock);
+	assert ( tSegment.m_iMemUsed>=0 );
+}
+
+
+void BlockCacheShard_c::Delete ( LinkedBlock_t * pBlock )
+{
+	Verify ( m_tHash.Delete ( pBlock->m_tKey ) );
+	Unlink(pBlock);
 
 	SafeDeleteArray ( pBlock->m_pData );
 	SafeDelete(pBlock);
 }
 
 
-bool BlockCache_c::Find ( DWORD uUID, SphOffset_t tOffset, BlockData_t & tData )
+bool BlockCacheShard_c::Find ( const HashKey_t & tKey, BlockData_t & tData )
 {
 	ScopedMutex_t tLock(m_tLock);
 
-	LinkedBlock_t ** ppBlock = m_tHash ( { uUID, tOffset } );
+	LinkedBlock_t ** ppBlock = m_tHash(tKey);
 	if ( !ppBlock )
+	{
+		m_iMisses++;
 		return false;
+	}
 
-	MoveToHead ( *ppBlock );
-	
-	(*ppBlock)->m_iRefcount++;
-	tData = *(BlockData_t*)(*ppBlock);
+	m_iHits++;
+
+	// probationary segment is a FIFO; only the main one is reordered on hits
+	LinkedBlock_t * pBlock = *ppBlock;
+	if ( pBlock->m_iSegment==MAIN && pBlock!=m_dSegments[MAIN].m_pHead )
+	{
+		Unlink(pBlock);
+		Link ( pBlock, MAIN );
+	}
+
+	pBlock->m_iRefcount++;
+	tData = *(BlockData_t*)pBlock;
 	return true;
 }
 
 
-void BlockCache_c::Release ( DWORD uUID, SphOffset_t tOffset )
+void BlockCacheShard_c::Release ( const HashKey_t & tKey )
 {
 	ScopedMutex_t tLock(m_tLock);
 
-	LinkedBlock_t ** ppBlock = m_tHash ( { uUID, tOffset } );
+	LinkedBlock_t ** ppBlock = m_tHash(tKey);
 	assert(ppBlock);
 
 	LinkedBlock_t * pBlock = *ppBlock;
@@ -447,79 +691,205 @@ void BlockCache_c::Release ( DWORD uUID, SphOffset_t tOffset )
 }
 
 
-void BlockCache_c::DeleteAll ( DWORD uUID )
+void BlockCacheShard_c::DeleteAll ( DWORD uUID )
 {
 	ScopedMutex_t tLock(m_tLock);
 
-	LinkedBlock_t * pBlock = m_pHead;
-	while ( pBlock )
+	for ( auto & tSegment : m_dSegments )
 	{
-		if ( pBlock->m_tKey.m_uUID==uUID )
+		LinkedBlock_t * pBlock = tSegment.m_pHead;
+		while ( pBlock )
 		{
-			assert ( !pBlock->m_iRefcount );
-			LinkedBlock_t * pToDelete = pBlock;
-			pBlock = pBlock->m_pNext;
-			Delete(pToDelete);
+			LinkedBlock_t * pNext = pBlock->m_pNext;
+			if ( pBlock->m_tKey.m_uUID==uUID )
+			{
+				assert ( !pBlock->m_iRefcount );
+				Delete(pBlock);
+			}
+
+			pBlock = pNext;
 		}
-		else
-			pBlock = pBlock->m_pNext;
 	}
 }
 
 
-bool BlockCache_c::Add ( DWORD uUID, SphOffset_t tOffset, BlockData_t & tData )
+bool BlockCacheShard_c::Add ( const HashKey_t & tKey, BlockData_t & tData )
 {
 	ScopedMutex_t tLock(m_tLock);
 
 	// if another thread managed to add a similar block while we were uncompressing ours, let it be
-	LinkedBlock_t ** ppBlock = m_tHash ( { uUID, tOffset } );
-	if ( ppBlock )
+	if ( m_tHash(tKey) )
 		return false;
 
-	DWORD uSpaceNeeded = tData.m_uSize + sizeof(LinkedBlock_t);
-	if ( !HaveSpaceFor ( uSpaceNeeded ) )
+	int64_t iSpaceNeeded = tData.m_uSize + sizeof(LinkedBlock_t);
+	if ( !HaveSpaceFor(iSpaceNeeded) )
 	{
-		DWORD MAX_BLOCK_SIZE = m_iCacheSize/64;
-		if ( uSpaceNeeded>MAX_BLOCK_SIZE )
+		if ( iSpaceNeeded>m_iMaxBlockSize )
 			return false;
 
-		SweepUnused ( uSpaceNeeded );
-		if ( !HaveSpaceFor ( uSpaceNeeded ) )
+		SweepUnused(iSpaceNeeded);
+		if ( !HaveSpaceFor(iSpaceNeeded) )
 			return false;
 	}
 
-	LinkedBlock_t * pBlock = new LinkedBlock_t;
+	auto * pBlock = new LinkedBlock_t;
 	*(BlockData_t*)pBlock = tData;
 	pBlock->m_iRefcount++;
-	pBlock->m_tKey = { uUID, tOffset };
+	pBlock->m_tKey = tKey;
 
-	Add ( pBlock );
+	Verify ( m_tHash.Add ( pBlock, tKey ) );
+	Link ( pBlock, IsGhost(tKey) ? MAIN : PROBATION );
 	return true;
 }
 
 
-void BlockCache_c::SweepUnused ( DWORD uSpaceNeeded )
+void BlockCacheShard_c::SweepUnused ( int64_t iSpaceNeeded )
 {
-	// least recently used blocks are the tail
-	LinkedBlock_t * pBlock = m_pTail;
-	while ( pBlock && !HaveSpaceFor ( uSpaceNeeded ) )
+	// probationary blocks go first while they take more than their share
+	bool bProbationFirst = m_dSegments[PROBATION].m_iMemUsed > m_iProbationSize;
+	SweepSegment ( bProbationFirst ? PROBATION : MAIN, iSpaceNeeded );
+	SweepSegment ( bProbationFirst ? MAIN : PROBATION, iSpaceNeeded );
+}
+
+
+void BlockCacheShard_c::SweepSegment ( int iSegment, int64_t iSpaceNeeded )
+{
+	// oldest (or least recently used) blocks are the tail
+	LinkedBlock_t * pBlock = m_dSegments[iSegment].m_pTail;
+	while ( pBlock && !HaveSpaceFor(iSpaceNeeded) )
 	{
+		LinkedBlock_t * pPrev = pBlock->m_pPrev;
 		if ( !pBlock->m_iRefcount )
 		{
-			assert ( !pBlock->m_iRefcount );
-			LinkedBlock_t * pToDelete = pBlock;
-			pBlock = pBlock->m_pPrev;
-			Delete(pToDelete);
+			if ( iSegment==PROBATION )
+				AddGhost ( pBlock->m_tKey );
+
+			Delete(pBlock);
+			m_iEvictions++;
 		}
-		else
-			pBlock = pBlock->m_pPrev;
+
+		pBlock = pPrev;
 	}
 }
 
 
-bool BlockCache_c::HaveSpaceFor ( DWORD uSpaceNeeded ) const
+bool BlockCacheShard_c::HaveSpaceFor ( int64_t iSpaceNeeded ) const
+{
+	return GetMemUsed()+iSpaceNeeded <= m_iCacheSize;
+}
+
+
+int64_t BlockCacheShard_c::GetMemUsed() const
+{
+	return m_dSegments[PROBATION].m_iMemUsed + m_dSegments[MAIN].m_iMemUsed;
+}
+
+
+void BlockCacheShard_c::AddGhost ( const HashKey_t & tKey )
+{
+	// ring of evicted keys; the hash counts the occurrences of every key in it
+	uint64_t & uOldest = m_dGhosts[m_iGhost];
+	if ( uOldest )
+	{
+		int * pCount = m_hGhosts(uOldest);
+		assert ( pCount && *pCount>0 );
+		if ( !--(*pCount) )
+			Verify ( m_hGhosts.Delete(uOldest) );
+	}
+
+	uOldest = GhostKey(tKey);
+	int * pCount = m_hGhosts(uOldest);
+	if ( pCount )
+		(*pCount)++;
+	else
+		m_hGhosts.Add ( 1, uOldest );
+	m_iGhost = ( m_iGhost+1 ) % m_dGhosts.GetLength();
+}
+
+
+bool BlockCacheShard_c::IsGhost ( const HashKey_t & tKey ) const
+{
+	return m_hGhosts.Exists ( GhostKey(tKey) );
+}
+
+
+DocstoreCacheStats_t BlockCacheShard_c::GetStats() const
+{
+	ScopedMutex_t tLock(m_tLock);
+
+	DocstoreCacheStats_t tStats;
+	tStats.m_iMaxBytes = m_iCacheSize;
+	tStats.m_iUsedBytes = GetMemUsed();
+	tStats.m_iHits = m_iHits;
+	tStats.m_iMisses = m_iMisses;
+	tStats.m_iEvictions = m_iEvictions;
+	return tStats;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BlockCache_c * BlockCache_c::m_pBlockCache = nullptr;
+
+
+BlockCache_c::BlockCache_c ( int64_t iCacheSize )
+{
+	int iShards = MAX_SHARDS;
+	while ( iShards>1 && iCacheSize/iShards < MIN_SHARD_SIZE )
+		iShards >>= 1;
+
+	int64_t iShardSize = iCacheSize/iShards;
+	int64_t iMaxBlockSize = Min ( iCacheSize/64, iShardSize/4 );
+
+	m_dShards.Resize(iShards);
+	for ( auto & pShard : m_dShards )
+		pShard = new BlockCacheShard_c ( iShardSize, iMaxBlockSize );
+}
+
+
+BlockCache_c::~BlockCache_c()
+{
+	for ( auto & pShard : m_dShards )
+		SafeDelete(pShard);
+}
+
+
+BlockCacheShard_c & BlockCache_c::GetShard ( DWORD uUID, SphOffset_t tOffset ) const
+{
+	// low bits of the hash are used by the shard's own hash table
+	DWORD uHash = BlockCacheShard_c::HashKey_t::Hash ( { uUID, tOffset } );
+	return *m_dShards[( uHash>>16 ) % m_dShards.GetLength()];
+}
+
+
+bool BlockCache_c::Find ( DWORD uUID, SphOffset_t tOffset, BlockData_t & tData )
+{
+	return GetShard ( uUID, tOffset ).Find ( { uUID, tOffset }, tData );
+}
+
+
+void BlockCache_c::Release ( DWORD uUID, SphOffset_t tOffset )
+{
+	GetShard ( uUID, tOffset ).Release ( { uUID, tOffset } );
+}
+
+
+void BlockCache_c::DeleteAll ( DWORD uUID )
+{
+	for ( auto & pShard : m_dShards )
+		pShard->DeleteAll(uUID);
+}
+
+
+bool BlockCache_c::Add ( DWORD uUID, SphOffset_t tOffset, BlockData_t & tData )
+{
+	return GetShard ( uUID, tOffset ).Add ( { uUID, tOffset }, tData );
+}
+
+
+void BlockCache_c::GetStats ( CSphVector<DocstoreCacheStats_t> & dStats ) const
 {
-	return m_iMemUsed+uSpaceNeeded <= m_iCacheSize;
+	for ( const auto & pShard : m_dShards )
+		dStats.Add ( pShard->GetStats() );
 }
 
 
@@ -727,6 +1097,7 @@ public:
 	int					GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const final;
 	void				CreateReader ( int64_t iSessionId ) const final;
 	DocstoreDoc_t		GetDoc ( RowID_t tRowID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const final;
+	void				GetDocs ( const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const final;
 	DocstoreSettings_t	GetDocstoreSettings() const final;
 
 private:
@@ -760,7 +1131,10 @@ private:
 	void						ReadFromFile ( BYTE * pData, int iLength, SphOffset_t tOffset, int64_t iSessionId ) const;
 	DocstoreDoc_t				ReadDocFromSmallBlock ( const Block_t & tBlock, RowID_t tRowID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const;
 	DocstoreDoc_t				ReadDocFromBigBlock ( const Block_t & tBlock, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const;
+	void						ReadDocsFromSmallBlock ( const Block_t & tBlock, const BlockCache_c::BlockData_t & tBlockData, bool bFromCache, const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> & dRows,
+		const VecTraits_T<int> * pFieldIds, const CSphFixedVector<int> & dFieldInRset, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const;
 	BlockCache_c::BlockData_t	UncompressSmallBlock ( const Block_t & tBlock, int64_t iSessionId ) const;
+	BlockCache_c::BlockData_t	UncompressSmallBlock ( const VecTraits_T<BYTE> & dBlock ) const;
 	BlockCache_c::BlockData_t	UncompressBigBlockField ( SphOffset_t tOffset, const FieldInfo_t & tInfo, int64_t iSessionId ) const;
 
 	bool						ProcessSmallBlockDoc ( RowID_t tCurDocRowID, RowID_t tRowID, const VecTraits_T<int> * pFieldIds, const CSphFixedVector<int> & dFieldInRset, bool bPack,
@@ -807,7 +1181,21 @@ bool Docstore_c::Init ( CSphString & sError )
 	m_uBlockSize = tReader.GetDword();
 	m_eCompression = Byte2Compression ( tReader.GetByte() );
 
-	m_pCompressor = CreateCompressor ( m_eCompression, m_iCompressionLevel );
+	CSphFixedVector<BYTE> dDict {0};
+	if ( uStorageVersion>=2 )
+	{
+		DWORD uDictSize = tReader.GetDword();
+		if ( uDictSize > MAX_DICT_SIZE )
+		{
+			sError.SetSprintf ( "Unable to load docstore: compression dictionary is too big (%u) in %s", uDictSize, m_sFilename.cstr() );
+			return false;
+		}
+
+		dDict.Reset(uDictSize);
+		tReader.GetBytes ( dDict.Begin(), dDict.GetLength() );
+	}
+
+	m_pCompressor = CreateCompressor ( m_eCompression, m_iCompressionLevel, dDict );
 	if ( !m_pCompressor )
 		return false;
 
@@ -938,11 +1326,15 @@ void Docstore_c::ReadFromFile ( BYTE * pData, int iLength, SphOffset_t tOffset,
 
 BlockCache_c::BlockData_t Docstore_c::UncompressSmallBlock ( const Block_t & tBlock, int64_t iSessionId ) const
 {
-	BlockCache_c::BlockData_t tResult;
 	CSphFixedVector<BYTE> dBlock ( tBlock.m_uSize );
-
 	ReadFromFile ( dBlock.Begin(), dBlock.GetLength(), tBlock.m_tOffset, iSessionId );
+	return UncompressSmallBlock ( dBlock );
+}
 
+
+BlockCache_c::BlockData_t Docstore_c::UncompressSmallBlock ( const VecTraits_T<BYTE> & dBlock ) const
+{
+	BlockCache_c::BlockData_t tResult;
 	MemoryReader2_c tBlockReader ( dBlock.Begin(), dBlock.GetLength() );
 	tResult.m_uFlags = tBlockReader.GetByte();
 	tResult.m_uNumDocs = tBlockReader.UnzipInt();
@@ -1012,18 +1404,10 @@ bool Docstore_c::ProcessSmallBlockDoc ( RowID_t tCurDocRowID, RowID_t tRowID, co
 }
 
 
-DocstoreDoc_t Docstore_c::ReadDocFromSmallBlock ( const Block_t & tBlock, RowID_t tRowID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const
+// dRows are indexes into dRowIDs/dDocs, sorted by rowid; all of them belong to this block
+void Docstore_c::ReadDocsFromSmallBlock ( const Block_t & tBlock, const BlockCache_c::BlockData_t & tBlockData, bool bFromCache, const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> & dRows,
+	const VecTraits_T<int> * pFieldIds, const CSphFixedVector<int> & dFieldInRset, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const
 {
-	BlockCache_c * pBlockCache = BlockCache_c::Get();
-
-	BlockCache_c::BlockData_t tBlockData;
-	bool bFromCache = pBlockCache && pBlockCache->Find ( m_uUID, tBlock.m_tOffset, tBlockData );
-	if ( !bFromCache )
-	{
-		tBlockData = UncompressSmallBlock ( tBlock, iSessionId );
-		bFromCache = pBlockCache && pBlockCache->Add ( m_uUID, tBlock.m_tOffset, tBlockData );
-	}
-
 	ScopedBlock_t tScopedBlock;
 	CSphFixedVector<BYTE> tDataPtr {0};	// scoped array ptr
 	if ( bFromCache )
@@ -1034,21 +1418,42 @@ DocstoreDoc_t Docstore_c::ReadDocFromSmallBlock ( const Block_t & tBlock, RowID_
 	else
 		tDataPtr.Set ( tBlockData.m_pData, 0 );
 
-	CSphFixedVector<int> dFieldInRset (	m_tFields.GetNumFields() );
-	CreateFieldRemap ( dFieldInRset, pFieldIds );
-
-	DocstoreDoc_t tResult;
-
 	RowID_t tCurDocRowID = tBlock.m_tRowID;
 	MemoryReader2_c tReader ( tBlockData.m_pData, tBlockData.m_uSize );
 	CSphBitvec tEmptyFields ( m_tFields.GetNumFields() );
-	for ( int i = 0; i < (int)tBlockData.m_uNumDocs; i++ )
+	int iRow = 0;
+	for ( int i = 0; i < (int)tBlockData.m_uNumDocs && iRow<dRows.GetLength(); i++, tCurDocRowID++ )
 	{
-		if ( ProcessSmallBlockDoc ( tCurDocRowID, tRowID, pFieldIds, dFieldInRset, bPack, tReader, tEmptyFields, tResult ) )
-			break;
+		int iDoc = dRows[iRow];
+		if ( !ProcessSmallBlockDoc ( tCurDocRowID, dRowIDs[iDoc], pFieldIds, dFieldInRset, bPack, tReader, tEmptyFields, dDocs[iDoc] ) )
+			continue;
 
-		tCurDocRowID++;
+		// same row might be requested more than once
+		for ( iRow++; iRow<dRows.GetLength() && dRowIDs[dRows[iRow]]==tCurDocRowID; iRow++ )
+			dDocs[dRows[iRow]] = dDocs[iDoc];
 	}
+}
+
+
+DocstoreDoc_t Docstore_c::ReadDocFromSmallBlock ( const Block_t & tBlock, RowID_t tRowID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const
+{
+	BlockCache_c * pBlockCache = BlockCache_c::Get();
+
+	BlockCache_c::BlockData_t tBlockData;
+	bool bFromCache = pBlockCache && pBlockCache->Find ( m_uUID, tBlock.m_tOffset, tBlockData );
+	if ( !bFromCache )
+	{
+		tBlockData = UncompressSmallBlock ( tBlock, iSessionId );
+		bFromCache = pBlockCache && pBlockCache->Add ( m_uUID, tBlock.m_tOffset, tBlockData );
+	}
+
+	CSphFixedVector<int> dFieldInRset (	m_tFields.GetNumFields() );
+	CreateFieldRemap ( dFieldInRset, pFieldIds );
+
+	DocstoreDoc_t tResult;
+	int iRow = 0;
+	VecTraits_T<DocstoreDoc_t> dResult ( &tResult, 1 );
+	ReadDocsFromSmallBlock ( tBlock, tBlockData, bFromCache, VecTraits_T<RowID_t> ( &tRowID, 1 ), VecTraits_T<int> ( &iRow, 1 ), pFieldIds, dFieldInRset, bPack, dResult );
 
 	return tResult;
 }
@@ -1173,6 +1578,94 @@ DocstoreDoc_t Docstore_c::ReadDocFromBigBlock ( const Block_t & tBlock, const Ve
 }
 
 
+void Docstore_c::GetDocs ( const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const
+{
+	assert ( dRowIDs.GetLength()==dDocs.GetLength() );
+	for ( auto & i : dDocs )
+		i.m_dFields.Reset();
+
+	if ( dRowIDs.IsEmpty() )
+		return;
+
+	// process rows in storage order, so that every block is looked up, read and uncompressed only once
+	CSphFixedVector<int> dOrder ( dRowIDs.GetLength() );
+	ARRAY_FOREACH ( i, dOrder )
+		dOrder[i] = i;
+
+	dOrder.Sort ( Lesser ( [&dRowIDs] ( int a, int b ) { return dRowIDs[a]<dRowIDs[b]; } ) );
+
+	// distinct blocks and the first row (in dOrder) that each of them holds
+	CSphVector<const Block_t *> dBlocks;
+	CSphVector<int> dBlockRows;
+	ARRAY_FOREACH ( i, dOrder )
+	{
+		const Block_t * pBlock = FindBlock ( dRowIDs[dOrder[i]] );
+		assert ( pBlock );
+		if ( dBlocks.IsEmpty() || dBlocks.Last()!=pBlock )
+		{
+			dBlocks.Add ( pBlock );
+			dBlockRows.Add(i);
+		}
+	}
+	dBlockRows.Add ( dOrder.GetLength() );
+
+	CSphFixedVector<int> dFieldInRset ( m_tFields.GetNumFields() );
+	CreateFieldRemap ( dFieldInRset, pFieldIds );
+
+	// pin the blocks that are already cached, so that only the missing ones get read
+	BlockCache_c * pBlockCache = BlockCache_c::Get();
+	CSphFixedVector<BlockCache_c::BlockData_t> dCachedData ( dBlocks.GetLength() );
+	CSphFixedVector<bool> dCached ( dBlocks.GetLength() );
+	ARRAY_FOREACH ( i, dBlocks )
+		dCached[i] = dBlocks[i]->m_eType==BLOCK_TYPE_SMALL && pBlockCache && pBlockCache->Find ( m_uUID, dBlocks[i]->m_tOffset, dCachedData[i] );
+
+	// reads of missing blocks that are adjacent in the file are glued up to this size
+	const int64_t MAX_GLUED_READ = 1048576;
+	CSphFixedVector<BYTE> dRead {0};
+
+	int iBlock = 0;
+	while ( iBlock<dBlocks.GetLength() )
+	{
+		const Block_t & tBlock = *dBlocks[iBlock];
+		auto fnRows = [&dOrder, &dBlockRows] ( int iBlock ) { return dOrder.Slice ( dBlockRows[iBlock], dBlockRows[iBlock+1]-dBlockRows[iBlock] ); };
+
+		if ( tBlock.m_eType==BLOCK_TYPE_BIG )
+		{
+			// a big block holds a single document, its fields are cached separately
+			DocstoreDoc_t tDoc = ReadDocFromBigBlock ( tBlock, pFieldIds, iSessionId, bPack );
+			for ( int iDoc : fnRows(iBlock) )
+				dDocs[iDoc] = tDoc;
+
+			iBlock++;
+			continue;
+		}
+
+		if ( dCached[iBlock] )
+		{
+			ReadDocsFromSmallBlock ( tBlock, dCachedData[iBlock], true, dRowIDs, fnRows(iBlock), pFieldIds, dFieldInRset, bPack, dDocs );
+			iBlock++;
+			continue;
+		}
+
+		int iGlued = iBlock+1;
+		int64_t iReadSize = tBlock.m_uSize;
+		while ( iGlued<dBlocks.GetLength() && dBlocks[iGlued]==dBlocks[iGlued-1]+1 && dBlocks[iGlued]->m_eType==BLOCK_TYPE_SMALL && !dCached[iGlued] && iReadSize+dBlocks[iGlued]->m_uSize<=MAX_GLUED_READ )
+			iReadSize += dBlocks[iGlued++]->m_uSize;
+
+		dRead.Reset ( iReadSize );
+		ReadFromFile ( dRead.Begin(), dRead.GetLength(), tBlock.m_tOffset, iSessionId );
+
+		for ( ; iBlock<iGlued; iBlock++ )
+		{
+			const Block_t & tReadBlock = *dBlocks[iBlock];
+			BlockCache_c::BlockData_t tBlockData = UncompressSmallBlock ( dRead.Slice ( tReadBlock.m_tOffset-tBlock.m_tOffset, tReadBlock.m_uSize ) );
+			bool bFromCache = pBlockCache && pBlockCache->Add ( m_uUID, tReadBlock.m_tOffset, tBlockData );
+			ReadDocsFromSmallBlock ( tReadBlock, tBlockData, bFromCache, dRowIDs, fnRows(iBlock), pFieldIds, dFieldInRset, bPack, dDocs );
+		}
+	}
+}
+
+
 DocstoreSettings_t Docstore_c::GetDocstoreSettings() const
 {
 	return *this;
@@ -1209,8 +1702,15 @@ private:
 		CSphVector<CSphVector<BYTE>>	m_dFields;
 	};
 
+	static const int		DICT_SIZE = 32768;
+	static const int		DICT_SAMPLE_SIZE = 1048576;
+
 	CSphString				m_sFilename;
 	CSphVector<StoredDoc_t>	m_dStoredDocs;
+	CSphVector<StoredDoc_t>	m_dSampleDocs;		// first documents; they are held until the dictionary is trained on them
+	int						m_iSampleSize = 0;
+	bool					m_bHaveDict = false;
+	CSphVector<BYTE>		m_dDict;
 	CSphVector<BYTE>		m_dHeader;
 	CSphVector<BYTE>		m_dBuffer;
 	CSphScopedPtr<Compressor_i> m_pCompressor{nullptr};
@@ -1227,6 +1727,8 @@ private:
 	CSphVector<SortedField_t>		m_dFieldSort;
 	CSphVector<CSphVector<BYTE>>	m_dCompressedBuffers;
 
+	void	AddStoredDoc ( StoredDoc_t && tDoc );
+	void	BuildDictionary();
 	void	WriteInitialHeader();
 	void	WriteTrailingHeader();
 	void	WriteBlock();
@@ -1247,9 +1749,10 @@ DocstoreBuilder_c::DocstoreBuilder_c ( const CSphString & sFilename, const Docst
 
 bool DocstoreBuilder_c::Init ( CSphString & sError )
 {
-	m_pCompressor = CreateCompressor ( m_eCompression, m_iCompressionLevel );
-	if ( !m_pCompressor )
-		return false;
+	// compressor is created when the dictionary is ready
+	m_bHaveDict = m_eCompression==Compression_e::NONE;
+	if ( m_bHaveDict )
+		m_pCompressor = CreateCompressor ( m_eCompression, m_iCompressionLevel, m_dDict );
 
 	if ( !m_tWriter.OpenFile ( m_sFilename, sError ) )
 		return false;
@@ -1262,14 +1765,7 @@ void DocstoreBuilder_c::AddDoc ( RowID_t tRowID, const Doc_t & tDoc )
 {
 	assert ( tDoc.m_dFields.GetLength()==m_tFields.GetNumFields() );
 
-	DWORD uLen = 0;
-	for ( const auto & i : tDoc.m_dFields )
-		uLen += i.GetLength();
-
-	if ( m_uStoredLen+uLen > m_uBlockSize )
-		WriteBlock();
-
-	StoredDoc_t & tStoredDoc = m_dStoredDocs.Add();
+	StoredDoc_t tStoredDoc;
 	tStoredDoc.m_tRowID = tRowID;
 	tStoredDoc.m_dFields.Resize ( m_tFields.GetNumFields() );
 	for ( int i = 0; i<m_tFields.GetNumFields(); i++ )
@@ -1284,10 +1780,60 @@ void DocstoreBuilder_c::AddDoc ( RowID_t tRowID, const Doc_t & tDoc )
 		memcpy ( tStoredDoc.m_dFields[i].Begin(), tDoc.m_dFields[i].Begin(), iLen );
 	}
 
+	if ( m_bHaveDict )
+	{
+		AddStoredDoc ( std::move(tStoredDoc) );
+		return;
+	}
+
+	for ( const auto & i : tStoredDoc.m_dFields )
+		m_iSampleSize += i.GetLength();
+
+	m_dSampleDocs.Add ( std::move(tStoredDoc) );
+	if ( m_iSampleSize>=DICT_SAMPLE_SIZE )
+		BuildDictionary();
+}
+
+
+void DocstoreBuilder_c::AddStoredDoc ( StoredDoc_t && tDoc )
+{
+	DWORD uLen = 0;
+	for ( const auto & i : tDoc.m_dFields )
+		uLen += i.GetLength();
+
+	if ( m_uStoredLen+uLen > m_uBlockSize )
+		WriteBlock();
+
+	m_dStoredDocs.Add ( std::move(tDoc) );
 	m_uStoredLen += uLen;
 }
 
 
+void DocstoreBuilder_c::BuildDictionary()
+{
+	assert ( !m_bHaveDict );
+
+	CSphVector<BYTE> dSample;
+	dSample.Reserve(m_iSampleSize);
+	for ( const auto & tDoc : m_dSampleDocs )
+		for ( const auto & i : tDoc.m_dFields )
+			dSample.Append(i);
+
+	// LZ4 looks only 64K back, so most of a bigger block is out of the dictionary's reach anyway
+	if ( m_uBlockSize<=DICT_SIZE*2 )
+		TrainDictionary ( dSample, DICT_SIZE, m_dDict );
+
+	m_pCompressor = CreateCompressor ( m_eCompression, m_iCompressionLevel, m_dDict );
+	m_bHaveDict = true;
+
+	for ( auto & tDoc : m_dSampleDocs )
+		AddStoredDoc ( std::move(tDoc) );
+
+	m_dSampleDocs.Reset();
+	m_iSampleSize = 0;
+}
+
+
 int DocstoreBuilder_c::AddField ( const CSphString & sName, DocstoreDataType_e eType )
 {
 	return m_tFields.AddField ( sName, eType );
@@ -1296,6 +1842,9 @@ int DocstoreBuilder_c::AddField ( const CSphString & sName, DocstoreDataType_e e
 
 void DocstoreBuilder_c::Finalize()
 {
+	if ( !m_bHaveDict )
+		BuildDictionary();
+
 	WriteBlock();
 	WriteTrailingHeader();
 }
@@ -1306,6 +1855,8 @@ void DocstoreBuilder_c::WriteInitialHeader()
 	m_tWriter.PutDword ( STORAGE_VERSION );
 	m_tWriter.PutDword ( m_uBlockSize );
 	m_tWriter.PutByte ( Compression2Byte(m_eCompression) );
+	m_tWriter.PutDword ( m_dDict.GetLength() );
+	m_tWriter.PutBytes ( m_dDict.Begin(), m_dDict.GetLength() );
 	m_tFields.Save(m_tWriter);
 
 	m_tHeaderOffset = m_tWriter.GetPos();
@@ -1540,6 +2091,7 @@ public:
 	void				DropTail ( RowID_t tTailID ) final;
 
 	DocstoreDoc_t		GetDoc ( RowID_t tRowID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const final;
+	void				GetDocs ( const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const final;
 	int					GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const final;
 	DocstoreSettings_t	GetDocstoreSettings() const final;
 	void				CreateReader ( int64_t iSessionId ) const final {};
@@ -1659,6 +2211,15 @@ DocstoreDoc_t DocstoreRT_c::GetDoc ( RowID_t tRowID, const VecTraits_T<int> * pF
 }
 
 
+void DocstoreRT_c::GetDocs ( const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const
+{
+	// documents are kept uncompressed in memory, so there is nothing to share between them
+	assert ( dRowIDs.GetLength()==dDocs.GetLength() );
+	ARRAY_FOREACH ( i, dRowIDs )
+		dDocs[i] = GetDoc ( dRowIDs[i], pFieldIds, iSessionId, bPack );
+}
+
+
 int DocstoreRT_c::GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const
 {
 	return m_tFields.GetFieldId ( sName, eType );
@@ -1781,6 +2342,16 @@ int64_t DocstoreRT_c::AllocatedBytes() const
 
 std::atomic<int64_t> DocstoreSession_c::m_tUIDGenerator { 0 };
 
+bool DocstoreSession_c::Info_t::GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, bool bPack ) const
+{
+	assert ( m_pDocstore );
+	if ( m_pPrefetch )
+		return m_pPrefetch->GetDoc ( tDoc, tDocID, pFieldIds, m_iSessionId, bPack );
+
+	return m_pDocstore->GetDoc ( tDoc, tDocID, pFieldIds, m_iSessionId, bPack );
+}
+
+
 DocstoreSession_c::DocstoreSession_c()
 	: m_iUID ( m_tUIDGenerator.fetch_add ( 1, std::memory_order_relaxed ) )
 {}
@@ -1795,6 +2366,73 @@ DocstoreSession_c::~DocstoreSession_c()
 
 //////////////////////////////////////////////////////////////////////////
 
+DocstorePrefetch_c::DocstorePrefetch_c ( const DocstoreReader_i & tReader, const VecTraits_T<DocID_t> & dDocIDs )
+	: m_tReader ( tReader )
+	, m_hDocs ( Max ( dDocIDs.GetLength()*2, 64 ) )
+{
+	for ( DocID_t tDocID : dDocIDs )
+	{
+		int & iDoc = m_hDocs.Acquire ( tDocID );
+		if ( iDoc )
+			continue;
+
+		m_dDocIDs.Add ( tDocID );
+		iDoc = m_dDocIDs.GetLength(); // 1-based, as 0 means a newly added entry
+	}
+}
+
+
+DocstorePrefetch_c::~DocstorePrefetch_c()
+{
+	for ( auto & i : m_dBatches )
+		SafeDelete(i);
+}
+
+
+const DocstorePrefetch_c::Batch_t & DocstorePrefetch_c::GetBatch ( const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const
+{
+	for ( const auto * pBatch : m_dBatches )
+	{
+		if ( pBatch->m_bPack!=bPack || pBatch->m_bAllFields!=!pFieldIds )
+			continue;
+
+		if ( !pFieldIds || ( pBatch->m_dFieldIds.GetLength()==pFieldIds->GetLength() && !memcmp ( pBatch->m_dFieldIds.Begin(), pFieldIds->Begin(), pFieldIds->GetLengthBytes() ) ) )
+			return *pBatch;
+	}
+
+	auto * pBatch = new Batch_t;
+	m_dBatches.Add ( pBatch );
+
+	pBatch->m_bPack = bPack;
+	pBatch->m_bAllFields = !pFieldIds;
+	if ( pFieldIds )
+		pBatch->m_dFieldIds.Append ( *pFieldIds );
+
+	pBatch->m_dDocs.Reset ( m_dDocIDs.GetLength() );
+	pBatch->m_tFound.Init ( m_dDocIDs.GetLength() );
+	m_tReader.GetDocs ( m_dDocIDs, pFieldIds, iSessionId, bPack, pBatch->m_dDocs, pBatch->m_tFound );
+	return *pBatch;
+}
+
+
+bool DocstorePrefetch_c::GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const
+{
+	int * pDoc = m_hDocs.Find ( tDocID );
+	if ( !pDoc )
+		return m_tReader.GetDoc ( tDoc, tDocID, pFieldIds, iSessionId, bPack );
+
+	int iDoc = *pDoc-1;
+	const Batch_t & tBatch = GetBatch ( pFieldIds, iSessionId, bPack );
+	if ( !tBatch.m_tFound.BitGet(iDoc) )
+		return false;
+
+	// a copy, as the same document might be requested by several expressions
+	tDoc = tBatch.m_dDocs[iDoc];
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 class DocstoreChecker_c
 {
 public:
@@ -1837,8 +2475,19 @@ bool DocstoreChecker_c::Check()
 	if ( uCompression > 2 )
 		return m_tReporter.Fail ( "Unknown docstore compression %u in %s", uCompression, m_szFilename );
 
+	CSphFixedVector<BYTE> dDict {0};
+	if ( uStorageVersion>=2 )
+	{
+		DWORD uDictSize = m_tReader.GetDword();
+		if ( uDictSize > MAX_DICT_SIZE )
+			return m_tReporter.Fail ( "Docstore compression dictionary is too big (%u) in %s", uDictSize, m_szFilename );
+
+		dDict.Reset(uDictSize);
+		m_tReader.GetBytes ( dDict.Begin(), dDict.GetLength() );
+	}
+
 	Compression_e eCompression = Byte2Compression(uCompression);
-	m_pCompressor = CreateCompressor ( eCompression, DEFAULT_COMPRESSION_LEVEL );
+	m_pCompressor = CreateCompressor ( eCompression, DEFAULT_COMPRESSION_LEVEL, dDict );
 	if ( !m_pCompressor.Ptr() )
 		return m_tReporter.Fail ( "Unable to create compressor in %s", m_szFilename );
 
@@ -2152,6 +2801,17 @@ void InitDocstore ( int64_t iCacheSize )
 }
 
 
+CSphVector<DocstoreCacheStats_t> GetDocstoreCacheStats()
+{
+	CSphVector<DocstoreCacheStats_t> dStats;
+	BlockCache_c * pBlockCache = BlockCache_c::Get();
+	if ( pBlockCache )
+		pBlockCache->GetStats(dStats);
+
+	return dStats;
+}
+
+
 void ShutdownDocstore()
 {
 	BlockCache_c::Done();
@@ -44,6 +44,7 @@ class Docstore_i : public DocstoreGetField_i
 public:
 	virtual void				CreateReader ( int64_t iSessionId ) const = 0;
 	virtual DocstoreDoc_t		GetDoc ( RowID_t tRowID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const = 0;
+	virtual void				GetDocs ( const VecTraits_T<RowID_t> & dRowIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs ) const = 0;
 	virtual DocstoreSettings_t	GetDocstoreSettings() const = 0;
 };
 
@@ -89,6 +90,8 @@ public:
 };
 
 
+class DocstorePrefetch_c;
+
 class DocstoreSession_c
 {
 public:
@@ -96,6 +99,9 @@ public:
 	{
 		const DocstoreReader_i *	m_pDocstore = nullptr;
 		int64_t						m_iSessionId = 0;
+		const DocstorePrefetch_c *	m_pPrefetch = nullptr;	///< documents of the current page fetched in batches (optional)
+
+		bool		GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, bool bPack ) const;
 	};
 
 
@@ -111,13 +117,54 @@ private:
 };
 
 
+// serves a known set of documents (e.g. a page of matches) from batches fetched on the first request
+// every distinct set of requested fields is fetched for all the documents at once
+class DocstorePrefetch_c final : public DocstoreReader_i
+{
+public:
+				DocstorePrefetch_c ( const DocstoreReader_i & tReader, const VecTraits_T<DocID_t> & dDocIDs );
+				~DocstorePrefetch_c();
+
+	void		CreateReader ( int64_t iSessionId ) const final { m_tReader.CreateReader(iSessionId); }
+	bool		GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const final;
+	int			GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const final { return m_tReader.GetFieldId ( sName, eType ); }
+
+private:
+	struct Batch_t
+	{
+		CSphVector<int>					m_dFieldIds;
+		bool							m_bAllFields = false;
+		bool							m_bPack = false;
+		CSphFixedVector<DocstoreDoc_t>	m_dDocs {0};
+		CSphBitvec						m_tFound;
+	};
+
+	const DocstoreReader_i &			m_tReader;
+	CSphVector<DocID_t>					m_dDocIDs;
+	OpenHash_T<int, DocID_t>			m_hDocs;
+	mutable CSphVector<Batch_t *>		m_dBatches;
+
+	const Batch_t &	GetBatch ( const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const;
+};
+
+
 Docstore_i *		CreateDocstore ( const CSphString & sFilename, CSphString & sError );
 DocstoreBuilder_i * CreateDocstoreBuilder ( const CSphString & sFilename, const DocstoreSettings_t & tSettings, CSphString & sError );
 DocstoreRT_i *		CreateDocstoreRT();
 DocstoreFields_i *	CreateDocstoreFields();
 
+struct DocstoreCacheStats_t
+{
+	int64_t		m_iMaxBytes = 0;
+	int64_t		m_iUsedBytes = 0;
+	int64_t		m_iHits = 0;
+	int64_t		m_iMisses = 0;
+	int64_t		m_iEvictions = 0;
+};
+
 void				InitDocstore ( int64_t iCacheSize );
 void				ShutdownDocstore();
+CSphVector<DocstoreCacheStats_t> GetDocstoreCacheStats();	///< one entry per cache shard; empty if the cache is disabled
 
 class DebugCheckError_c;
 class CSphAutoreader;
@@ -13,6 +13,10 @@
 #include "fileio.h"
 #include "sphinxint.h"
 
+#if HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#endif
+
 #define SPH_READ_PROGRESS_CHUNK (8192*1024)
 #define SPH_READ_NOPROGRESS_CHUNK (32768*1024)
 
@@ -319,6 +323,24 @@ void CSphReader::SkipBytes ( int iCount )
 }
 
 
+void CSphReader::ReadAhead ( SphOffset_t iPos, int iSizeHint ) const
+{
+	if ( m_iFD<0 )
+		return;
+
+	// already buffered
+	if ( iPos>=m_iPos && iPos<m_iPos+m_iBuffUsed )
+		return;
+
+	// same length as UpdateCache() would read
+	if ( iSizeHint<=0 )
+		iSizeHint = ( m_iReadUnhinted>0 ) ? m_iReadUnhinted : DEFAULT_READ_UNHINTED;
+	int iReadLen = Min ( iSizeHint, m_iBufSize>0 ? m_iBufSize : DEFAULT_READ_BUFFER );
+
+	sphReadAhead ( m_iFD, iPos, iReadLen );
+}
+
+
 void CSphReader::UpdateCache()
 {
 	CSphScopedProfile tProf ( m_pProfile, m_eProfileState );
@@ -486,12 +508,29 @@ void CSphReader::ResetError()
 
 DWORD CSphReader::UnzipInt()
 {
+	// fast path: longest possible value is already buffered
+	if ( m_iBuffUsed-m_iBuffPos>=sphMaxZippedLen<DWORD>() )
+	{
+		const BYTE * pCur = m_pBuff + m_iBuffPos;
+		DWORD uRes = sphUnzipInMemory<DWORD> ( pCur );
+		m_iBuffPos = int ( pCur - m_pBuff );
+		return uRes;
+	}
+
 	SPH_VARINT_DECODE ( DWORD, GetByte() );
 }
 
 
 uint64_t CSphReader::UnzipOffset()
 {
+	if ( m_iBuffUsed-m_iBuffPos>=sphMaxZippedLen<uint64_t>() )
+	{
+		const BYTE * pCur = m_pBuff + m_iBuffPos;
+		uint64_t uRes = sphUnzipInMemory<uint64_t> ( pCur );
+		m_iBuffPos = int ( pCur - m_pBuff );
+		return uRes;
+	}
+
 	SPH_VARINT_DECODE ( uint64_t, GetByte() );
 }
 
@@ -907,4 +946,13 @@ int sphPread ( int iFD, void * pBuf, int iBytes, SphOffset_t iOffset )
 }
 
 #endif // HAVE_PREAD
-#endif // USE_WINDOWS
\ No newline at end of file
+#endif // USE_WINDOWS
+
+
+void sphReadAhead ( int iFD, SphOffset_t iOffset, int iBytes )
+{
+#if HAVE_POSIX_FADVISE
+	if ( iBytes>0 )
+		posix_fadvise ( iFD, iOffset, iBytes, POSIX_FADV_WILLNEED );
+#endif
+}
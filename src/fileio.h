@@ -64,6 +64,7 @@ public:
 	void		SeekTo ( SphOffset_t iPos, int iSizeHint );
 
 	void		SkipBytes ( int iCount );
+	void		ReadAhead ( SphOffset_t iPos, int iSizeHint ) const;	///< let OS start fetching what a read at iPos would need; doesn't block
 	SphOffset_t	GetPos () const { return m_iPos+m_iBuffPos; }
 
 	void		GetBytes ( void * pData, int iSize );
@@ -210,4 +211,7 @@ bool SeekAndWarn ( int iFD, SphOffset_t iPos, const char * szWarnPrefix );
 // atomic seek+read wrapper
 int sphPread ( int iFD, void * pBuf, int iBytes, SphOffset_t iOffset );
 
+// async readahead hint; no-op where not supported
+void sphReadAhead ( int iFD, SphOffset_t iOffset, int iBytes );
+
 #endif // _sphinxint_
@@ -0,0 +1,435 @@
+//
+// Copyright (c) 2017-2021, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License. You should have
+// received a copy of the GPL license along with this program; if you
+// did not, you can find it at http://www.gnu.org/
+//
+
+#include <gtest/gtest.h>
+
+#include "sphinxint.h"
+#include "docstore.h"
+
+#define DOCSTORE_FILE_NAME "__docstore.tmp"
+
+// field contents are generated from the rowid, so that every read can be checked against the source
+static CSphString TestDocField ( RowID_t tRowID, int iField )
+{
+	if ( tRowID%50==7 || ( iField==1 && tRowID%13==0 ) )
+		return "";
+
+	// every 97th document doesn't fit a block and goes to a big one
+	int iWords = ( iField==0 && tRowID%97==0 ) ? 2000 : 5+tRowID%40;
+	StringBuilder_c sField;
+	for ( int i=0; i<iWords; ++i )
+		sField.Appendf ( "%s%u ", iField ? "data" : "word", ( tRowID*7+i )%1000 );
+
+	return sField.cstr();
+}
+
+
+static bool IsSameDoc ( const DocstoreDoc_t & tA, const DocstoreDoc_t & tB )
+{
+	if ( tA.m_dFields.GetLength()!=tB.m_dFields.GetLength() )
+		return false;
+
+	ARRAY_FOREACH ( i, tA.m_dFields )
+		if ( tA.m_dFields[i].GetLength()!=tB.m_dFields[i].GetLength() || memcmp ( tA.m_dFields[i].Begin(), tB.m_dFields[i].Begin(), tA.m_dFields[i].GetLength() ) )
+			return false;
+
+	return true;
+}
+
+
+static bool IsSourceDoc ( const DocstoreDoc_t & tDoc, RowID_t tRowID, const VecTraits_T<int> * pFieldIds )
+{
+	int iFields = pFieldIds ? pFieldIds->GetLength() : 2;
+	if ( tDoc.m_dFields.GetLength()!=iFields )
+		return false;
+
+	for ( int i=0; i<iFields; ++i )
+	{
+		CSphString sField = TestDocField ( tRowID, pFieldIds ? (*pFieldIds)[i] : i );
+		int iLen = sField.Length();
+		if ( tDoc.m_dFields[i].GetLength()!=iLen || memcmp ( tDoc.m_dFields[i].Begin(), sField.cstr(), iLen ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+// docids are rowids+1, the ones past the last row are missing; batches are fetched the way a disk index does it
+class DocstoreRowReader_c : public DocstoreReader_i
+{
+public:
+	DocstoreRowReader_c ( const Docstore_i & tDocstore, int iDocs )
+		: m_tDocstore ( tDocstore )
+		, m_iDocs ( iDocs )
+	{}
+
+	bool GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const final
+	{
+		if ( tDocID<1 || tDocID>m_iDocs )
+			return false;
+
+		tDoc = m_tDocstore.GetDoc ( RowID_t ( tDocID-1 ), pFieldIds, iSessionId, bPack );
+		return true;
+	}
+
+	int GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const final
+	{
+		return m_tDocstore.GetFieldId ( sName, eType );
+	}
+
+	void GetDocs ( const VecTraits_T<DocID_t> & dDocIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs, CSphBitvec & tFound ) const final
+	{
+		m_iBatches++;
+
+		CSphVector<RowID_t> dRowIDs;
+		CSphVector<int> dFetched;
+		ARRAY_FOREACH ( i, dDocIDs )
+			if ( dDocIDs[i]>=1 && dDocIDs[i]<=m_iDocs )
+			{
+				dRowIDs.Add ( RowID_t ( dDocIDs[i]-1 ) );
+				dFetched.Add(i);
+			}
+
+		CSphFixedVector<DocstoreDoc_t> dFetchedDocs ( dRowIDs.GetLength() );
+		m_tDocstore.GetDocs ( dRowIDs, pFieldIds, iSessionId, bPack, dFetchedDocs );
+		ARRAY_FOREACH ( i, dFetched )
+		{
+			dDocs[dFetched[i]] = std::move ( dFetchedDocs[i] );
+			tFound.BitSet ( dFetched[i] );
+		}
+	}
+
+	mutable int m_iBatches = 0;
+
+private:
+	const Docstore_i &	m_tDocstore;
+	int					m_iDocs;
+};
+
+
+class Docstore : public ::testing::TestWithParam<Compression_e>
+{
+protected:
+	void TearDown () override
+	{
+		m_pDocstore.Reset();
+		ShutdownDocstore();
+		unlink ( DOCSTORE_FILE_NAME );
+	}
+
+	void Build ( int iDocs, DWORD uBlockSize )
+	{
+		DocstoreSettings_t tSettings;
+		tSettings.m_eCompression = GetParam();
+		tSettings.m_uBlockSize = uBlockSize;
+
+		CSphScopedPtr<DocstoreBuilder_i> pBuilder { CreateDocstoreBuilder ( DOCSTORE_FILE_NAME, tSettings, m_sError ) };
+		ASSERT_TRUE ( pBuilder.Ptr() ) << m_sError.cstr();
+		pBuilder->AddField ( "title", DOCSTORE_TEXT );
+		pBuilder->AddField ( "data", DOCSTORE_BIN );
+
+		for ( int i=0; i<iDocs; ++i )
+		{
+			CSphString dFields[2] = { TestDocField ( i, 0 ), TestDocField ( i, 1 ) };
+			DocstoreBuilder_i::Doc_t tDoc;
+			for ( const auto & sField : dFields )
+				tDoc.m_dFields.Add ( { (BYTE *)const_cast<char *>( sField.cstr() ), sField.Length() } );
+
+			pBuilder->AddDoc ( i, tDoc );
+		}
+
+		pBuilder->Finalize();
+		pBuilder.Reset();
+
+		m_pDocstore = CreateDocstore ( DOCSTORE_FILE_NAME, m_sError );
+		ASSERT_TRUE ( m_pDocstore.Ptr() ) << m_sError.cstr();
+		m_iDocs = iDocs;
+	}
+
+	// batched read must return exactly what per-document reads (and the source) do, in the requested order
+	void CheckBatch ( const VecTraits_T<RowID_t> & dRowIDs, int64_t iSessionId )
+	{
+		int dTitle[] = { 0 };
+		int dData[] = { 1 };
+		const VecTraits_T<int> dTitleIds ( dTitle, 1 );
+		const VecTraits_T<int> dDataIds ( dData, 1 );
+
+		for ( const VecTraits_T<int> * pFieldIds : { (const VecTraits_T<int> *)nullptr, &dTitleIds, &dDataIds } )
+			for ( bool bPack : { false, true } )
+			{
+				CSphFixedVector<DocstoreDoc_t> dDocs ( dRowIDs.GetLength() );
+				m_pDocstore->GetDocs ( dRowIDs, pFieldIds, iSessionId, bPack, dDocs );
+
+				ARRAY_FOREACH ( i, dRowIDs )
+				{
+					DocstoreDoc_t tDoc = m_pDocstore->GetDoc ( dRowIDs[i], pFieldIds, iSessionId, bPack );
+					ASSERT_TRUE ( IsSameDoc ( dDocs[i], tDoc ) ) << "rowid " << dRowIDs[i] << " pack " << bPack;
+					if ( !bPack )
+					{
+						ASSERT_TRUE ( IsSourceDoc ( dDocs[i], dRowIDs[i], pFieldIds ) ) << "rowid " << dRowIDs[i];
+					}
+				}
+			}
+	}
+
+	CSphString					m_sError;
+	CSphScopedPtr<Docstore_i>	m_pDocstore { nullptr };
+	int							m_iDocs = 0;
+};
+
+
+TEST_P ( Docstore, batched_vs_single )
+{
+	ASSERT_NO_FATAL_FAILURE ( Build ( 6000, 1024 ) );
+
+	// all rows in order: every block, glued reads of adjacent blocks (over the glue limit with no compression) and big blocks
+	CSphVector<RowID_t> dAll;
+	for ( int i=0; i<m_iDocs; ++i )
+		dAll.Add(i);
+
+	// a page of matches: scattered rows in arbitrary order, some of them several times
+	CSphVector<RowID_t> dScattered;
+	for ( int i=0; i<300; ++i )
+		dScattered.Add ( ( i*7919 ) % m_iDocs );
+	dScattered.Add ( dScattered[10] );
+	dScattered.Add ( dScattered[10] );
+	dScattered.Add ( dScattered[0] );
+
+	// neighbours in the same block, requested backwards and twice
+	CSphVector<RowID_t> dSameBlock;
+	for ( int i=30; i>=20; --i )
+	{
+		dSameBlock.Add(i);
+		dSameBlock.Add(i);
+	}
+
+	// big blocks only, with a duplicate, mixed with their small neighbours
+	RowID_t dBigRows[] = { 97*3, 97, 97*3, 0, 97*2+1, 97*2, 97*2-1 };
+	VecTraits_T<RowID_t> dBig ( dBigRows, sizeof(dBigRows)/sizeof(dBigRows[0]) );
+
+	RowID_t tSingle = 4321;
+	VecTraits_T<RowID_t> dSingle ( &tSingle, 1 );
+
+	for ( bool bCache : { false, true } )
+	{
+		InitDocstore ( bCache ? 64*1048576 : 0 );
+
+		DocstoreSession_c tSession;
+		for ( int64_t iSessionId : { (int64_t)-1, tSession.GetUID() } )
+		{
+			if ( iSessionId!=-1 )
+				m_pDocstore->CreateReader(iSessionId);
+
+			// repeated batches are served (partly) from the cache when it's on
+			for ( int iPass=0; iPass<2; ++iPass )
+			{
+				CheckBatch ( dScattered, iSessionId );
+				CheckBatch ( dSameBlock, iSessionId );
+				CheckBatch ( dBig, iSessionId );
+				CheckBatch ( dSingle, iSessionId );
+				CheckBatch ( dAll, iSessionId );
+			}
+		}
+
+		CSphFixedVector<DocstoreDoc_t> dEmpty {0};
+		m_pDocstore->GetDocs ( VecTraits_T<RowID_t>(), nullptr, -1, false, dEmpty );
+
+		ShutdownDocstore();
+	}
+}
+
+
+TEST_P ( Docstore, prefetch )
+{
+	ASSERT_NO_FATAL_FAILURE ( Build ( 2000, 1024 ) );
+	InitDocstore ( 64*1048576 );
+
+	DocstoreRowReader_c tReader ( *m_pDocstore, m_iDocs );
+
+	// page of matches with duplicates and a couple of ids that are not in the docstore
+	CSphVector<DocID_t> dDocIDs;
+	for ( int i=0; i<100; ++i )
+		dDocIDs.Add ( 1 + ( i*397 ) % m_iDocs );
+	dDocIDs.Add ( dDocIDs[5] );
+	dDocIDs.Add ( m_iDocs+10 );
+	dDocIDs.Add ( 98 );
+
+	DocstorePrefetch_c tPrefetch ( tReader, dDocIDs );
+
+	int dTitle[] = { 0 };
+	const VecTraits_T<int> dTitleIds ( dTitle, 1 );
+
+	for ( const VecTraits_T<int> * pFieldIds : { (const VecTraits_T<int> *)nullptr, &dTitleIds } )
+		for ( bool bPack : { false, true } )
+			for ( int iPass=0; iPass<2; ++iPass )
+				for ( DocID_t tDocID : dDocIDs )
+				{
+					DocstoreDoc_t tPrefetched, tDirect;
+					bool bFound = tPrefetch.GetDoc ( tPrefetched, tDocID, pFieldIds, -1, bPack );
+					ASSERT_EQ ( bFound, tReader.GetDoc ( tDirect, tDocID, pFieldIds, -1, bPack ) ) << "docid " << tDocID;
+					if ( bFound )
+					{
+						ASSERT_TRUE ( IsSameDoc ( tPrefetched, tDirect ) ) << "docid " << tDocID;
+					}
+				}
+
+	// one batch per distinct set of fields and packing
+	ASSERT_EQ ( tReader.m_iBatches, 4 );
+
+	// ids that are not on the page are read directly
+	DocstoreDoc_t tDoc;
+	ASSERT_TRUE ( tPrefetch.GetDoc ( tDoc, 2, nullptr, -1, false ) );
+	ASSERT_TRUE ( IsSourceDoc ( tDoc, 1, nullptr ) );
+	ASSERT_FALSE ( tPrefetch.GetDoc ( tDoc, m_iDocs+20, nullptr, -1, false ) );
+	ASSERT_EQ ( tReader.m_iBatches, 4 );
+}
+
+
+static DocstoreCacheStats_t GetCacheStats()
+{
+	DocstoreCacheStats_t tTotal;
+	for ( const auto & tShard : GetDocstoreCacheStats() )
+	{
+		tTotal.m_iMaxBytes += tShard.m_iMaxBytes;
+		tTotal.m_iUsedBytes += tShard.m_iUsedBytes;
+		tTotal.m_iHits += tShard.m_iHits;
+		tTotal.m_iMisses += tShard.m_iMisses;
+		tTotal.m_iEvictions += tShard.m_iEvictions;
+	}
+
+	return tTotal;
+}
+
+
+TEST_P ( Docstore, block_cache )
+{
+	ASSERT_NO_FATAL_FAILURE ( Build ( 12000, 1024 ) );
+
+	// a single shard that holds about a thousand blocks
+	const int64_t CACHE_SIZE = 1048576;
+	InitDocstore ( CACHE_SIZE );
+	ASSERT_EQ ( GetDocstoreCacheStats().GetLength(), 1 );
+
+	auto fnRead = [this] ( RowID_t tRowID ) { m_pDocstore->GetDoc ( tRowID, nullptr, -1, false ); };
+
+	// first read misses and puts the block to the probationary segment, next one hits
+	const RowID_t ROW_A = 1;
+	fnRead ( ROW_A );
+	DocstoreCacheStats_t tStats = GetCacheStats();
+	ASSERT_EQ ( tStats.m_iMisses, 1 );
+	ASSERT_EQ ( tStats.m_iHits, 0 );
+	ASSERT_EQ ( tStats.m_iEvictions, 0 );
+
+	fnRead ( ROW_A );
+	tStats = GetCacheStats();
+	ASSERT_EQ ( tStats.m_iMisses, 1 );
+	ASSERT_EQ ( tStats.m_iHits, 1 );
+
+	// scan until the cache is full; the oldest probationary block (that is, ours) goes first
+	RowID_t tRow = 10;
+	while ( !GetCacheStats().m_iEvictions )
+	{
+		ASSERT_LT ( tRow, (RowID_t)m_iDocs );
+		fnRead ( tRow++ );
+	}
+
+	tStats = GetCacheStats();
+	ASSERT_LE ( tStats.m_iUsedBytes, CACHE_SIZE );
+	ASSERT_GT ( tStats.m_iUsedBytes, CACHE_SIZE/2 );
+
+	// evicted key is remembered, so the block is re-admitted straight to the main segment
+	fnRead ( ROW_A );
+	DocstoreCacheStats_t tNewStats = GetCacheStats();
+	ASSERT_EQ ( tNewStats.m_iMisses, tStats.m_iMisses+1 );
+	ASSERT_EQ ( tNewStats.m_iHits, tStats.m_iHits );
+
+	// a block that was read once stays in the probationary segment
+	const RowID_t ROW_B = m_iDocs-2;
+	fnRead ( ROW_B );
+
+	// another long scan (over twice the cache size) only cycles the probationary segment
+	for ( ; tRow<(RowID_t)m_iDocs-10; ++tRow )
+		fnRead ( tRow );
+
+	tStats = GetCacheStats();
+	ASSERT_LE ( tStats.m_iUsedBytes, CACHE_SIZE );
+	ASSERT_GT ( tStats.m_iEvictions, tNewStats.m_iEvictions );
+
+	fnRead ( ROW_A );
+	tNewStats = GetCacheStats();
+	ASSERT_EQ ( tNewStats.m_iHits, tStats.m_iHits+1 ) << "promoted block survives the scan";
+	ASSERT_EQ ( tNewStats.m_iMisses, tStats.m_iMisses );
+
+	fnRead ( ROW_B );
+	tStats = GetCacheStats();
+	ASSERT_EQ ( tStats.m_iMisses, tNewStats.m_iMisses+1 ) << "probationary block is evicted by the scan";
+	ASSERT_EQ ( tStats.m_iMaxBytes, CACHE_SIZE );
+
+	// blocks of a removed docstore are dropped from the cache
+	m_pDocstore.Reset();
+	ASSERT_EQ ( GetCacheStats().m_iUsedBytes, 0 );
+}
+
+
+TEST_P ( Docstore, dictionary )
+{
+	// enough data for the builder to train a compression dictionary
+	ASSERT_NO_FATAL_FAILURE ( Build ( 6000, 1024 ) );
+
+	CSphAutoreader tReader;
+	ASSERT_TRUE ( tReader.Open ( DOCSTORE_FILE_NAME, m_sError ) ) << m_sError.cstr();
+	ASSERT_EQ ( tReader.GetDword(), 2u ) << "storage version";
+	ASSERT_EQ ( tReader.GetDword(), 1024u ) << "block size";
+	tReader.GetByte();
+	DWORD uDictSize = tReader.GetDword();
+	tReader.Close();
+
+	if ( GetParam()==Compression_e::NONE )
+	{
+		ASSERT_EQ ( uDictSize, 0u );
+	} else
+	{
+		ASSERT_GT ( uDictSize, 0u );
+		ASSERT_LE ( uDictSize, 65536u );
+	}
+
+	// every block is compressed against the same dictionary, and each one is decompressed on its own
+	for ( int iPass=0; iPass<2; ++iPass )
+		for ( int i=iPass; i<m_iDocs; i+=2 )
+			ASSERT_TRUE ( IsSourceDoc ( m_pDocstore->GetDoc ( i, nullptr, -1, false ), i, nullptr ) ) << "rowid " << i;
+}
+
+
+TEST ( docstore, dictionary_too_big )
+{
+	CSphString sError;
+	{
+		CSphWriter tWriter;
+		ASSERT_TRUE ( tWriter.OpenFile ( DOCSTORE_FILE_NAME, sError ) ) << sError.cstr();
+		tWriter.PutDword(2);		// storage version
+		tWriter.PutDword(1024);		// block size
+		tWriter.PutByte(1);			// lz4
+		CSphFixedVector<BYTE> dDict ( 65537 );
+		dDict.Fill(0);
+		tWriter.PutDword ( dDict.GetLength() );
+		tWriter.PutBytes ( dDict.Begin(), dDict.GetLength() );
+		tWriter.PutDword(0);		// fields
+		tWriter.PutDword(0);		// blocks
+		tWriter.CloseFile();
+	}
+
+	CSphScopedPtr<Docstore_i> pDocstore { CreateDocstore ( DOCSTORE_FILE_NAME, sError ) };
+	ASSERT_FALSE ( pDocstore.Ptr() );
+	ASSERT_FALSE ( sError.IsEmpty() );
+	unlink ( DOCSTORE_FILE_NAME );
+}
+
+INSTANTIATE_TEST_SUITE_P ( Compressions, Docstore, ::testing::Values ( Compression_e::NONE, Compression_e::LZ4, Compression_e::LZ4HC ) );
@@ -585,3 +585,72 @@ TEST_F ( filter_block_level, and )
 	*dMax.Begin() = 30;
 	ASSERT_TRUE ( tFilter->EvalBlock ( dMin.Begin(), dMax.Begin() ) );
 }
+
+TEST_F ( filter_block_level, batch )
+{
+	CSphString sWarning, sError;
+	CSphSchema tSchema;
+	CSphColumnInfo tCol;
+	CSphScopedPtr<ISphFilter> tFilter ( NULL );
+
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tCol.m_sName = "gid";
+	tSchema.AddAttr ( tCol, false );
+
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tCol.m_sName = "tag";
+	tSchema.AddAttr ( tCol, false );
+
+	tCtx.m_pSchema = &tSchema;
+
+	tOpt.m_iMinValue = 10;
+	tOpt.m_iMaxValue = 40;
+	ISphFilter * pFilter1 = sphCreateFilter ( tOpt, tCtx, sError, sWarning );
+	ASSERT_TRUE ( pFilter1!=NULL );
+
+	tOpt.m_sAttrName = "tag";
+	tOpt.m_eType = SPH_FILTER_VALUES;
+	SphAttr_t dValues[] = { 1, 3 };
+	tOpt.SetExternalValues ( dValues, sizeof ( dValues ) / sizeof ( dValues[0] ) );
+	ISphFilter * pFilter2 = sphCreateFilter ( tOpt, tCtx, sError, sWarning );
+	ASSERT_TRUE ( pFilter2!=NULL );
+
+	tFilter = sphJoinFilters ( pFilter1, pFilter2 );
+	ASSERT_TRUE ( tFilter.Ptr()!=NULL );
+
+	const int ROWS = 100;
+	int iStride = tSchema.GetRowSize();
+	CSphFixedVector<CSphRowitem> dStorage ( ROWS*iStride );
+	CSphFixedVector<const CSphRowitem *> dRows ( ROWS );
+	CSphFixedVector<RowID_t> dRowIDs ( ROWS );
+	CSphFixedVector<int> dSelected ( ROWS );
+	for ( int i = 0; i < ROWS; i++ )
+	{
+		CSphRowitem * pRow = dStorage.Begin() + i*iStride;
+		sphSetRowAttr ( pRow, tSchema.GetAttr("gid")->m_tLocator, i );
+		sphSetRowAttr ( pRow, tSchema.GetAttr("tag")->m_tLocator, i % 4 );
+		dRows[i] = pRow;
+		dRowIDs[i] = i;
+		dSelected[i] = i;
+	}
+
+	CSphMatch tMatch;
+	int iPassed = tFilter->EvalBatch ( tMatch, dRowIDs.Begin(), dRows.Begin(), dSelected.Begin(), ROWS );
+
+	// batch result must match row-by-row evaluation
+	int iExpected = 0;
+	for ( int i = 0; i < ROWS; i++ )
+	{
+		tMatch.m_tRowID = i;
+		tMatch.m_pStatic = dRows[i];
+		if ( !tFilter->Eval ( tMatch ) )
+			continue;
+
+		ASSERT_LT ( iExpected, iPassed );
+		ASSERT_EQ ( dSelected[iExpected], i );
+		iExpected++;
+	}
+
+	ASSERT_EQ ( iPassed, iExpected );
+	ASSERT_EQ ( iPassed, 15 ); // odd gids (tags 1 and 3) in 10..40
+}
@@ -18,6 +18,8 @@
 #include "threadutils.h"
 #include <cmath>
 #include "histogram.h"
+#include "secondaryindex.h"
+#include "attribute.h"
 
 // Miscelaneous short functional tests: TDigest, SpanSearch,
 // stringbuilder, CJson, TaggedHash, Log2
@@ -1404,6 +1406,52 @@ TEST ( functions, StridedSort_regressions )
 	ASSERT_EQ ( dUniq1[1], 3 );
 }
 
+// threaded hits sort must give the same order as the plain one
+static void TestSortHitsPass ( int iHits, int iWords, int iRows, int iPositions, int iThreads )
+{
+	auto fnLess = [] ( const CSphWordHit & a, const CSphWordHit & b )
+	{
+		if ( a.m_uWordID!=b.m_uWordID )
+			return a.m_uWordID<b.m_uWordID;
+		if ( a.m_tRowID!=b.m_tRowID )
+			return a.m_tRowID<b.m_tRowID;
+		return HITMAN::GetPosWithField ( a.m_uWordPos )<HITMAN::GetPosWithField ( b.m_uWordPos );
+	};
+
+	CSphVector<CSphWordHit> dHits ( iHits );
+	for ( auto & tHit : dHits )
+	{
+		tHit.m_uWordID = 1 + sphRand() % iWords;
+		tHit.m_tRowID = sphRand() % iRows;
+		tHit.m_uWordPos = HITMAN::Create ( sphRand() % 4, 1 + sphRand() % iPositions, ( sphRand() & 1 )!=0 );
+	}
+
+	CSphVector<CSphWordHit> dThreaded ( iHits );
+	memcpy ( dThreaded.Begin(), dHits.Begin(), dHits.GetLengthBytes() );
+
+	sphSort ( dHits.Begin(), dHits.GetLength(), Lesser ( fnLess ) );
+	sphSortHits ( dThreaded.Begin(), dThreaded.GetLength(), iThreads );
+
+	// equal keys might come in any order; compare by key
+	for ( int i=0; i<iHits; ++i )
+	{
+		ASSERT_FALSE ( fnLess ( dHits[i], dThreaded[i] ) ) << "hit " << i;
+		ASSERT_FALSE ( fnLess ( dThreaded[i], dHits[i] ) ) << "hit " << i;
+	}
+}
+
+TEST ( functions, SortHits )
+{
+	// below the split threshold, and a single thread
+	SCOPED_TRACE ( "small" ); TestSortHitsPass ( 1000, 100, 100, 100, 4 );
+	SCOPED_TRACE ( "single thread" ); TestSortHitsPass ( 300000, 1000, 1000, 100, 1 );
+
+	SCOPED_TRACE ( "random" ); TestSortHitsPass ( 300000, 100000, 10000, 1000, 4 );
+	SCOPED_TRACE ( "odd threads" ); TestSortHitsPass ( 500000, 100000, 10000, 1000, 3 );
+	SCOPED_TRACE ( "duplicates" ); TestSortHitsPass ( 300000, 3, 5, 2, 4 );
+	SCOPED_TRACE ( "one word" ); TestSortHitsPass ( 300000, 1, 1000, 100, 4 );
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 TEST ( functions, Writer )
@@ -1431,6 +1479,44 @@ TEST ( functions, Writer )
 	delete[] pData;
 }
 
+TEST ( functions, ReaderUnzip )
+{
+	const CSphString sTmpWriteout = "__unzip.tmp";
+	CSphString sErr;
+
+	CSphVector<uint64_t> dValues;
+	for ( int i=0; i<64; ++i )
+	{
+		dValues.Add ( ( 1ULL<<i )-1 );
+		dValues.Add ( 1ULL<<i );
+		dValues.Add ( i );
+	}
+
+	{
+		CSphWriter tWr;
+		ASSERT_TRUE ( tWr.OpenFile ( sTmpWriteout, sErr ) );
+		for ( auto uValue : dValues )
+		{
+			tWr.ZipInt ( (DWORD)uValue );
+			tWr.ZipOffset ( uValue );
+		}
+	}
+
+	// odd small buffer to have values split between reads and so mix fast and slow decoding
+	BYTE dBuf[13];
+	CSphAutofile tFile ( sTmpWriteout, SPH_O_READ, sErr );
+	CSphReader tRd ( dBuf, sizeof(dBuf) );
+	tRd.SetFile ( tFile );
+	for ( auto uValue : dValues )
+	{
+		ASSERT_EQ ( tRd.UnzipInt(), (DWORD)uValue );
+		ASSERT_EQ ( tRd.UnzipOffset(), uValue );
+	}
+	ASSERT_FALSE ( tRd.GetErrorFlag() );
+
+	unlink ( sTmpWriteout.cstr () );
+}
+
 //////////////////////////////////////////////////////////////////////////
 struct tstcase { float wold; DWORD utimer; float wnew; };
 
@@ -3460,3 +3546,330 @@ TEST ( functions, histogram )
 		ASSERT_EQ( iRes, 3 );
 	}
 }
+
+static CSphVector<RowID_t> GetSecondaryIndexRows ( const SecondaryIndex_c & tIndex, const CSphFilterSettings & tFilter )
+{
+	CSphVector<RowID_t> dRows;
+	CSphScopedPtr<RowidIterator_i> pIterator ( tIndex.CreateIterator ( tFilter ) );
+	if ( !pIterator.Ptr() )
+		return dRows;
+
+	RowIdBlock_t dBlock;
+	while ( pIterator->GetNextRowIdBlock ( dBlock ) )
+		for ( auto tRowID : dBlock )
+			dRows.Add ( tRowID );
+
+	return dRows;
+}
+
+TEST ( functions, secondary_index )
+{
+	const int NUM_ROWS = 1000;
+
+	CSphSchema tSchema;
+	CSphColumnInfo tId ( sphGetDocidName(), SPH_ATTR_BIGINT );
+	tSchema.AddAttr ( tId, false );
+	CSphColumnInfo tGid ( "gid", SPH_ATTR_INTEGER );
+	tGid.m_uAttrFlags = CSphColumnInfo::ATTR_SECONDARY_INDEX;
+	tSchema.AddAttr ( tGid, false );
+	CSphColumnInfo tPrice ( "price", SPH_ATTR_FLOAT );
+	tPrice.m_uAttrFlags = CSphColumnInfo::ATTR_SECONDARY_INDEX;
+	tSchema.AddAttr ( tPrice, false );
+
+	const CSphAttrLocator & tGidLoc = tSchema.GetAttr("gid")->m_tLocator;
+	const CSphAttrLocator & tPriceLoc = tSchema.GetAttr("price")->m_tLocator;
+
+	SecondaryIndexBuilder_c tBuilder ( tSchema );
+	ASSERT_FALSE ( tBuilder.IsEmpty() );
+
+	CSphFixedVector<CSphRowitem> dRow ( tSchema.GetRowSize() );
+	for ( int i = 0; i < NUM_ROWS; i++ )
+	{
+		sphSetRowAttr ( dRow.Begin(), tGidLoc, i % 7 );
+		sphSetRowAttr ( dRow.Begin(), tPriceLoc, sphF2DW ( float ( i % 10 - 5 ) ) );
+		tBuilder.Collect ( i, dRow.Begin(), nullptr );
+	}
+
+	CSphString sFile = "test_secondary_index.spidx";
+	CSphString sError;
+	ASSERT_TRUE ( tBuilder.Save ( sFile, sError ) ) << sError.cstr();
+
+	SecondaryIndex_c tIndex;
+	ASSERT_TRUE ( tIndex.Setup ( sFile, tSchema, NUM_ROWS, sError ) ) << sError.cstr();
+
+	// gid in (3)
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = "gid";
+		tFilter.m_eType = SPH_FILTER_VALUES;
+		tFilter.m_dValues.Add(3);
+		ASSERT_TRUE ( tIndex.IsEnabled ( tFilter, SPH_COLLATION_DEFAULT ) );
+		ASSERT_TRUE ( tIndex.IsExact ( tFilter ) );
+
+		CSphVector<RowID_t> dRows = GetSecondaryIndexRows ( tIndex, tFilter );
+		ASSERT_EQ ( dRows.GetLength(), 143 );
+		ARRAY_FOREACH ( i, dRows )
+		{
+			ASSERT_EQ ( dRows[i] % 7, 3u );
+			ASSERT_TRUE ( !i || dRows[i-1]<dRows[i] );
+		}
+	}
+
+	// gid not between 2 and 4
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = "gid";
+		tFilter.m_eType = SPH_FILTER_RANGE;
+		tFilter.m_iMinValue = 2;
+		tFilter.m_iMaxValue = 4;
+		tFilter.m_bExclude = true;
+
+		CSphVector<RowID_t> dRows = GetSecondaryIndexRows ( tIndex, tFilter );
+		ASSERT_EQ ( dRows.GetLength(), 571 );
+		ARRAY_FOREACH ( i, dRows )
+		{
+			ASSERT_TRUE ( dRows[i] % 7 < 2 || dRows[i] % 7 > 4 );
+			ASSERT_TRUE ( !i || dRows[i-1]<dRows[i] );
+		}
+	}
+
+	// price>-2.5 and price<=0
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = "price";
+		tFilter.m_eType = SPH_FILTER_FLOATRANGE;
+		tFilter.m_fMinValue = -2.5f;
+		tFilter.m_fMaxValue = 0.0f;
+		tFilter.m_bHasEqualMin = false;
+		ASSERT_TRUE ( tIndex.IsEnabled ( tFilter, SPH_COLLATION_DEFAULT ) );
+
+		int64_t iEstimate = 0;
+		ASSERT_TRUE ( tIndex.EstimateRsetSize ( tFilter, iEstimate ) );
+		ASSERT_GE ( iEstimate, 300 );
+
+		CSphVector<RowID_t> dRows = GetSecondaryIndexRows ( tIndex, tFilter );
+		ASSERT_EQ ( dRows.GetLength(), 300 );
+		for ( auto tRowID : dRows )
+			ASSERT_TRUE ( tRowID % 10>=3 && tRowID % 10<=5 );
+	}
+
+	// access path depends on estimated full-text matches
+	{
+		HistogramContainer_c tHistograms;
+		Histogram_i * pHistogram = CreateHistogram ( "gid", SPH_ATTR_INTEGER );
+		for ( int i = 0; i < NUM_ROWS; i++ )
+			pHistogram->Insert ( i % 7 );
+		pHistogram->Finalize();
+		tHistograms.Add ( pHistogram );
+
+		CSphVector<CSphFilterSettings> dFilters;
+		CSphFilterSettings & tFilter = dFilters.Add();
+		tFilter.m_sAttrName = "gid";
+		tFilter.m_eType = SPH_FILTER_VALUES;
+		tFilter.m_dValues.Add(3);
+
+		CSphVector<FilterTreeItem_t> dFilterTree;
+		CSphVector<IndexHint_t> dHints;
+		CSphVector<CSphFilterSettings> dModifiedFilters;
+		bool bFiltersChanged = false;
+
+		// fullscan
+		AccessPlan_t tPlan;
+		CSphScopedPtr<RowidIterator_i> pIterator ( CreateFilteredIterator ( dFilters, dModifiedFilters, bFiltersChanged, dFilterTree, dHints, tHistograms, nullptr, &tIndex, SPH_COLLATION_DEFAULT, tPlan ) );
+		ASSERT_TRUE ( pIterator.Ptr() );
+		ASSERT_TRUE ( bFiltersChanged );
+		ASSERT_TRUE ( tPlan.m_ePath==AccessPath_e::LOOKUP );
+		ASSERT_EQ ( tPlan.m_iTotalDocs, NUM_ROWS );
+		ASSERT_EQ ( tPlan.m_dEstimates.GetLength(), 1 );
+		ASSERT_TRUE ( tPlan.m_dEstimates[0].m_bUsed );
+
+		// rare keyword; cheaper to filter its matches
+		dModifiedFilters.Resize(0);
+		tPlan.m_iFulltextDocs = 5;
+		pIterator = CreateFilteredIterator ( dFilters, dModifiedFilters, bFiltersChanged, dFilterTree, dHints, tHistograms, nullptr, &tIndex, SPH_COLLATION_DEFAULT, tPlan );
+		ASSERT_FALSE ( pIterator.Ptr() );
+		ASSERT_TRUE ( tPlan.m_ePath==AccessPath_e::FULLTEXT );
+		ASSERT_FALSE ( tPlan.m_dEstimates[0].m_bUsed );
+
+		// frequent keyword; cheaper to skip to the rows from the index
+		dModifiedFilters.Resize(0);
+		tPlan.m_iFulltextDocs = NUM_ROWS;
+		pIterator = CreateFilteredIterator ( dFilters, dModifiedFilters, bFiltersChanged, dFilterTree, dHints, tHistograms, nullptr, &tIndex, SPH_COLLATION_DEFAULT, tPlan );
+		ASSERT_TRUE ( pIterator.Ptr() );
+		ASSERT_TRUE ( tPlan.m_ePath==AccessPath_e::FULLTEXT_LOOKUP );
+
+		StringBuilder_c sPlan;
+		tPlan.Format ( sPlan );
+		ASSERT_STREQ ( sPlan.cstr(), "path=fulltext+lookup, cost=0.004290, total_docs=1000, fulltext_docs=1000, gid=143 (index)" );
+	}
+
+	// gid in (1,5); rows of both values are merged in rowid order, and hints skip them
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = "gid";
+		tFilter.m_eType = SPH_FILTER_VALUES;
+		tFilter.m_dValues.Add(5);
+		tFilter.m_dValues.Add(1);
+
+		CSphVector<RowID_t> dRows = GetSecondaryIndexRows ( tIndex, tFilter );
+		ASSERT_EQ ( dRows.GetLength(), 286 );
+		ARRAY_FOREACH ( i, dRows )
+		{
+			ASSERT_TRUE ( dRows[i] % 7==1 || dRows[i] % 7==5 );
+			ASSERT_TRUE ( !i || dRows[i-1]<dRows[i] );
+		}
+
+		CSphScopedPtr<RowidIterator_i> pIterator ( tIndex.CreateIterator ( tFilter ) );
+		ASSERT_TRUE ( pIterator->HintRowID ( 500 ) );
+		RowIdBlock_t dBlock;
+		ASSERT_TRUE ( pIterator->GetNextRowIdBlock ( dBlock ) );
+		ASSERT_EQ ( dBlock[0], 502u );
+	}
+
+	// gid between 5 and 6 goes through a bitmap, and hints skip it too
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = "gid";
+		tFilter.m_eType = SPH_FILTER_RANGE;
+		tFilter.m_iMinValue = 5;
+		tFilter.m_iMaxValue = 6;
+
+		CSphScopedPtr<RowidIterator_i> pIterator ( tIndex.CreateIterator ( tFilter ) );
+		ASSERT_TRUE ( pIterator->HintRowID ( 500 ) );
+		RowIdBlock_t dBlock;
+		ASSERT_TRUE ( pIterator->GetNextRowIdBlock ( dBlock ) );
+		ASSERT_EQ ( dBlock[0], 502u );
+		ASSERT_EQ ( dBlock[1], 503u );
+		ASSERT_EQ ( dBlock[2], 509u );
+		ASSERT_FALSE ( pIterator->HintRowID ( NUM_ROWS ) );
+	}
+
+	// updates disable the index
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = "gid";
+		tFilter.m_eType = SPH_FILTER_VALUES;
+		tFilter.m_dValues.Add(3);
+		tIndex.Invalidate ( "gid" );
+		ASSERT_FALSE ( tIndex.IsEnabled ( tFilter, SPH_COLLATION_DEFAULT ) );
+	}
+
+	tIndex.Reset();
+	unlink ( sFile.cstr() );
+}
+
+TEST ( functions, secondary_index_sparse_range )
+{
+	const int NUM_ROWS = 10000;
+	const int PRIME = 7919;
+
+	CSphSchema tSchema;
+	CSphColumnInfo tId ( sphGetDocidName(), SPH_ATTR_BIGINT );
+	tSchema.AddAttr ( tId, false );
+	CSphColumnInfo tVal ( "val", SPH_ATTR_INTEGER );
+	tVal.m_uAttrFlags = CSphColumnInfo::ATTR_SECONDARY_INDEX;
+	tSchema.AddAttr ( tVal, false );
+	const CSphAttrLocator & tValLoc = tSchema.GetAttr("val")->m_tLocator;
+
+	// unique values, scattered over rows
+	SecondaryIndexBuilder_c tBuilder ( tSchema );
+	CSphFixedVector<CSphRowitem> dRow ( tSchema.GetRowSize() );
+	for ( int i = 0; i < NUM_ROWS; i++ )
+	{
+		sphSetRowAttr ( dRow.Begin(), tValLoc, ( i*PRIME ) % NUM_ROWS );
+		tBuilder.Collect ( i, dRow.Begin(), nullptr );
+	}
+
+	CSphString sFile = "test_secondary_index_sparse.spidx";
+	CSphString sError;
+	ASSERT_TRUE ( tBuilder.Save ( sFile, sError ) ) << sError.cstr();
+
+	SecondaryIndex_c tIndex;
+	ASSERT_TRUE ( tIndex.Setup ( sFile, tSchema, NUM_ROWS, sError ) ) << sError.cstr();
+
+	// 1% of rows; collected and sorted instead of a bitmap, must come in rowid order all the same
+	CSphFilterSettings tFilter;
+	tFilter.m_sAttrName = "val";
+	tFilter.m_eType = SPH_FILTER_RANGE;
+	tFilter.m_iMinValue = 1000;
+	tFilter.m_iMaxValue = 1099;
+
+	CSphVector<RowID_t> dRows = GetSecondaryIndexRows ( tIndex, tFilter );
+	ASSERT_EQ ( dRows.GetLength(), 100 );
+	ARRAY_FOREACH ( i, dRows )
+	{
+		int64_t iVal = ( (int64_t)dRows[i]*PRIME ) % NUM_ROWS;
+		ASSERT_TRUE ( iVal>=1000 && iVal<=1099 );
+		ASSERT_TRUE ( !i || dRows[i-1]<dRows[i] );
+	}
+
+	// hints skip the collected rows
+	CSphScopedPtr<RowidIterator_i> pIterator ( tIndex.CreateIterator ( tFilter ) );
+	ASSERT_TRUE ( pIterator->HintRowID ( dRows[49]+1 ) );
+	RowIdBlock_t dBlock;
+	ASSERT_TRUE ( pIterator->GetNextRowIdBlock ( dBlock ) );
+	ASSERT_EQ ( dBlock[0], dRows[50] );
+	ASSERT_EQ ( dBlock.GetLength(), 50 );
+	ASSERT_FALSE ( pIterator->GetNextRowIdBlock ( dBlock ) );
+	ASSERT_FALSE ( pIterator->HintRowID ( dRows.Last()+1 ) );
+
+	tIndex.Reset();
+	unlink ( sFile.cstr() );
+}
+
+TEST ( functions, secondary_index_float_nan )
+{
+	const int NUM_ROWS = 100;
+
+	CSphSchema tSchema;
+	CSphColumnInfo tId ( sphGetDocidName(), SPH_ATTR_BIGINT );
+	tSchema.AddAttr ( tId, false );
+	CSphColumnInfo tPrice ( "price", SPH_ATTR_FLOAT );
+	tPrice.m_uAttrFlags = CSphColumnInfo::ATTR_SECONDARY_INDEX;
+	tSchema.AddAttr ( tPrice, false );
+	const CSphAttrLocator & tPriceLoc = tSchema.GetAttr("price")->m_tLocator;
+
+	// every 4th price is NaN, others are 1, 2, 3
+	SecondaryIndexBuilder_c tBuilder ( tSchema );
+	CSphFixedVector<CSphRowitem> dRow ( tSchema.GetRowSize() );
+	for ( int i = 0; i < NUM_ROWS; i++ )
+	{
+		float fPrice = ( i % 4 ) ? float ( i % 4 ) : ( ( i % 8 ) ? NAN : -NAN );
+		sphSetRowAttr ( dRow.Begin(), tPriceLoc, sphF2DW(fPrice) );
+		tBuilder.Collect ( i, dRow.Begin(), nullptr );
+	}
+
+	CSphString sFile = "test_secondary_index_nan.spidx";
+	CSphString sError;
+	ASSERT_TRUE ( tBuilder.Save ( sFile, sError ) ) << sError.cstr();
+
+	SecondaryIndex_c tIndex;
+	ASSERT_TRUE ( tIndex.Setup ( sFile, tSchema, NUM_ROWS, sError ) ) << sError.cstr();
+
+	CSphFilterSettings tFilter;
+	tFilter.m_sAttrName = "price";
+	tFilter.m_eType = SPH_FILTER_FLOATRANGE;
+
+	// NaNs never match a range
+	tFilter.m_fMinValue = -FLT_MAX;
+	tFilter.m_fMaxValue = FLT_MAX;
+	ASSERT_EQ ( GetSecondaryIndexRows ( tIndex, tFilter ).GetLength(), 75 );
+
+	// but do match an excluded one, same as float range filter does
+	tFilter.m_fMinValue = 1.0f;
+	tFilter.m_fMaxValue = 2.0f;
+	tFilter.m_bExclude = true;
+	CSphVector<RowID_t> dRows = GetSecondaryIndexRows ( tIndex, tFilter );
+	ASSERT_EQ ( dRows.GetLength(), 50 );
+	for ( auto tRowID : dRows )
+		ASSERT_TRUE ( tRowID % 4==0 || tRowID % 4==3 );
+
+	// range with NaN bound is empty, and excluding it leaves all rows
+	tFilter.m_fMaxValue = NAN;
+	ASSERT_EQ ( GetSecondaryIndexRows ( tIndex, tFilter ).GetLength(), NUM_ROWS );
+	tFilter.m_bExclude = false;
+	ASSERT_EQ ( GetSecondaryIndexRows ( tIndex, tFilter ).GetLength(), 0 );
+
+	tIndex.Reset();
+	unlink ( sFile.cstr() );
+}
@@ -15,8 +15,11 @@
 #include "sphinxint.h"
 #include "attribute.h"
 #include "sphinxrt.h"
+#include "accumulator.h"
 #include "sphinxsort.h"
 #include "searchdaemon.h"
+#include "searchdresultcache.h"
+#include "sphinxqcache.h"
 
 #include <gmock/gmock.h>
 
@@ -154,10 +157,12 @@ public:
 			return nullptr;
 		}
 
+		// docid comes from own counter, as index renumbers rowid of the docinfo on every commit
+		m_tDocInfo.SetAttr ( m_tSchema.GetAttr(0).m_tLocator, m_iDocsCounter+1000 );
+
 		++m_tDocInfo.m_tRowID;
 		++m_iDocsCounter;
 
-		m_tDocInfo.SetAttr ( m_tSchema.GetAttr(0).m_tLocator, m_tDocInfo.m_tRowID+1000 );
 		m_tDocInfo.SetAttr ( m_tSchema.GetAttr(1).m_tLocator, 1313 );
 
 		snprintf ( m_dFields[0], m_iMaxFieldLen, "cat title%d title%d title%d title%d title%d"
@@ -229,6 +234,151 @@ protected:
 		DeleteIndexFiles ( RT_INDEX_FILE_NAME );
 	}
 
+	// source attrs are dynamic; index schema makes them static
+	void AddSrcAttr ( const char * szName, ESphAttr eType )
+	{
+		tCol.m_sName = szName;
+		tCol.m_eAttrType = eType;
+		tSrcSchema.AddAttr ( tCol, true );
+	}
+
+	CSphSchema IndexSchema () const
+	{
+		CSphSchema tSchema;
+		for ( int i=0; i<tSrcSchema.GetFieldsCount(); i++ )
+			tSchema.AddField ( tSrcSchema.GetField(i) );
+
+		bool bHasBlobs = false;
+		for ( int i=0; i<tSrcSchema.GetAttrsCount(); i++ )
+			bHasBlobs |= sphIsBlobAttr ( tSrcSchema.GetAttr(i).m_eAttrType );
+
+		for ( int i=0; i<tSrcSchema.GetAttrsCount(); i++ )
+		{
+			tSchema.AddAttr ( tSrcSchema.GetAttr(i), false );
+
+			// strings are kept in blobs, and their locator goes right after docid
+			if ( !i && bHasBlobs )
+				tSchema.AddAttr ( CSphColumnInfo ( sphGetBlobLocatorName(), SPH_ATTR_BIGINT ), false );
+		}
+
+		return tSchema;
+	}
+
+	static const int * FieldLengths ( MockTestDoc_c * pSrc ) { return pSrc->m_dFieldLengths.Begin(); }
+	static const int * FieldLengths ( MockDocRandomizer_c * pSrc ) { return pSrc->m_dFieldLengths; }
+
+	template<typename SOURCE>
+	bool StartSource ( SOURCE * pSrc, CSphDict * pDict )
+	{
+		using namespace testing;
+		EXPECT_CALL ( *pSrc, Connect ( _ ) ).WillOnce ( Return ( true ) );
+		EXPECT_CALL ( *pSrc, GetFieldLengths () ).WillRepeatedly ( Return ( FieldLengths ( pSrc ) ) );
+		EXPECT_CALL ( *pSrc, Disconnect () );
+
+		pSrc->SetTokenizer ( pTok );
+		pSrc->SetDict ( pDict );
+		pSrc->Setup ( CSphSourceSettings() );
+
+		return pSrc->Connect ( sError ) && pSrc->IterateStart ( sError ) && pSrc->UpdateSchema ( &tSrcSchema, sError );
+	}
+
+	// index gets its own clones of tokenizer and dict, as source still needs them
+	RtIndex_i * CreateIndex ( int64_t iRamSize, bool bKeywordDict, CSphDict * pDict, const CSphIndexSettings * pSettings = nullptr,
+		const MutableIndexSettings_c * pMutable = nullptr )
+	{
+		RtIndex_i * pIndex = sphCreateIndexRT ( IndexSchema(), "testrt", iRamSize, RT_INDEX_FILE_NAME, bKeywordDict );
+		if ( pSettings )
+			pIndex->Setup ( *pSettings );
+
+		// prealloc takes RAM limit from mutable settings, not the one index was created with
+		MutableIndexSettings_c tMutable;
+		if ( pMutable )
+			tMutable = *pMutable;
+		tMutable.m_iMemLimit = iRamSize;
+		pIndex->SetMutableSettings ( tMutable );
+
+		pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+		pIndex->SetDictionary ( pDict->Clone () );
+		pIndex->PostSetup ();
+		StrVec_t dWarnings;
+		EXPECT_TRUE ( pIndex->Prealloc ( false, nullptr, dWarnings ) );
+		return pIndex;
+	}
+
+	// index hands out its thread local accumulator when no external one is given; tests need own ones
+	RtAccum_t * CreateOwnAccum ( RtIndex_i * pIndex, bool bKeywordDict )
+	{
+		auto * pAcc = new RtAccum_t ( bKeywordDict );
+		EXPECT_EQ ( pIndex->CreateAccum ( pAcc, sError ), pAcc );
+		return pAcc;
+	}
+
+	// adds all the docs of the source; commits each one when no accum given
+	template<typename SOURCE>
+	bool IndexDocs ( SOURCE * pSrc, RtIndex_i * pIndex, RtAccum_t * pAcc = nullptr )
+	{
+		CSphString sFilter;
+		CSphVector<int64_t> dMvas;
+		bool bEOF = false;
+		while ( pSrc->IterateDocument ( bEOF, sError ) && !bEOF )
+		{
+			pIndex->AddDocument ( pSrc->GetFields(), pSrc->m_tDocInfo, false, sFilter, nullptr, dMvas, sError, sWarning, pAcc );
+			if ( !pAcc )
+				pIndex->Commit ( nullptr, nullptr );
+		}
+		pSrc->Disconnect ();
+		return bEOF && ( !pAcc || pIndex->Commit ( nullptr, pAcc ) );
+	}
+
+	struct SearchResult_t
+	{
+		CSphVector<std::pair<SphAttr_t,int64_t>> m_dMatches;	///< rowid and weight, or group key and count
+		int64_t m_iTotal = -1;									///< total found, or -1 if the query failed
+	};
+
+	// runs the prepared query with a single sorter and flattens its matches
+	static SearchResult_t Search ( RtIndex_i * pIndex, CSphQuery & tQuery )
+	{
+		AggrResult_t tResult;
+		CSphQueryResult tQueryResult;
+		tQueryResult.m_pMeta = &tResult;
+		CSphMultiQueryArgs tArgs ( 1 );
+		tQuery.m_pQueryParser = sphCreatePlainQueryParser();
+
+		SphQueueSettings_t tQueueSettings ( pIndex->GetMatchSchema () );
+		tQueueSettings.m_iMaxMatches = tQuery.m_iMaxMatches;
+		tQueueSettings.m_bComputeItems = !tQuery.m_dItems.IsEmpty();
+		SphQueueRes_t tQueueRes;
+		ISphMatchSorter * pSorter = sphCreateQueue ( tQueueSettings, tQuery, tResult.m_sError, tQueueRes );
+
+		SearchResult_t tRes;
+		if ( pSorter && pIndex->MultiQuery ( tQueryResult, tQuery, { &pSorter, 1 }, tArgs ) )
+		{
+			tRes.m_iTotal = pSorter->m_iTotal;
+			const CSphColumnInfo * pGroupBy = pSorter->GetSchema()->GetAttr ( "@groupby" );
+			const CSphColumnInfo * pCount = pSorter->GetSchema()->GetAttr ( "@count" );
+
+			CSphFixedVector<CSphMatch> dMatches ( pSorter->GetLength() );
+			int iMatches = pSorter->Flatten ( dMatches.Begin() );
+			for ( int i=0; i<iMatches; ++i )
+				if ( pGroupBy && pCount )
+					tRes.m_dMatches.Add ( { dMatches[i].GetAttr ( pGroupBy->m_tLocator ), dMatches[i].GetAttr ( pCount->m_tLocator ) } );
+				else
+					tRes.m_dMatches.Add ( { dMatches[i].m_tRowID, dMatches[i].m_iWeight } );
+		}
+
+		SafeDelete ( pSorter );
+		SafeDelete ( tQuery.m_pQueryParser );
+		return tRes;
+	}
+
+	static int64_t CountMatches ( RtIndex_i * pIndex, const char * szQuery )
+	{
+		CSphQuery tQuery;
+		tQuery.m_sQuery = szQuery;
+		return Search ( pIndex, tQuery ).m_iTotal;
+	}
+
 	CSphColumnInfo tCol;
 	CSphSchema tSrcSchema;
 	CSphString sError, sWarning;
@@ -632,4 +782,780 @@ TEST_F ( RT, SendVsMerge )
 	SafeDelete ( pIndex );
 	SafeDelete ( pSrc );
 	pTok = nullptr; // owned and deleted by index
-}
\ No newline at end of file
+}
+
+static int g_iMergeHookCalls = 0;
+static void MockScheduleMerge ( const CSphString & )
+{
+	++g_iMergeHookCalls;
+}
+
+TEST_F ( RT, BackgroundMergeSegments )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+	AddSrcAttr ( "tag2", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, false, pDict ) };
+
+	// commits only append segments and ask for the merge
+	g_iMergeHookCalls = 0;
+	SetRtMergeSegmentsHook ( MockScheduleMerge );
+	ASSERT_TRUE ( IndexDocs ( pSrc.Ptr(), pIndex.Ptr() ) );
+
+	CSphIndexStatus tBefore;
+	pIndex->GetStatus ( &tBefore );
+	ASSERT_GE ( g_iMergeHookCalls, 1 );
+	ASSERT_GE ( tBefore.m_iMergesPending, 1 );
+	ASSERT_LE ( tBefore.m_iNumRamChunks, 32 );
+
+	// that is what merge task does
+	pIndex->MergeRamSegments ();
+	SetRtMergeSegmentsHook ( nullptr );
+
+	CSphIndexStatus tAfter;
+	pIndex->GetStatus ( &tAfter );
+	ASSERT_LT ( tAfter.m_iNumRamChunks, tBefore.m_iNumRamChunks );
+	ASSERT_GT ( tAfter.m_iMergesDone, 0 );
+	ASSERT_EQ ( tAfter.m_iMergesPending, 0 );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, 801 );
+}
+
+static int g_iSaveHookCalls = 0;
+static void MockScheduleSave ( const CSphString & )
+{
+	++g_iSaveHookCalls;
+}
+
+TEST_F ( RT, BackgroundSaveDiskChunk )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+	AddSrcAttr ( "tag2", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 128 * 1024, false, pDict ) };
+
+	// commits only freeze RAM chunk and ask for the save
+	g_iSaveHookCalls = 0;
+	SetRtSaveDiskChunkHook ( MockScheduleSave );
+
+	int iSaved = 0;
+	CSphString sFilter;
+	CSphVector<int64_t> dMvas;
+	bool bEOF = false;
+	while (true)
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		if ( bEOF )
+			break;
+
+		pIndex->AddDocument ( pSrc->GetFields (), pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, NULL );
+		pIndex->Commit ( NULL, NULL );
+
+		if ( g_iSaveHookCalls==iSaved )
+			continue;
+
+		// writer already returned, but disk chunk isn't here yet
+		CSphIndexStatus tFrozen;
+		pIndex->GetStatus ( &tFrozen );
+		ASSERT_EQ ( tFrozen.m_iNumChunks, iSaved );
+
+		// that is what save task does
+		pIndex->SaveFrozenRamChunk ();
+		++iSaved;
+
+		CSphIndexStatus tSaved;
+		pIndex->GetStatus ( &tSaved );
+		ASSERT_EQ ( tSaved.m_iNumChunks, iSaved );
+	}
+	pSrc->Disconnect ();
+	SetRtSaveDiskChunkHook ( nullptr );
+
+	ASSERT_GE ( iSaved, 1 );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, 801 );
+}
+
+TEST_F ( RT, TruncateWhileSaveDiskChunk )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+	AddSrcAttr ( "tag2", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 128 * 1024, false, pDict ) };
+
+	g_iSaveHookCalls = 0;
+	SetRtSaveDiskChunkHook ( MockScheduleSave );
+
+	// commit till RAM chunk gets frozen, then keep committing into the double buffer a bit
+	CSphString sFilter;
+	CSphVector<int64_t> dMvas;
+	bool bEOF = false;
+	int iAfterFreeze = 0;
+	while ( iAfterFreeze<10 )
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		ASSERT_FALSE ( bEOF );
+
+		pIndex->AddDocument ( pSrc->GetFields (), pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, NULL );
+		pIndex->Commit ( NULL, NULL );
+		if ( g_iSaveHookCalls )
+			++iAfterFreeze;
+	}
+
+	ASSERT_TRUE ( pIndex->Truncate ( sError ) );
+
+	// the task scheduled before truncate finds nothing to save
+	pIndex->SaveFrozenRamChunk ();
+
+	CSphIndexStatus tStatus;
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_EQ ( tStatus.m_iNumChunks, 0 );
+	ASSERT_EQ ( tStatus.m_iNumRamChunks, 0 );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, 0 );
+
+	// and commits after truncate start from the clean RAM chunk
+	int iDocs = 0;
+	while (true)
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		if ( bEOF )
+			break;
+
+		pIndex->AddDocument ( pSrc->GetFields (), pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, NULL );
+		pIndex->Commit ( NULL, NULL );
+		++iDocs;
+		if ( g_iSaveHookCalls>1 )
+			pIndex->SaveFrozenRamChunk ();
+	}
+	pSrc->Disconnect ();
+	SetRtSaveDiskChunkHook ( nullptr );
+
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, iDocs );
+}
+
+TEST_F ( RT, DocidChunkMap )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+
+	MutableIndexSettings_c tMutable;
+	tMutable.m_bDocidMap = true;
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 128 * 1024, false, pDict, nullptr, &tMutable ) };
+
+	CSphString sFilter;
+	CSphVector<int64_t> dMvas;
+	CSphVector<DocID_t> dDocs;
+	bool bEOF = false;
+	while (true)
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		if ( bEOF )
+			break;
+
+		dDocs.Add ( sphGetDocID ( pSrc->m_tDocInfo.m_pDynamic ) );
+		pIndex->AddDocument ( pSrc->GetFields (), pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, NULL );
+		pIndex->Commit ( NULL, NULL );
+
+		// a few disk chunks, and the rest stays in RAM segments
+		if ( dDocs.GetLength()%250==0 )
+			pIndex->ForceDiskChunk();
+	}
+	pSrc->Disconnect ();
+
+	CSphIndexStatus tStatus;
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_GE ( tStatus.m_iNumChunks, 2 );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, dDocs.GetLength() );
+
+	// every other doc, spread over all the chunks and RAM segments
+	CSphVector<DocID_t> dKill;
+	for ( int i=0; i<dDocs.GetLength(); i+=2 )
+		dKill.Add ( dDocs[i] );
+	dKill.Add ( dDocs.Last()+100 ); // absent
+
+	int iDeleted = 0;
+	ASSERT_TRUE ( pIndex->DeleteDocument ( dKill, sError, nullptr ) );
+	ASSERT_TRUE ( pIndex->Commit ( &iDeleted, nullptr ) );
+	ASSERT_EQ ( iDeleted, dKill.GetLength()-1 );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, dDocs.GetLength()-iDeleted );
+
+	// stale entries kill nothing
+	ASSERT_TRUE ( pIndex->DeleteDocument ( dKill, sError, nullptr ) );
+	ASSERT_TRUE ( pIndex->Commit ( &iDeleted, nullptr ) );
+	ASSERT_EQ ( iDeleted, 0 );
+
+	// chunk filters are counted as used RAM, and dropped once map gets disabled
+	CSphIndexStatus tMapped;
+	pIndex->GetStatus ( &tMapped );
+
+	tMutable.m_bDocidMap = false;
+	pIndex->SetMutableSettings ( tMutable );
+	ASSERT_TRUE ( pIndex->DeleteDocument ( dKill, sError, nullptr ) );
+	ASSERT_TRUE ( pIndex->Commit ( &iDeleted, nullptr ) );
+	ASSERT_EQ ( iDeleted, 0 );
+
+	CSphIndexStatus tUnmapped;
+	pIndex->GetStatus ( &tUnmapped );
+	ASSERT_LT ( tUnmapped.m_iRamUse-tUnmapped.m_iRamChunkSize, tMapped.m_iRamUse-tMapped.m_iRamChunkSize );
+}
+
+TEST_F ( RT, BulkCommit )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, false, pDict ) };
+
+	CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), false ) };
+	ASSERT_TRUE ( pAcc.Ptr() );
+	pAcc->m_bBulk = true;
+
+	// half goes as usual commit, so bulk one has to flush RAM chunk first
+	CSphString sFilter;
+	CSphVector<int64_t> dMvas;
+	bool bEOF = false;
+	int iDocs = 0;
+	while (true)
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		if ( bEOF )
+			break;
+
+		++iDocs;
+		RtAccum_t * pDocAcc = ( iDocs<=400 ? nullptr : pAcc.Ptr() );
+		pIndex->AddDocument ( pSrc->GetFields (), pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, pDocAcc );
+		if ( !pDocAcc )
+			pIndex->Commit ( NULL, NULL );
+	}
+	pSrc->Disconnect ();
+
+	CSphIndexStatus tStatus;
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_EQ ( tStatus.m_iNumChunks, 0 );
+
+	ASSERT_TRUE ( pIndex->Commit ( NULL, pAcc.Ptr() ) );
+
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_EQ ( tStatus.m_iNumChunks, 2 );
+	ASSERT_EQ ( tStatus.m_iRamChunkSize, 0 );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, iDocs );
+}
+
+TEST_F ( RT, AccumAppend )
+{
+	tDictSettings.m_bWordDict = true;
+	DictRefPtr_c pDict { sphCreateDictionaryKeywords ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag", SPH_ATTR_STRING );
+
+	// both halves start with different keywords, so their packed keyword offsets differ
+	const char * dFields[] = { "black cat", "sleeps", "white dog", "barks", "white cat", "sleeps", "black dog", "runs" };
+	CSphScopedPtr<MockTestDoc_c> pSrc { new MockTestDoc_c ( tSrcSchema, ( BYTE ** ) dFields, 4, 2 ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, true, pDict ) };
+
+	CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), true ) };
+	CSphScopedPtr<RtAccum_t> pJobAcc { CreateOwnAccum ( pIndex.Ptr(), true ) };
+
+	const char * dTags[] = { "first", "second", "third", "fourth" };
+	CSphVector<int64_t> dMvas;
+	CSphString sFilter;
+	bool bEOF = false;
+	for ( int iDoc=0; ; ++iDoc )
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		if ( bEOF )
+			break;
+
+		const char * dStr[] = { dTags[iDoc] };
+		pIndex->AddDocument ( pSrc->GetFields(), pSrc->m_tDocInfo, false, sFilter, dStr, dMvas, sError, sWarning, iDoc<2 ? pAcc.Ptr() : pJobAcc.Ptr() );
+	}
+	pSrc->Disconnect ();
+
+	pAcc->Append ( *pJobAcc.Ptr() );
+	ASSERT_EQ ( pAcc->m_uAccumDocs, 4u );
+	ASSERT_EQ ( pJobAcc->m_uAccumDocs, 0u );
+	ASSERT_TRUE ( pIndex->Commit ( NULL, pAcc.Ptr() ) );
+	ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, 4 );
+
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "white" ), 2 );
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "black cat" ), 1 );
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "sleeps" ), 2 );
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "runs" ), 1 );
+}
+
+TEST_F ( RT, PruneByWeight )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+
+	// a few rare 'bird' docs to fill the queue, then a lot of 'cat' ones with varying tf
+	const int DOCS = 200;
+	CSphVector<CSphString> dTexts;
+	for ( int i=0; i<DOCS; ++i )
+	{
+		StringBuilder_c sTitle;
+		if ( i%25==0 )
+			sTitle << "bird ";
+		for ( int j=0; j<=i%4; ++j )
+			sTitle << "cat ";
+		sTitle.Sprintf ( "filler%d", i );
+		dTexts.Add ( sTitle.cstr() );
+		dTexts.Add ( "content" );
+	}
+
+	CSphVector<const char *> dFields;
+	for ( const auto & sText : dTexts )
+		dFields.Add ( sText.cstr() );
+
+	CSphScopedPtr<MockTestDoc_c> pSrc { new MockTestDoc_c ( tSrcSchema, ( BYTE ** ) dFields.Begin(), DOCS, 2 ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, true, pDict ) };
+
+	CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), true ) };
+	ASSERT_TRUE ( IndexDocs ( pSrc.Ptr(), pIndex.Ptr(), pAcc.Ptr() ) );
+
+	auto fnSearch = [&pIndex] ( ESphRankMode eRanker, bool bPrune )
+	{
+		CSphQuery tQuery;
+		tQuery.m_sQuery = "bird | cat";
+		tQuery.m_eRanker = eRanker;
+		tQuery.m_iMaxMatches = 4;
+		tQuery.m_bPruneByWeight = bPrune;
+		return Search ( pIndex.Ptr(), tQuery );
+	};
+
+	for ( auto eRanker : { SPH_RANK_BM25, SPH_RANK_PROXIMITY_BM25 } )
+	{
+		SearchResult_t tFull = fnSearch ( eRanker, false );
+		SearchResult_t tPruned = fnSearch ( eRanker, true );
+
+		// same top matches, but less docs evaluated
+		ASSERT_EQ ( tFull.m_iTotal, DOCS );
+		ASSERT_EQ ( tFull.m_dMatches.GetLength(), 4 );
+		ASSERT_EQ ( tPruned.m_dMatches.GetLength(), 4 );
+		for ( int i=0; i<4; ++i )
+		{
+			ASSERT_EQ ( tFull.m_dMatches[i].first, tPruned.m_dMatches[i].first );
+			ASSERT_EQ ( tFull.m_dMatches[i].second, tPruned.m_dMatches[i].second );
+		}
+		ASSERT_LT ( tPruned.m_iTotal, tFull.m_iTotal );
+	}
+}
+
+TEST_F ( RT, PreloadDict )
+{
+	tDictSettings.m_bWordDict = true;
+	DictRefPtr_c pDict { sphCreateDictionaryKeywords ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+
+	// enough distinct keywords to span several dictionary checkpoints
+	const int DOCS = 200;
+	CSphVector<CSphString> dTexts;
+	for ( int i=0; i<DOCS; ++i )
+	{
+		dTexts.Add().SetSprintf ( "word%03d", i );
+		dTexts.Add ( ( i%2 ) ? "apple" : "apricot" );
+	}
+
+	CSphVector<const char *> dFields;
+	for ( const auto & sText : dTexts )
+		dFields.Add ( sText.cstr() );
+
+	CSphScopedPtr<MockTestDoc_c> pSrc { new MockTestDoc_c ( tSrcSchema, ( BYTE ** ) dFields.Begin(), DOCS, 2 ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+
+	CSphIndexSettings tSettings;
+	tSettings.SetMinPrefixLen ( 1 );
+	MutableIndexSettings_c tMutable;
+
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, true, pDict, &tSettings, &tMutable ) };
+	{
+		CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), true ) };
+		ASSERT_TRUE ( IndexDocs ( pSrc.Ptr(), pIndex.Ptr(), pAcc.Ptr() ) );
+	}
+
+	// words go to the disk chunk dictionary
+	ASSERT_TRUE ( pIndex->ForceDiskChunk() );
+	pIndex = nullptr;
+
+	for ( bool bPreload : { false, true } )
+	{
+		tMutable.m_bPreloadDict = bPreload;
+		pIndex = CreateIndex ( 32 * 1024 * 1024, true, pDict, &tSettings, &tMutable );
+		ASSERT_EQ ( pIndex->GetStats().m_iTotalDocuments, DOCS );
+
+		// disk chunk took the preloaded path, and its wordlist is accounted as RAM
+		CSphIndexStatus tStatus;
+		pIndex->GetStatus ( &tStatus );
+		if ( bPreload )
+		{
+			ASSERT_GT ( tStatus.m_iPreloadedDict, 0 );
+			ASSERT_GT ( tStatus.m_iRamUse, tStatus.m_iPreloadedDict );
+		} else
+		{
+			ASSERT_EQ ( tStatus.m_iPreloadedDict, 0 );
+		}
+
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "apple" ), DOCS/2 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word150" ), 1 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word2000" ), 0 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "absent" ), 0 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "zzz" ), 0 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "ap*" ), DOCS );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "apr*" ), DOCS/2 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word1*" ), 100 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word05*" ), 10 );
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word2*" ), 0 );
+
+		pIndex = nullptr;
+	}
+}
+
+// repeated wildcards against a disk chunk are served from the expansion cache, even the large ones
+TEST_F ( RT, ExpansionCache )
+{
+	tDictSettings.m_bWordDict = true;
+	DictRefPtr_c pDict { sphCreateDictionaryKeywords ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+
+	// 'word*' expands to every doc's own keyword, and takes more than a megabyte in cache
+	const int DOCS = 50000;
+	CSphVector<CSphString> dTexts;
+	for ( int i=0; i<DOCS; ++i )
+	{
+		dTexts.Add().SetSprintf ( "word%05d", i );
+		dTexts.Add ( ( i%2 ) ? "apple" : "apricot" );
+	}
+
+	CSphVector<const char *> dFields;
+	for ( const auto & sText : dTexts )
+		dFields.Add ( sText.cstr() );
+
+	CSphScopedPtr<MockTestDoc_c> pSrc { new MockTestDoc_c ( tSrcSchema, ( BYTE ** ) dFields.Begin(), DOCS, 2 ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+
+	CSphIndexSettings tSettings;
+	tSettings.SetMinPrefixLen ( 1 );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 64 * 1024 * 1024, true, pDict, &tSettings ) };
+	{
+		CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), true ) };
+		ASSERT_TRUE ( IndexDocs ( pSrc.Ptr(), pIndex.Ptr(), pAcc.Ptr() ) );
+	}
+	ASSERT_TRUE ( pIndex->ForceDiskChunk() );
+
+	SetExpansionCacheSize ( 0 );
+	SetExpansionCacheSize ( 16 * 1024 * 1024 );
+	ExpansionCacheStatus_t tStart = GetExpansionCacheStatus();
+	ASSERT_EQ ( tStart.m_iUsedBytes, 0 );
+	ASSERT_GT ( tStart.m_iShards, 1 );
+
+	int64_t iEntryBytes = 0;
+	for ( const char * szQuery : { "ap*", "word1*", "word*" } )
+	{
+		ExpansionCacheStatus_t tBefore = GetExpansionCacheStatus();
+		int64_t iMatches = CountMatches ( pIndex.Ptr(), szQuery );
+		ExpansionCacheStatus_t tMiss = GetExpansionCacheStatus();
+		ASSERT_EQ ( tMiss.m_iMisses, tBefore.m_iMisses+1 ) << szQuery;
+		ASSERT_EQ ( tMiss.m_iHits, tBefore.m_iHits ) << szQuery;
+		ASSERT_GT ( tMiss.m_iUsedBytes, tBefore.m_iUsedBytes ) << szQuery;
+		iEntryBytes = tMiss.m_iUsedBytes - tBefore.m_iUsedBytes;
+
+		ASSERT_EQ ( CountMatches ( pIndex.Ptr(), szQuery ), iMatches ) << szQuery;
+		ExpansionCacheStatus_t tHit = GetExpansionCacheStatus();
+		ASSERT_EQ ( tHit.m_iHits, tMiss.m_iHits+1 ) << szQuery;
+		ASSERT_EQ ( tHit.m_iMisses, tMiss.m_iMisses ) << szQuery;
+	}
+
+	// last one is larger than 16M split into 16 shards would fit
+	ASSERT_GT ( iEntryBytes, 1024 * 1024 );
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "ap*" ), DOCS );
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word1*" ), 10000 );
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "word*" ), DOCS );
+
+	SetExpansionCacheSize ( 16 * 1024 * 1024 );
+}
+
+// sets 'gid' attribute to docid modulo the number of groups
+class MockGroupDoc_c : public MockTestDoc_c
+{
+public:
+	MockGroupDoc_c ( const CSphSchema & tSchema, BYTE ** ppDocs, int iDocs, int iFields, int iGroups )
+		: MockTestDoc_c ( tSchema, ppDocs, iDocs, iFields )
+		, m_iGroups ( iGroups )
+	{}
+
+	BYTE ** NextDocument ( bool & bEOF, CSphString & sError ) override
+	{
+		BYTE ** ppDoc = MockTestDoc_c::NextDocument ( bEOF, sError );
+		if ( ppDoc )
+			m_tDocInfo.SetAttr ( m_tSchema.GetAttr("gid")->m_tLocator, ( m_iDocsCounter+1 ) % m_iGroups );
+		return ppDoc;
+	}
+
+	int m_iGroups;
+};
+
+TEST_F ( RT, PseudoShardedQuery )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "gid", SPH_ATTR_INTEGER );
+
+	// just enough docs for the disk chunk to be split into 2 pseudo-shards
+	const int DOCS = 2*65536;
+	const int GROUPS = 13;
+	const char * dTexts[] = { "cat cat dog", "filler", "cat", "filler", "dog", "filler", "cat dog", "filler cat" };
+	CSphVector<const char *> dFields;
+	for ( int i=0; i<DOCS; ++i )
+	{
+		int iText = ( i*7 ) % 4;
+		dFields.Add ( dTexts[iText*2] );
+		dFields.Add ( dTexts[iText*2+1] );
+	}
+
+	CSphScopedPtr<MockGroupDoc_c> pSrc { new MockGroupDoc_c ( tSrcSchema, ( BYTE ** ) dFields.Begin(), DOCS, 2, GROUPS ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 256 * 1024 * 1024, false, pDict ) };
+	{
+		CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), false ) };
+		ASSERT_TRUE ( IndexDocs ( pSrc.Ptr(), pIndex.Ptr(), pAcc.Ptr() ) );
+	}
+	ASSERT_TRUE ( pIndex->ForceDiskChunk() );
+
+	auto fnSearch = [&pIndex] ( const char * szQuery, int iConcurrency, bool bGroup, int iCutoff )
+	{
+		CSphQuery tQuery;
+		tQuery.m_sQuery = szQuery;
+		tQuery.m_iCouncurrency = iConcurrency;
+		tQuery.m_iCutoff = iCutoff;
+		tQuery.m_iMaxMatches = 50;
+		if ( bGroup )
+			tQuery.m_sGroupBy = "gid";
+
+		CSphQueryItem & tItem = tQuery.m_dItems.Add ();
+		tItem.m_sExpr = "*";
+		tItem.m_sAlias = "*";
+		tQuery.m_sSelect = "*";
+		return Search ( pIndex.Ptr(), tQuery );
+	};
+
+	for ( const char * szQuery : { "cat", "cat | dog", "" } )
+		for ( bool bGroup : { false, true } )
+			for ( int iCutoff : { 0, 1000 } )
+			{
+				SearchResult_t tSingle = fnSearch ( szQuery, 1, bGroup, iCutoff );
+				SearchResult_t tSharded = fnSearch ( szQuery, 4, bGroup, iCutoff );
+
+				ASSERT_GT ( tSingle.m_iTotal, 0 );
+				ASSERT_LE ( tSingle.m_iTotal, iCutoff ? iCutoff : DOCS );
+				ASSERT_EQ ( tSingle.m_dMatches.GetLength(), bGroup ? GROUPS : 50 );
+
+				ASSERT_EQ ( tSingle.m_iTotal, tSharded.m_iTotal ) << szQuery;
+				ASSERT_EQ ( tSingle.m_dMatches.GetLength(), tSharded.m_dMatches.GetLength() ) << szQuery;
+				ARRAY_FOREACH ( i, tSingle.m_dMatches )
+				{
+					ASSERT_EQ ( tSingle.m_dMatches[i].first, tSharded.m_dMatches[i].first ) << szQuery << " match " << i;
+					ASSERT_EQ ( tSingle.m_dMatches[i].second, tSharded.m_dMatches[i].second ) << szQuery << " match " << i;
+				}
+			}
+}
+
+// result cache key carries the index generation; any visible change must make the old entry unreachable
+TEST_F ( RT, ResultCacheInvalidation )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, false, pDict ) };
+	CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), false ) };
+
+	CSphString sFilter;
+	CSphVector<int64_t> dMvas;
+	bool bEOF = false;
+	auto fnAddDoc = [&]
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( bEOF, sError ) );
+		ASSERT_FALSE ( bEOF );
+		pIndex->AddDocument ( pSrc->GetFields (), pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, pAcc.Ptr() );
+		pIndex->Commit ( NULL, pAcc.Ptr() );
+	};
+
+	for ( int i=0; i<100; ++i )
+		fnAddDoc();
+
+	auto fnKey = [&pIndex]
+	{
+		ISphOutputBuffer tKey;
+		tKey.SendString ( "select * from testrt where match('cat')" );
+		ResultCacheKeyAddIndex ( tKey, *pIndex );
+
+		CSphVector<BYTE> dKey;
+		tKey.SwapData ( dKey );
+		return dKey;
+	};
+
+	auto fnStore = [&fnKey]
+	{
+		CSphFixedVector<AggrResult_t> dRes { 1 };
+		dRes[0].m_iSuccesses = 1;
+		dRes[0].m_iTotalMatches = 100;
+		dRes[0].m_dResults.Add();
+		ResultCacheAdd ( fnKey(), dRes, 0 );
+	};
+
+	auto fnHit = [&fnKey]
+	{
+		CSphFixedVector<AggrResult_t> dRes { 1 };
+		return ResultCacheFind ( fnKey(), dRes );
+	};
+
+	ResultCacheSetup ( 1024 * 1024, 0 );
+
+	fnStore();
+	ASSERT_TRUE ( fnHit() );
+
+	// a search does not change anything
+	ASSERT_EQ ( CountMatches ( pIndex.Ptr(), "cat" ), 100 );
+	ASSERT_TRUE ( fnHit() );
+
+	// commit
+	fnAddDoc();
+	ASSERT_FALSE ( fnHit() );
+	fnStore();
+	ASSERT_TRUE ( fnHit() );
+
+	// update
+	CSphAttrUpdate tUpd;
+	tUpd.m_dAttributes.Add ( { "tag1", SPH_ATTR_INTEGER } );
+	tUpd.m_dDocids.Add ( 1001 );
+	tUpd.m_dRowOffset.Add ( 0 );
+	tUpd.m_dPool.Add ( 42 );
+	bool bCritical = false;
+	ASSERT_EQ ( pIndex->UpdateAttributes ( tUpd, -1, bCritical, FNLOCKER(), sError, sWarning ), 1 );
+	ASSERT_FALSE ( fnHit() );
+	fnStore();
+	ASSERT_TRUE ( fnHit() );
+
+	// truncate
+	ASSERT_TRUE ( pIndex->Truncate ( sError ) );
+	ASSERT_FALSE ( fnHit() );
+
+	pSrc->Disconnect ();
+	ResultCacheSetup ( 0, 0 );
+}
+
+// disk chunks are served from the query cache by their own ids; kills apply on top of cached matches, updates and alters must drop those entries
+TEST_F ( RT, QcacheDiskChunkInvalidation )
+{
+	DictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", false, 32, nullptr, sError ) };
+
+	AddSrcAttr ( "id", SPH_ATTR_BIGINT );
+	AddSrcAttr ( "tag1", SPH_ATTR_INTEGER );
+
+	CSphScopedPtr<MockDocRandomizer_c> pSrc { new MockDocRandomizer_c ( tSrcSchema ) };
+	ASSERT_TRUE ( StartSource ( pSrc.Ptr(), pDict ) );
+	CSphScopedPtr<RtIndex_i> pIndex { CreateIndex ( 32 * 1024 * 1024, false, pDict ) };
+	CSphScopedPtr<RtAccum_t> pAcc { CreateOwnAccum ( pIndex.Ptr(), false ) };
+	ASSERT_TRUE ( IndexDocs ( pSrc.Ptr(), pIndex.Ptr(), pAcc.Ptr() ) );
+	ASSERT_TRUE ( pIndex->ForceDiskChunk() );
+	int64_t iDocs = pIndex->GetStats().m_iTotalDocuments;
+
+	// cache every query, starting from the empty cache
+	QcacheStatus_t tDefaults = QcacheGetStatus();
+	QcacheSetup ( 0, 0, 60 );
+	QcacheSetup ( 16 * 1024 * 1024, 0, 60 );
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 0 );
+
+	auto fnSearch = [&pIndex]
+	{
+		CSphQuery tQuery;
+		tQuery.m_sQuery = "cat";
+		SearchResult_t tRes = Search ( pIndex.Ptr(), tQuery );
+		EXPECT_EQ ( tRes.m_dMatches.GetLength(), tRes.m_iTotal );
+		return tRes.m_iTotal;
+	};
+
+	ASSERT_EQ ( fnSearch(), iDocs );
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 1 );
+
+	int64_t iHits = QcacheGetStatus().m_iHits;
+	ASSERT_EQ ( fnSearch(), iDocs );
+	ASSERT_EQ ( QcacheGetStatus().m_iHits, iHits+1 );
+
+	// delete from the cached chunk; the entry still hits, and the killed doc is gone
+	DocID_t dDeleted[] = { 1001 };
+	ASSERT_TRUE ( pIndex->DeleteDocument ( { dDeleted, 1 }, sError, pAcc.Ptr() ) ) << sError.cstr();
+	ASSERT_TRUE ( pIndex->Commit ( nullptr, pAcc.Ptr() ) );
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 1 );
+
+	ASSERT_EQ ( fnSearch(), iDocs-1 );
+	ASSERT_EQ ( QcacheGetStatus().m_iHits, iHits+2 );
+
+	// replace a doc of the cached chunk with one that does not match anymore
+	CSphMatch tDoc;
+	tDoc.Reset ( tSrcSchema.GetRowSize() );
+	tDoc.SetAttr ( tSrcSchema.GetAttr(0).m_tLocator, 1002 );
+	tDoc.SetAttr ( tSrcSchema.GetAttr(1).m_tLocator, 1313 );
+	const char * szTitle = "mouse";
+	const char * szContent = "dog";
+	VecTraits_T<const char> dFields[] = { { szTitle, (int64_t) strlen ( szTitle ) }, { szContent, (int64_t) strlen ( szContent ) } };
+	CSphString sFilter;
+	CSphVector<int64_t> dMvas;
+	ASSERT_TRUE ( pIndex->AddDocument ( { dFields, 2 }, tDoc, true, sFilter, nullptr, dMvas, sError, sWarning, pAcc.Ptr() ) ) << sError.cstr();
+	ASSERT_TRUE ( pIndex->Commit ( nullptr, pAcc.Ptr() ) );
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 1 );
+
+	ASSERT_EQ ( fnSearch(), iDocs-2 );
+	ASSERT_EQ ( QcacheGetStatus().m_iHits, iHits+3 );
+
+	// update
+	CSphAttrUpdate tUpd;
+	tUpd.m_dAttributes.Add ( { "tag1", SPH_ATTR_INTEGER } );
+	tUpd.m_dDocids.Add ( 1003 );
+	tUpd.m_dRowOffset.Add ( 0 );
+	tUpd.m_dPool.Add ( 42 );
+	bool bCritical = false;
+	ASSERT_EQ ( pIndex->UpdateAttributes ( tUpd, -1, bCritical, FNLOCKER(), sError, sWarning ), 1 );
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 0 );
+
+	ASSERT_EQ ( fnSearch(), iDocs-2 );
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 1 );
+
+	// alter
+	ASSERT_TRUE ( pIndex->AddRemoveAttribute ( true, "tag2", SPH_ATTR_INTEGER, sError ) ) << sError.cstr();
+	ASSERT_EQ ( QcacheGetStatus().m_iCachedQueries, 0 );
+
+	QcacheSetup ( 0, 0, 60 );
+	QcacheSetup ( tDefaults.m_iMaxBytes, tDefaults.m_iThreshMs, tDefaults.m_iTtlS );
+}
@@ -341,4 +341,445 @@ TEST_F ( CustomNetloop_c, test_usual_remove_23 )
 {
 	auto dOutdated = RemoveOutdated ( 1, 2 );
 	ARRAY_FOREACH ( i, dOutdated ) SafeDelete ( dOutdated[i] );
-}
\ No newline at end of file
+}
+
+//////////////////////////////////////////////////////////////////////////
+// result cache
+
+static void FillCacheTestResult ( AggrResult_t & tRes, int iMatches, const char * szTag )
+{
+	CSphSchema tSchema;
+	CSphColumnInfo tGid ( "gid", SPH_ATTR_INTEGER );
+	tSchema.AddAttr ( tGid, true );
+	CSphColumnInfo tTag ( "tag", SPH_ATTR_STRINGPTR );
+	tSchema.AddAttr ( tTag, true );
+
+	tRes.m_tSchema = tSchema;
+	tRes.m_iSuccesses = 1;
+	tRes.m_iTotalMatches = iMatches*10;
+	tRes.m_iCount = iMatches;
+	tRes.AddStat ( "hello", iMatches*10, iMatches*20 );
+
+	auto & tOne = tRes.m_dResults.Add();
+	tOne.m_tSchema = tSchema;
+	const CSphAttrLocator & tGidLoc = tSchema.GetAttr(0).m_tLocator;
+	const CSphAttrLocator & tTagLoc = tSchema.GetAttr(1).m_tLocator;
+	for ( int i = 0; i < iMatches; ++i )
+	{
+		CSphMatch & tMatch = tOne.m_dMatches.Add();
+		tMatch.Reset ( tSchema.GetDynamicSize() );
+		tMatch.m_tRowID = i;
+		tMatch.m_iWeight = 1000+i;
+		tMatch.SetAttr ( tGidLoc, i%7 );
+		tMatch.SetAttr ( tTagLoc, (SphAttr_t) sphPackPtrAttr ( { (const BYTE *) szTag, (int) strlen ( szTag ) } ) );
+	}
+}
+
+
+static CSphVector<BYTE> CacheTestKey ( int iKey )
+{
+	CSphVector<BYTE> dKey;
+	dKey.Resize ( sizeof(iKey) );
+	memcpy ( dKey.Begin(), &iKey, sizeof(iKey) );
+	return dKey;
+}
+
+
+TEST ( result_cache, hit_returns_same_results )
+{
+	ResultCacheSetup ( 0, 0 );
+	ResultCacheSetup ( 16*1024*1024, 0 );
+	ASSERT_TRUE ( ResultCacheEnabled() );
+	ResultCacheStatus_t tStart = ResultCacheGetStatus();
+
+	CSphFixedVector<AggrResult_t> dOrig { 1 };
+	FillCacheTestResult ( dOrig[0], 100, "the tag" );
+	ASSERT_TRUE ( ResultCacheCanStore ( dOrig[0] ) );
+
+	auto dKey = CacheTestKey ( 1 );
+	CSphFixedVector<AggrResult_t> dCached { 1 };
+	ASSERT_FALSE ( ResultCacheFind ( dKey, dCached ) );
+
+	ResultCacheAdd ( dKey, dOrig, 0 );
+	ASSERT_FALSE ( ResultCacheFind ( CacheTestKey ( 2 ), dCached ) );
+	ASSERT_TRUE ( ResultCacheFind ( dKey, dCached ) );
+
+	const AggrResult_t & tOrig = dOrig[0];
+	const AggrResult_t & tRes = dCached[0];
+	ASSERT_EQ ( tRes.m_iTotalMatches, tOrig.m_iTotalMatches );
+	ASSERT_EQ ( tRes.m_iCount, tOrig.m_iCount );
+	ASSERT_EQ ( tRes.m_iSuccesses, tOrig.m_iSuccesses );
+	ASSERT_EQ ( tRes.m_hWordStats.GetLength(), 1 );
+	ASSERT_EQ ( tRes.m_hWordStats["hello"].first, 1000 );
+	ASSERT_EQ ( tRes.m_tSchema.GetAttrsCount(), tOrig.m_tSchema.GetAttrsCount() );
+	ASSERT_EQ ( tRes.m_dResults.GetLength(), 1 );
+
+	const auto & dMatches = tRes.m_dResults.First().m_dMatches;
+	const auto & dOrigMatches = tOrig.m_dResults.First().m_dMatches;
+	ASSERT_EQ ( dMatches.GetLength(), dOrigMatches.GetLength() );
+
+	const CSphAttrLocator & tGid = tRes.m_tSchema.GetAttr(0).m_tLocator;
+	const CSphAttrLocator & tTag = tRes.m_tSchema.GetAttr(1).m_tLocator;
+	ARRAY_FOREACH ( i, dMatches )
+	{
+		ASSERT_EQ ( dMatches[i].m_tRowID, dOrigMatches[i].m_tRowID );
+		ASSERT_EQ ( dMatches[i].m_iWeight, dOrigMatches[i].m_iWeight );
+		ASSERT_EQ ( dMatches[i].GetAttr ( tGid ), dOrigMatches[i].GetAttr ( tOrig.m_tSchema.GetAttr(0).m_tLocator ) );
+
+		auto tStr = sphUnpackPtrAttr ( (const BYTE *) dMatches[i].GetAttr ( tTag ) );
+		ASSERT_EQ ( CSphString ( (const char *) tStr.first, tStr.second ), "the tag" );
+	}
+
+	ResultCacheStatus_t tStatus = ResultCacheGetStatus();
+	ASSERT_EQ ( tStatus.m_iCachedResults, 1 );
+	ASSERT_EQ ( tStatus.m_iHits, tStart.m_iHits+1 );
+	ASSERT_EQ ( tStatus.m_iMisses, tStart.m_iMisses+2 );
+
+	ResultCacheSetup ( 0, 0 );
+	ASSERT_FALSE ( ResultCacheEnabled() );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iUsedBytes, 0 );
+}
+
+
+TEST ( result_cache, eviction_respects_max_bytes )
+{
+	const int64_t iMaxBytes = 64*1024;
+	ResultCacheSetup ( 0, 0 );
+	ResultCacheSetup ( iMaxBytes, 0 );
+
+	// larger than the whole cache, never stored
+	CSphFixedVector<AggrResult_t> dHuge { 1 };
+	FillCacheTestResult ( dHuge[0], 10000, "huge" );
+	ResultCacheAdd ( CacheTestKey ( 0 ), dHuge, 0 );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iCachedResults, 0 );
+
+	const int iEntries = 100;
+	for ( int i = 1; i<=iEntries; ++i )
+	{
+		CSphFixedVector<AggrResult_t> dRes { 1 };
+		FillCacheTestResult ( dRes[0], 50, "small" );
+		ResultCacheAdd ( CacheTestKey ( i ), dRes, 0 );
+
+		ResultCacheStatus_t tStatus = ResultCacheGetStatus();
+		ASSERT_GT ( tStatus.m_iCachedResults, 0 );
+		ASSERT_LE ( tStatus.m_iUsedBytes, iMaxBytes );
+	}
+
+	// least recently used went first
+	ResultCacheStatus_t tStatus = ResultCacheGetStatus();
+	ASSERT_LT ( tStatus.m_iCachedResults, iEntries );
+
+	CSphFixedVector<AggrResult_t> dRes { 1 };
+	ASSERT_FALSE ( ResultCacheFind ( CacheTestKey ( 1 ), dRes ) );
+	ASSERT_TRUE ( ResultCacheFind ( CacheTestKey ( iEntries ), dRes ) );
+
+	// shrinking evicts right away
+	ResultCacheSetup ( iMaxBytes/4, 0 );
+	ASSERT_LE ( ResultCacheGetStatus().m_iUsedBytes, iMaxBytes/4 );
+
+	ResultCacheSetup ( 0, 0 );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iCachedResults, 0 );
+}
+
+
+TEST ( result_cache, thresh_skips_cheap_results )
+{
+	ResultCacheSetup ( 0, 0 );
+	ResultCacheSetup ( 16*1024*1024, 100 );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iThreshMs, 100 );
+
+	CSphFixedVector<AggrResult_t> dRes { 1 };
+	FillCacheTestResult ( dRes[0], 10, "cheap" );
+	ResultCacheAdd ( CacheTestKey ( 1 ), dRes, 99*1000 );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iCachedResults, 0 );
+
+	ResultCacheAdd ( CacheTestKey ( 1 ), dRes, 100*1000 );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iCachedResults, 1 );
+
+	ResultCacheSetup ( 0, 0 );
+}
+
+
+TEST ( result_cache, volatile_queries_not_cached )
+{
+	CSphQuery tQuery;
+	tQuery.m_sQuery = "hello";
+	tQuery.m_sSelect = "*, gid*2 as g2";
+	ASSERT_TRUE ( IsResultCacheable ( tQuery ) );
+
+	CSphQuery tRand = tQuery;
+	tRand.m_sSelect = "*, RAND ( ) as r";
+	ASSERT_FALSE ( IsResultCacheable ( tRand ) );
+
+	CSphQuery tNow = tQuery;
+	tNow.m_sSortBy = "now()-ts desc";
+	ASSERT_FALSE ( IsResultCacheable ( tNow ) );
+
+	CSphQuery tExprFilter = tQuery;
+	auto & tExpr = tExprFilter.m_dFilters.Add();
+	tExpr.m_eType = SPH_FILTER_EXPRESSION;
+	tExpr.m_sAttrName = "ts>now()-3600";
+	ASSERT_FALSE ( IsResultCacheable ( tExprFilter ) );
+
+	CSphQuery tUservar = tQuery;
+	auto & tVar = tUservar.m_dFilters.Add();
+	tVar.m_eType = SPH_FILTER_USERVAR;
+	tVar.m_sAttrName = "gid";
+	tVar.m_dStrings.Add ( "@ids" );
+	ASSERT_FALSE ( IsResultCacheable ( tUservar ) );
+
+	// plugins might be reloaded without touching any index
+	CSphQuery tRanker = tQuery;
+	tRanker.m_eRanker = SPH_RANK_PLUGIN;
+	tRanker.m_sUDRanker = "myranker";
+	ASSERT_FALSE ( IsResultCacheable ( tRanker ) );
+
+	CSphQuery tTokenFilter = tQuery;
+	tTokenFilter.m_sQueryTokenFilterLib = "my.so";
+	tTokenFilter.m_sQueryTokenFilterName = "myfilter";
+	ASSERT_FALSE ( IsResultCacheable ( tTokenFilter ) );
+}
+
+
+// whole daemon path: a served RT index with static attrs, strings and stored fields, searched via SearchHandler_c
+class ResultCacheRT_c : public ::testing::Test
+{
+protected:
+	static constexpr const char * INDEX_NAME = "result_cache_rt";
+	static const int DOCS = 50;
+
+	void SetUp () override
+	{
+		StartGlobalWorkPool ();
+
+		CSphConfigSection tRTConfig;
+		sphRTInit ( tRTConfig, true, nullptr );
+		sphRTConfigure ( tRTConfig, true );
+		SmallStringHash_T<CSphIndex *> hIndexes;
+		sphReplayBinlog ( hIndexes );
+
+		CSphConfigSection hIndex;
+		hIndex.AddEntry ( "type", "rt" );
+		hIndex.AddEntry ( "path", INDEX_NAME );
+		hIndex.AddEntry ( "rt_field", "title" );
+		hIndex.AddEntry ( "rt_attr_uint", "gid" );
+		hIndex.AddEntry ( "rt_attr_string", "tag" );
+		hIndex.AddEntry ( "stored_fields", "title" );
+
+		CSphString sError;
+		CSphSchema tSchema ( INDEX_NAME );
+		CSphIndexSettings tSettings;
+		ASSERT_TRUE ( ConfigureRTPercolate ( tSchema, tSettings, INDEX_NAME, hIndex, false, true, false, sError ) ) << sError.cstr();
+
+		ServedDesc_t tDesc;
+		tDesc.m_eType = IndexType_e::RT;
+		tDesc.m_pIndex = sphCreateIndexRT ( tSchema, INDEX_NAME, 32*1024*1024, INDEX_NAME, true );
+		tDesc.m_pIndex->Setup ( tSettings );
+
+		StrVec_t dWarnings;
+		g_bOptNoLock = true;
+		ASSERT_TRUE ( PreallocNewIndex ( tDesc, &hIndex, INDEX_NAME, dWarnings, sError ) ) << sError.cstr();
+
+		AddDocs ( (RtIndex_i *)tDesc.m_pIndex );
+
+		// served index owns the index from now on
+		g_pLocalIndexes->AddOrReplace ( new ServedIndex_c ( tDesc ), INDEX_NAME );
+		tDesc.m_pIndex = nullptr;
+
+		ResultCacheSetup ( 16*1024*1024, 0 );
+	}
+
+	void TearDown () override
+	{
+		ResultCacheSetup ( 0, 0 );
+		g_pLocalIndexes->Delete ( INDEX_NAME );
+		sphRTDone ();
+
+		for ( const char * szExt : { "meta", "ram", "lock", "settings" } )
+		{
+			CSphString sFile;
+			sFile.SetSprintf ( "%s.%s", INDEX_NAME, szExt );
+			unlink ( sFile.cstr() );
+		}
+	}
+
+	static void AddDocs ( RtIndex_i * pIndex )
+	{
+		CSphString sError, sWarning;
+		CSphScopedPtr<RtAccum_t> pAcc { new RtAccum_t ( true ) };
+		ASSERT_EQ ( pIndex->CreateAccum ( pAcc.Ptr(), sError ), pAcc.Ptr() );
+
+		const CSphSchema & tSchema = pIndex->GetMatchSchema();
+		CSphAttrLocator tId = tSchema.GetAttr ( sphGetDocidName() )->m_tLocator;
+		CSphAttrLocator tGid = tSchema.GetAttr ( "gid" )->m_tLocator;
+		tId.m_bDynamic = tGid.m_bDynamic = true;
+
+		CSphVector<int64_t> dMvas;
+		for ( int i = 1; i<=DOCS; ++i )
+		{
+			CSphString sTitle, sTag;
+			sTitle.SetSprintf ( "hello world %s", i%2 ? "odd" : "even" );
+			sTag.SetSprintf ( "tag%d", i%5 );
+
+			CSphMatch tDoc;
+			tDoc.Reset ( tSchema.GetRowSize() );
+			tDoc.SetAttr ( tId, i );
+			tDoc.SetAttr ( tGid, i%3 );
+
+			VecTraits_T<const char> dTitle ( sTitle.cstr(), sTitle.Length() );
+			const char * dStrings[] = { sTag.cstr() };
+			ASSERT_TRUE ( pIndex->AddDocument ( { &dTitle, 1 }, tDoc, false, CSphString(), dStrings, dMvas, sError, sWarning, pAcc.Ptr() ) ) << sError.cstr();
+		}
+
+		ASSERT_TRUE ( pIndex->Commit ( nullptr, pAcc.Ptr() ) );
+	}
+
+	static CSphQuery MakeQuery ( const char * szQuery )
+	{
+		CSphQuery tQuery;
+		tQuery.m_sIndexes = INDEX_NAME;
+		tQuery.m_sQuery = szQuery;
+		tQuery.m_sSelect = "*";
+		tQuery.m_iLimit = DOCS;
+
+		CSphString sError;
+		EXPECT_TRUE ( ParseSelectList ( sError, tQuery ) ) << sError.cstr();
+		return tQuery;
+	}
+
+	// same as sql FACET: head query, then one grouped query per facet column
+	static void SetupFacets ( SearchHandler_c & tHandler, CSphQuery tQuery, const VecTraits_T<const char *> & dFacets )
+	{
+		tQuery.m_dRefItems = tQuery.m_dItems;
+		CSphQueryItem & tCount = tQuery.m_dItems.Add();
+		tCount.m_sExpr = tCount.m_sAlias = "count(*)";
+		tQuery.m_bFacetHead = true;
+		tHandler.SetQuery ( 0, tQuery, nullptr );
+
+		ARRAY_FOREACH ( i, dFacets )
+		{
+			tQuery.m_bFacetHead = false;
+			tQuery.m_bFacet = true;
+			tQuery.m_sSelect = dFacets[i];
+			tQuery.m_dRefItems.Resize ( 0 );
+			CSphQueryItem & tItem = tQuery.m_dRefItems.Add();
+			tItem.m_sExpr = tItem.m_sAlias = dFacets[i];
+			CSphQueryItem & tRefCount = tQuery.m_dRefItems.Add();
+			tRefCount.m_sExpr = tRefCount.m_sAlias = "count(*)";
+			tQuery.m_sGroupBy = tQuery.m_sFacetBy = dFacets[i];
+			tQuery.m_sGroupSortBy = "@groupby desc";
+			tQuery.m_sOrderBy = "@weight desc";
+			tHandler.SetQuery ( i+1, tQuery, nullptr );
+		}
+	}
+
+	// all the rows of all the results as text, with string and stored field values unpacked
+	static StrVec_t RenderResults ( const SearchHandler_c & tHandler )
+	{
+		StrVec_t dRows;
+		for ( const AggrResult_t & tRes : tHandler.m_dAggrResults )
+		{
+			EXPECT_TRUE ( tRes.m_sError.IsEmpty() ) << tRes.m_sError.cstr();
+			EXPECT_EQ ( tRes.m_dResults.GetLength(), 1 );
+			if ( tRes.m_dResults.GetLength()!=1 )
+				continue;
+
+			dRows.Add().SetSprintf ( "total=" INT64_FMT " found=" INT64_FMT, tRes.m_iTotalMatches, (int64_t)tRes.m_dResults.First().m_dMatches.GetLength() );
+			for ( const CSphMatch & tMatch : tRes.m_dResults.First().m_dMatches )
+			{
+				StringBuilder_c sRow;
+				sRow.Appendf ( "w=%d", tMatch.m_iWeight );
+				for ( int i = 0; i<tRes.m_tSchema.GetAttrsCount(); ++i )
+				{
+					const CSphColumnInfo & tAttr = tRes.m_tSchema.GetAttr(i);
+					if ( tAttr.IsDataPtr() )
+					{
+						auto tBlob = sphUnpackPtrAttr ( (const BYTE *) tMatch.GetAttr ( tAttr.m_tLocator ) );
+						sRow.Appendf ( " %s=%.*s", tAttr.m_sName.cstr(), tBlob.second, (const char *) tBlob.first );
+					} else
+						sRow.Appendf ( " %s=" INT64_FMT, tAttr.m_sName.cstr(), (int64_t)tMatch.GetAttr ( tAttr.m_tLocator ) );
+				}
+				dRows.Add ( sRow.cstr() );
+			}
+		}
+		return dRows;
+	}
+
+	// runs the queries in a fresh handler, as every client request does
+	template<typename SETUP>
+	static StrVec_t Run ( int iQueries, SETUP && fnSetup )
+	{
+		StrVec_t dRows;
+		Threads::CallCoroutine ( [&]
+		{
+			SearchHandler_c tHandler ( iQueries, sphCreatePlainQueryParser(), QUERY_API, true );
+			fnSetup ( tHandler );
+			tHandler.RunQueries();
+			dRows = RenderResults ( tHandler );
+		} );
+		return dRows;
+	}
+};
+
+
+TEST_F ( ResultCacheRT_c, hit_returns_same_rows )
+{
+	auto fnSetup = [] ( SearchHandler_c & tHandler ) { tHandler.SetQuery ( 0, MakeQuery ( "hello odd" ), nullptr ); };
+	ResultCacheStatus_t tStart = ResultCacheGetStatus();
+
+	StrVec_t dMiss = Run ( 1, fnSetup );
+	ResultCacheStatus_t tAfterMiss = ResultCacheGetStatus();
+	ASSERT_EQ ( tAfterMiss.m_iMisses, tStart.m_iMisses+1 );
+	ASSERT_EQ ( tAfterMiss.m_iHits, tStart.m_iHits );
+	ASSERT_EQ ( tAfterMiss.m_iCachedResults, 1 );
+
+	StrVec_t dHit = Run ( 1, fnSetup );
+	ResultCacheStatus_t tAfterHit = ResultCacheGetStatus();
+	ASSERT_EQ ( tAfterHit.m_iHits, tStart.m_iHits+1 );
+	ASSERT_EQ ( tAfterHit.m_iMisses, tAfterMiss.m_iMisses );
+
+	// header and 25 odd docs; every row has id, gid, tag and the stored title
+	ASSERT_EQ ( dMiss.GetLength(), DOCS/2+1 );
+	ASSERT_NE ( strstr ( dMiss[1].cstr(), "title=hello world odd" ), nullptr ) << dMiss[1].cstr();
+	ASSERT_NE ( strstr ( dMiss[1].cstr(), "tag=tag" ), nullptr ) << dMiss[1].cstr();
+	ASSERT_NE ( strstr ( dMiss[1].cstr(), "gid=" ), nullptr ) << dMiss[1].cstr();
+
+	ASSERT_EQ ( dHit.GetLength(), dMiss.GetLength() );
+	ARRAY_FOREACH ( i, dMiss )
+		ASSERT_STREQ ( dHit[i].cstr(), dMiss[i].cstr() );
+}
+
+
+TEST_F ( ResultCacheRT_c, facets_hit_as_one_subset )
+{
+	const char * dFacets[] = { "gid", "tag" };
+	auto fnSetup = [&dFacets] ( SearchHandler_c & tHandler ) { SetupFacets ( tHandler, MakeQuery ( "hello" ), { dFacets, 2 } ); };
+	ResultCacheStatus_t tStart = ResultCacheGetStatus();
+
+	StrVec_t dMiss = Run ( 3, fnSetup );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iCachedResults, 1 );
+
+	StrVec_t dHit = Run ( 3, fnSetup );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iHits, tStart.m_iHits+1 );
+
+	// head rows, then 3 gid groups and 5 tag groups
+	ASSERT_EQ ( dMiss.GetLength(), DOCS+1 + 3+1 + 5+1 );
+	ASSERT_EQ ( dHit.GetLength(), dMiss.GetLength() );
+	ARRAY_FOREACH ( i, dMiss )
+		ASSERT_STREQ ( dHit[i].cstr(), dMiss[i].cstr() );
+}
+
+
+TEST_F ( ResultCacheRT_c, thresh_skips_fast_queries )
+{
+	ResultCacheSetup ( 16*1024*1024, 60*1000 );
+	auto fnSetup = [] ( SearchHandler_c & tHandler ) { tHandler.SetQuery ( 0, MakeQuery ( "hello" ), nullptr ); };
+	ResultCacheStatus_t tStart = ResultCacheGetStatus();
+
+	StrVec_t dFirst = Run ( 1, fnSetup );
+	StrVec_t dSecond = Run ( 1, fnSetup );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iCachedResults, 0 );
+	ASSERT_EQ ( ResultCacheGetStatus().m_iMisses, tStart.m_iMisses+2 );
+	ASSERT_EQ ( dFirst.GetLength(), DOCS+1 );
+	ASSERT_EQ ( dSecond.GetLength(), dFirst.GetLength() );
+}
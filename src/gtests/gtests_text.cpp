@@ -425,6 +425,83 @@ TEST ( Text, expression_parser )
 	SafeDeleteArray ( pRow );
 }
 
+// batch evaluation must give the same results as per-match evaluation
+TEST ( Text, expression_batch )
+{
+	CSphColumnInfo tCol;
+
+	CSphSchema tSchema;
+	tCol.m_sName = "id";
+	tCol.m_eAttrType = SPH_ATTR_BIGINT;
+	tSchema.AddAttr ( tCol, false );
+
+	tCol.m_sName = "aaa";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSchema.AddAttr ( tCol, false );
+
+	tCol.m_sName = "bbb";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSchema.AddAttr ( tCol, false );
+
+	tCol.m_sName = "fff";
+	tCol.m_eAttrType = SPH_ATTR_FLOAT;
+	tSchema.AddAttr ( tCol, false );
+
+	const int ROWS = 100;
+	int iStride = tSchema.GetRowSize();
+	CSphFixedVector<CSphRowitem> dRows ( ROWS*iStride );
+	CSphFixedVector<CSphMatch> dMatches ( ROWS );
+	CSphFixedVector<const CSphMatch *> dBatch ( ROWS );
+	for ( int i = 0; i < ROWS; i++ )
+	{
+		CSphRowitem * pRow = dRows.Begin() + i*iStride;
+		sphSetRowAttr ( pRow, tSchema.GetAttr(0).m_tLocator, 1000+i );
+		sphSetRowAttr ( pRow, tSchema.GetAttr(1).m_tLocator, i*7 );
+		sphSetRowAttr ( pRow, tSchema.GetAttr(2).m_tLocator, i%5 );
+		sphSetRowAttr ( pRow, tSchema.GetAttr(3).m_tLocator, sphF2DW ( i*0.5f ) );
+		dMatches[i].m_tRowID = i;
+		dMatches[i].m_pStatic = pRow;
+		dBatch[i] = &dMatches[i];
+	}
+
+	const char * dTests[] =
+	{
+		"aaa+bbb*3", "aaa-bbb", "-aaa", "abs(bbb-2)", "min(aaa,bbb)", "max(aaa,fff)", "aaa*fff+1",
+		"aaa<bbb*10", "bbb=2", "fff>=10", "if(bbb,aaa mod bbb,-1)", "if(fff<20,aaa+1,id)", "id+aaa", "(aaa|bbb)&6"
+	};
+
+	for ( const char * szExpr : dTests )
+	{
+		CSphString sError;
+		ESphAttr eType = SPH_ATTR_NONE;
+		ExprParseArgs_t tExprArgs;
+		tExprArgs.m_pAttrType = &eType;
+		ISphExprRefPtr_c pExpr ( sphExprParse ( szExpr, tSchema, sError, tExprArgs ) );
+		ASSERT_TRUE ( pExpr.Ptr () ) << "parsing " << szExpr << ":" << sError.cstr ();
+
+		CSphFixedVector<float> dFloat ( ROWS );
+		pExpr->EvalBatch ( dBatch.Begin(), ROWS, dFloat.Begin() );
+		for ( int i = 0; i < ROWS; i++ )
+			ASSERT_FLOAT_EQ ( pExpr->Eval ( dMatches[i] ), dFloat[i] ) << szExpr << " at row " << i;
+
+		if ( eType==SPH_ATTR_INTEGER )
+		{
+			CSphFixedVector<int> dInt ( ROWS );
+			pExpr->IntEvalBatch ( dBatch.Begin(), ROWS, dInt.Begin() );
+			for ( int i = 0; i < ROWS; i++ )
+				ASSERT_EQ ( pExpr->IntEval ( dMatches[i] ), dInt[i] ) << szExpr << " at row " << i;
+		}
+
+		if ( eType==SPH_ATTR_INTEGER || eType==SPH_ATTR_BIGINT )
+		{
+			CSphFixedVector<int64_t> dInt64 ( ROWS );
+			pExpr->Int64EvalBatch ( dBatch.Begin(), ROWS, dInt64.Begin() );
+			for ( int i = 0; i < ROWS; i++ )
+				ASSERT_EQ ( pExpr->Int64Eval ( dMatches[i] ), dInt64[i] ) << szExpr << " at row " << i;
+		}
+	}
+}
+
 TEST ( Text, DISABLED_bench_expression_parser )
 {
 	CSphColumnInfo tCol;
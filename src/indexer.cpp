@@ -1703,6 +1703,7 @@ static void ShowHelp ()
 		"--drop-src clears src index after merge\n"
 		"--dump-rows <FILE>\tdump indexed rows into FILE\n"
 		"--print-queries\t\tprint SQL queries (for debugging)\n"
+		"--threads <N>\t\tmax threads to use for index build and merge\n"
 		"--print-rt\t\tprint indexed rows as SQL insert commands and field mapping info for populating an RT index\n"
 		"--keep-attrs\t\tretain attributes from the old index\n"
 		"\n"
@@ -1723,6 +1724,7 @@ int main ( int argc, char ** argv )
 	bool bIndexAll = false;
 	bool bDropSrc = false;
 	CSphString sDumpRows;
+	int iThreads = 0;
 
 	if ( argc==2 && ( !strcmp ( argv[1], "--help" ) || !strcmp ( argv[1], "-h" )))
 	{
@@ -1789,6 +1791,12 @@ int main ( int argc, char ** argv )
 		} else if ( strcasecmp ( argv[i], "--all" )==0 )
 		{
 			bIndexAll = true;
+
+		} else if ( strcasecmp ( argv[i], "--threads" )==0 && (i+1)<argc )
+		{
+			iThreads = atoi ( argv[++i] );
+			if ( iThreads<=0 )
+				break;
 		} else if ( strcasecmp ( argv[i], "--verbose" )==0 ) // just to prevent warning about unknow option
 		{
 		} else if ( isalnum ( argv[i][0] ) || argv[i][0]=='_' || sphIsWild ( argv[i][0] ) )
@@ -1958,9 +1966,14 @@ int main ( int argc, char ** argv )
 
 		sphSetThrottling ( hIndexer.GetInt ( "max_iops", 0 ), hIndexer.GetSize ( "max_iosize", 0 ) );
 
+		if ( !iThreads )
+			iThreads = hIndexer.GetInt ( "threads", 1 );
+
 		sphAotSetCacheSize ( hIndexer.GetSize ( "lemmatizer_cache", 262144 ) );
 	}
 
+	sphSetIndexerThreads ( iThreads );
+
 	sphConfigureCommon ( hConf );
 
 	/////////////////////
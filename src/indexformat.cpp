@@ -260,6 +260,232 @@ struct DictEntryDiskPayload_t
 
 //////////////////////////////////////////////////////////////////////////
 
+/// one shard of the expansion cache; LRU of entries with its own lock and share of the memory limit
+class ExpansionCacheShard_c
+{
+public:
+	~ExpansionCacheShard_c()
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		while ( m_tLRU.GetLength() )
+			DeleteEntry ( (Entry_t *)m_tLRU.Begin() );
+	}
+
+	void SetMaxBytes ( int64_t iMaxBytes )
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		m_iMaxBytes = iMaxBytes;
+		Shrink();
+	}
+
+	int64_t GetUsedBytes()
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		return m_iBytes;
+	}
+
+	bool Fetch ( const CSphString & sKey, DictEntryDiskPayload_t & tPayload )
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		Entry_t ** ppEntry = m_hEntries ( sKey );
+		if ( !ppEntry )
+			return false;
+
+		// most recently used go first
+		Entry_t * pEntry = *ppEntry;
+		m_tLRU.Remove ( pEntry );
+		m_tLRU.Add ( pEntry );
+
+		tPayload.m_dWordExpand = pEntry->m_dWordExpand;
+		tPayload.m_dWordPayload = pEntry->m_dWordPayload;
+		tPayload.m_dWordBuf = pEntry->m_dWordBuf;
+		return true;
+	}
+
+	void Store ( int64_t iWordlistId, const CSphString & sKey, const DictEntryDiskPayload_t & tPayload )
+	{
+		int64_t iBytes = sizeof(Entry_t) + sKey.Length() + tPayload.m_dWordExpand.GetLengthBytes64()
+			+ tPayload.m_dWordPayload.GetLengthBytes64() + tPayload.m_dWordBuf.GetLengthBytes64();
+
+		ScopedMutex_t tLock ( m_tLock );
+		if ( iBytes>m_iMaxBytes || m_hEntries.Exists ( sKey ) )
+			return;
+
+		auto * pEntry = new Entry_t;
+		pEntry->m_iWordlistId = iWordlistId;
+		pEntry->m_sKey = sKey;
+		pEntry->m_dWordExpand = tPayload.m_dWordExpand;
+		pEntry->m_dWordPayload = tPayload.m_dWordPayload;
+		pEntry->m_dWordBuf = tPayload.m_dWordBuf;
+		pEntry->m_iBytes = iBytes;
+
+		m_hEntries.Add ( pEntry, sKey );
+		m_tLRU.Add ( pEntry );
+		m_iBytes += iBytes;
+		Shrink();
+	}
+
+	void Drop ( int64_t iWordlistId )
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		for ( auto & tNode : m_tLRU )
+		{
+			auto * pEntry = (Entry_t *)&tNode;
+			if ( pEntry->m_iWordlistId==iWordlistId )
+				DeleteEntry ( pEntry );
+		}
+	}
+
+private:
+	struct Entry_t : public ListNode_t
+	{
+		int64_t								m_iWordlistId = 0;
+		CSphString							m_sKey;
+		CSphVector<DiskExpandedEntry_t>		m_dWordExpand;
+		CSphVector<DiskExpandedPayload_t>	m_dWordPayload;
+		CSphVector<BYTE>					m_dWordBuf;
+		int64_t								m_iBytes = 0;
+	};
+
+	CSphMutex										m_tLock;
+	List_t											m_tLRU GUARDED_BY ( m_tLock );
+	CSphOrderedHash<Entry_t *, CSphString, CSphStrHashFunc, 256>	m_hEntries GUARDED_BY ( m_tLock );
+	int64_t											m_iBytes GUARDED_BY ( m_tLock ) = 0;
+	int64_t											m_iMaxBytes GUARDED_BY ( m_tLock ) = 0;
+
+	void DeleteEntry ( Entry_t * pEntry ) REQUIRES ( m_tLock )
+	{
+		m_hEntries.Delete ( pEntry->m_sKey );
+		m_tLRU.Remove ( pEntry );
+		m_iBytes -= pEntry->m_iBytes;
+		delete pEntry;
+	}
+
+	void Shrink() REQUIRES ( m_tLock )
+	{
+		// evict least recently used ones
+		while ( m_iBytes>m_iMaxBytes && m_tLRU.GetLength() )
+			DeleteEntry ( (Entry_t *)m_tLRU.End()->m_pPrev );
+	}
+};
+
+
+/// daemon-wide LRU cache of disk wordlist expansions (prefixes and infixes)
+/// disk wordlists never change, so entries only go away on eviction or when their wordlist is reset
+/// entries are spread over shards by key, so concurrent lookups mostly take different locks
+/// small caches get less shards, so that every shard still fits a large expansion
+class ExpansionCache_c
+{
+public:
+	ExpansionCache_c()
+	{
+		SetMaxBytes ( 16777216 );
+	}
+
+	bool IsEnabled() const
+	{
+		return m_iMaxBytes.load ( std::memory_order_relaxed )>0;
+	}
+
+	void SetMaxBytes ( int64_t iMaxBytes )
+	{
+		iMaxBytes = Max ( iMaxBytes, 0 );
+		auto iShards = (int)Max ( Min ( iMaxBytes/MIN_SHARD_BYTES, (int64_t)MAX_SHARDS ), 1 );
+
+		// shards left out get no memory, so whatever they still hold is evicted
+		m_iMaxBytes = iMaxBytes;
+		m_iShards = iShards;
+		for ( int i=0; i<MAX_SHARDS; ++i )
+			m_dShards[i].SetMaxBytes ( i<iShards ? iMaxBytes/iShards : 0 );
+	}
+
+	bool Fetch ( const CSphString & sKey, DictEntryDiskPayload_t & tPayload )
+	{
+		bool bHit = GetShard ( sKey ).Fetch ( sKey, tPayload );
+		( bHit ? m_iHits : m_iMisses ).fetch_add ( 1, std::memory_order_relaxed );
+		return bHit;
+	}
+
+	void Store ( int64_t iWordlistId, const CSphString & sKey, const DictEntryDiskPayload_t & tPayload )
+	{
+		GetShard ( sKey ).Store ( iWordlistId, sKey, tPayload );
+	}
+
+	void Drop ( int64_t iWordlistId )
+	{
+		for ( auto & tShard : m_dShards )
+			tShard.Drop ( iWordlistId );
+	}
+
+	ExpansionCacheStatus_t GetStatus()
+	{
+		ExpansionCacheStatus_t tStatus;
+		tStatus.m_iMaxBytes = m_iMaxBytes.load ( std::memory_order_relaxed );
+		tStatus.m_iShards = m_iShards.load ( std::memory_order_relaxed );
+		tStatus.m_iHits = m_iHits.load ( std::memory_order_relaxed );
+		tStatus.m_iMisses = m_iMisses.load ( std::memory_order_relaxed );
+		for ( auto & tShard : m_dShards )
+			tStatus.m_iUsedBytes += tShard.GetUsedBytes();
+
+		return tStatus;
+	}
+
+private:
+	static const int		MAX_SHARDS = 16;
+	static const int64_t	MIN_SHARD_BYTES = 4194304;	///< largest expansion a shard is guaranteed to fit (unless the whole cache is smaller)
+
+	ExpansionCacheShard_c	m_dShards[MAX_SHARDS];
+	std::atomic<int64_t>	m_iMaxBytes { 0 };
+	std::atomic<int>		m_iShards { 1 };
+	std::atomic<int64_t>	m_iHits { 0 };
+	std::atomic<int64_t>	m_iMisses { 0 };
+
+	ExpansionCacheShard_c & GetShard ( const CSphString & sKey )
+	{
+		return m_dShards [ sphCRC32 ( sKey.cstr(), sKey.Length() ) % m_iShards.load ( std::memory_order_relaxed ) ];
+	}
+};
+
+static ExpansionCache_c g_tExpansionCache;
+
+
+void SetExpansionCacheSize ( int64_t iMaxBytes )
+{
+	g_tExpansionCache.SetMaxBytes ( iMaxBytes );
+}
+
+
+ExpansionCacheStatus_t GetExpansionCacheStatus()
+{
+	return g_tExpansionCache.GetStatus();
+}
+
+
+int64_t CWordlist::NewCacheId()
+{
+	static std::atomic<int64_t> iCacheIds { 0 };
+	return ++iCacheIds;
+}
+
+
+void CWordlist::RenewCacheId()
+{
+	// whatever gets loaded next is a different wordlist for the cache
+	g_tExpansionCache.Drop ( m_iCacheId );
+	m_iCacheId = NewCacheId();
+}
+
+
+static CSphString ExpansionCacheKey ( int64_t iWordlistId, char cType, const char * sSubstring, int iSubLen, const char * sWildcard, const ISphWordlist::Args_t & tArgs )
+{
+	// expansion limit is applied on convert to args, so it isn't part of the key
+	CSphString sKey;
+	sKey.SetSprintf ( INT64_FMT "%c%d%d%d:%.*s:%s", iWordlistId, cType, tArgs.m_bPayload ? 1 : 0, tArgs.m_bHasExactForms ? 1 : 0, (int)tArgs.m_eHitless, iSubLen, sSubstring, sWildcard );
+	return sKey;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 CWordlist::~CWordlist ()
 {
 	Reset();
@@ -273,6 +499,11 @@ void CWordlist::Reset ()
 	m_pWords.Reset ( 0 );
 	SafeDeleteArray ( m_pInfixBlocksWords );
 	SafeDelete ( m_pCpReader );
+	m_dPreloadedWords.Reset();
+	m_dPreloadedArena.Reset();
+	m_dCheckpointWords.Reset();
+
+	RenewCacheId();
 }
 
 
@@ -280,6 +511,8 @@ bool CWordlist::Preread ( const CSphString & sName, bool bWordDict, int iSkiplis
 {
 	assert ( m_iDictCheckpointsOffset>0 );
 
+	RenewCacheId();
+
 	m_bWordDict = bWordDict;
 	m_iWordsEnd = m_iDictCheckpointsOffset; // set wordlist end
 	m_iSkiplistBlockSize = iSkiplistBlockSize;
@@ -410,6 +643,110 @@ void CWordlist::DebugPopulateCheckpoints()
 }
 
 
+void CWordlist::PreloadWords()
+{
+	if ( !m_bWordDict || m_tBuf.IsEmpty() )
+		return;
+
+	assert ( !m_pCpReader );
+
+	CSphVector<PreloadedWord_t> dWords;
+	CSphTightVector<BYTE> dArena;
+	CSphVector<int> dCheckpointWords;
+	dCheckpointWords.Reserve ( m_dCheckpoints.GetLength()+1 );
+
+	for ( const auto & tCheckpoint : m_dCheckpoints )
+	{
+		dCheckpointWords.Add ( dWords.GetLength() );
+
+		KeywordsBlockReader_c tDictReader ( AcquireDict ( &tCheckpoint ), m_iSkiplistBlockSize );
+		while ( tDictReader.UnpackWord() )
+		{
+			int iLen = tDictReader.GetWordLen();
+			int64_t iOff = dArena.GetLength();
+			if ( iOff+iLen+2>UINT_MAX )
+			{
+				sphWarning ( "dictionary is too big to preload, words=%d", dWords.GetLength() );
+				return;
+			}
+
+			PreloadedWord_t & tWord = dWords.Add();
+			tWord.m_iDoclistOffset = tDictReader.m_iDoclistOffset;
+			tWord.m_iSkiplistOffset = tDictReader.m_iSkiplistOffset;
+			tWord.m_uWordOff = (DWORD)iOff;
+			tWord.m_iDocs = tDictReader.m_iDocs;
+			tWord.m_iHits = tDictReader.m_iHits;
+			tWord.m_iDoclistHint = tDictReader.m_iDoclistHint;
+
+			BYTE * pWord = dArena.AddN ( iLen+2 );
+			pWord[0] = (BYTE)iLen;
+			memcpy ( pWord+1, tDictReader.GetWord(), iLen );
+			pWord[iLen+1] = '\0';
+		}
+	}
+	dCheckpointWords.Add ( dWords.GetLength() );
+
+	m_dPreloadedWords.SwapData ( dWords );
+	m_dPreloadedArena.SwapData ( dArena );
+	m_dCheckpointWords.SwapData ( dCheckpointWords );
+}
+
+
+int64_t CWordlist::GetPreloadedBytes() const
+{
+	return m_dPreloadedWords.AllocatedBytes() + m_dPreloadedArena.AllocatedBytes() + m_dCheckpointWords.AllocatedBytes();
+}
+
+
+void CWordlist::GetPreloadedWord ( int iWord, CSphDictEntry & tWord ) const
+{
+	const PreloadedWord_t & tEntry = m_dPreloadedWords[iWord];
+	tWord.m_sKeyword = m_dPreloadedArena.Begin() + tEntry.m_uWordOff + 1;
+	tWord.m_iDoclistOffset = tEntry.m_iDoclistOffset;
+	tWord.m_iSkiplistOffset = tEntry.m_iSkiplistOffset;
+	tWord.m_iDocs = tEntry.m_iDocs;
+	tWord.m_iHits = tEntry.m_iHits;
+	tWord.m_iDoclistHint = tEntry.m_iDoclistHint;
+}
+
+
+// first preloaded word which is not less than given one
+int CWordlist::PreloadedLowerBound ( const char * sWord, int iWordLen ) const
+{
+	const BYTE * pArena = m_dPreloadedArena.Begin();
+	int iLo = 0;
+	int iHi = m_dPreloadedWords.GetLength();
+	while ( iLo<iHi )
+	{
+		int iMid = iLo + ( iHi-iLo ) / 2;
+		const BYTE * pMid = pArena + m_dPreloadedWords[iMid].m_uWordOff;
+		if ( sphDictCmpStrictly ( (const char *)pMid+1, *pMid, sWord, iWordLen )<0 )
+			iLo = iMid+1;
+		else
+			iHi = iMid;
+	}
+
+	return iLo;
+}
+
+
+bool CWordlist::FindWord ( const char * sWord, int iWordLen, CSphDictEntry & tWord ) const
+{
+	assert ( IsPreloaded() );
+
+	int iWord = PreloadedLowerBound ( sWord, iWordLen );
+	if ( iWord>=m_dPreloadedWords.GetLength() )
+		return false;
+
+	const BYTE * pWord = m_dPreloadedArena.Begin() + m_dPreloadedWords[iWord].m_uWordOff;
+	if ( sphDictCmpStrictly ( (const char *)pWord+1, *pWord, sWord, iWordLen )!=0 )
+		return false;
+
+	GetPreloadedWord ( iWord, tWord );
+	return true;
+}
+
+
 const CSphWordlistCheckpoint * CWordlist::FindCheckpoint ( const char * sWord, int iWordLen, SphWordID_t iWordID, bool bStarMode ) const
 {
 	if ( m_pCpReader ) // FIXME!!! fall to regular checkpoints after data got read
@@ -503,12 +840,74 @@ void CWordlist::GetPrefixedWords ( const char * sSubstring, int iSubLen, const c
 
 	DictEntryDiskPayload_t tDict2Payload ( tArgs.m_bPayload, tArgs.m_eHitless );
 
+	CSphString sKey;
+	if ( g_tExpansionCache.IsEnabled() )
+		sKey = ExpansionCacheKey ( m_iCacheId, 'p', sSubstring, iSubLen, sWildcard, tArgs );
+
+	if ( sKey.IsEmpty() || !g_tExpansionCache.Fetch ( sKey, tDict2Payload ) )
+	{
+		CollectPrefixedWords ( sSubstring, iSubLen, sWildcard, tDict2Payload );
+		if ( !sKey.IsEmpty() && !sphInterrupted() )
+			g_tExpansionCache.Store ( m_iCacheId, sKey, tDict2Payload );
+	}
+
+	tDict2Payload.Convert ( tArgs );
+}
+
+
+void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, Args_t & tArgs ) const
+{
+	// dict must be of keywords type, and fully cached
+	// mmap()ed in the worst case, should we ever banish it to disk again
+	if ( m_tBuf.IsEmpty() || !m_dCheckpoints.GetLength() )
+		return;
+
+	DictEntryDiskPayload_t tDict2Payload ( tArgs.m_bPayload, tArgs.m_eHitless );
+
+	CSphString sKey;
+	if ( g_tExpansionCache.IsEnabled() )
+		sKey = ExpansionCacheKey ( m_iCacheId, 'i', sSubstring, iSubLen, sWildcard, tArgs );
+
+	if ( sKey.IsEmpty() || !g_tExpansionCache.Fetch ( sKey, tDict2Payload ) )
+	{
+		CollectInfixedWords ( sSubstring, iSubLen, sWildcard, tArgs.m_bHasExactForms, tDict2Payload );
+		if ( !sKey.IsEmpty() && !sphInterrupted() )
+			g_tExpansionCache.Store ( m_iCacheId, sKey, tDict2Payload );
+	}
+
+	tDict2Payload.Convert ( tArgs );
+}
+
+
+void CWordlist::CollectPrefixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, DictEntryDiskPayload_t & tDict2Payload ) const
+{
 	int dWildcard [ SPH_MAX_WORD_LEN + 1 ];
 	int * pWildcard = ( sphIsUTF8 ( sWildcard ) && sphUTF8ToWideChar ( sWildcard, dWildcard, SPH_MAX_WORD_LEN ) ) ? dWildcard : NULL;
 
 	// assume dict=crc never has word with wordid=0, however just don't consider it and explicitly set nullptr.
 	const CSphWordlistCheckpoint * pCheckpoint = m_bWordDict ? FindCheckpoint ( sSubstring, iSubLen, 0, true ) : nullptr;
 	const int iSkipMagic = ( BYTE(*sSubstring)<0x20 ); // whether to skip heading magic chars in the prefix, like NONSTEMMED maker
+
+	// preloaded wordlist has all the prefixed words in a single sorted run
+	if ( IsPreloaded() )
+	{
+		CSphDictEntry tWord;
+		for ( int iWord = PreloadedLowerBound ( sSubstring, iSubLen ); iWord<m_dPreloadedWords.GetLength() && !sphInterrupted(); iWord++ )
+		{
+			const BYTE * pWord = m_dPreloadedArena.Begin() + m_dPreloadedWords[iWord].m_uWordOff;
+			if ( sphDictCmp ( sSubstring, iSubLen, (const char *)pWord+1, *pWord )!=0 )
+				break;
+
+			if ( sphWildcardMatch ( (const char *)pWord + 1 + iSkipMagic, sWildcard, pWildcard ) )
+			{
+				GetPreloadedWord ( iWord, tWord );
+				tDict2Payload.Add ( tWord, *pWord );
+			}
+		}
+
+		return;
+	}
+
 	while ( pCheckpoint )
 	{
 		// decode wordlist chunk
@@ -539,18 +938,11 @@ void CWordlist::GetPrefixedWords ( const char * sSubstring, int iSubLen, const c
 		if ( sphDictCmp ( sSubstring, iSubLen, pCheckpoint->m_sWord, (int) strlen ( pCheckpoint->m_sWord ) )<0 )
 			break;
 	}
-
-	tDict2Payload.Convert ( tArgs );
 }
 
 
-void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, Args_t & tArgs ) const
+void CWordlist::CollectInfixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, bool bHasExactForms, DictEntryDiskPayload_t & tDict2Payload ) const
 {
-	// dict must be of keywords type, and fully cached
-	// mmap()ed in the worst case, should we ever banish it to disk again
-	if ( m_tBuf.IsEmpty() || !m_dCheckpoints.GetLength() )
-		return;
-
 	assert ( !m_pCpReader );
 
 	// extract key1, upto 6 chars from infix start
@@ -562,13 +954,36 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 	if ( !sphLookupInfixCheckpoints ( sSubstring, iBytes1, m_tBuf.GetWritePtr(), m_dInfixBlocks, m_iInfixCodepointBytes, dPoints ) )
 		return;
 
-	DictEntryDiskPayload_t tDict2Payload ( tArgs.m_bPayload, tArgs.m_eHitless );
-	const int iSkipMagic = ( tArgs.m_bHasExactForms ? 1 : 0 ); // whether to skip heading magic chars in the prefix, like NONSTEMMED maker
+	const int iSkipMagic = ( bHasExactForms ? 1 : 0 ); // whether to skip heading magic chars in the prefix, like NONSTEMMED maker
 
 	int dWildcard [ SPH_MAX_WORD_LEN + 1 ];
 	int * pWildcard = ( sphIsUTF8 ( sWildcard ) && sphUTF8ToWideChar ( sWildcard, dWildcard, SPH_MAX_WORD_LEN ) ) ? dWildcard : NULL;
 
 	// walk those checkpoints, check all their words
+	if ( IsPreloaded() )
+	{
+		CSphDictEntry tWord;
+		for ( DWORD uPoint : dPoints )
+		{
+			for ( int iWord = m_dCheckpointWords[uPoint-1]; iWord<m_dCheckpointWords[uPoint] && !sphInterrupted(); iWord++ )
+			{
+				const BYTE * pWord = m_dPreloadedArena.Begin() + m_dPreloadedWords[iWord].m_uWordOff + 1;
+
+				// stemmed terms should not match suffixes
+				if ( bHasExactForms && *pWord!=MAGIC_WORD_HEAD_NONSTEMMED )
+					continue;
+
+				if ( sphWildcardMatch ( (const char *)pWord+iSkipMagic, sWildcard, pWildcard ) )
+				{
+					GetPreloadedWord ( iWord, tWord );
+					tDict2Payload.Add ( tWord, pWord[-1] );
+				}
+			}
+		}
+
+		return;
+	}
+
 	ARRAY_FOREACH ( i, dPoints )
 	{
 		// OPTIMIZE? add a quicker path than a generic wildcard for "*infix*" case?
@@ -579,7 +994,7 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 				break;
 
 			// stemmed terms should not match suffixes
-			if ( tArgs.m_bHasExactForms && *tDictReader.m_sKeyword!=MAGIC_WORD_HEAD_NONSTEMMED )
+			if ( bHasExactForms && *tDictReader.m_sKeyword!=MAGIC_WORD_HEAD_NONSTEMMED )
 				continue;
 
 			if ( sphWildcardMatch ( (const char *)tDictReader.m_sKeyword+iSkipMagic, sWildcard, pWildcard ) )
@@ -589,8 +1004,6 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 		if ( sphInterrupted () )
 			break;
 	}
-
-	tDict2Payload.Convert ( tArgs );
 }
 
 
@@ -93,6 +93,7 @@ struct DictHeader_t
 
 
 class CheckpointReader_c;
+struct DictEntryDiskPayload_t;
 
 // FIXME: eliminate this, move it to proper dict impls
 class CWordlist : public ISphWordlist, public DictHeader_t, public ISphWordlistSuggest
@@ -122,7 +123,22 @@ public:
 
 	void								DebugPopulateCheckpoints();
 
+	void								PreloadWords();	///< decode the whole dict=keywords wordlist into RAM
+	bool								IsPreloaded() const { return !m_dCheckpointWords.IsEmpty(); }
+	int64_t								GetPreloadedBytes() const;	///< RAM taken by the preloaded wordlist
+	bool								FindWord ( const char * sWord, int iWordLen, CSphDictEntry & tWord ) const; ///< exact lookup in preloaded wordlist
+
 private:
+	struct PreloadedWord_t
+	{
+		SphOffset_t		m_iDoclistOffset;
+		SphOffset_t		m_iSkiplistOffset;
+		DWORD			m_uWordOff;		///< offset into words arena, length byte goes first
+		int				m_iDocs;
+		int				m_iHits;
+		int				m_iDoclistHint;
+	};
+
 	bool								m_bWordDict = false;
 	CSphVector<InfixBlock_t>			m_dInfixBlocks {0};
 	CSphFixedVector<BYTE>				m_pWords {0};			///< arena for checkpoint's words
@@ -131,6 +147,19 @@ private:
 
 	SphOffset_t							m_iWordsEnd = 0;		///< end of wordlist
 	CheckpointReader_c *				m_pCpReader = nullptr;
+
+	CSphVector<PreloadedWord_t>			m_dPreloadedWords;		///< decoded wordlist, in dictionary order
+	CSphTightVector<BYTE>				m_dPreloadedArena;		///< length-prefixed zero-terminated words
+	CSphVector<int>						m_dCheckpointWords;		///< first preloaded word of every checkpoint, and total words count
+	int64_t								m_iCacheId = NewCacheId();	///< this wordlist in expansion cache, unique per loaded wordlist
+
+	static int64_t						NewCacheId();
+	void								RenewCacheId();
+	void								GetPreloadedWord ( int iWord, CSphDictEntry & tWord ) const;
+	int									PreloadedLowerBound ( const char * sWord, int iWordLen ) const;
+
+	void								CollectPrefixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, DictEntryDiskPayload_t & tDict2Payload ) const;
+	void								CollectInfixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, bool bHasExactForms, DictEntryDiskPayload_t & tDict2Payload ) const;
 };
 
 
@@ -714,6 +714,11 @@ bool CSphIndexSettings::Setup ( const CSphConfigSection & hIndex, const char * s
 
 	ParseStoredFields(hIndex);
 
+	sFields = hIndex.GetStr ( "secondary_indexes" );
+	sFields.ToLower();
+	sphSplit ( m_dSecondaryIndexes, sFields.cstr() );
+	m_dSecondaryIndexes.Uniq();
+
 #if USE_COLUMNAR
 	if ( !ParseColumnarSettings ( hIndex, sError ) )
 		return false;
@@ -1655,6 +1660,8 @@ enum class MutableName_e
 	ACCESS_HITLISTS,
 	READ_BUFFER_DOCS,
 	READ_BUFFER_HITS,
+	RT_DOCID_MAP,
+	PRELOAD_DICT,
 
 	TOTAL
 };
@@ -1672,6 +1679,8 @@ const char * GetMutableName ( MutableName_e eName )
 		case MutableName_e::ACCESS_HITLISTS: return "access_hitlists";
 		case MutableName_e::READ_BUFFER_DOCS: return "read_buffer_docs";
 		case MutableName_e::READ_BUFFER_HITS: return "read_buffer_hits";
+		case MutableName_e::RT_DOCID_MAP: return "rt_docid_map";
+		case MutableName_e::PRELOAD_DICT: return "preload_dict";
 		default: assert ( 0 && "Invalid mutable option" ); return "";
 	}
 }
@@ -1829,6 +1838,28 @@ bool MutableIndexSettings_c::Load ( const char * sFileName, const char * sIndexN
 		sError = "";
 	}
 
+	JsonObj_c tDocidMap = tParser.GetBoolItem ( "rt_docid_map", sError, true );
+	if ( tDocidMap )
+	{
+		m_bDocidMap = tDocidMap.BoolVal();
+		m_dLoaded.BitSet ( (int)MutableName_e::RT_DOCID_MAP );
+	} else if ( !sError.IsEmpty() )
+	{
+		sphWarning ( "index %s: %s", sIndexName, sError.cstr() );
+		sError = "";
+	}
+
+	JsonObj_c tPreloadDict = tParser.GetBoolItem ( "preload_dict", sError, true );
+	if ( tPreloadDict )
+	{
+		m_bPreloadDict = tPreloadDict.BoolVal();
+		m_dLoaded.BitSet ( (int)MutableName_e::PRELOAD_DICT );
+	} else if ( !sError.IsEmpty() )
+	{
+		sphWarning ( "index %s: %s", sIndexName, sError.cstr() );
+		sError = "";
+	}
+
 	GetFileAccess( tParser, MutableName_e::ACCESS_PLAIN_ATTRS, false, m_tFileAccess.m_eAttr, m_dLoaded );
 	GetFileAccess( tParser, MutableName_e::ACCESS_BLOB_ATTRS, false, m_tFileAccess.m_eBlob, m_dLoaded );
 	GetFileAccess( tParser, MutableName_e::ACCESS_DOCLISTS, true, m_tFileAccess.m_eDoclist, m_dLoaded );
@@ -1884,6 +1915,18 @@ void MutableIndexSettings_c::Load ( const CSphConfigSection & hIndex, bool bNeed
 		m_dLoaded.BitSet ( (int)MutableName_e::PREOPEN );
 	}
 
+	if ( hIndex.Exists ( "rt_docid_map" ) )
+	{
+		m_bDocidMap = ( hIndex.GetInt ( "rt_docid_map", 0 )!=0 );
+		m_dLoaded.BitSet ( (int)MutableName_e::RT_DOCID_MAP );
+	}
+
+	if ( hIndex.Exists ( "preload_dict" ) )
+	{
+		m_bPreloadDict = ( hIndex.GetInt ( "preload_dict", 0 )!=0 );
+		m_dLoaded.BitSet ( (int)MutableName_e::PRELOAD_DICT );
+	}
+
 	// DEPRICATED - remove these 2 options
 	if ( hIndex.GetBool ( "mlock", false ) )
 	{
@@ -1970,6 +2013,10 @@ bool MutableIndexSettings_c::Save ( CSphString & sBuf ) const
 	AddInt ( m_dLoaded, MutableName_e::RT_MEM_LIMIT, tRoot, m_iMemLimit );
 	if ( m_dLoaded.BitGet ( (int)MutableName_e::PREOPEN ) )
 		tRoot.AddBool ( "preopen", m_bPreopen );
+	if ( m_dLoaded.BitGet ( (int)MutableName_e::RT_DOCID_MAP ) )
+		tRoot.AddBool ( "rt_docid_map", m_bDocidMap );
+	if ( m_dLoaded.BitGet ( (int)MutableName_e::PRELOAD_DICT ) )
+		tRoot.AddBool ( "preload_dict", m_bPreloadDict );
 	
 	AddStr ( m_dLoaded, MutableName_e::ACCESS_PLAIN_ATTRS, tRoot, FileAccessName ( m_tFileAccess.m_eAttr ) );
 	AddStr ( m_dLoaded, MutableName_e::ACCESS_BLOB_ATTRS, tRoot, FileAccessName ( m_tFileAccess.m_eBlob ) );
@@ -2004,6 +2051,18 @@ void MutableIndexSettings_c::Combine ( const MutableIndexSettings_c & tOther )
 		m_dLoaded.BitSet ( (int)MutableName_e::PREOPEN );
 	}
 
+	if ( tOther.m_dLoaded.BitGet ( (int)MutableName_e::RT_DOCID_MAP ) )
+	{
+		m_bDocidMap = tOther.m_bDocidMap;
+		m_dLoaded.BitSet ( (int)MutableName_e::RT_DOCID_MAP );
+	}
+
+	if ( tOther.m_dLoaded.BitGet ( (int)MutableName_e::PRELOAD_DICT ) )
+	{
+		m_bPreloadDict = tOther.m_bPreloadDict;
+		m_dLoaded.BitSet ( (int)MutableName_e::PRELOAD_DICT );
+	}
+
 	if ( tOther.m_dLoaded.BitGet ( (int)MutableName_e::ACCESS_PLAIN_ATTRS ) )
 	{
 		m_tFileAccess.m_eAttr = tOther.m_tFileAccess.m_eAttr;
@@ -2058,6 +2117,10 @@ void MutableIndexSettings_c::Format ( SettingsFormatter_c & tOut, FilenameBuilde
 		FormatCond ( m_bNeedSave, m_dLoaded, MutableName_e::RT_MEM_LIMIT, m_iMemLimit!=tDefaults.m_iMemLimit ) );
 	tOut.Add ( GetMutableName ( MutableName_e::PREOPEN ), m_bPreopen,
 		FormatCond ( m_bNeedSave, m_dLoaded, MutableName_e::PREOPEN, m_bPreopen!=tDefaults.m_bPreopen ) );
+	tOut.Add ( GetMutableName ( MutableName_e::RT_DOCID_MAP ), m_bDocidMap,
+		FormatCond ( m_bNeedSave, m_dLoaded, MutableName_e::RT_DOCID_MAP, m_bDocidMap!=tDefaults.m_bDocidMap ) );
+	tOut.Add ( GetMutableName ( MutableName_e::PRELOAD_DICT ), m_bPreloadDict,
+		FormatCond ( m_bNeedSave, m_dLoaded, MutableName_e::PRELOAD_DICT, m_bPreloadDict!=tDefaults.m_bPreloadDict ) );
 
 	tOut.Add ( GetMutableName ( MutableName_e::ACCESS_PLAIN_ATTRS ), FileAccessName ( m_tFileAccess.m_eAttr ),
 		FormatCond ( m_bNeedSave, m_dLoaded, MutableName_e::ACCESS_PLAIN_ATTRS, m_tFileAccess.m_eAttr!=tDefaults.m_tFileAccess.m_eAttr ) );
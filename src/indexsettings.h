@@ -172,6 +172,7 @@ public:
 
 	StrVec_t m_dColumnarAttrs;			///< list of attributes to place in columnar store
 	StrVec_t m_dColumnarStringsNoHash;	///< list of columnar string attributes that don't need pregenerated hashes
+	StrVec_t m_dSecondaryIndexes;		///< list of attributes to build secondary indexes for
 
 	ESphWordpart GetWordpart ( const char * sField, bool bWordDict );
 	int GetMinPrefixLen ( bool bWordDict ) const;
@@ -311,6 +312,8 @@ public:
 	int			m_iExpandKeywords;
 	int64_t		m_iMemLimit;
 	bool		m_bPreopen = false;
+	bool		m_bDocidMap = false;
+	bool		m_bPreloadDict = false;
 	FileAccessSettings_t m_tFileAccess;
 	
 	MutableIndexSettings_c();
@@ -36,6 +36,7 @@ void QueryProfile_c::Start ( ESphQueryState eNew )
 	memset ( m_tmTotal, 0, sizeof(m_tmTotal) );
 	m_eState = eNew;
 	m_tmStamp = sphMicroTimer();
+	m_sAccessPlan = "";
 }
 
 
@@ -47,6 +48,25 @@ void QueryProfile_c::AddMetric ( const QueryProfile_c & tData )
 		m_dSwitches[i] += tData.m_dSwitches[i];
 		m_tmTotal[i] += tData.m_tmTotal[i];
 	}
+
+	AddAccessPlan ( tData.m_sAccessPlan );
+}
+
+
+void QueryProfile_c::AddAccessPlan ( const CSphString & sPlan )
+{
+	if ( sPlan.IsEmpty() )
+		return;
+
+	if ( m_sAccessPlan.IsEmpty() )
+	{
+		m_sAccessPlan = sPlan;
+		return;
+	}
+
+	StringBuilder_c sBuf;
+	sBuf << m_sAccessPlan << "; " << sPlan;
+	sBuf.MoveTo ( m_sAccessPlan );
 }
 
 
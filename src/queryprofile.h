@@ -76,6 +76,7 @@ public:
 	int				m_dSwitches [ SPH_QSTATE_TOTAL+1 ];	///< number of switches to given state
 	int64_t			m_tmTotal [ SPH_QSTATE_TOTAL+1 ];	///< total time spent per state
 	CSphVector<BYTE> m_dPlan; 							///< bson with plan
+	CSphString		m_sAccessPlan;						///< access paths chosen by the planner, one per searched index or chunk
 
 														/// create empty and stopped profile
 					QueryProfile_c();
@@ -92,6 +93,7 @@ public:
 	void			AddMetric ( const QueryProfile_c & tData );
 
 	void			BuildResult ( XQNode_t * pRoot, const CSphSchema & tSchema, const StrVec_t & dZones );
+	void			AddAccessPlan ( const CSphString & sPlan );
 };
 
 
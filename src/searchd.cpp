@@ -23,6 +23,7 @@
 #include "sphinxjsonquery.h"
 #include "sphinxplugin.h"
 #include "sphinxqcache.h"
+#include "searchdresultcache.h"
 #include "accumulator.h"
 #include "searchdaemon.h"
 #include "searchdha.h"
@@ -49,6 +50,8 @@
 #include "taskflushbinlog.h"
 #include "taskflushattrs.h"
 #include "taskflushmutable.h"
+#include "taskmergesegments.h"
+#include "tasksavediskchunk.h"
 #include "taskpreread.h"
 #include "coroutine.h"
 #include "dynamic_idx.h"
@@ -1491,6 +1494,19 @@ protected:
 };
 
 
+/// result cache key is the same query serialization as for agents,
+/// plus the things master applies itself and never sends
+class ResultCacheKeyBuilder_c : public SearchRequestBuilder_c
+{
+public:
+	explicit ResultCacheKeyBuilder_c ( const VecTraits_T<CSphQuery> & dQueries )
+		: SearchRequestBuilder_c ( dQueries, 1 )
+	{}
+
+	void		BuildKey ( ISphOutputBuffer & tOut ) const;
+};
+
+
 class SearchReplyParser_c : public ReplyParser_i, public ISphNoncopyable
 {
 public:
@@ -1526,7 +1542,8 @@ enum
 	QFLAG_FACET					= 1UL << 9,
 	QFLAG_FACET_HEAD			= 1UL << 10,
 	QFLAG_JSON_QUERY			= 1UL << 11,
-	QFLAG_NOT_ONLY_ALLOWED		= 1UL << 12
+	QFLAG_NOT_ONLY_ALLOWED		= 1UL << 12,
+	QFLAG_PRUNE_BY_WEIGHT		= 1UL << 13
 };
 
 void operator<< ( ISphOutputBuffer & tOut, const CSphNamedInt & tValue )
@@ -1558,6 +1575,7 @@ void SearchRequestBuilder_c::SendQuery ( const char * sIndexes, ISphOutputBuffer
 	uFlags |= QFLAG_FACET * q.m_bFacet;
 	uFlags |= QFLAG_FACET_HEAD * q.m_bFacetHead;
 	uFlags |= QFLAG_NOT_ONLY_ALLOWED * q.m_bNotOnlyAllowed;
+	uFlags |= QFLAG_PRUNE_BY_WEIGHT * q.m_bPruneByWeight;
 
 	if ( q.m_eQueryType==QUERY_JSON )
 		uFlags |= QFLAG_JSON_QUERY;
@@ -1743,6 +1761,30 @@ void SearchRequestBuilder_c::SendQuery ( const char * sIndexes, ISphOutputBuffer
 }
 
 
+void ResultCacheKeyBuilder_c::BuildKey ( ISphOutputBuffer & tOut ) const
+{
+	for ( const auto & q : m_dQueries )
+	{
+		SendQuery ( q.m_sIndexes.cstr(), tOut, q, -1, 0 );
+		tOut.SendInt ( q.m_iOffset );
+		tOut.SendInt ( q.m_iLimit );
+		tOut.SendInt ( q.m_iOuterOffset );
+		tOut.SendInt ( q.m_iOuterLimit );
+		tOut.SendInt ( q.m_eQueryType );
+		tOut.SendInt ( q.m_bAgent );
+		tOut.SendString ( q.m_sFacetBy.cstr() );
+
+		tOut.SendInt ( q.m_dIncludeItems.GetLength() );
+		for ( const auto & sItem : q.m_dIncludeItems )
+			tOut.SendString ( sItem.cstr() );
+
+		tOut.SendInt ( q.m_dExcludeItems.GetLength() );
+		for ( const auto & sItem : q.m_dExcludeItems )
+			tOut.SendString ( sItem.cstr() );
+	}
+}
+
+
 void SearchRequestBuilder_c::BuildRequest ( const AgentConn_t & tAgent, ISphOutputBuffer & tOut ) const
 {
 	auto tHdr = APIHeader ( tOut, SEARCHD_COMMAND_SEARCH, VER_COMMAND_SEARCH ); // API header
@@ -2467,6 +2509,7 @@ bool ParseSearchQuery ( InputBuffer_c & tReq, ISphOutputBuffer & tOut, CSphQuery
 		tQuery.m_bFacetHead = !!( uFlags & QFLAG_FACET_HEAD );
 		tQuery.m_eQueryType = (uFlags & QFLAG_JSON_QUERY) ? QUERY_JSON : QUERY_API;
 		tQuery.m_bNotOnlyAllowed = !!( uFlags & QFLAG_NOT_ONLY_ALLOWED );
+		tQuery.m_bPruneByWeight = !!( uFlags & QFLAG_PRUNE_BY_WEIGHT );
 
 		if ( uMasterVer>0 || uVer==0x11E )
 			tQuery.m_bNormalizedTFIDF = !!( uFlags & QFLAG_NORMALIZED_TF );
@@ -4173,11 +4216,12 @@ CSphVector<int> GetUniqueTagsWithDocstores ( const AggrResult_t & tRes, int iOff
 }
 
 
-void SetupPostlimitExprs ( const DocstoreReader_i * pDocstore, const CSphColumnInfo * pCol, const char * sQuery, int64_t iDocstoreSessionId )
+void SetupPostlimitExprs ( const DocstoreReader_i * pDocstore, const CSphColumnInfo * pCol, const char * sQuery, int64_t iDocstoreSessionId, const DocstorePrefetch_c * pPrefetch=nullptr )
 {
 	DocstoreSession_c::Info_t tSessionInfo;
 	tSessionInfo.m_pDocstore = pDocstore;
 	tSessionInfo.m_iSessionId = iDocstoreSessionId;
+	tSessionInfo.m_pPrefetch = pPrefetch;
 
 	assert ( pCol && pCol->m_pExpr );
 	pCol->m_pExpr->Command ( SPH_EXPR_SET_DOCSTORE, &tSessionInfo ); // value is copied; no leak of pointer to local here.
@@ -4199,6 +4243,17 @@ void EvalPostlimitExprs ( CSphMatch & tMatch, const CSphColumnInfo * pCol )
 	}
 }
 
+// docids of the matches (of the given tag, if any) that postlimit expressions will fetch stored fields for
+static CSphVector<DocID_t> GetPostlimitDocIDs ( const VecTraits_T<CSphMatch> & dMatches, int iTag=-1 )
+{
+	CSphVector<DocID_t> dDocIDs;
+	for ( const auto & tMatch : dMatches )
+		if ( iTag<0 || tMatch.m_iTag==iTag )
+			dDocIDs.Add ( sphGetDocID ( tMatch.m_pDynamic ? tMatch.m_pDynamic : tMatch.m_pStatic ) );
+
+	return dDocIDs;
+}
+
 // single resultset cunk, but has many tags
 void ProcessMultiPostlimit ( AggrResult_t & tRes, VecTraits_T<const CSphColumnInfo *> & dPostlimit, const char * sQuery,
 		int iOff, int iLim )
@@ -4224,8 +4279,16 @@ void ProcessMultiPostlimit ( AggrResult_t & tRes, VecTraits_T<const CSphColumnIn
 	for ( int iTag : dDocstoreTags )
 		tRes.m_dResults[iTag].m_pDocstore->CreateReader ( iSessionUID );
 
-	int iLastTag = -1;
+	// stored fields are fetched for all the matches of a docstore at once, rather than match by match
 	auto dMatches = tRes.m_dResults.First ().m_dMatches.Slice ( iOff, iLim );
+	CSphFixedVector<DocstorePrefetch_c *> dPrefetch ( tRes.m_dResults.GetLength() );
+	for ( auto & i : dPrefetch )
+		i = nullptr;
+
+	for ( int iTag : dDocstoreTags )
+		dPrefetch[iTag] = new DocstorePrefetch_c ( *tRes.m_dResults[iTag].Docstore(), GetPostlimitDocIDs ( dMatches, iTag ) );
+
+	int iLastTag = -1;
 	for ( auto & dMatch : dMatches )
 	{
 		int iTag = dMatch.m_iTag;
@@ -4235,13 +4298,21 @@ void ProcessMultiPostlimit ( AggrResult_t & tRes, VecTraits_T<const CSphColumnIn
 		if ( iTag!=iLastTag )
 		{
 			for ( const auto & pCol : dPostlimit )
-				SetupPostlimitExprs ( pDocstore, pCol, sQuery, iSessionUID );
+				SetupPostlimitExprs ( pDocstore, pCol, sQuery, iSessionUID, dPrefetch[iTag] );
 			iLastTag = iTag;
 		}
 
 		for ( const auto & pCol : dPostlimit )
 			EvalPostlimitExprs ( dMatch, pCol );
 	}
+
+	// expressions must not refer to prefetched documents past this point
+	if ( iLastTag!=-1 )
+		for ( const auto & pCol : dPostlimit )
+			SetupPostlimitExprs ( tRes.m_dResults[iLastTag].Docstore(), pCol, sQuery, iSessionUID );
+
+	for ( auto & i : dPrefetch )
+		SafeDelete(i);
 }
 
 void ProcessSinglePostlimit ( OneResultset_t & tRes, VecTraits_T<const CSphColumnInfo *> & dPostlimit, const char * sQuery, int iOff, int iLim )
@@ -4259,12 +4330,21 @@ void ProcessSinglePostlimit ( OneResultset_t & tRes, VecTraits_T<const CSphColum
 	if ( tRes.Docstore () )
 		tRes.m_pDocstore->CreateReader ( iSessionUID );
 
+	// stored fields are fetched for the whole page at once, rather than match by match
+	CSphScopedPtr<DocstorePrefetch_c> pPrefetch { nullptr };
+	if ( tRes.Docstore () )
+		pPrefetch = new DocstorePrefetch_c ( *tRes.Docstore (), GetPostlimitDocIDs ( dMatches ) );
+
 	for ( const auto & pCol : dPostlimit )
-		SetupPostlimitExprs ( tRes.Docstore (), pCol, sQuery, iSessionUID );
+		SetupPostlimitExprs ( tRes.Docstore (), pCol, sQuery, iSessionUID, pPrefetch.Ptr() );
 
 	for ( auto & tMatch : dMatches )
 		for ( const auto & pCol : dPostlimit )
 			EvalPostlimitExprs ( tMatch, pCol );
+
+	// expressions must not refer to prefetched documents past this point
+	for ( const auto & pCol : dPostlimit )
+		SetupPostlimitExprs ( tRes.Docstore (), pCol, sQuery, iSessionUID );
 }
 
 void ProcessLocalPostlimit ( AggrResult_t & tRes, const CSphQuery & tQuery, bool bMaster )
@@ -5055,6 +5135,7 @@ private:
 	bool							ParseIdxSubkeys();
 	bool							CheckMultiQuery() const;
 	bool							RLockInvokedIndexes();
+	bool							BuildResultCacheKey ( CSphVector<BYTE> & dKey ) const;
 	void							UniqLocals ( VecTraits_T<LocalIndex_t>& dLocals );
 	void							RunActionQuery ( const CSphQuery & tQuery, const CSphString & sIndex, CSphString * pErrors ); ///< run delete/update
 	bool							BuildIndexList ( int & iDivideLimits, VecRefPtrsAgentConn_t & dRemotes, CSphVector<DistrServedByAgent_t> & dDistrServedByAgent ); // fixme!
@@ -5629,6 +5710,9 @@ void SearchHandler_c::RunLocalSearches ()
 
 	bool bSingle = iConcurrency==1;
 
+	// threads left when there are fewer local indexes than allowed concurrency go to pseudo-sharding
+	int iIndexConcurrency = m_dNQueries.First().m_iCouncurrency ? Max ( 1, iConcurrency / iNumLocals ) : 1;
+
 //	sphWarning ( "iConcurrency: %d", iConcurrency );
 
 	// if run parallel - start in mass order, if single - in natural order
@@ -5712,6 +5796,7 @@ void SearchHandler_c::RunLocalSearches ()
 			CSphMultiQueryArgs tMultiArgs ( iIndexWeight );
 			tMultiArgs.m_uPackedFactorFlags = tQueueRes.m_uPackedFactorFlags;
 			tMultiArgs.m_bNoYeld = bNoYeld;
+			tMultiArgs.m_iConcurrency = iIndexConcurrency;
 			if ( m_bGotLocalDF )
 			{
 				tMultiArgs.m_bLocalDF = true;
@@ -6547,6 +6632,125 @@ DEFINE_RENDER ( QueryInfo_t )
 }
 
 // one ore more queries against one and same set of indexes
+// results that depend on time, randomness or session state must never be served from the result cache
+static bool IsDeterministicExpr ( const CSphString & sExpr )
+{
+	static const char * dVolatile[] = { "rand(", "now(", "curtime(", "curdate(", "utc_time(", "utc_timestamp(",
+		"uuid_short(", "last_insert_id(", "connection_id(", "@random" };
+
+	if ( sExpr.IsEmpty() )
+		return true;
+
+	CSphVector<char> dCompact;
+	for ( const char * p = sExpr.cstr(); *p; ++p )
+		if ( !isspace ( (BYTE)*p ) )
+			dCompact.Add ( (char) tolower ( (BYTE)*p ) );
+	dCompact.Add ( '\0' );
+
+	for ( const char * szFunc : dVolatile )
+		if ( strstr ( dCompact.Begin(), szFunc ) )
+			return false;
+
+	return true;
+}
+
+
+// udf might be dropped, re-created or reloaded without touching any index (and might be volatile itself)
+static bool HasUdfCall ( const CSphString & sExpr )
+{
+	const char * p = sExpr.cstr();
+	while ( p && *p )
+	{
+		if ( !sphIsAttr ( *p ) || isdigit ( (BYTE)*p ) )
+		{
+			++p;
+			continue;
+		}
+
+		const char * sName = p;
+		while ( sphIsAttr ( *p ) )
+			++p;
+
+		const char * sNext = p;
+		while ( isspace ( (BYTE)*sNext ) )
+			++sNext;
+
+		if ( *sNext=='(' && sphPluginExists ( PLUGIN_FUNCTION, CSphString ( sName, int ( p-sName ) ).cstr() ) )
+			return true;
+	}
+
+	return false;
+}
+
+
+static bool IsCacheableExpr ( const CSphString & sExpr )
+{
+	return IsDeterministicExpr ( sExpr ) && !HasUdfCall ( sExpr );
+}
+
+
+static bool IsResultCacheable ( const CSphQuery & tQuery )
+{
+	// global idf file might be reloaded without touching any index
+	if ( tQuery.m_bGlobalIDF || tQuery.m_pTableFunc || !tQuery.m_dStringSubkeys.IsEmpty() || !tQuery.m_dIntSubkeys.IsEmpty() )
+		return false;
+
+	// same for ranker and query token filter plugins
+	if ( tQuery.m_eRanker==SPH_RANK_PLUGIN || !tQuery.m_sQueryTokenFilterLib.IsEmpty() )
+		return false;
+
+	if ( !IsCacheableExpr ( tQuery.m_sSelect ) || !IsCacheableExpr ( tQuery.m_sSortBy ) || !IsCacheableExpr ( tQuery.m_sGroupSortBy )
+		|| !IsCacheableExpr ( tQuery.m_sGroupBy ) || !IsCacheableExpr ( tQuery.m_sOuterOrderBy ) || !IsCacheableExpr ( tQuery.m_sRankerExpr ) )
+		return false;
+
+	for ( const auto & tFilter : tQuery.m_dFilters )
+	{
+		if ( tFilter.m_eType==SPH_FILTER_USERVAR )
+			return false;
+
+		if ( tFilter.m_eType==SPH_FILTER_EXPRESSION && !IsCacheableExpr ( tFilter.m_sAttrName ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+/// key covers the queries, how they are served, and the exact state (generation) of every local index involved
+bool SearchHandler_c::BuildResultCacheKey ( CSphVector<BYTE> & dKey ) const
+{
+	if ( !ResultCacheEnabled() || m_pProfile || m_pUpdates || m_pDelDocs || m_dLocal.IsEmpty() )
+		return false;
+
+	for ( const auto & tQuery : m_dNQueries )
+		if ( !IsResultCacheable ( tQuery ) )
+			return false;
+
+	ISphOutputBuffer tKey;
+	ResultCacheKeyBuilder_c ( m_dNQueries ).BuildKey ( tKey );
+	tKey.SendInt ( m_eQueryType );
+	tKey.SendInt ( m_bMaster );
+	tKey.SendInt ( m_bFederatedUser );
+	tKey.SendInt ( m_bMultiQueue );
+	tKey.SendInt ( m_bFacetQueue );
+
+	for ( const auto & tLocal : m_dLocal )
+	{
+		const ServedDesc_t * pServed = m_dLocked.Get ( tLocal.m_sName );
+		if ( !pServed || !pServed->m_pIndex || pServed->m_pIndex->IsPQ() )
+			return false;
+
+		tKey.SendString ( tLocal.m_sName.cstr() );
+		tKey.SendString ( tLocal.m_sParentIndex.cstr() );
+		tKey.SendInt ( tLocal.m_iWeight );
+		ResultCacheKeyAddIndex ( tKey, *pServed->m_pIndex );
+	}
+
+	tKey.SwapData ( dKey );
+	return true;
+}
+
+
 void SearchHandler_c::RunSubset ( int iStart, int iEnd )
 {
 	int iQueries = iEnd - iStart;
@@ -6629,6 +6833,29 @@ void SearchHandler_c::RunSubset ( int iStart, int iEnd )
 	if ( !m_bMultiQueue )
 		m_bFacetQueue = false;
 
+	///////////////////////////////////////
+	// serve whole subset from result cache
+	///////////////////////////////////////
+
+	CSphVector<BYTE> dCacheKey;
+	bool bResultCache = dRemotes.IsEmpty() && BuildResultCacheKey ( dCacheKey );
+	for ( int i=iStart; i<iEnd && bResultCache; ++i )
+		bResultCache = !m_dTables[i];
+
+	if ( bResultCache && ResultCacheFind ( dCacheKey, m_dNAggrResults ) )
+	{
+		// no local searches were made, so there are no per-index stats either
+		m_dQueryIndexStats.Reset();
+
+		tmSubset += sphMicroTimer();
+		tmCpu += sphTaskCpuTimer();
+
+		CSphIOStats tNoIO;
+		CalcTimeStats ( tmCpu, tmSubset, dDistrServedByAgent );
+		CalcGlobalStats ( tmCpu, tmSubset, tmLocal, tNoIO, dRemotes );
+		return;
+	}
+
 	///////////////////////////////////////////////////////////
 	// main query loop (with multiple retries for distributed)
 	///////////////////////////////////////////////////////////
@@ -6885,6 +7112,9 @@ void SearchHandler_c::RunSubset ( int iStart, int iEnd )
 		}
 	}
 
+	if ( bResultCache )
+		ResultCacheAdd ( dCacheKey, m_dNAggrResults, tmSubset+sphMicroTimer() );
+
 	/////////
 	// stats
 	/////////
@@ -8474,6 +8704,55 @@ void BuildStatus ( VectorLike & dStatus )
 	dStatus.MatchTupletf ( "qcache_used_bytes", "%l", s.m_iUsedBytes );
 	dStatus.MatchTupletf ( "qcache_hits", "%l", s.m_iHits );
 
+	ResultCacheStatus_t tResultCache = ResultCacheGetStatus();
+	dStatus.MatchTupletf ( "qcache_result_max_bytes", "%l", tResultCache.m_iMaxBytes );
+	dStatus.MatchTupletf ( "qcache_result_thresh_msec", "%d", tResultCache.m_iThreshMs );
+	dStatus.MatchTupletf ( "qcache_result_cached", "%d", tResultCache.m_iCachedResults );
+	dStatus.MatchTupletf ( "qcache_result_used_bytes", "%l", tResultCache.m_iUsedBytes );
+	dStatus.MatchTupletf ( "qcache_result_hits", "%l", tResultCache.m_iHits );
+	dStatus.MatchTupletf ( "qcache_result_misses", "%l", tResultCache.m_iMisses );
+
+	ExpansionCacheStatus_t tExpansionCache = GetExpansionCacheStatus();
+	dStatus.MatchTupletf ( "expansion_cache_max_bytes", "%l", tExpansionCache.m_iMaxBytes );
+	dStatus.MatchTupletf ( "expansion_cache_used_bytes", "%l", tExpansionCache.m_iUsedBytes );
+	dStatus.MatchTupletf ( "expansion_cache_shards", "%d", tExpansionCache.m_iShards );
+	dStatus.MatchTupletf ( "expansion_cache_hits", "%l", tExpansionCache.m_iHits );
+	dStatus.MatchTupletf ( "expansion_cache_misses", "%l", tExpansionCache.m_iMisses );
+
+	CSphVector<DocstoreCacheStats_t> dDocstoreCache = GetDocstoreCacheStats();
+	if ( dDocstoreCache.GetLength() )
+	{
+		DocstoreCacheStats_t tTotal;
+		for ( const auto & tShard : dDocstoreCache )
+		{
+			tTotal.m_iMaxBytes += tShard.m_iMaxBytes;
+			tTotal.m_iUsedBytes += tShard.m_iUsedBytes;
+			tTotal.m_iHits += tShard.m_iHits;
+			tTotal.m_iMisses += tShard.m_iMisses;
+			tTotal.m_iEvictions += tShard.m_iEvictions;
+		}
+
+		dStatus.MatchTupletf ( "docstore_cache_max_bytes", "%l", tTotal.m_iMaxBytes );
+		dStatus.MatchTupletf ( "docstore_cache_used_bytes", "%l", tTotal.m_iUsedBytes );
+		dStatus.MatchTupletf ( "docstore_cache_hits", "%l", tTotal.m_iHits );
+		dStatus.MatchTupletf ( "docstore_cache_misses", "%l", tTotal.m_iMisses );
+		dStatus.MatchTupletf ( "docstore_cache_evictions", "%l", tTotal.m_iEvictions );
+		dStatus.MatchTupletf ( "docstore_cache_shards", "%d", dDocstoreCache.GetLength() );
+
+		StringBuilder_c sKey;
+		ARRAY_FOREACH ( i, dDocstoreCache )
+		{
+			const DocstoreCacheStats_t & tShard = dDocstoreCache[i];
+			const std::pair<const char *, int64_t> dCounters[] = { { "used_bytes", tShard.m_iUsedBytes }, { "hits", tShard.m_iHits }, { "misses", tShard.m_iMisses }, { "evictions", tShard.m_iEvictions } };
+			for ( const auto & tCounter : dCounters )
+			{
+				sKey.Clear();
+				sKey.Sprintf ( "docstore_cache_shard_%d_%s", i, tCounter.first );
+				dStatus.MatchTupletf ( sKey.cstr(), "%l", tCounter.second );
+			}
+		}
+	}
+
 	// clusters
 	ReplicateClustersStatus ( dStatus );
 }
@@ -10055,6 +10334,9 @@ static bool IsHttpStmt ( const SqlStmt_t & tStmt )
 	return !tStmt.m_sEndpoint.IsEmpty();
 }
 
+// multi-row inserts shorter than that are tokenized in the session thread
+static const int INSERT_ROWS_PER_JOB = 256;
+
 void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool bReplace, bool bCommit,
 	  CSphString & sWarning, CSphSessionAccum & tAcc, ESphCollation	eCollation, CSphVector<int64_t> & dLastIds )
 {
@@ -10197,10 +10479,6 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 		}
 	}
 
-	CSphVector<int64_t> dMvas;
-	CSphVector<const char *> dStrings;
-	StringPtrTraits_t tStrings;
-	tStrings.m_dOff.Reset ( tSchema.GetAttrsCount() );
 	RtAccum_t * pAccum = tAcc.GetAcc ( pIndex, sError );
 	if ( !pAccum )
 	{
@@ -10213,13 +10491,30 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 	CSphAttrLocator tIdLoc = pDocid->m_tLocator;
 	tIdLoc.m_bDynamic = true;
 	CSphVector<int64_t> dIds;
-	dIds.Reserve ( tStmt.m_iRowsAffected );
+	dIds.Resize ( tStmt.m_iRowsAffected );
 
-	// convert attrs
-	for ( int c=0; c<tStmt.m_iRowsAffected; ++c )
+	// per-row conversion buffers, one set per worker
+	struct InsertRowBuf_t
+	{
+		CSphVector<int64_t>			m_dMvas;
+		CSphVector<const char *>	m_dStrings;
+		StringPtrTraits_t			m_tStrings;
+
+		explicit InsertRowBuf_t ( int iAttrs )
+		{
+			m_tStrings.m_dOff.Reset ( iAttrs );
+		}
+	};
+
+	// convert attrs of a single row and add it to given accumulator
+	auto fnAddRow = [&] ( int c, RtAccum_t * pAccum, InsertRowBuf_t & tBuf, CSphString & sError, CSphString & sWarning ) -> bool
 	{
 		assert ( sError.IsEmpty() );
 
+		auto & dMvas = tBuf.m_dMvas;
+		auto & dStrings = tBuf.m_dStrings;
+		auto & tStrings = tBuf.m_tStrings;
+
 		CSphMatchVariant tDoc;
 		tDoc.Reset ( tSchema.GetRowSize() );
 		if ( iIdIndex>=0 )
@@ -10228,7 +10523,7 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 			if ( tDoc.GetAttr ( tIdLoc )<0 )
 			{
 				sError.SetSprintf ( "'id' column is " INT64_FMT ". Must be positive.", (int64_t)tDoc.GetAttr ( tIdLoc ) );
-				break;
+				return false;
 			}
 		} else
 		{
@@ -10341,7 +10636,7 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 			}
 		}
 		if ( !sError.IsEmpty() )
-			break;
+			return false;
 
 		// remap JSON to string pointers
 		tStrings.SavePointersTo ( dStrings );
@@ -10377,7 +10672,7 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 			}
 		}
 		if ( !sError.IsEmpty() )
-			break;
+			return false;
 
 		// do add
 		if ( bPq )
@@ -10385,13 +10680,13 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 			if ( iIdIndex>=0 && tDoc.GetAttr ( tIdLoc )<0 )
 			{
 				sError.SetSprintf ( "'id' column is " INT64_FMT ". Must be positive.", (int64_t)tDoc.GetAttr ( tIdLoc ) );
-				break;
+				return false;
 			}
 
 			CSphVector<CSphFilterSettings> dFilters;
 			CSphVector<FilterTreeItem_t>   dFilterTree;
 			if ( !PercolateParseFilters ( dStrings[2], eCollation, tSchemaInt, dFilters, dFilterTree, sError ) )
-				break;
+				return false;
 
 			PercolateQueryArgs_t tArgs ( dFilters, dFilterTree );
 			tArgs.m_sQuery   = dStrings[0];
@@ -10408,20 +10703,77 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 				auto * pCmd = pAccum->AddCommand ( ReplicationCommand_e::PQUERY_ADD, tStmt.m_sCluster, tStmt.m_sIndex );
 				pCmd->m_pStored  = pStored;
 
-				dIds.Add ( pStored->m_iQUID );
+				dIds[c] = pStored->m_iQUID;
 			}
 		} else
 		{
 			pIndex->AddDocument ( dFields, tDoc, bReplace, tStmt.m_sStringParam, dStrings.Begin(), dMvas, sError, sWarning, pAccum );
-			dIds.Add ( tDoc.GetAttr ( tIdLoc ) );
+			dIds[c] = tDoc.GetAttr ( tIdLoc );
+		}
+
+		return sError.IsEmpty();
+	};
+
+	// large plain batches are tokenized by row ranges into private accumulators on the work pool
+	int iJobs = bPq ? 1 : tStmt.m_iRowsAffected / INSERT_ROWS_PER_JOB;
+	if ( iJobs>1 )
+	{
+		int iThreads = GetEffectiveDistThreads();
+		iJobs = Min ( iJobs, iThreads ? iThreads : Threads::NThreads() );
+	}
+
+	if ( iJobs<=1 )
+	{
+		InsertRowBuf_t tBuf ( tSchema.GetAttrsCount() );
+		for ( int c=0; c<tStmt.m_iRowsAffected; ++c )
+			if ( !fnAddRow ( c, pAccum, tBuf, sError, sWarning ) )
+				break;
+	} else
+	{
+		CSphFixedVector<RtAccum_t *> dAccums { iJobs };
+		dAccums.ZeroVec();
+		auto tAccumsDeleter = AtScopeExit ( [&dAccums] { for ( auto & pJobAcc : dAccums ) SafeDelete ( pJobAcc ); } );
 
-			pAccum->AddCommand ( ReplicationCommand_e::RT_TRX, tStmt.m_sCluster, tStmt.m_sIndex );
+		for ( int i=0; i<iJobs && sError.IsEmpty(); ++i )
+		{
+			dAccums[i] = new RtAccum_t ( pAccum->m_bKeywordDict );
+			pIndex->CreateAccum ( dAccums[i], sError );
 		}
 
-		if ( !sError.IsEmpty() )
-			break;
+		CSphFixedVector<CSphString> dErrors { iJobs };
+		CSphFixedVector<CSphString> dWarnings { iJobs };
+		std::atomic<int32_t> iCurJob { 0 };
+		if ( sError.IsEmpty() )
+			Threads::CoExecuteN ( iJobs, false, [&]
+			{
+				InsertRowBuf_t tBuf ( tSchema.GetAttrsCount() );
+				for ( int iJob = iCurJob.fetch_add ( 1, std::memory_order_acq_rel ); iJob<iJobs; iJob = iCurJob.fetch_add ( 1, std::memory_order_acq_rel ) )
+				{
+					int iStart = (int)( (int64_t)tStmt.m_iRowsAffected * iJob / iJobs );
+					int iEnd = (int)( (int64_t)tStmt.m_iRowsAffected * ( iJob+1 ) / iJobs );
+					for ( int c=iStart; c<iEnd; ++c )
+						if ( !fnAddRow ( c, dAccums[iJob], tBuf, dErrors[iJob], dWarnings[iJob] ) )
+							break;
+				}
+			});
+
+		// merge in row order; the first failed range reports the error as sequential path would
+		for ( int i=0; i<iJobs && sError.IsEmpty(); ++i )
+		{
+			if ( !dWarnings[i].IsEmpty() )
+				sWarning = dWarnings[i];
+
+			if ( !dErrors[i].IsEmpty() )
+				sError = dErrors[i];
+			else
+				pAccum->Append ( *dAccums[i] );
+		}
 	}
 
+	if ( !bPq && sError.IsEmpty() )
+		pAccum->AddCommand ( ReplicationCommand_e::RT_TRX, tStmt.m_sCluster, tStmt.m_sIndex );
+
+
 	// fire exit
 	if ( !sError.IsEmpty() )
 	{
@@ -10433,7 +10785,8 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, SqlStmt_t & tStmt, bool
 	dLastIds.SwapData ( dIds );
 
 	// no errors so far
-	if ( bCommit )
+	// bulk load txn gets written out as a new disk chunk each time it outgrows RAM chunk
+	if ( bCommit || ( !bPq && pAccum->m_bBulk && pAccum->GetUsedRam()>=pIndex->GetMemLimit() ) )
 		HandleCmdReplicate ( *pAccum, sError );
 
 	int64_t iLastInsertId = 0;
@@ -12995,6 +13348,7 @@ void HandleMysqlSet ( RowBuffer_i & tOut, SqlStmt_t & tStmt, SessionVars_t & tVa
 					}
 				}
 			}
+			tAcc.SetBulk ( false );
 		} else if ( tStmt.m_sSetName=="collation_connection" )
 		{
 			// per-session COLLATION_CONNECTION
@@ -13081,6 +13435,12 @@ void HandleMysqlSet ( RowBuffer_i & tOut, SqlStmt_t & tStmt, SessionVars_t & tVa
 		{
 			const QcacheStatus_t & s = QcacheGetStatus();
 			QcacheSetup ( s.m_iMaxBytes, s.m_iThreshMs, (int)tStmt.m_iSetValue );
+		} else if ( tStmt.m_sSetName=="qcache_result_max_bytes" )
+		{
+			ResultCacheSetup ( tStmt.m_iSetValue, ResultCacheGetStatus().m_iThreshMs );
+		} else if ( tStmt.m_sSetName=="qcache_result_thresh_msec" )
+		{
+			ResultCacheSetup ( ResultCacheGetStatus().m_iMaxBytes, (int)tStmt.m_iSetValue );
 		} else if ( tStmt.m_sSetName=="log_debug_filter" )
 		{
 			int iLen = tStmt.m_sSetValue.Length();
@@ -14250,6 +14610,15 @@ static void AddDiskIndexStatus ( VectorLike & dStatus, const CSphIndex * pIndex,
 		dStatus.MatchTupletf ( "disk_chunks", "%d", tStatus.m_iNumChunks );
 		dStatus.MatchTupletf ( "mem_limit", "%l", tStatus.m_iMemLimit );
 		dStatus.MatchTupletf ( "ram_bytes_retired", "%l", tStatus.m_iRamRetired );
+		dStatus.MatchTupletf ( "ram_segments_merges_pending", "%l", tStatus.m_iMergesPending );
+		dStatus.MatchTupletf ( "ram_segments_merges_done", "%l", tStatus.m_iMergesDone );
+		dStatus.MatchTupletf ( "ram_segments_merged_bytes", "%l", tStatus.m_iMergedBytes );
+		dStatus.MatchTupletFn ( "ram_segments_merge_rate", [&tStatus] {
+			StringBuilder_c sRate;
+			int64_t iRate = tStatus.m_iMergeTimeUs ? tStatus.m_iMergedBytes * 1000000 / tStatus.m_iMergeTimeUs : 0;
+			sRate.Sprintf ( "%l bytes/sec", iRate );
+			return CSphString ( sRate.cstr () );
+		} );
 		dStatus.MatchTupletf ( "tid", "%l", tStatus.m_iTID );
 		dStatus.MatchTupletf ( "tid_saved", "%l", tStatus.m_iSavedTID );
 	}
@@ -14985,6 +15354,13 @@ static void HandleMysqlShowPlan ( RowBuffer_i & tOut, const QueryProfile_c & p,
 	tOut.PutString ( sPlan.cstr (), sPlan.GetLength() );
 	tOut.Commit();
 
+	if ( !p.m_sAccessPlan.IsEmpty() )
+	{
+		tOut.PutString ( "access_plan" );
+		tOut.PutString ( p.m_sAccessPlan );
+		tOut.Commit();
+	}
+
 	tOut.Eof ( bMoreResultsFollow );
 }
 
@@ -15164,9 +15540,18 @@ RtAccum_t * CSphSessionAccum::GetAcc ( RtIndex_i * pIndex, CSphString & sError )
 	if ( pAcc!=m_pAcc )
 		SafeDelete ( m_pAcc );
 	m_pAcc = pAcc;
+	if ( m_pAcc )
+		m_pAcc->m_bBulk = m_bBulk;
 	return pAcc;
 }
 
+void CSphSessionAccum::SetBulk ( bool bBulk )
+{
+	m_bBulk = bBulk;
+	if ( m_pAcc )
+		m_pAcc->m_bBulk = bBulk;
+}
+
 RtIndex_i * CSphSessionAccum::GetIndex ()
 {
 	if ( m_pAcc )
@@ -15376,6 +15761,7 @@ public:
 					}
 					HandleCmdReplicate ( *pAccum, m_sError );
 				}
+				m_tAcc.SetBulk ( pStmt->m_iIntParam==1 );
 				tOut.Ok();
 				return true;
 			}
@@ -15403,6 +15789,7 @@ public:
 						pIndex->RollBack ( pAccum );
 					}
 				}
+				m_tAcc.SetBulk ( false );
 				tOut.Ok();
 				return true;
 			}
@@ -17157,6 +17544,7 @@ static void ReloadIndexSettings ( CSphConfigParser & tCP ) REQUIRES ( MainThread
 						bReconfigure = ( tDesc.m_tSettings.m_iExpandKeywords!=pServedRLocked->m_tSettings.m_iExpandKeywords ||
 							tDesc.m_tSettings.m_tFileAccess!=pServedRLocked->m_tSettings.m_tFileAccess ||
 							tDesc.m_tSettings.m_bPreopen!=pServedRLocked->m_tSettings.m_bPreopen ||
+							tDesc.m_tSettings.m_bPreloadDict!=pServedRLocked->m_tSettings.m_bPreloadDict ||
 							tDesc.m_sGlobalIDFPath!=pServedRLocked->m_sGlobalIDFPath );
 						bReconfigure |= ( pServedRLocked->m_eType!=IndexType_e::TEMPLATE
 								&& hIndex.Exists ( "path" )
@@ -18298,6 +18686,7 @@ void ConfigureSearchd ( const CSphConfig & hConf, bool bOptPIDFile, bool bTestMo
 	MutableIndexSettings_c::GetDefaults().m_bPreopen = hSearchd.GetBool ( "preopen_indexes" );
 	sphSetUnlinkOld ( hSearchd.GetBool ( "unlink_old" ) );
 	g_iExpansionLimit = hSearchd.GetInt ( "expansion_limit" );
+	SetExpansionCacheSize ( hSearchd.GetSize64 ( "expansion_cache_size", 16777216 ) );
 
 	// initialize buffering settings
 	SetUnhintedBuffer ( hSearchd.GetSize( "read_unhinted", DEFAULT_READ_UNHINTED ) );
@@ -18435,6 +18824,7 @@ void ConfigureSearchd ( const CSphConfig & hConf, bool bOptPIDFile, bool bTestMo
 	s.m_iThreshMs = hSearchd.GetMsTimeMs ( "qcache_thresh_msec", s.m_iThreshMs );
 	s.m_iTtlS = hSearchd.GetSTimeS ( "qcache_ttl_sec", s.m_iTtlS );
 	QcacheSetup ( s.m_iMaxBytes, s.m_iThreshMs, s.m_iTtlS );
+	ResultCacheSetup ( hSearchd.GetSize64 ( "qcache_result_max_bytes", 0 ), hSearchd.GetMsTimeMs ( "qcache_result_thresh_msec", 0 ) );
 
 	// hostname_lookup = {config_load | request}
 	g_bHostnameLookup = ( hSearchd.GetStr ( "hostname_lookup" ) == "request" );
@@ -19424,6 +19814,10 @@ int WINAPI ServiceMain ( int argc, char **argv ) REQUIRES (!MainThread)
 	
 	StartRtBinlogFlushing();
 
+	// from now on RAM segments of RT indexes are merged and saved to disk chunks in background
+	SetRtMergeSegmentsHook ( ScheduleMergeSegments );
+	SetRtSaveDiskChunkHook ( ScheduleSaveDiskChunk );
+
 	ScheduleFlushAttrs();
 
 	gStats().m_uStarted = (DWORD)time(NULL);
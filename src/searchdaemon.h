@@ -1178,9 +1178,11 @@ public:
 
 	RtAccum_t * GetAcc ( RtIndex_i * pIndex, CSphString & sError );
 	RtIndex_i * GetIndex ();
+	void SetBulk ( bool bBulk );
 
 private:
 	RtAccum_t * m_pAcc = nullptr;
+	bool m_bBulk = false;
 };
 
 
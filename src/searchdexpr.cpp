@@ -574,7 +574,7 @@ bool Expr_Highlight_c::FetchFieldsFromDocstore ( DocstoreDoc_t & tFetchedDoc, Do
 		return false;
 
 	const CSphVector<int> * pFieldsToFetch = m_bFetchAllFields ? nullptr : &m_dFieldsToFetch;
-	return m_tSession.m_pDocstore->GetDoc ( tFetchedDoc, tDocID, pFieldsToFetch, m_tSession.m_iSessionId, false );
+	return m_tSession.GetDoc ( tFetchedDoc, tDocID, pFieldsToFetch, false );
 }
 
 
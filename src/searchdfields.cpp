@@ -219,15 +219,23 @@ bool GetFieldFromLocal ( const CSphString & sIndexName, const FieldRequest_t & t
 		}
 	}
 
-	DocstoreDoc_t tDoc;
+	// fetch all the documents at once, so that docstore reads and unpacks every block only once
+	CSphVector<DocID_t> dDocids;
 	for ( DocID_t tDocid : tArgs.m_dDocs )
-	{
-		if ( hFetchedDocs.Exists ( tDocid ) )
-			continue;
+		if ( !hFetchedDocs.Exists ( tDocid ) )
+			dDocids.Add ( tDocid );
 
-		if ( !pIndex->GetDoc ( tDoc, tDocid, &dFieldIds, iSessionID, false ) )
+	CSphFixedVector<DocstoreDoc_t> dDocs ( dDocids.GetLength() );
+	CSphBitvec tFound ( dDocids.GetLength() );
+	pIndex->GetDocs ( dDocids, &dFieldIds, iSessionID, false, dDocs, tFound );
+
+	ARRAY_CONSTFOREACH ( iDoc, dDocids )
+	{
+		DocID_t tDocid = dDocids[iDoc];
+		if ( !tFound.BitGet(iDoc) || hFetchedDocs.Exists ( tDocid ) )
 			continue;
 
+		const DocstoreDoc_t & tDoc = dDocs[iDoc];
 		assert ( tDoc.m_dFields.GetLength()==dFieldIds.GetLength() );
 		hFetchedDocs.Set ( tDocid, tRes.m_dLocs.GetLength() );
 		for ( int iField : dFieldRemap )
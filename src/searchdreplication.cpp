@@ -1934,7 +1934,10 @@ bool CommitMonitor_c::Commit ( CSphString& sError )
 			return false;
 
 		if ( !pIndex->Commit ( m_pDeletedCount, &m_tAcc ) )
+		{
+			sError = pIndex->GetLastError();
 			return false;
+		}
 
 		return true;
 	}
@@ -0,0 +1,392 @@
+//
+// Copyright (c) 2017-2021, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License. You should have
+// received a copy of the GPL license along with this program; if you
+// did not, you can find it at http://www.gnu.org/
+//
+
+#include "searchdresultcache.h"
+#include "attribute.h"
+#include "fnv64.h"
+
+namespace {
+
+/// one query of the cached subset
+struct CachedResult_t : public ISphNoncopyable
+{
+	CSphSchema						m_tSchema;			///< flattened result schema, all attrs are dynamic
+	CSphFixedVector<CSphMatch>		m_dMatches { 0 };	///< all the matches that survived the final limit, with attrs and data ptrs copied
+	SmallStringHash_T<CSphQueryResultMeta::WordStat_t> m_hWordStats;
+	StrVec_t						m_dZeroCount;
+	int64_t							m_iTotalMatches = 0;
+	int								m_iMultiplier = 1;
+	int								m_iOffset = 0;
+	int								m_iCount = 0;
+	int								m_iSuccesses = 0;
+
+	~CachedResult_t()
+	{
+		for ( auto & tMatch : m_dMatches )
+			m_tSchema.FreeDataPtrs ( tMatch );
+	}
+};
+
+
+struct ResultCacheEntry_t
+{
+	CSphVector<BYTE>				m_dKey;
+	uint64_t						m_uHash = 0;
+	CSphFixedVector<CachedResult_t>	m_dResults { 0 };
+	int64_t							m_iSize = 0;
+	ResultCacheEntry_t *			m_pPrev = nullptr;	///< more recently used
+	ResultCacheEntry_t *			m_pNext = nullptr;	///< less recently used
+};
+
+
+class ResultCache_c : public ResultCacheStatus_t
+{
+public:
+					~ResultCache_c();
+
+	void			Setup ( int64_t iMaxBytes, int iThreshMs );
+	bool			Find ( const VecTraits_T<BYTE> & dKey, VecTraits_T<AggrResult_t> & dResults );
+	void			Add ( ResultCacheEntry_t * pEntry );
+	ResultCacheStatus_t GetStatus();
+	bool			IsEnabled() const { return GetMaxBytes()>0; }
+	int64_t			GetMaxBytes() const { return m_iMaxBytesLimit.load ( std::memory_order_relaxed ); }
+	int				GetThreshMs() const { return m_iThreshMsLimit.load ( std::memory_order_relaxed ); }
+
+private:
+	CSphMutex		m_tLock;
+	std::atomic<int64_t> m_iMaxBytesLimit { 0 };	///< lock-free copy of m_iMaxBytes for the per-query checks
+	std::atomic<int> m_iThreshMsLimit { 0 };		///< lock-free copy of m_iThreshMs
+	CSphOrderedHash<ResultCacheEntry_t *, uint64_t, IdentityHash_fn, 4096> m_hEntries;
+	ResultCacheEntry_t * m_pHead = nullptr;		///< most recently used entry
+	ResultCacheEntry_t * m_pTail = nullptr;		///< least recently used entry
+
+	void			Unlink ( ResultCacheEntry_t * pEntry );
+	void			LinkToHead ( ResultCacheEntry_t * pEntry );
+	void			DeleteEntry ( ResultCacheEntry_t * pEntry );
+	void			EnforceLimits();
+};
+
+ResultCache_c g_tResultCache;
+
+} // namespace
+
+
+// static attrs point into index storage, and blob attrs are read from index blob pool;
+// only plain values and data ptrs (owned by the match) could be copied out
+static bool CanFlattenSchema ( const ISphSchema & tSchema )
+{
+	for ( int i = 0; i < tSchema.GetAttrsCount(); ++i )
+	{
+		const CSphColumnInfo & tAttr = tSchema.GetAttr(i);
+		if ( tAttr.m_eAttrType==SPH_ATTR_NONE || tAttr.m_eAttrType==SPH_ATTR_JSON_FIELD || tAttr.IsColumnar() || sphIsBlobAttr ( tAttr ) )
+			return false;
+
+		if ( tAttr.m_tLocator.m_iBitOffset<0 )
+			return false;
+	}
+
+	return true;
+}
+
+
+static void FlattenSchema ( const ISphSchema & tSrc, CSphSchema & tDst )
+{
+	for ( int i = 0; i < tSrc.GetFieldsCount(); ++i )
+		tDst.AddField ( tSrc.GetField(i) );
+
+	for ( int i = 0; i < tSrc.GetAttrsCount(); ++i )
+	{
+		const CSphColumnInfo & tAttr = tSrc.GetAttr(i);
+		CSphColumnInfo tCol = tAttr;
+		tCol.m_pExpr = nullptr;
+		tCol.m_tLocator = CSphAttrLocator ( -1, tAttr.m_tLocator.m_iBitCount );
+		tDst.AddAttr ( tCol, true );
+	}
+}
+
+
+static int64_t CopyFlattenedMatch ( CSphMatch & tDst, const CSphMatch & tSrc, const ISphSchema & tSrcSchema, const CSphSchema & tFlat )
+{
+	tDst.Reset ( tFlat.GetDynamicSize() );
+	tDst.m_tRowID = tSrc.m_tRowID;
+	tDst.m_iWeight = tSrc.m_iWeight;
+	tDst.m_iTag = 0;
+
+	int64_t iBytes = sizeof(CSphMatch) + tFlat.GetDynamicSize()*sizeof(CSphRowitem);
+	for ( int i = 0; i < tFlat.GetAttrsCount(); ++i )
+	{
+		const CSphAttrLocator & tFrom = tSrcSchema.GetAttr(i).m_tLocator;
+		const CSphColumnInfo & tTo = tFlat.GetAttr(i);
+
+		if ( !tTo.IsDataPtr() )
+		{
+			tDst.SetAttr ( tTo.m_tLocator, tSrc.GetAttr ( tFrom ) );
+			continue;
+		}
+
+		auto pData = (const BYTE *) tSrc.GetAttr ( tFrom );
+		if ( !pData )
+			continue;
+
+		tDst.SetAttr ( tTo.m_tLocator, (SphAttr_t) sph::CopyPackedAttr ( pData ) );
+		iBytes += sphUnpackPtrAttr ( pData ).second + sizeof(DWORD);
+	}
+
+	return iBytes;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+ResultCache_c::~ResultCache_c()
+{
+	while ( m_pHead )
+		DeleteEntry ( m_pHead );
+}
+
+
+void ResultCache_c::Setup ( int64_t iMaxBytes, int iThreshMs )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	m_iMaxBytes = Max ( iMaxBytes, 0 );
+	m_iThreshMs = Max ( iThreshMs, 0 );
+	m_iMaxBytesLimit.store ( m_iMaxBytes, std::memory_order_relaxed );
+	m_iThreshMsLimit.store ( m_iThreshMs, std::memory_order_relaxed );
+	EnforceLimits();
+}
+
+
+bool ResultCache_c::Find ( const VecTraits_T<BYTE> & dKey, VecTraits_T<AggrResult_t> & dResults )
+{
+	uint64_t uHash = sphFNV64 ( dKey.Begin(), dKey.GetLength() );
+
+	ScopedMutex_t tLock ( m_tLock );
+	ResultCacheEntry_t ** ppEntry = m_hEntries ( uHash );
+	ResultCacheEntry_t * pEntry = ppEntry ? *ppEntry : nullptr;
+	if ( !pEntry || pEntry->m_dResults.GetLength()!=dResults.GetLength()
+		|| pEntry->m_dKey.GetLength()!=dKey.GetLength() || memcmp ( pEntry->m_dKey.Begin(), dKey.Begin(), dKey.GetLength() ) )
+	{
+		++m_iMisses;
+		return false;
+	}
+
+	++m_iHits;
+	Unlink ( pEntry );
+	LinkToHead ( pEntry );
+
+	ARRAY_FOREACH ( i, dResults )
+	{
+		const CachedResult_t & tCached = pEntry->m_dResults[i];
+		AggrResult_t & tRes = dResults[i];
+
+		tRes.m_hWordStats = tCached.m_hWordStats;
+		tRes.m_iTotalMatches = tCached.m_iTotalMatches;
+		tRes.m_iMultiplier = tCached.m_iMultiplier;
+		tRes.m_dZeroCount = tCached.m_dZeroCount;
+		tRes.m_iOffset = tCached.m_iOffset;
+		tRes.m_iCount = tCached.m_iCount;
+		tRes.m_iSuccesses = tCached.m_iSuccesses;
+		tRes.m_tSchema = tCached.m_tSchema;
+
+		tRes.m_dResults.Reset();
+		auto & tOne = tRes.m_dResults.Add();
+		tOne.m_tSchema = tCached.m_tSchema;
+		tOne.m_dMatches.Reserve ( tCached.m_dMatches.GetLength() );
+		for ( const auto & tMatch : tCached.m_dMatches )
+			tCached.m_tSchema.CloneMatch ( tOne.m_dMatches.Add(), tMatch );
+
+		Debug ( tRes.m_bSingle = true; )
+		Debug ( tRes.m_bOneSchema = true; )
+		Debug ( tRes.m_bTagsCompacted = true; )
+		Debug ( tRes.m_bIdxByTag = true; )
+	}
+
+	return true;
+}
+
+
+void ResultCache_c::Add ( ResultCacheEntry_t * pEntry )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	if ( pEntry->m_iSize>m_iMaxBytes )
+	{
+		SafeDelete ( pEntry );
+		return;
+	}
+
+	// same key might have been added by a concurrent query (or that is a hash collision); newer one wins
+	ResultCacheEntry_t ** ppOld = m_hEntries ( pEntry->m_uHash );
+	if ( ppOld )
+		DeleteEntry ( *ppOld );
+
+	m_hEntries.Add ( pEntry, pEntry->m_uHash );
+	LinkToHead ( pEntry );
+	m_iUsedBytes += pEntry->m_iSize;
+	++m_iCachedResults;
+
+	EnforceLimits();
+}
+
+
+ResultCacheStatus_t ResultCache_c::GetStatus()
+{
+	ScopedMutex_t tLock ( m_tLock );
+	return *this;
+}
+
+
+void ResultCache_c::Unlink ( ResultCacheEntry_t * pEntry )
+{
+	if ( pEntry->m_pPrev )
+		pEntry->m_pPrev->m_pNext = pEntry->m_pNext;
+	else
+		m_pHead = pEntry->m_pNext;
+
+	if ( pEntry->m_pNext )
+		pEntry->m_pNext->m_pPrev = pEntry->m_pPrev;
+	else
+		m_pTail = pEntry->m_pPrev;
+
+	pEntry->m_pPrev = pEntry->m_pNext = nullptr;
+}
+
+
+void ResultCache_c::LinkToHead ( ResultCacheEntry_t * pEntry )
+{
+	pEntry->m_pNext = m_pHead;
+	if ( m_pHead )
+		m_pHead->m_pPrev = pEntry;
+	m_pHead = pEntry;
+	if ( !m_pTail )
+		m_pTail = pEntry;
+}
+
+
+void ResultCache_c::DeleteEntry ( ResultCacheEntry_t * pEntry )
+{
+	Unlink ( pEntry );
+	m_hEntries.Delete ( pEntry->m_uHash );
+	m_iUsedBytes -= pEntry->m_iSize;
+	--m_iCachedResults;
+	SafeDelete ( pEntry );
+}
+
+
+void ResultCache_c::EnforceLimits()
+{
+	// entries of the previous index generations are never hit again, so they just age out here
+	while ( m_pTail && m_iUsedBytes>m_iMaxBytes )
+		DeleteEntry ( m_pTail );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void ResultCacheSetup ( int64_t iMaxBytes, int iThreshMs )
+{
+	g_tResultCache.Setup ( iMaxBytes, iThreshMs );
+}
+
+
+ResultCacheStatus_t ResultCacheGetStatus()
+{
+	return g_tResultCache.GetStatus();
+}
+
+
+bool ResultCacheEnabled()
+{
+	// stale value is ok here; worst case is one extra lookup or one missed add right after the setting changed
+	return g_tResultCache.IsEnabled();
+}
+
+
+void ResultCacheKeyAddIndex ( ISphOutputBuffer & tKey, const CSphIndex & tIndex )
+{
+	tKey.SendUint64 ( tIndex.GetIndexId() );
+	tKey.SendUint64 ( tIndex.GetGeneration() );
+}
+
+
+bool ResultCacheCanStore ( const AggrResult_t & tRes )
+{
+	if ( tRes.m_iSuccesses<=0 || !tRes.m_sError.IsEmpty() || !tRes.m_sWarning.IsEmpty() || tRes.m_pProfile )
+		return false;
+
+	// finalized results are merged into single chunk
+	if ( tRes.m_dResults.GetLength()!=1 )
+		return false;
+
+	return CanFlattenSchema ( tRes.m_tSchema );
+}
+
+
+bool ResultCacheFind ( const VecTraits_T<BYTE> & dKey, VecTraits_T<AggrResult_t> & dResults )
+{
+	return g_tResultCache.Find ( dKey, dResults );
+}
+
+
+void ResultCacheAdd ( const VecTraits_T<BYTE> & dKey, const VecTraits_T<AggrResult_t> & dResults, int64_t tmElapsed )
+{
+	// cheap queries are faster to run again than to copy out
+	if ( tmElapsed < (int64_t)g_tResultCache.GetThreshMs()*1000 )
+		return;
+
+	// matches alone (w/o strings and mvas) give a lower bound of the entry size; check it before copying anything out
+	int64_t iMaxBytes = g_tResultCache.GetMaxBytes();
+	int64_t iSize = sizeof(ResultCacheEntry_t) + dKey.GetLength();
+	for ( const AggrResult_t & tRes : dResults )
+	{
+		if ( !ResultCacheCanStore ( tRes ) )
+			return;
+
+		iSize += sizeof(CachedResult_t) + tRes.m_dResults.First().m_dMatches.GetLength() * ( sizeof(CSphMatch) + tRes.m_tSchema.GetDynamicSize()*sizeof(CSphRowitem) );
+	}
+
+	if ( iSize>iMaxBytes )
+		return;
+
+	// copying out might be expensive, so do that before locking the cache
+	CSphScopedPtr<ResultCacheEntry_t> pEntry { new ResultCacheEntry_t };
+	pEntry->m_dKey.Append ( dKey );
+	pEntry->m_uHash = sphFNV64 ( dKey.Begin(), dKey.GetLength() );
+	pEntry->m_dResults.Reset ( dResults.GetLength() );
+	pEntry->m_iSize = sizeof(ResultCacheEntry_t) + dKey.GetLength();
+
+	ARRAY_FOREACH ( i, dResults )
+	{
+		const AggrResult_t & tRes = dResults[i];
+		CachedResult_t & tCached = pEntry->m_dResults[i];
+		FlattenSchema ( tRes.m_tSchema, tCached.m_tSchema );
+
+		// strings and mvas might still not fit; stop copying as soon as the running size exceeds the limit
+		const auto & dMatches = tRes.m_dResults.First().m_dMatches;
+		tCached.m_dMatches.Reset ( dMatches.GetLength() );
+		ARRAY_FOREACH ( j, dMatches )
+		{
+			pEntry->m_iSize += CopyFlattenedMatch ( tCached.m_dMatches[j], dMatches[j], tRes.m_tSchema, tCached.m_tSchema );
+			if ( pEntry->m_iSize>iMaxBytes )
+				return;
+		}
+
+		tCached.m_hWordStats = tRes.m_hWordStats;
+		for ( const auto & tStat : tRes.m_hWordStats )
+			pEntry->m_iSize += tStat.first.Length() + sizeof(tStat);
+
+		tCached.m_dZeroCount = tRes.m_dZeroCount;
+		tCached.m_iTotalMatches = tRes.m_iTotalMatches;
+		tCached.m_iMultiplier = tRes.m_iMultiplier;
+		tCached.m_iOffset = tRes.m_iOffset;
+		tCached.m_iCount = tRes.m_iCount;
+		tCached.m_iSuccesses = tRes.m_iSuccesses;
+		pEntry->m_iSize += sizeof(CachedResult_t);
+	}
+
+	g_tResultCache.Add ( pEntry.LeakPtr() );
+}
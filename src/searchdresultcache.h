@@ -0,0 +1,46 @@
+//
+// Copyright (c) 2017-2021, Manticore Software LTD (https://manticoresearch.com)
+// All rights reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License. You should have
+// received a copy of the GPL license along with this program; if you
+// did not, you can find it at http://www.gnu.org/
+//
+
+#ifndef _searchdresultcache_
+#define _searchdresultcache_
+
+#include "searchdaemon.h"
+
+/// result cache status
+struct ResultCacheStatus_t
+{
+	int64_t		m_iMaxBytes = 0;		///< max RAM bytes, 0 means disabled
+	int			m_iThreshMs = 0;		///< minimum wall time of the subset to cache, in msec
+	int			m_iCachedResults = 0;	///< cached query subsets count
+	int64_t		m_iUsedBytes = 0;		///< used RAM bytes
+	int64_t		m_iHits = 0;			///< cache hits
+	int64_t		m_iMisses = 0;			///< cache misses
+};
+
+/// second-tier cache that keeps final (sorted, grouped and limited) results of a whole query subset
+/// the key is built by the caller, and must include everything the results depend on (queries, indexes and their generations)
+void				ResultCacheSetup ( int64_t iMaxBytes, int iThreshMs );
+ResultCacheStatus_t	ResultCacheGetStatus();
+bool				ResultCacheEnabled();
+
+/// append the id and the current generation of a local index to the key, so that any visible change of the index makes a new key
+void				ResultCacheKeyAddIndex ( ISphOutputBuffer & tKey, const CSphIndex & tIndex );
+
+/// check whether aggregated (and finalized) results could be stored
+bool				ResultCacheCanStore ( const AggrResult_t & tRes );
+
+/// fill results from the cache; returns false on miss
+bool				ResultCacheFind ( const VecTraits_T<BYTE> & dKey, VecTraits_T<AggrResult_t> & dResults );
+
+/// store a copy of the results; static attrs are copied too, so the entry does not refer to index data
+/// results that took less than the threshold to compute, or that do not fit into the cache, are not copied
+void				ResultCacheAdd ( const VecTraits_T<BYTE> & dKey, const VecTraits_T<AggrResult_t> & dResults, int64_t tmElapsed );
+
+#endif // _searchdresultcache_
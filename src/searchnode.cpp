@@ -18,6 +18,7 @@
 #include "sphinxqcache.h"
 #include "attribute.h"
 #include "mini_timer.h"
+#include "secondaryindex.h"
 
 #include <math.h>
 
@@ -5478,6 +5479,324 @@ void ExtNotNear_c::CollectHits ( const ExtDoc_t * pDocs )
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+// ROWID FILTER
+//////////////////////////////////////////////////////////////////////////
+
+/// passes through only the documents from a given sorted rowid list, or streamed from a rowid iterator
+/// used to push attribute filters served by docid lookup or secondary indexes down into the full-text tree
+/// iterators can't rewind, so the node is only good for a single pass
+class ExtRowidFilter_c : public ExtNode_i
+{
+public:
+						ExtRowidFilter_c ( ExtNode_i * pNode, CSphVector<RowID_t> & dRowIDs );
+						ExtRowidFilter_c ( ExtNode_i * pNode, RowidIterator_i * pIterator );
+						~ExtRowidFilter_c() override;
+
+	void				Reset ( const ISphQwordSetup & tSetup ) override;
+	void				HintRowID ( RowID_t tRowID ) override		{ m_pNode->HintRowID ( tRowID ); }
+	const ExtDoc_t *	GetDocsChunk() override;
+	const ExtHit_t *	GetHits ( const ExtDoc_t * pDocs ) override	{ return m_pNode->GetHits ( pDocs ); }
+
+	int					GetQwords ( ExtQwordsHash_t & hQwords ) override { return m_pNode->GetQwords ( hQwords ); }
+	void				SetQwordsIDF ( const ExtQwordsHash_t & hQwords ) override { m_pNode->SetQwordsIDF ( hQwords ); }
+	void				GetTerms ( const ExtQwordsHash_t & hQwords, CSphVector<TermPos_t> & dTermDupes ) const override { m_pNode->GetTerms ( hQwords, dTermDupes ); }
+	bool				GotHitless() override						{ return m_pNode->GotHitless(); }
+	int					GetDocsCount() override;
+	int					GetHitsCount() override						{ return m_pNode->GetHitsCount(); }
+	uint64_t			GetWordID() const override					{ return m_pNode->GetWordID(); }
+	void				SetAtomPos ( int iPos ) override			{ m_pNode->SetAtomPos ( iPos ); }
+	int					GetAtomPos() const override					{ return m_pNode->GetAtomPos(); }
+	void				SetCollectHits() override					{ m_pNode->SetCollectHits(); }
+
+	void				DebugDump ( int iLevel ) override;
+
+private:
+	ExtNode_i *			m_pNode = nullptr;
+	CSphScopedPtr<RowidIterator_i> m_pIterator { nullptr };	///< wanted rows are either streamed from an iterator
+	CSphVector<RowID_t>	m_dRowIDs;								///< or taken from a sorted list
+	RowIdBlock_t		m_dBlock;								///< current block of wanted rows
+	int					m_iBlockRow = 0;
+	const ExtDoc_t *	m_pDoc = nullptr;
+	ExtDoc_t			m_dDocs[MAX_BLOCK_DOCS];
+
+	bool				HaveRows();
+	bool				SkipTo ( RowID_t tRowID );
+};
+
+
+ExtRowidFilter_c::ExtRowidFilter_c ( ExtNode_i * pNode, CSphVector<RowID_t> & dRowIDs )
+	: m_pNode ( pNode )
+{
+	assert ( m_pNode );
+	m_dRowIDs.SwapData ( dRowIDs );
+	m_dBlock = m_dRowIDs;
+}
+
+
+ExtRowidFilter_c::ExtRowidFilter_c ( ExtNode_i * pNode, RowidIterator_i * pIterator )
+	: m_pNode ( pNode )
+	, m_pIterator ( pIterator )
+{
+	assert ( m_pNode && m_pIterator.Ptr() );
+}
+
+
+ExtRowidFilter_c::~ExtRowidFilter_c()
+{
+	SafeDelete ( m_pNode );
+}
+
+
+void ExtRowidFilter_c::Reset ( const ISphQwordSetup & tSetup )
+{
+	m_pNode->Reset ( tSetup );
+	m_pDoc = nullptr;
+	if ( !m_pIterator.Ptr() )
+	{
+		m_dBlock = m_dRowIDs;
+		m_iBlockRow = 0;
+	}
+}
+
+
+int ExtRowidFilter_c::GetDocsCount()
+{
+	if ( m_pIterator.Ptr() )
+		return m_pNode->GetDocsCount();
+
+	return Min ( m_pNode->GetDocsCount(), m_dRowIDs.GetLength() );
+}
+
+
+bool ExtRowidFilter_c::HaveRows()
+{
+	while ( m_iBlockRow>=m_dBlock.GetLength() )
+	{
+		if ( !m_pIterator.Ptr() || !m_pIterator->GetNextRowIdBlock ( m_dBlock ) )
+		{
+			m_dBlock = RowIdBlock_t();
+			m_iBlockRow = 0;
+			return false;
+		}
+
+		m_iBlockRow = 0;
+	}
+
+	return true;
+}
+
+
+bool ExtRowidFilter_c::SkipTo ( RowID_t tRowID )
+{
+	while ( HaveRows() )
+	{
+		// skip whole blocks below the wanted row; iterator may skip them without decoding
+		if ( m_dBlock.Last()<tRowID )
+		{
+			m_iBlockRow = m_dBlock.GetLength();
+			if ( m_pIterator.Ptr() && !m_pIterator->HintRowID ( tRowID ) )
+				return false;
+
+			continue;
+		}
+
+		RowID_t * pFound = sphBinarySearchFirst ( m_dBlock.Begin()+m_iBlockRow, m_dBlock.End(), SphIdentityFunctor_T<RowID_t>(), tRowID );
+		m_iBlockRow = int ( pFound-m_dBlock.Begin() );
+		return true;
+	}
+
+	return false;
+}
+
+
+const ExtDoc_t * ExtRowidFilter_c::GetDocsChunk()
+{
+	int iDoc = 0;
+	while ( iDoc<MAX_BLOCK_DOCS-1 && HaveRows() )
+	{
+		if ( !HasDocs(m_pDoc) )
+		{
+			// return docs from a single child chunk only, so that the child is still able to return hits for them
+			if ( iDoc )
+				break;
+
+			m_pNode->HintRowID ( m_dBlock[m_iBlockRow] );
+			m_pDoc = m_pNode->GetDocsChunk();
+			if ( !m_pDoc )
+			{
+				m_dBlock = RowIdBlock_t();
+				m_pIterator.Reset();
+				break;
+			}
+
+			continue;
+		}
+
+		RowID_t tRowID = m_dBlock[m_iBlockRow];
+		if ( m_pDoc->m_tRowID<tRowID )
+			m_pDoc++;
+		else if ( m_pDoc->m_tRowID>tRowID )
+		{
+			// skip to the first wanted row not below the current doc
+			if ( !SkipTo ( m_pDoc->m_tRowID ) )
+				break;
+		}
+		else
+		{
+			m_dDocs[iDoc++] = *m_pDoc++;
+			m_iBlockRow++;
+		}
+	}
+
+	m_dDocs[iDoc].m_tRowID = INVALID_ROWID;
+	return iDoc ? m_dDocs : nullptr;
+}
+
+
+void ExtRowidFilter_c::DebugDump ( int iLevel )
+{
+	DebugIndent ( iLevel );
+	if ( m_pIterator.Ptr() )
+		printf ( "ExtRowidFilter: streamed rows\n" );
+	else
+		printf ( "ExtRowidFilter: %d rows\n", m_dRowIDs.GetLength() );
+	m_pNode->DebugDump ( iLevel+1 );
+}
+
+
+ExtNode_i * CreateRowidFilterNode ( ExtNode_i * pNode, CSphVector<RowID_t> & dRowIDs )
+{
+	return new ExtRowidFilter_c ( pNode, dRowIDs );
+}
+
+
+ExtNode_i * CreateRowidFilterNode ( ExtNode_i * pNode, RowidIterator_i * pIterator )
+{
+	return new ExtRowidFilter_c ( pNode, pIterator );
+}
+
+
+/// passes through only the documents from a given rowid range; used to split full-text search into pseudo-shards
+class ExtRowRange_c : public ExtNode_i
+{
+public:
+						ExtRowRange_c ( ExtNode_i * pNode, RowID_t tMinRowID, RowID_t tMaxRowID );
+						~ExtRowRange_c() override;
+
+	void				Reset ( const ISphQwordSetup & tSetup ) override;
+	void				HintRowID ( RowID_t tRowID ) override		{ m_pNode->HintRowID ( tRowID ); }
+	const ExtDoc_t *	GetDocsChunk() override;
+	const ExtHit_t *	GetHits ( const ExtDoc_t * pDocs ) override	{ return m_pNode->GetHits ( pDocs ); }
+
+	int					GetQwords ( ExtQwordsHash_t & hQwords ) override { return m_pNode->GetQwords ( hQwords ); }
+	void				SetQwordsIDF ( const ExtQwordsHash_t & hQwords ) override { m_pNode->SetQwordsIDF ( hQwords ); }
+	void				GetTerms ( const ExtQwordsHash_t & hQwords, CSphVector<TermPos_t> & dTermDupes ) const override { m_pNode->GetTerms ( hQwords, dTermDupes ); }
+	bool				GotHitless() override						{ return m_pNode->GotHitless(); }
+	int					GetDocsCount() override						{ return m_pNode->GetDocsCount(); }
+	int					GetHitsCount() override						{ return m_pNode->GetHitsCount(); }
+	uint64_t			GetWordID() const override					{ return m_pNode->GetWordID(); }
+	void				SetAtomPos ( int iPos ) override			{ m_pNode->SetAtomPos ( iPos ); }
+	int					GetAtomPos() const override					{ return m_pNode->GetAtomPos(); }
+	void				SetCollectHits() override					{ m_pNode->SetCollectHits(); }
+
+	void				DebugDump ( int iLevel ) override;
+
+private:
+	ExtNode_i *			m_pNode = nullptr;
+	RowID_t				m_tMinRowID = 0;
+	RowID_t				m_tMaxRowID = INVALID_ROWID;
+	bool				m_bStarted = false;
+	bool				m_bDone = false;
+	ExtDoc_t			m_dDocs[MAX_BLOCK_DOCS];
+};
+
+
+ExtRowRange_c::ExtRowRange_c ( ExtNode_i * pNode, RowID_t tMinRowID, RowID_t tMaxRowID )
+	: m_pNode ( pNode )
+	, m_tMinRowID ( tMinRowID )
+	, m_tMaxRowID ( tMaxRowID )
+{
+	assert ( m_pNode );
+}
+
+
+ExtRowRange_c::~ExtRowRange_c()
+{
+	SafeDelete ( m_pNode );
+}
+
+
+void ExtRowRange_c::Reset ( const ISphQwordSetup & tSetup )
+{
+	m_pNode->Reset ( tSetup );
+	m_bStarted = false;
+	m_bDone = false;
+}
+
+
+const ExtDoc_t * ExtRowRange_c::GetDocsChunk()
+{
+	if ( m_bDone )
+		return nullptr;
+
+	// skiplists let the terms jump straight to the start of the range
+	if ( !m_bStarted )
+	{
+		m_bStarted = true;
+		if ( m_tMinRowID )
+			m_pNode->HintRowID ( m_tMinRowID );
+	}
+
+	while ( !m_bDone )
+	{
+		const ExtDoc_t * pDoc = m_pNode->GetDocsChunk();
+		if ( !pDoc )
+		{
+			m_bDone = true;
+			break;
+		}
+
+		int iDoc = 0;
+		for ( ; HasDocs(pDoc); pDoc++ )
+		{
+			if ( pDoc->m_tRowID<m_tMinRowID )
+				continue;
+
+			if ( pDoc->m_tRowID>=m_tMaxRowID )
+			{
+				m_bDone = true;
+				break;
+			}
+
+			m_dDocs[iDoc++] = *pDoc;
+		}
+
+		if ( iDoc )
+		{
+			m_dDocs[iDoc].m_tRowID = INVALID_ROWID;
+			return m_dDocs;
+		}
+	}
+
+	return nullptr;
+}
+
+
+void ExtRowRange_c::DebugDump ( int iLevel )
+{
+	DebugIndent ( iLevel );
+	printf ( "ExtRowRange: %u-%u\n", m_tMinRowID, m_tMaxRowID );
+	m_pNode->DebugDump ( iLevel+1 );
+}
+
+
+ExtNode_i * CreateRowRangeNode ( ExtNode_i * pNode, RowID_t tMinRowID, RowID_t tMaxRowID )
+{
+	return new ExtRowRange_c ( pNode, tMinRowID, tMaxRowID );
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 // INTRA-BATCH CACHING
 //////////////////////////////////////////////////////////////////////////
@@ -91,6 +91,18 @@ public:
 };
 
 
+class RowidIterator_i;
+
+/// wraps a full-text node so that it only returns the documents from a sorted rowid list; takes ownership of the node
+ExtNode_i *	CreateRowidFilterNode ( ExtNode_i * pNode, CSphVector<RowID_t> & dRowIDs );
+
+/// same, with rows streamed from an iterator that returns them in ascending order; takes ownership of both
+ExtNode_i *	CreateRowidFilterNode ( ExtNode_i * pNode, RowidIterator_i * pIterator );
+
+/// wraps a full-text node so that it only returns the documents from [min,max) rowid range; takes ownership of the node
+ExtNode_i *	CreateRowRangeNode ( ExtNode_i * pNode, RowID_t tMinRowID, RowID_t tMaxRowID );
+
+
 class NodeCacheContainer_c;
 
 /// intra-batch node cache
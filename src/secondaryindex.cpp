@@ -14,6 +14,9 @@
 #include "sphinxint.h"
 #include "killlist.h"
 #include "attribute.h"
+#include "collation.h"
+#include "fileutils.h"
+#include <algorithm>
 
 
 static bool HaveIndex ( const CSphString & sAttr )
@@ -50,6 +53,7 @@ public:
 	bool				HintRowID ( RowID_t tRowID ) override;
 	bool				GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock ) override;
 	int64_t				GetNumProcessed() const override;
+	bool				IsSorted() const override { return false; }
 
 private:
 	int64_t				m_iProcessed {0};
@@ -131,6 +135,7 @@ public:
 	bool				HintRowID ( RowID_t tRowID ) override;
 	bool				GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock ) override;
 	int64_t				GetNumProcessed() const override;
+	bool				IsSorted() const override { return false; }
 
 protected:
 	int64_t				m_iProcessed {0};
@@ -277,6 +282,7 @@ public:
 	bool		HintRowID ( RowID_t tRowID ) override;
 	bool		GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock ) override;
 	int64_t		GetNumProcessed() const override;
+	bool		IsSorted() const override;
 
 private:
 	struct IteratorState_t
@@ -475,6 +481,22 @@ int64_t RowidIterator_Intersect_T<T>::GetNumProcessed() const
 	return iTotal;
 }
 
+template<typename T>
+bool RowidIterator_Intersect_T<T>::IsSorted() const
+{
+	return true;
+}
+
+template<>
+bool RowidIterator_Intersect_T<RowidIterator_i>::IsSorted() const
+{
+	for ( const auto & i : m_dIterators )
+		if ( !i.m_pIterator->IsSorted() )
+			return false;
+
+	return true;
+}
+
 #if USE_COLUMNAR
 class RowidIterator_Wrapper_c : public RowidIterator_i
 {
@@ -534,10 +556,10 @@ bool RowidIterator_Wrapper_c::GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock )
 }
 
 
-static RowidIterator_i * CreateIterator ( const CSphFilterSettings & tFilter, const BYTE * pDocidLookup )
+static RowidIterator_i * CreateIterator ( const CSphFilterSettings & tFilter, const BYTE * pDocidLookup, const SecondaryIndex_c * pSecondaryIndex )
 {
 	if ( !HaveIndex ( tFilter.m_sAttrName ) )
-		return nullptr;
+		return pSecondaryIndex ? pSecondaryIndex->CreateIterator(tFilter) : nullptr;
 
 	switch ( tFilter.m_eType )
 	{
@@ -615,12 +637,19 @@ public:
 		return 8.0f*float(iDocs)*SCALE;
 	}
 
+	float Fulltext ( int64_t iDocs ) const
+	{
+		return 20.0f*float(iDocs)*SCALE;
+	}
+
 private:
 	static constexpr float SCALE = 1.0f/1000000.0f;
 };
 
 
-float CalcQueryCost ( const CSphVector<CSphFilterSettings> & dFilters, const CSphVector<IndexWithEstimate_t> & dSecondaryIndexes, int64_t iTotalDocs )
+/// iFulltextDocs is the estimated count of full-text matches, or -1 for fullscan queries
+/// rows from the enabled indexes are then used to skip through the doclists instead of scanning all rows
+float CalcQueryCost ( const CSphVector<CSphFilterSettings> & dFilters, const CSphVector<IndexWithEstimate_t> & dSecondaryIndexes, int64_t iTotalDocs, int64_t iFulltextDocs )
 {
 	float fCost = 0.0f;
 	int64_t iDocsProcessedByIndexes = 0;
@@ -641,32 +670,50 @@ float CalcQueryCost ( const CSphVector<CSphFilterSettings> & dFilters, const CSp
 
 
 	CostEstimate_c tCost;
+	bool bFulltext = iFulltextDocs>=0;
 
 	if ( !nEnabled )
 	{
-		fCost += tCost.Fullscan ( iTotalDocs );
-		fCost += tCost.Filter ( iTotalDocs, dFilters.GetLength() );
-	}
-	else
-	{
-		fCost += tCost.LookupRead ( iDocsProcessedByIndexes );
-
-		if ( nEnabled>1 )
+		if ( bFulltext )
 		{
-			fCost += tCost.IndexIntersect ( iDocsProcessedByIndexes );
-			fCost += tCost.Filter ( uint64_t(fTotalIndexProbability*iTotalDocs), dFilters.GetLength()-nEnabled );
+			fCost += tCost.Fulltext ( iFulltextDocs );
+			fCost += tCost.Filter ( iFulltextDocs, dFilters.GetLength() );
 		}
 		else
-			fCost += tCost.Filter ( iDocsProcessedByIndexes, dFilters.GetLength()-nEnabled );
+		{
+			fCost += tCost.Fullscan ( iTotalDocs );
+			fCost += tCost.Filter ( iTotalDocs, dFilters.GetLength() );
+		}
+
+		return fCost;
+	}
+
+	fCost += tCost.LookupRead ( iDocsProcessedByIndexes );
+
+	int64_t iDocsAfterIndexes = iDocsProcessedByIndexes;
+	if ( nEnabled>1 )
+	{
+		fCost += tCost.IndexIntersect ( iDocsProcessedByIndexes );
+		iDocsAfterIndexes = int64_t(fTotalIndexProbability*iTotalDocs);
+	}
+
+	if ( bFulltext )
+	{
+		iDocsAfterIndexes = Min ( iDocsAfterIndexes, iFulltextDocs );
+		fCost += tCost.Fulltext ( iDocsAfterIndexes );
 	}
 
+	fCost += tCost.Filter ( iDocsAfterIndexes, dFilters.GetLength()-nEnabled );
+
 	return fCost;
 }
 
 
-void SelectIterators ( const CSphVector<CSphFilterSettings> & dFilters, const CSphVector<IndexHint_t> & dHints, CSphVector<SecondaryIndexInfo_t> & dEnabledIndexes, const HistogramContainer_c & tHistograms )
+static void SelectIterators ( const CSphVector<CSphFilterSettings> & dFilters, const CSphVector<IndexHint_t> & dHints, CSphVector<SecondaryIndexInfo_t> & dEnabledIndexes, const HistogramContainer_c & tHistograms,
+	const SecondaryIndex_c * pSecondaryIndex, ESphCollation eCollation, AccessPlan_t & tPlan )
 {
 	dEnabledIndexes.Resize(0);
+	tPlan.m_dEstimates.Resize(0);
 
 	bool bHaveUseHint = false;
 	ARRAY_FOREACH_COND ( i, dHints, !bHaveUseHint )
@@ -677,11 +724,13 @@ void SelectIterators ( const CSphVector<CSphFilterSettings> & dFilters, const CS
 	{
 		const CSphFilterSettings & tFilter = dFilters[i];
 
-		if ( !HaveIndex ( tFilter.m_sAttrName.cstr() ) )
+		bool bSecondaryIndex = !HaveIndex ( tFilter.m_sAttrName ) && pSecondaryIndex && pSecondaryIndex->IsEnabled ( tFilter, eCollation );
+		if ( !HaveIndex ( tFilter.m_sAttrName ) && !bSecondaryIndex )
 			continue;
 
+		// there are no histograms for strings; secondary index can estimate by itself
 		const Histogram_i * pHistogram = tHistograms.Get ( tFilter.m_sAttrName );
-		if ( !pHistogram )
+		if ( !pHistogram && !bSecondaryIndex )
 			continue;
 
 		IndexHint_e * pHint = nullptr;
@@ -697,19 +746,27 @@ void SelectIterators ( const CSphVector<CSphFilterSettings> & dFilters, const CS
 
 		IndexWithEstimate_t tNewIndex;
 
-		bool bUsable = pHistogram->EstimateRsetSize ( tFilter, tNewIndex.m_iRsetEstimate );
+		bool bUsable = pHistogram ? pHistogram->EstimateRsetSize ( tFilter, tNewIndex.m_iRsetEstimate ) : pSecondaryIndex->EstimateRsetSize ( tFilter, tNewIndex.m_iRsetEstimate );
 		if ( bUsable )
 		{
 			tNewIndex.m_iFilterId = i;
 			tNewIndex.m_bForce = pHint && *pHint==INDEX_HINT_FORCE;
 
 			dSecondaryIndexes.Add ( tNewIndex );
+
+			AccessPlan_t::Estimate_t & tEstimate = tPlan.m_dEstimates.Add();
+			tEstimate.m_sAttr = tFilter.m_sAttrName;
+			tEstimate.m_iRsetEstimate = tNewIndex.m_iRsetEstimate;
+			tEstimate.m_bUsed = false;
 		}
 	}
 
 	int nAvailableIndexes = dSecondaryIndexes.GetLength();
 	if ( !nAvailableIndexes )
+	{
+		tPlan.m_fCost = CalcQueryCost ( dFilters, dSecondaryIndexes, tPlan.m_iTotalDocs, tPlan.m_iFulltextDocs );
 		return;
+	}
 
 	CSphBitvec dEnabled ( nAvailableIndexes );
 	CSphBitvec dBestEnabled ( nAvailableIndexes );
@@ -726,7 +783,7 @@ void SelectIterators ( const CSphVector<CSphFilterSettings> & dFilters, const CS
 		for ( int i = 0; i < dEnabled.GetBits(); i++ )
 			dSecondaryIndexes[i].m_bEnabled = dEnabled.BitGet(i);
 
-		float fCost = CalcQueryCost ( dFilters, dSecondaryIndexes, tHistograms.GetNumValues() );
+		float fCost = CalcQueryCost ( dFilters, dSecondaryIndexes, tPlan.m_iTotalDocs, tPlan.m_iFulltextDocs );
 		if ( fCost < fBestCost )
 		{
 			dBestEnabled = dEnabled;
@@ -737,42 +794,68 @@ void SelectIterators ( const CSphVector<CSphFilterSettings> & dFilters, const CS
 			break;
 	}
 
+	tPlan.m_fCost = fBestCost;
+
 	for ( int i = 0; i < dBestEnabled.GetBits(); i++ )
 		if ( dBestEnabled.BitGet(i) )
 		{
 			SecondaryIndexInfo_t & tInfo = dEnabledIndexes.Add();
 			tInfo.m_iFilterId = dSecondaryIndexes[i].m_iFilterId;
+			tPlan.m_dEstimates[i].m_bUsed = true;
 		}
+
+	if ( dEnabledIndexes.GetLength() )
+		tPlan.m_ePath = tPlan.m_iFulltextDocs>=0 ? AccessPath_e::FULLTEXT_LOOKUP : AccessPath_e::LOOKUP;
 }
 
 
 RowidIterator_i * CreateFilteredIterator ( const CSphVector<CSphFilterSettings> & dFilters, CSphVector<CSphFilterSettings> & dModifiedFilters, bool & bFiltersChanged, const CSphVector<FilterTreeItem_t> & dFilterTree,
-	const CSphVector<IndexHint_t> & dHints, const HistogramContainer_c & tHistograms, const BYTE * pDocidLookup )
+	const CSphVector<IndexHint_t> & dHints, const HistogramContainer_c & tHistograms, const BYTE * pDocidLookup, const SecondaryIndex_c * pSecondaryIndex, ESphCollation eCollation, AccessPlan_t & tPlan )
 {
 	bFiltersChanged = false;
 
+	bool bFulltext = tPlan.m_iFulltextDocs>=0;
+	tPlan.m_iTotalDocs = tHistograms.GetNumValues();
+	tPlan.m_ePath = bFulltext ? AccessPath_e::FULLTEXT : AccessPath_e::FULLSCAN;
+
 	// no iterators with OR queries
 	if ( dFilterTree.GetLength() )
 		return nullptr;
 
 	CSphVector<SecondaryIndexInfo_t> dEnabledIndexes;
-	SelectIterators ( dFilters, dHints, dEnabledIndexes, tHistograms );
+	SelectIterators ( dFilters, dHints, dEnabledIndexes, tHistograms, pSecondaryIndex, eCollation, tPlan );
 
 	CSphVector<RowidIterator_i *> dIterators;
+	CSphVector<int> dReplacedFilters;
 	for ( auto & i : dEnabledIndexes )
 	{
-		RowidIterator_i * pIterator = CreateIterator ( dFilters[i.m_iFilterId], pDocidLookup );
-		if ( pIterator )
-			dIterators.Add ( pIterator );
+		const CSphFilterSettings & tFilter = dFilters[i.m_iFilterId];
+		RowidIterator_i * pIterator = CreateIterator ( tFilter, pDocidLookup, pSecondaryIndex );
+		if ( !pIterator )
+		{
+			for ( auto & tEstimate : tPlan.m_dEstimates )
+				if ( tEstimate.m_sAttr==tFilter.m_sAttrName )
+					tEstimate.m_bUsed = false;
+
+			continue;
+		}
+
+		dIterators.Add ( pIterator );
+
+		// string indexes are built over hashes, so such filters still have to be applied
+		if ( HaveIndex ( tFilter.m_sAttrName ) || pSecondaryIndex->IsExact(tFilter) )
+			dReplacedFilters.Add ( i.m_iFilterId );
 	}
 
 	if ( !dIterators.GetLength() )
+	{
+		tPlan.m_ePath = bFulltext ? AccessPath_e::FULLTEXT : AccessPath_e::FULLSCAN;
 		return nullptr;
+	}
 
-	dEnabledIndexes.Sort ( bind ( &SecondaryIndexInfo_t::m_iFilterId ) );
 	ARRAY_FOREACH ( i, dFilters )
 	{
-		if ( !dEnabledIndexes.any_of ( [i] ( const SecondaryIndexInfo_t & tInfo ) { return tInfo.m_iFilterId==i; } ) )
+		if ( !dReplacedFilters.Contains(i) )
 			dModifiedFilters.Add ( dFilters[i] );
 	}
 
@@ -785,6 +868,30 @@ RowidIterator_i * CreateFilteredIterator ( const CSphVector<CSphFilterSettings>
 }
 
 
+static const char * AccessPathName ( AccessPath_e ePath )
+{
+	switch ( ePath )
+	{
+	case AccessPath_e::FULLSCAN:		return "fullscan";
+	case AccessPath_e::LOOKUP:			return "lookup";
+	case AccessPath_e::FULLTEXT:		return "fulltext";
+	case AccessPath_e::FULLTEXT_LOOKUP:	return "fulltext+lookup";
+	default:							return "unknown";
+	}
+}
+
+
+void AccessPlan_t::Format ( StringBuilder_c & sOut ) const
+{
+	sOut.Appendf ( "path=%s, cost=%.6f, total_docs=" INT64_FMT, AccessPathName ( m_ePath ), m_fCost, m_iTotalDocs );
+	if ( m_iFulltextDocs>=0 )
+		sOut.Appendf ( ", fulltext_docs=" INT64_FMT, m_iFulltextDocs );
+
+	for ( const auto & tEstimate : m_dEstimates )
+		sOut.Appendf ( ", %s=" INT64_FMT "%s", tEstimate.m_sAttr.cstr(), tEstimate.m_iRsetEstimate, tEstimate.m_bUsed ? " (index)" : " (filter)" );
+}
+
+
 RowidIterator_i * CreateIteratorIntersect ( CSphVector<RowidIterator_i*> & dIterators )
 {
 	return new RowidIterator_Intersect_T<RowidIterator_i> ( dIterators.Begin(), dIterators.GetLength() );
@@ -813,7 +920,8 @@ DocidLookupWriter_c::DocidLookupWriter_c ( DWORD nDocs )
 
 DocidLookupWriter_c::~DocidLookupWriter_c()
 {
-	SafeDelete ( m_pWriter );
+	if ( m_bOwnWriter )
+		SafeDelete ( m_pWriter );
 }
 
 
@@ -825,6 +933,22 @@ bool DocidLookupWriter_c::Open ( const CSphString & sFilename, CSphString & sErr
 	if ( !m_pWriter->OpenFile ( sFilename, sError ) )
 		return false;
 
+	Open ( *m_pWriter );
+	m_bOwnWriter = true;
+	return true;
+}
+
+
+void DocidLookupWriter_c::Open ( CSphWriter & tWriter )
+{
+	if ( m_pWriter!=&tWriter )
+	{
+		assert ( !m_pWriter );
+		m_pWriter = &tWriter;
+		m_bOwnWriter = false;
+	}
+
+	m_tBlockStart = m_pWriter->GetPos();
 	m_pWriter->PutDword ( m_nDocs );
 	m_pWriter->PutDword ( DOCS_PER_LOOKUP_CHECKPOINT );
 
@@ -839,19 +963,17 @@ bool DocidLookupWriter_c::Open ( const CSphString & sFilename, CSphString & sErr
 		m_pWriter->PutOffset(0);
 		m_pWriter->PutOffset(0);
 	}
-
-	return true;
 }
 
 
 void DocidLookupWriter_c::AddPair ( const DocidRowidPair_t & tPair )
 {
-	assert ( tPair.m_tDocID>=m_tLastDocID );
+	assert ( !m_iProcessed || tPair.m_tDocID>=m_tLastDocID );
 
 	if ( !(m_iProcessed % DOCS_PER_LOOKUP_CHECKPOINT) )
 	{
 		m_dCheckpoints[m_iCheckpoint].m_tBaseDocID = tPair.m_tDocID;
-		m_dCheckpoints[m_iCheckpoint].m_tOffset = m_pWriter->GetPos();
+		m_dCheckpoints[m_iCheckpoint].m_tOffset = m_pWriter->GetPos()-m_tBlockStart;
 		m_iCheckpoint++;
 
 		// no need to store docid for 1st entry
@@ -870,6 +992,7 @@ void DocidLookupWriter_c::AddPair ( const DocidRowidPair_t & tPair )
 
 bool DocidLookupWriter_c::Finalize ( CSphString & sError )
 {
+	SphOffset_t tEnd = m_pWriter->GetPos();
 	m_pWriter->Flush();
 	m_pWriter->SeekTo ( m_tCheckpointStart );
 	m_pWriter->PutOffset ( m_tLastDocID );
@@ -879,6 +1002,13 @@ bool DocidLookupWriter_c::Finalize ( CSphString & sError )
 		m_pWriter->PutOffset ( i.m_tOffset );
 	}
 
+	// somebody else's file; get back to its end
+	if ( !m_bOwnWriter )
+	{
+		m_pWriter->SeekTo ( tEnd );
+		return true;
+	}
+
 	m_pWriter->CloseFile();
 	if ( m_pWriter->IsError() )
 	{
@@ -952,3 +1082,825 @@ void LookupReaderIterator_c::SetData ( const BYTE * pData )
 	LookupReader_c::SetData(pData);
 	SetCheckpoint ( m_pCheckpoints );
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+static const DWORD SPIDX_VERSION = 1;
+
+bool IsSecondaryIndexAttr ( const CSphColumnInfo & tAttr )
+{
+	if ( !( tAttr.m_uAttrFlags & CSphColumnInfo::ATTR_SECONDARY_INDEX ) || tAttr.IsColumnar() || tAttr.m_sName==sphGetDocidName() )
+		return false;
+
+	switch ( tAttr.m_eAttrType )
+	{
+	case SPH_ATTR_INTEGER:
+	case SPH_ATTR_TIMESTAMP:
+	case SPH_ATTR_BOOL:
+	case SPH_ATTR_BIGINT:
+	case SPH_ATTR_FLOAT:
+	case SPH_ATTR_STRING:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/// maps floats to non-negative integers that sort in the same order
+static SphAttr_t FloatKey ( float fValue )
+{
+	if ( fValue==0.0f )
+		fValue = 0.0f; // -0.0 and 0.0 are the same value
+
+	DWORD uBits = sphF2DW(fValue);
+	uBits = ( uBits & 0x80000000 ) ? ~uBits : ( uBits | 0x80000000 );
+	return (SphAttr_t)uBits;
+}
+
+/// strings are indexed by their hashes (default collation)
+static SphAttr_t StringKey ( const BYTE * pStr, int iLen )
+{
+	return (SphAttr_t)( LibcCIHash_fn::Hash ( pStr, iLen ) & U64C(0x7FFFFFFFFFFFFFFF) );
+}
+
+
+SecondaryIndexBuilder_c::SecondaryIndexBuilder_c ( const CSphSchema & tSchema )
+{
+	for ( int i = 0; i < tSchema.GetAttrsCount(); i++ )
+	{
+		const CSphColumnInfo & tAttr = tSchema.GetAttr(i);
+		if ( !IsSecondaryIndexAttr(tAttr) )
+			continue;
+
+		Attr_t & tNew = m_dAttrs.Add();
+		tNew.m_sName = tAttr.m_sName;
+		tNew.m_eType = tAttr.m_eAttrType;
+		tNew.m_tLocator = tAttr.m_tLocator;
+	}
+}
+
+
+void SecondaryIndexBuilder_c::Collect ( RowID_t tRowID, const CSphRowitem * pRow, const BYTE * pBlobPool )
+{
+	for ( auto & tAttr : m_dAttrs )
+	{
+		DocidRowidPair_t & tPair = tAttr.m_dPairs.Add();
+		tPair.m_tRowID = tRowID;
+
+		switch ( tAttr.m_eType )
+		{
+		case SPH_ATTR_FLOAT:
+			tPair.m_tDocID = FloatKey ( sphDW2F ( (DWORD)sphGetRowAttr ( pRow, tAttr.m_tLocator ) ) );
+			break;
+
+		case SPH_ATTR_STRING:
+			{
+				int iLen = 0;
+				const BYTE * pStr = sphGetBlobAttr ( pRow, tAttr.m_tLocator, pBlobPool, iLen );
+				tPair.m_tDocID = StringKey ( pStr, iLen );
+			}
+			break;
+
+		default:
+			tPair.m_tDocID = sphGetRowAttr ( pRow, tAttr.m_tLocator );
+			break;
+		}
+	}
+}
+
+
+static bool CmpValueRowid ( const DocidRowidPair_t & a, const DocidRowidPair_t & b )
+{
+	if ( a.m_tDocID==b.m_tDocID )
+		return a.m_tRowID < b.m_tRowID;
+
+	return a.m_tDocID < b.m_tDocID;
+}
+
+
+bool SecondaryIndexBuilder_c::Save ( const CSphString & sFilename, CSphString & sError )
+{
+	CSphWriter tWriter;
+	if ( !tWriter.OpenFile ( sFilename, sError ) )
+		return false;
+
+	tWriter.PutDword ( SPIDX_VERSION );
+	tWriter.PutDword ( m_dAttrs.GetLength() );
+
+	CSphVector<SphOffset_t> dDataOffsets;
+	for ( const auto & tAttr : m_dAttrs )
+	{
+		tWriter.PutString ( tAttr.m_sName );
+		tWriter.PutDword ( tAttr.m_eType );
+		tWriter.PutByte ( 1 ); // index is valid; cleared by updates
+		dDataOffsets.Add ( tWriter.GetPos() );
+		tWriter.PutOffset ( 0 );
+	}
+
+	ARRAY_FOREACH ( i, m_dAttrs )
+	{
+		CSphVector<DocidRowidPair_t> & dPairs = m_dAttrs[i].m_dPairs;
+		dPairs.Sort ( Lesser ( CmpValueRowid ) );
+
+		// lookup blocks are accessed directly from the mapped file
+		while ( tWriter.GetPos() % sizeof(SphOffset_t) )
+			tWriter.PutByte(0);
+
+		SeekAndPutOffset ( tWriter, dDataOffsets[i], tWriter.GetPos() );
+
+		DocidLookupWriter_c tLookupWriter ( dPairs.GetLength() );
+		tLookupWriter.Open ( tWriter );
+		for ( const auto & tPair : dPairs )
+			tLookupWriter.AddPair ( tPair );
+
+		if ( !tLookupWriter.Finalize ( sError ) )
+			return false;
+
+		dPairs.Reset();
+	}
+
+	tWriter.CloseFile();
+	if ( tWriter.IsError() )
+	{
+		sError.SetSprintf ( "error writing %s", sFilename.cstr() );
+		return false;
+	}
+
+	return true;
+}
+
+
+bool WriteSecondaryIndexes ( const CSphString & sSPA, const CSphString & sSPB, const CSphString & sSPIDX, const CSphSchema & tSchema, DWORD uTotalDocs, CSphString & sError )
+{
+	SecondaryIndexBuilder_c tBuilder ( tSchema );
+	if ( tBuilder.IsEmpty() || !uTotalDocs )
+		return true;
+
+	CSphAutofile tSPA ( sSPA.cstr(), SPH_O_READ, sError );
+	if ( tSPA.GetFD()==-1 )
+		return false;
+
+	CSphReader tSPAReader;
+	tSPAReader.SetFile(tSPA);
+
+	CSphMappedBuffer<BYTE> tBlobs;
+	if ( tSchema.HasBlobAttrs() && !tBlobs.Setup ( sSPB, sError, false ) )
+		return false;
+
+	int iStride = tSchema.GetRowSize();
+	CSphVector<CSphRowitem> dRow ( iStride );
+	CSphRowitem * pRow = dRow.Begin();
+
+	for ( RowID_t tRowID = 0; tRowID < uTotalDocs; tRowID++ )
+	{
+		tSPAReader.GetBytes ( pRow, iStride*sizeof(CSphRowitem) );
+		if ( tSPAReader.GetErrorFlag() )
+		{
+			sError = tSPAReader.GetErrorMessage();
+			return false;
+		}
+
+		tBuilder.Collect ( tRowID, pRow, tBlobs.GetWritePtr() );
+	}
+
+	return tBuilder.Save ( sSPIDX, sError );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// reads value-rowid pairs of a single attribute lookup block, in value order
+class AttrLookupReader_c : public LookupReader_c
+{
+public:
+	struct Cursor_t
+	{
+		int				m_iCheckpoint {0};
+		int				m_iDoc {0};
+		int				m_iDocs {0};
+		const BYTE *	m_pCur {nullptr};
+		SphAttr_t		m_tValue {0};				///< value of the current pair
+		RowID_t			m_tRowID {INVALID_ROWID};	///< rowid of the current pair
+	};
+
+	explicit	AttrLookupReader_c ( const BYTE * pData ) : LookupReader_c ( pData ) {}
+
+	bool		Seek ( SphAttr_t tValue, Cursor_t & tCursor ) const;	///< move to the first pair with value not less than tValue
+	bool		Next ( Cursor_t & tCursor ) const;
+	template<typename FN>
+	int64_t		ForEachInRange ( SphAttr_t tMin, SphAttr_t tMax, FN && fnRow ) const;	///< calls fnRow for rowids of all the values in range
+	int64_t		EstimateRange ( SphAttr_t tMin, SphAttr_t tMax ) const;
+
+private:
+	int			FindFirstCheckpoint ( SphAttr_t tValue ) const;
+	int			FindLastCheckpoint ( SphAttr_t tValue ) const;
+	void		SetCheckpoint ( int iCheckpoint, Cursor_t & tCursor ) const;
+};
+
+
+int AttrLookupReader_c::FindFirstCheckpoint ( SphAttr_t tValue ) const
+{
+	int iLeft = 0;
+	int iRight = m_nCheckpoints;
+	while ( iLeft<iRight )
+	{
+		int iMid = iLeft + ( iRight-iLeft )/2;
+		if ( m_pCheckpoints[iMid].m_tBaseDocID<tValue )
+			iLeft = iMid+1;
+		else
+			iRight = iMid;
+	}
+
+	// unlike docids, values are not unique; same value might start at the end of previous checkpoint
+	return Max ( iLeft-1, 0 );
+}
+
+
+int AttrLookupReader_c::FindLastCheckpoint ( SphAttr_t tValue ) const
+{
+	int iLeft = 0;
+	int iRight = m_nCheckpoints;
+	while ( iLeft<iRight )
+	{
+		int iMid = iLeft + ( iRight-iLeft )/2;
+		if ( m_pCheckpoints[iMid].m_tBaseDocID<=tValue )
+			iLeft = iMid+1;
+		else
+			iRight = iMid;
+	}
+
+	return iLeft-1;
+}
+
+
+void AttrLookupReader_c::SetCheckpoint ( int iCheckpoint, Cursor_t & tCursor ) const
+{
+	const DocidLookupCheckpoint_t * pCheckpoint = m_pCheckpoints + iCheckpoint;
+	tCursor.m_iCheckpoint = iCheckpoint;
+	tCursor.m_iDoc = 0;
+	tCursor.m_iDocs = GetNumDocsInCheckpoint(pCheckpoint);
+	tCursor.m_pCur = m_pData + pCheckpoint->m_tOffset;
+	tCursor.m_tValue = pCheckpoint->m_tBaseDocID;
+}
+
+
+bool AttrLookupReader_c::Next ( Cursor_t & tCursor ) const
+{
+	if ( tCursor.m_iDoc==tCursor.m_iDocs )
+	{
+		if ( tCursor.m_iCheckpoint+1>=m_nCheckpoints )
+		{
+			tCursor.m_tRowID = INVALID_ROWID;
+			return false;
+		}
+
+		SetCheckpoint ( tCursor.m_iCheckpoint+1, tCursor );
+	}
+
+	// 1st entry doesnt have a value
+	if ( tCursor.m_iDoc )
+		tCursor.m_tValue += sphUnzipOffset ( tCursor.m_pCur );
+
+	tCursor.m_tRowID = sphUnalignedRead ( *(RowID_t*)tCursor.m_pCur );
+	tCursor.m_pCur += sizeof(RowID_t);
+	tCursor.m_iDoc++;
+	return true;
+}
+
+
+bool AttrLookupReader_c::Seek ( SphAttr_t tValue, Cursor_t & tCursor ) const
+{
+	tCursor.m_tRowID = INVALID_ROWID;
+	if ( !m_nCheckpoints || tValue>m_tMaxDocID )
+		return false;
+
+	SetCheckpoint ( FindFirstCheckpoint(tValue), tCursor );
+	do
+	{
+		if ( !Next(tCursor) )
+			return false;
+	}
+	while ( tCursor.m_tValue<tValue );
+
+	return true;
+}
+
+
+template<typename FN>
+int64_t AttrLookupReader_c::ForEachInRange ( SphAttr_t tMin, SphAttr_t tMax, FN && fnRow ) const
+{
+	if ( tMin>tMax )
+		return 0;
+
+	int64_t iProcessed = 0;
+	Cursor_t tCursor;
+	bool bHaveRows = Seek ( tMin, tCursor );
+	while ( bHaveRows && tCursor.m_tValue<=tMax )
+	{
+		fnRow ( tCursor.m_tRowID );
+		iProcessed++;
+		bHaveRows = Next(tCursor);
+	}
+
+	return iProcessed;
+}
+
+
+int64_t AttrLookupReader_c::EstimateRange ( SphAttr_t tMin, SphAttr_t tMax ) const
+{
+	if ( !m_nCheckpoints || tMin>tMax || tMin>m_tMaxDocID || tMax<m_pCheckpoints->m_tBaseDocID )
+		return 0;
+
+	int nCheckpoints = FindLastCheckpoint(tMax) - FindFirstCheckpoint(tMin) + 1;
+	return Min ( (int64_t)nCheckpoints*m_nDocsPerCheckpoint, (int64_t)m_nDocs );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// rows of exact values (IN lists, string hashes)
+/// rowids are sorted within a value, so the rows of every value are read lazily and merged by rowid
+class RowidIterator_SecondaryIndexValues_c : public SecondaryIndexIterator_c
+{
+public:
+			RowidIterator_SecondaryIndexValues_c ( const BYTE * pData, CSphVector<SphAttr_t> & dValues );
+
+	bool	HintRowID ( RowID_t tRowID ) override;
+	bool	GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock ) override;
+	int64_t	GetNumProcessed() const override { return m_iProcessed; }
+
+private:
+	struct Stream_t
+	{
+		SphAttr_t						m_tValue {0};
+		AttrLookupReader_c::Cursor_t	m_tCursor;
+	};
+
+	AttrLookupReader_c		m_tReader;
+	CSphVector<Stream_t>	m_dStreams;		///< heap; stream with the lowest rowid goes first
+	int64_t					m_iProcessed {0};
+
+	static bool				HeapLess ( const Stream_t & a, const Stream_t & b ) { return a.m_tCursor.m_tRowID>b.m_tCursor.m_tRowID; }
+	bool					Advance ( Stream_t & tStream );
+};
+
+
+RowidIterator_SecondaryIndexValues_c::RowidIterator_SecondaryIndexValues_c ( const BYTE * pData, CSphVector<SphAttr_t> & dValues )
+	: m_tReader ( pData )
+{
+	// every row has a single value, so different values never yield the same rowid
+	dValues.Uniq();
+	for ( auto tValue : dValues )
+	{
+		Stream_t tStream;
+		tStream.m_tValue = tValue;
+		if ( m_tReader.Seek ( tValue, tStream.m_tCursor ) && tStream.m_tCursor.m_tValue==tValue )
+		{
+			m_dStreams.Add ( tStream );
+			m_iProcessed++;
+		}
+	}
+
+	std::make_heap ( m_dStreams.Begin(), m_dStreams.Begin()+m_dStreams.GetLength(), HeapLess );
+}
+
+
+bool RowidIterator_SecondaryIndexValues_c::Advance ( Stream_t & tStream )
+{
+	if ( !m_tReader.Next ( tStream.m_tCursor ) || tStream.m_tCursor.m_tValue!=tStream.m_tValue )
+		return false;
+
+	m_iProcessed++;
+	return true;
+}
+
+
+bool RowidIterator_SecondaryIndexValues_c::HintRowID ( RowID_t tRowID )
+{
+	ARRAY_FOREACH ( i, m_dStreams )
+	{
+		bool bHaveRows = true;
+		while ( bHaveRows && m_dStreams[i].m_tCursor.m_tRowID<tRowID )
+			bHaveRows = Advance ( m_dStreams[i] );
+
+		if ( !bHaveRows )
+			m_dStreams.RemoveFast ( i-- );
+	}
+
+	std::make_heap ( m_dStreams.Begin(), m_dStreams.Begin()+m_dStreams.GetLength(), HeapLess );
+	return !m_dStreams.IsEmpty();
+}
+
+
+bool RowidIterator_SecondaryIndexValues_c::GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock )
+{
+	RowID_t * pRowIdStart = m_dCollected.Begin();
+	RowID_t * pRowIdMax = pRowIdStart + m_dCollected.GetLength();
+	RowID_t * pRowID = pRowIdStart;
+
+	while ( !m_dStreams.IsEmpty() && pRowID<pRowIdMax )
+	{
+		Stream_t * pHeap = m_dStreams.Begin();
+		std::pop_heap ( pHeap, pHeap+m_dStreams.GetLength(), HeapLess );
+
+		Stream_t & tStream = m_dStreams.Last();
+		*pRowID++ = tStream.m_tCursor.m_tRowID;
+		if ( Advance ( tStream ) )
+			std::push_heap ( pHeap, pHeap+m_dStreams.GetLength(), HeapLess );
+		else
+			m_dStreams.Pop();
+	}
+
+	return ReturnIteratorResult ( pRowID, pRowIdStart, dRowIdBlock );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+/// rows of value ranges
+/// rowids come in value order, so matching rows are either collected and sorted, or marked in a bitmap (a bit per row)
+/// and read back in rowid order; bitmap is only used for dense ranges, where it takes less RAM than the rowids
+class RowidIterator_SecondaryIndexRanges_c : public SecondaryIndexIterator_c
+{
+public:
+			RowidIterator_SecondaryIndexRanges_c ( const BYTE * pData, const CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges );
+
+	bool	HintRowID ( RowID_t tRowID ) override;
+	bool	GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock ) override;
+	int64_t	GetNumProcessed() const override { return m_iProcessed; }
+
+private:
+	CSphVector<RowID_t>	m_dRowIDs;			///< sorted rows of a sparse range
+	int					m_iRowID {0};		///< next one of m_dRowIDs to return
+	bool				m_bBitmap {false};
+	CSphBitvec			m_dRows;			///< rows of a dense range
+	RowID_t				m_tRowID {0};		///< next row of m_dRows to check
+	int64_t				m_iProcessed {0};
+
+	bool				GetNextCollected ( RowIdBlock_t & dRowIdBlock );
+};
+
+
+RowidIterator_SecondaryIndexRanges_c::RowidIterator_SecondaryIndexRanges_c ( const BYTE * pData, const CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges )
+{
+	AttrLookupReader_c tReader ( pData );
+	auto uRows = *(const DWORD*)pData;
+
+	int64_t iEstimate = 0;
+	for ( const auto & tRange : dRanges )
+		iEstimate += tReader.EstimateRange ( tRange.first, tRange.second );
+
+	// a bit per row vs 32 bits per matching row
+	if ( iEstimate*32<(int64_t)uRows )
+	{
+		m_dRowIDs.Reserve ( iEstimate );
+		for ( const auto & tRange : dRanges )
+			m_iProcessed += tReader.ForEachInRange ( tRange.first, tRange.second, [this] ( RowID_t tRowID ) { m_dRowIDs.Add ( tRowID ); } );
+
+		m_dRowIDs.Sort();
+		return;
+	}
+
+	m_bBitmap = true;
+	m_dRows.Init ( uRows );
+	for ( const auto & tRange : dRanges )
+		m_iProcessed += tReader.ForEachInRange ( tRange.first, tRange.second, [this] ( RowID_t tRowID ) { m_dRows.BitSet ( tRowID ); } );
+}
+
+
+bool RowidIterator_SecondaryIndexRanges_c::HintRowID ( RowID_t tRowID )
+{
+	if ( !m_bBitmap )
+	{
+		const RowID_t * pStart = m_dRowIDs.Begin() + m_iRowID;
+		const RowID_t * pEnd = m_dRowIDs.Begin() + m_dRowIDs.GetLength();
+		m_iRowID = int ( std::lower_bound ( pStart, pEnd, tRowID ) - m_dRowIDs.Begin() );
+		return m_iRowID<m_dRowIDs.GetLength();
+	}
+
+	m_tRowID = Max ( m_tRowID, tRowID );
+	return m_tRowID<(RowID_t)m_dRows.GetBits();
+}
+
+
+bool RowidIterator_SecondaryIndexRanges_c::GetNextCollected ( RowIdBlock_t & dRowIdBlock )
+{
+	RowID_t * pRowIdStart = m_dCollected.Begin();
+	int iRows = Min ( m_dCollected.GetLength(), m_dRowIDs.GetLength()-m_iRowID );
+	memcpy ( pRowIdStart, m_dRowIDs.Begin()+m_iRowID, iRows*sizeof(RowID_t) );
+	m_iRowID += iRows;
+
+	return ReturnIteratorResult ( pRowIdStart+iRows, pRowIdStart, dRowIdBlock );
+}
+
+
+bool RowidIterator_SecondaryIndexRanges_c::GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock )
+{
+	if ( !m_bBitmap )
+		return GetNextCollected ( dRowIdBlock );
+
+	RowID_t * pRowIdStart = m_dCollected.Begin();
+	RowID_t * pRowIdMax = pRowIdStart + m_dCollected.GetLength();
+	RowID_t * pRowID = pRowIdStart;
+
+	const DWORD * pBits = m_dRows.Begin();
+	auto tRows = (RowID_t)m_dRows.GetBits();
+	while ( m_tRowID<tRows && pRowID<pRowIdMax )
+	{
+		// skip empty words at once
+		DWORD uBits = pBits [ m_tRowID>>5 ] >> ( m_tRowID & 31 );
+		if ( !uBits )
+		{
+			m_tRowID = ( ( m_tRowID>>5 ) + 1 )<<5;
+			continue;
+		}
+
+		if ( uBits & 1 )
+			*pRowID++ = m_tRowID;
+
+		m_tRowID++;
+	}
+
+	return ReturnIteratorResult ( pRowID, pRowIdStart, dRowIdBlock );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool SecondaryIndex_c::Setup ( const CSphString & sFilename, const CSphSchema & tSchema, DWORD uRows, CSphString & sError )
+{
+	Reset();
+
+	if ( !m_tBuf.Setup ( sFilename, sError, true ) )
+		return false;
+
+	const BYTE * pStart = m_tBuf.GetWritePtr();
+	const BYTE * pEnd = pStart + m_tBuf.GetLengthBytes();
+	const BYTE * p = pStart;
+
+	auto fnFail = [&] ( const char * szReason )
+	{
+		sError.SetSprintf ( "%s: %s", sFilename.cstr(), szReason );
+		Reset();
+		return false;
+	};
+
+	if ( p+2*sizeof(DWORD)>pEnd )
+		return fnFail ( "file is too short" );
+
+	DWORD uVersion = sphUnalignedRead ( *(DWORD*)p );
+	p += sizeof(DWORD);
+	if ( uVersion!=SPIDX_VERSION )
+		return fnFail ( "unsupported version" );
+
+	DWORD nAttrs = sphUnalignedRead ( *(DWORD*)p );
+	p += sizeof(DWORD);
+
+	for ( DWORD i = 0; i < nAttrs; i++ )
+	{
+		if ( p+sizeof(DWORD)>pEnd )
+			return fnFail ( "broken header" );
+
+		int iLen = (int)sphUnalignedRead ( *(DWORD*)p );
+		p += sizeof(DWORD);
+		if ( iLen<0 || p+iLen+sizeof(DWORD)+1+sizeof(SphOffset_t)>pEnd )
+			return fnFail ( "broken header" );
+
+		Attr_t & tAttr = m_dAttrs.Add();
+		tAttr.m_sName.SetBinary ( (const char*)p, iLen );
+		p += iLen;
+		tAttr.m_eType = (ESphAttr)sphUnalignedRead ( *(DWORD*)p );
+		p += sizeof(DWORD);
+		tAttr.m_pValid = m_tBuf.GetWritePtr() + ( p-pStart );
+		p++;
+		SphOffset_t tOffset = sphUnalignedRead ( *(SphOffset_t*)p );
+		p += sizeof(SphOffset_t);
+
+		if ( tOffset<=0 || tOffset+(SphOffset_t)( 2*sizeof(DWORD)+sizeof(DocID_t) )>(SphOffset_t)m_tBuf.GetLengthBytes() )
+			return fnFail ( "broken data offset" );
+
+		tAttr.m_pData = pStart + tOffset;
+		if ( *(const DWORD*)tAttr.m_pData!=uRows )
+			return fnFail ( "row count mismatch" );
+
+		// schema could be altered since the index was built
+		const CSphColumnInfo * pSchemaAttr = tSchema.GetAttr ( tAttr.m_sName.cstr() );
+		if ( !pSchemaAttr || pSchemaAttr->m_eAttrType!=tAttr.m_eType || !IsSecondaryIndexAttr(*pSchemaAttr) )
+			*tAttr.m_pValid = 0;
+	}
+
+	return true;
+}
+
+
+void SecondaryIndex_c::Reset()
+{
+	m_tBuf.Reset();
+	m_dAttrs.Reset();
+}
+
+
+bool SecondaryIndex_c::Flush ( CSphString & sError ) const
+{
+	if ( !m_tBuf.GetWritePtr() )
+		return true;
+
+	return m_tBuf.Flush ( true, sError );
+}
+
+
+const SecondaryIndex_c::Attr_t * SecondaryIndex_c::GetAttr ( const CSphString & sAttr ) const
+{
+	for ( const auto & tAttr : m_dAttrs )
+		if ( tAttr.m_sName==sAttr )
+			return &tAttr;
+
+	return nullptr;
+}
+
+
+bool SecondaryIndex_c::IsEnabled ( const CSphFilterSettings & tFilter, ESphCollation eCollation ) const
+{
+	const Attr_t * pAttr = GetAttr ( tFilter.m_sAttrName );
+	if ( !pAttr || !*pAttr->m_pValid )
+		return false;
+
+	switch ( pAttr->m_eType )
+	{
+	case SPH_ATTR_FLOAT:
+		return tFilter.m_eType==SPH_FILTER_FLOATRANGE;
+
+	case SPH_ATTR_STRING:
+		// hashes are only good for equality with default collation
+		if ( eCollation!=SPH_COLLATION_DEFAULT || tFilter.m_bExclude )
+			return false;
+
+		if ( tFilter.m_eType==SPH_FILTER_STRING )
+			return tFilter.m_dStrings.GetLength()==1 && ( tFilter.m_bHasEqualMin || tFilter.m_bHasEqualMax );
+
+		return tFilter.m_eType==SPH_FILTER_STRING_LIST && tFilter.m_eMvaFunc==SPH_MVAFUNC_NONE;
+
+	default:
+		return tFilter.m_eType==SPH_FILTER_RANGE || ( tFilter.m_eType==SPH_FILTER_VALUES && !tFilter.m_bExclude );
+	}
+}
+
+
+bool SecondaryIndex_c::IsExact ( const CSphFilterSettings & tFilter ) const
+{
+	const Attr_t * pAttr = GetAttr ( tFilter.m_sAttrName );
+	return pAttr && pAttr->m_eType!=SPH_ATTR_STRING;
+}
+
+
+void SecondaryIndex_c::GetKeyRanges ( const Attr_t & tAttr, const CSphFilterSettings & tFilter, CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges ) const
+{
+	switch ( tFilter.m_eType )
+	{
+	case SPH_FILTER_VALUES:
+		for ( int i = 0; i < tFilter.GetNumValues(); i++ )
+			dRanges.Add ( { tFilter.GetValue(i), tFilter.GetValue(i) } );
+		return;
+
+	case SPH_FILTER_STRING:
+	case SPH_FILTER_STRING_LIST:
+		for ( const auto & sValue : tFilter.m_dStrings )
+		{
+			SphAttr_t tKey = StringKey ( (const BYTE*)sValue.cstr(), sValue.Length() );
+			dRanges.Add ( { tKey, tKey } );
+		}
+		return;
+
+	case SPH_FILTER_FLOATRANGE:
+		GetFloatKeyRanges ( tFilter, dRanges );
+		return;
+
+	default:
+		break;
+	}
+
+	SphAttr_t tLowest = INT64_MIN;
+	SphAttr_t tHighest = INT64_MAX;
+	SphAttr_t tMin = tFilter.m_iMinValue;
+	SphAttr_t tMax = tFilter.m_iMaxValue;
+
+	if ( tFilter.m_bOpenLeft )
+		tMin = tLowest;
+	else if ( !tFilter.m_bHasEqualMin )
+	{
+		if ( tMin==tHighest )
+			return;
+		tMin++;
+	}
+
+	if ( tFilter.m_bOpenRight )
+		tMax = tHighest;
+	else if ( !tFilter.m_bHasEqualMax )
+	{
+		if ( tMax==tLowest )
+			return;
+		tMax--;
+	}
+
+	AddKeyRanges ( tMin, tMax, tLowest, tHighest, tFilter.m_bExclude, dRanges );
+}
+
+
+void SecondaryIndex_c::GetFloatKeyRanges ( const CSphFilterSettings & tFilter, CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges )
+{
+	// same as float range filter: bounds are always set, NaN never falls in the range, so excluded ranges do have NaNs
+	// keys of all floats including NaNs are 32-bit, and NaNs go past the infinities
+	const SphAttr_t tLowest = 0;
+	const SphAttr_t tHighest = UINT_MAX;
+
+	if ( std::isnan ( tFilter.m_fMinValue ) || std::isnan ( tFilter.m_fMaxValue ) )
+	{
+		if ( tFilter.m_bExclude )
+			dRanges.Add ( { tLowest, tHighest } );
+		return;
+	}
+
+	SphAttr_t tMin = FloatKey ( tFilter.m_fMinValue );
+	SphAttr_t tMax = FloatKey ( tFilter.m_fMaxValue );
+	if ( !tFilter.m_bHasEqualMin )
+		tMin++;
+
+	if ( !tFilter.m_bHasEqualMax )
+		tMax--;
+
+	// stepping over an infinity lands on NaNs
+	tMin = Max ( tMin, FloatKey ( -INFINITY ) );
+	tMax = Min ( tMax, FloatKey ( INFINITY ) );
+
+	AddKeyRanges ( tMin, tMax, tLowest, tHighest, tFilter.m_bExclude, dRanges );
+}
+
+
+void SecondaryIndex_c::AddKeyRanges ( SphAttr_t tMin, SphAttr_t tMax, SphAttr_t tLowest, SphAttr_t tHighest, bool bExclude, CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges )
+{
+	if ( !bExclude )
+	{
+		if ( tMin<=tMax )
+			dRanges.Add ( { tMin, tMax } );
+		return;
+	}
+
+	if ( tMin>tMax )
+	{
+		dRanges.Add ( { tLowest, tHighest } );
+		return;
+	}
+
+	if ( tMin>tLowest )
+		dRanges.Add ( { tLowest, tMin-1 } );
+
+	if ( tMax<tHighest )
+		dRanges.Add ( { tMax+1, tHighest } );
+}
+
+
+bool SecondaryIndex_c::EstimateRsetSize ( const CSphFilterSettings & tFilter, int64_t & iEstimate ) const
+{
+	const Attr_t * pAttr = GetAttr ( tFilter.m_sAttrName );
+	if ( !pAttr )
+		return false;
+
+	CSphVector<std::pair<SphAttr_t,SphAttr_t>> dRanges;
+	GetKeyRanges ( *pAttr, tFilter, dRanges );
+
+	AttrLookupReader_c tReader ( pAttr->m_pData );
+	int64_t iTotal = *(const DWORD*)pAttr->m_pData;
+	iEstimate = 0;
+	for ( const auto & tRange : dRanges )
+		iEstimate += tReader.EstimateRange ( tRange.first, tRange.second );
+
+	iEstimate = Min ( iEstimate, iTotal );
+	return true;
+}
+
+
+RowidIterator_i * SecondaryIndex_c::CreateIterator ( const CSphFilterSettings & tFilter ) const
+{
+	const Attr_t * pAttr = GetAttr ( tFilter.m_sAttrName );
+	if ( !pAttr || !*pAttr->m_pValid )
+		return nullptr;
+
+	CSphVector<std::pair<SphAttr_t,SphAttr_t>> dRanges;
+	GetKeyRanges ( *pAttr, tFilter, dRanges );
+
+	// exact values are streamed; ranges might span lots of values, so their rows are collected first
+	CSphVector<SphAttr_t> dValues;
+	for ( const auto & tRange : dRanges )
+		if ( tRange.first==tRange.second )
+			dValues.Add ( tRange.first );
+
+	if ( dValues.GetLength()==dRanges.GetLength() )
+		return new RowidIterator_SecondaryIndexValues_c ( pAttr->m_pData, dValues );
+
+	return new RowidIterator_SecondaryIndexRanges_c ( pAttr->m_pData, dRanges );
+}
+
+
+void SecondaryIndex_c::Invalidate ( const CSphString & sAttr )
+{
+	for ( auto & tAttr : m_dAttrs )
+		if ( tAttr.m_sName==sAttr )
+			*tAttr.m_pValid = 0;
+}
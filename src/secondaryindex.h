@@ -26,6 +26,7 @@ public:
 	virtual bool	HintRowID ( RowID_t tRowID ) = 0;
 	virtual bool	GetNextRowIdBlock ( RowIdBlock_t & dRowIdBlock ) = 0;
 	virtual int64_t	GetNumProcessed() const = 0;
+	virtual bool	IsSorted() const { return true; }	///< whether rowids come in ascending order (docid lookups return them in docid order)
 };
 
 struct SecondaryIndexInfo_t
@@ -33,8 +34,38 @@ struct SecondaryIndexInfo_t
 	int		m_iFilterId {-1};
 };
 
+class SecondaryIndex_c;
+
+/// how the rows of a query get fetched
+enum class AccessPath_e
+{
+	FULLSCAN,			///< scan all rows, apply filters to every row
+	LOOKUP,				///< iterate rows from docid lookup and/or secondary indexes, apply remaining filters
+	FULLTEXT,			///< evaluate full-text tree, apply filters to every match
+	FULLTEXT_LOOKUP		///< evaluate full-text tree skipping to the rows from docid lookup and/or secondary indexes
+};
+
+/// access path chosen by the planner, along with the estimates it was based on
+struct AccessPlan_t
+{
+	struct Estimate_t
+	{
+		CSphString	m_sAttr;
+		int64_t		m_iRsetEstimate {0};
+		bool		m_bUsed {false};
+	};
+
+	AccessPath_e			m_ePath {AccessPath_e::FULLSCAN};
+	int64_t					m_iTotalDocs {0};
+	int64_t					m_iFulltextDocs {-1};	///< estimated full-text matches; set by the caller, -1 means no full-text part
+	float					m_fCost {0.0f};
+	CSphVector<Estimate_t>	m_dEstimates;
+
+	void		Format ( StringBuilder_c & sOut ) const;
+};
+
 RowidIterator_i * CreateFilteredIterator ( const CSphVector<CSphFilterSettings> & dFilters, CSphVector<CSphFilterSettings> & dModifiedFilters, bool & bFiltersChanged, const CSphVector<FilterTreeItem_t> & dFilterTree,
-	const CSphVector<IndexHint_t> & dHints, const HistogramContainer_c & tHistograms, const BYTE * pDocidLookup );
+	const CSphVector<IndexHint_t> & dHints, const HistogramContainer_c & tHistograms, const BYTE * pDocidLookup, const SecondaryIndex_c * pSecondaryIndex, ESphCollation eCollation, AccessPlan_t & tPlan );
 
 RowidIterator_i * CreateIteratorIntersect ( CSphVector<RowidIterator_i*> & dIterators );
 
@@ -70,6 +101,7 @@ public:
 					~DocidLookupWriter_c();
 
 	bool			Open ( const CSphString & sFilename, CSphString & sError );
+	void			Open ( CSphWriter & tWriter );		///< write to an already opened file, starting from its current position
 	void			AddPair ( const DocidRowidPair_t & tPair );
 	bool			Finalize ( CSphString & sError );
 	CSphWriter &	GetWriter();
@@ -81,6 +113,8 @@ private:
 	int				m_iCheckpoint {0};
 	DWORD			m_nDocs {0};
 	CSphWriter *	m_pWriter {nullptr};
+	bool			m_bOwnWriter {true};
+	SphOffset_t		m_tBlockStart {0};
 	SphOffset_t		m_tCheckpointStart {0};
 	DocID_t			m_tLastDocID {0};
 	CSphFixedVector<DocidLookupCheckpoint_t> m_dCheckpoints {0};
@@ -280,5 +314,73 @@ private:
 
 bool WriteDocidLookup ( const CSphString & sFilename, const CSphFixedVector<DocidRowidPair_t> & dLookup, CSphString & sError );
 
+//////////////////////////////////////////////////////////////////////////
+
+/// per-attribute secondary indexes (.spidx)
+/// every indexed attribute gets a list of value-rowid pairs sorted by value, stored in docid lookup format
+/// strings are stored as hashes, so string filters still have to be checked against the rows
+bool IsSecondaryIndexAttr ( const CSphColumnInfo & tAttr );
+
+class SecondaryIndexBuilder_c
+{
+public:
+	explicit	SecondaryIndexBuilder_c ( const CSphSchema & tSchema );
+
+	bool		IsEmpty() const { return m_dAttrs.IsEmpty(); }
+	void		Collect ( RowID_t tRowID, const CSphRowitem * pRow, const BYTE * pBlobPool );
+	bool		Save ( const CSphString & sFilename, CSphString & sError );
+
+private:
+	struct Attr_t
+	{
+		CSphString						m_sName;
+		ESphAttr						m_eType {SPH_ATTR_NONE};
+		CSphAttrLocator					m_tLocator;
+		CSphVector<DocidRowidPair_t>	m_dPairs;
+	};
+
+	CSphVector<Attr_t>	m_dAttrs;
+};
+
+
+/// builds secondary indexes for all flagged attributes from attribute (.spa) and blob (.spb) files
+bool WriteSecondaryIndexes ( const CSphString & sSPA, const CSphString & sSPB, const CSphString & sSPIDX, const CSphSchema & tSchema, DWORD uTotalDocs, CSphString & sError );
+
+
+class SecondaryIndex_c
+{
+public:
+	bool		Setup ( const CSphString & sFilename, const CSphSchema & tSchema, DWORD uRows, CSphString & sError );
+	void		Reset();
+	bool		Flush ( CSphString & sError ) const;
+
+	bool		IsEnabled ( const CSphFilterSettings & tFilter, ESphCollation eCollation ) const;
+	bool		IsExact ( const CSphFilterSettings & tFilter ) const;
+	bool		EstimateRsetSize ( const CSphFilterSettings & tFilter, int64_t & iEstimate ) const;
+	RowidIterator_i * CreateIterator ( const CSphFilterSettings & tFilter ) const;
+
+	/// index no longer matches attribute values (eg after an update); persisted in the file
+	void		Invalidate ( const CSphString & sAttr );
+
+	CSphMappedBuffer<BYTE> & GetBuffer() { return m_tBuf; }
+
+private:
+	struct Attr_t
+	{
+		CSphString		m_sName;
+		ESphAttr		m_eType {SPH_ATTR_NONE};
+		BYTE *			m_pValid {nullptr};
+		const BYTE *	m_pData {nullptr};
+	};
+
+	CSphMappedBuffer<BYTE>	m_tBuf;
+	CSphVector<Attr_t>		m_dAttrs;
+
+	const Attr_t *	GetAttr ( const CSphString & sAttr ) const;
+	void			GetKeyRanges ( const Attr_t & tAttr, const CSphFilterSettings & tFilter, CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges ) const;
+	static void		GetFloatKeyRanges ( const CSphFilterSettings & tFilter, CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges );
+	static void		AddKeyRanges ( SphAttr_t tMin, SphAttr_t tMax, SphAttr_t tLowest, SphAttr_t tHighest, bool bExclude, CSphVector<std::pair<SphAttr_t,SphAttr_t>> & dRanges );
+};
+
 
 #endif // _secondaryindex_
\ No newline at end of file
@@ -588,6 +588,9 @@ struct DiskSubstringPayload_t : public ISphSubstringPayload
 };
 
 
+static const int		READAHEAD_MIN_DOCLIST	= 4096;				///< smaller expanded doclists are not hinted for readahead
+static const int64_t	READAHEAD_MAX_EXPANDED	= 16*1024*1024;	///< max bytes hinted for readahead per expanded term
+
 template < bool INLINE_HITS >
 class DiskPayloadQword_c : public DiskIndexQword_c<INLINE_HITS, false>
 {
@@ -627,6 +630,21 @@ public:
 		if ( m_iDoclist>=m_pPayload->m_dDoclist.GetLength() )
 			return false;
 
+		// expanded terms are read one after another, so let them be fetched in advance
+		// tiny doclists are not worth a syscall each, and a huge expansion must not flood the page cache
+		int64_t iReadAhead = 0;
+		for ( const auto & tDoclist : m_pPayload->m_dDoclist )
+		{
+			if ( tDoclist.m_iLen<READAHEAD_MIN_DOCLIST )
+				continue;
+
+			iReadAhead += tDoclist.m_iLen;
+			if ( iReadAhead>READAHEAD_MAX_EXPANDED )
+				break;
+
+			this->m_rdDoclist->ReadAhead ( tDoclist.m_uOff, tDoclist.m_iLen );
+		}
+
 		SetupReader();
 		return true;
 	}
@@ -873,6 +891,7 @@ static IndexFileExt_t g_dIndexFilesExts[SPH_EXT_TOTAL] =
 	{ SPH_EXT_SPT,	".spt",		53,	true,	true,	"docid lookup table" },
 	{ SPH_EXT_SPHI,	".sphi",	53,	true,	true,	"secondary index histograms" },
 	{ SPH_EXT_SPDS, ".spds",	57, true,	true,	"document storage" },
+	{ SPH_EXT_SPIDX, ".spidx",	62, true,	true,	"per-attribute secondary indexes" },
 	{ SPH_EXT_SPL,	".spl",		1,	true,	false,	"file lock for the index" },
 	{ SPH_EXT_SETTINGS,	".settings", 1,	true,	false,	"index runtime settings" }
 };
@@ -1808,6 +1827,7 @@ public:
 	bool				PreallocDocidLookup();
 	bool				PreallocKilllist();
 	bool				PreallocHistograms ( StrVec_t & dWarnings );
+	bool				PreallocSecondaryIndex ( StrVec_t & dWarnings );
 	bool				PreallocDocstore();
 
 #if USE_COLUMNAR
@@ -1817,10 +1837,12 @@ public:
 	bool				PreallocSkiplist();
 
 	CSphFixedVector<SphAttr_t> 	BuildDocList () const final;
+	CSphVector<DocID_t>			BuildAliveDocList () const final;
 
 	// docstore-related section
 	void				CreateReader ( int64_t iSessionId ) const final;
 	bool				GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const final;
+	void				GetDocs ( const VecTraits_T<DocID_t> & dDocIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs, CSphBitvec & tFound ) const final;
 	int					GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const final;
 	Bson_t				ExplainQuery ( const CSphString & sQuery ) const final;
 
@@ -1860,6 +1882,7 @@ private:
 
 	CSphMappedBuffer<BYTE>		m_tDocidLookup;		///< speeds up docid-rowid lookups + used for applying killlist on startup
 	LookupReader_c				m_tLookupReader;	///< used by getrowidbydocid
+	SecondaryIndex_c			m_tSecondaryIndex;	///< per-attribute value-rowid lookups
 
 	CSphScopedPtr<Docstore_i> 	m_pDocstore {nullptr};
 
@@ -1888,9 +1911,9 @@ private:
 	void						GetIndexFiles ( CSphVector<CSphString> & dFiles, const FilenameBuilder_i * pFilenameBuilder ) const override;
 
 	bool						ParsedMultiQuery ( const CSphQuery & tQuery, CSphQueryResult & tResult, const VecTraits_T<ISphMatchSorter*> & dSorters, const XQQuery_t & tXQ, CSphDict * pDict,
-									const CSphMultiQueryArgs & tArgs, CSphQueryNodeCache * pNodeCache ) const;
+									const CSphMultiQueryArgs & tArgs, CSphQueryNodeCache * pNodeCache, QcacheEntry_c * pCached = nullptr ) const;
 
-	void						ScanByBlocks ( const CSphQueryContext & tCtx, CSphQueryResultMeta & tMeta, const VecTraits_T<ISphMatchSorter *> & dSorters, CSphMatch & tMatch, int iCutoff,
+	void						ScanByBlocks ( RowID_t tStart, RowID_t tEnd, const CSphQueryContext & tCtx, CSphQueryResultMeta & tMeta, const VecTraits_T<ISphMatchSorter *> & dSorters, CSphMatch & tMatch, int iCutoff,
 									bool bRandomize, int iIndexWeight, int64_t tmMaxTimer ) const;
 
 	void						RunFullscanOnAttrs ( RowID_t tStart, RowID_t tEnd, const CSphQueryContext & tCtx, CSphQueryResultMeta & tMeta, const VecTraits_T<ISphMatchSorter *> & dSorters,
@@ -1901,6 +1924,9 @@ private:
 
 	bool						MultiScan ( CSphQueryResult & tResult, const CSphQuery & dQuery, const VecTraits_T<ISphMatchSorter *> & dSorters, const CSphMultiQueryArgs & tArgs ) const;
 
+	int							GetPseudoShards ( const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *> & dSorters, const CSphMultiQueryArgs & tArgs ) const;
+	bool						PseudoShardedQuery ( CSphQueryResult & tResult, const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *> & dSorters, const CSphMultiQueryArgs & tArgs, int iShards ) const;
+
 	template<bool USE_KLIST, bool RANDOMIZE, bool USE_FACTORS>
 	void						MatchExtended ( CSphQueryContext & tCtx, const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *>& dSorters, ISphRanker * pRanker, int iTag, int iIndexWeight ) const;
 
@@ -1925,7 +1951,8 @@ private:
 	XQNode_t *					ExpandPrefix ( XQNode_t * pNode, CSphQueryResultMeta & tMeta, CSphScopedPayload * pPayloads, DWORD uQueryDebugFlags ) const;
 
 	static void					CreateRowMaps ( const CSphIndex_VLN * pDstIndex, const CSphIndex_VLN * pSrcIndex, const ISphFilter * pFilter, CSphVector<RowID_t> & dSrcRowMap, CSphVector<RowID_t> & dDstRowMap, bool bSupressDstDocids );
-	static bool					MergeAttributes ( volatile bool * pLocalStop, const CSphIndex_VLN * pIndex, const CSphVector<RowID_t> & dRowMap, AttrIndexBuilder_c & tMinMax,	CSphWriter & tWriterSPA, BlobRowBuilder_i * pBlobRowBuilder, DocstoreBuilder_i * pDocstoreBuilder, RowID_t & tResultRowID );
+	static bool					MergeAttributes ( volatile bool * pLocalStop, const CSphIndex_VLN * pIndex, const CSphVector<RowID_t> & dRowMap, AttrIndexBuilder_c & tMinMax,	CSphWriter & tWriterSPA, BlobRowBuilder_i * pBlobRowBuilder, RowID_t & tResultRowID );
+	static bool					MergeDocstore ( volatile bool * pLocalStop, const CSphIndex_VLN * pIndex, const CSphVector<RowID_t> & dRowMap, DocstoreBuilder_i & tDocstoreBuilder );
 
 	void						Update_CollectRowPtrs ( UpdateContext_t & tCtx );
 	bool						Update_WriteBlobRow ( UpdateContext_t & tCtx, int iUpd, CSphRowitem * pDocinfo, const BYTE * pBlob, int iLength, int nBlobAttrs, bool & bCritical, CSphString & sError ) override;
@@ -6682,6 +6709,11 @@ void CSphSchema::SetupFlags ( const CSphSourceSettings & tSettings )
 	if ( bHaveColumnar )
 		RebuildLocators(true);
 #endif
+
+	for ( const auto & sAttr : tSettings.m_dSecondaryIndexes )
+		for ( auto & tAttr : m_dAttrs )
+			if ( tAttr.m_sName==sAttr )
+				tAttr.m_uAttrFlags |= CSphColumnInfo::ATTR_SECONDARY_INDEX;
 }
 
 
@@ -7715,6 +7747,12 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, b
 	if ( !Update_FixupData ( tCtx, sError ) )
 		return -1;
 
+	// new values won't be in the secondary indexes; disable them until the index is rebuilt
+	// that goes before the values change, so no query uses an index that doesn't match the rows
+	if ( tCtx.m_dUpdatedRows.any_of ( []( const UpdatedRowData_t & tRow ){ return tRow.m_pRow!=nullptr; } ) )
+		for ( const auto & tAttr : tUpd.m_dAttributes )
+			m_tSecondaryIndex.Invalidate ( tAttr.m_sName );
+
 	// FIXME! FIXME! FIXME! overwriting just-freed blocks might hurt concurrent searchers;
 	// should implement a simplistic MVCC-style delayed-free to avoid that
 
@@ -7738,6 +7776,13 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, b
 		if ( i.m_bUpdated )
 			iUpdated++;
 
+	// cached matches were filtered by the old values; kills, on the other hand, are applied on top of cached matches
+	if ( iUpdated )
+	{
+		QcacheDeleteIndex ( m_iIndexId );
+		NextGeneration();
+	}
+
 	if ( !Update_HandleJsonWarnings ( tCtx, iUpdated, sWarning, sError ) )
 		return -1;
 
@@ -7794,6 +7839,14 @@ bool CSphIndex_VLN::SaveAttributes ( CSphString & sError ) const
 
 	sphLogDebugvv ( "index '%s' attrs (%d) saving...", m_sIndexName.cstr(), uAttrStatus );
 
+	// invalidated secondary indexes go to disk first; otherwise a crash in between leaves updated values
+	// on disk along with the indexes that still look valid
+	if ( uAttrStatus & ( IndexUpdateHelper_c::ATTRS_UPDATED | IndexUpdateHelper_c::ATTRS_BLOB_UPDATED ) )
+	{
+		if ( !m_tSecondaryIndex.Flush ( sError ) )
+			return false;
+	}
+
 	if ( uAttrStatus & IndexUpdateHelper_c::ATTRS_UPDATED )
 	{
 		if ( !m_tAttr.Flush ( true, sError ) )
@@ -7933,6 +7986,10 @@ bool CSphIndex_VLN::AddRemoveAttribute ( bool bAddAttr, const CSphString & sAttr
 	if ( !Alter_AddRemoveFromSchema ( tNewSchema, sAttrName, eAttrType, bAddAttr, sError ) )
 		return false;
 
+	// even a failed alter might leave files half-updated; cached results are stale either way
+	QcacheDeleteIndex ( m_iIndexId );
+	NextGeneration();
+
 	int iOldStride = m_tSchema.GetRowSize();
 	int iNewStride = tNewSchema.GetRowSize();
 
@@ -8216,7 +8273,10 @@ int CSphIndex_VLN::KillMulti ( const VecTraits_T<DocID_t> & dKlist )
 
 	int iTotalKilled = KillByLookup ( tTargetReader, tKillerReader, m_tDeadRowMap );
 	if ( iTotalKilled )
+	{
 		m_uAttrsStatus |= IndexUpdateHelper_c::ATTRS_ROWMAP_UPDATED;
+		NextGeneration();
+	}
 
 	return iTotalKilled;
 }
@@ -8235,6 +8295,89 @@ struct CmpHit_fn
 };
 
 
+static int g_iIndexerThreads = 1;
+
+void sphSetIndexerThreads ( int iThreads )
+{
+	g_iIndexerThreads = Max ( iThreads, 1 );
+}
+
+
+/// sort hits block using up to iThreads threads
+/// top levels are split quicksort-style around sampled pivots, so no extra memory is needed
+void sphSortHits ( CSphWordHit * pHits, int iHits, int iThreads )
+{
+	const int MIN_HITS_PER_THREAD = 65536;
+	const int PIVOT_SAMPLES = 63;
+	CmpHit_fn tCmp;
+
+	if ( iThreads<=1 || iHits<2*MIN_HITS_PER_THREAD )
+	{
+		sphSort ( pHits, iHits, tCmp );
+		return;
+	}
+
+	// median of evenly spaced samples
+	CSphWordHit dSamples[PIVOT_SAMPLES];
+	for ( int i=0; i<PIVOT_SAMPLES; i++ )
+		dSamples[i] = pHits [ (int64_t)iHits*( 2*i+1 )/( 2*PIVOT_SAMPLES ) ];
+	sphSort ( dSamples, PIVOT_SAMPLES, tCmp );
+	const CSphWordHit tPivot = dSamples[PIVOT_SAMPLES/2];
+
+	CSphWordHit * pMid = std::partition ( pHits, pHits+iHits, [&tCmp, &tPivot] ( const CSphWordHit & tHit ) { return tCmp.IsLess ( tHit, tPivot ); } );
+	auto iLeft = int ( pMid-pHits );
+
+	// pivot is the least hit (say, one huge word); nothing to split
+	if ( !iLeft )
+	{
+		sphSort ( pHits, iHits, tCmp );
+		return;
+	}
+
+	int iLeftThreads = Min ( Max ( int ( (int64_t)iThreads*iLeft/iHits ), 1 ), iThreads-1 );
+	SphThread_t tThd;
+	bool bThread = Threads::Create ( &tThd, [pHits, iLeft, iLeftThreads] { sphSortHits ( pHits, iLeft, iLeftThreads ); }, false, "sort_hits" );
+	if ( !bThread )
+		sphSortHits ( pHits, iLeft, 1 );
+
+	sphSortHits ( pMid, iHits-iLeft, bThread ? iThreads-iLeftThreads : 1 );
+
+	if ( bThread )
+		Threads::Join ( &tThd );
+}
+
+
+/// run independent index build jobs on up to iThreads threads (in given order if single-threaded)
+/// returns false if any of jobs failed
+static bool RunBuildJobs ( VecTraits_T<std::function<bool()>> dJobs, int iThreads )
+{
+	CSphFixedVector<BYTE> dOk ( dJobs.GetLength() );
+	dOk.Fill ( 0 );
+	std::atomic<int> iNextJob { 0 };
+
+	auto fnWorker = [&dJobs, &dOk, &iNextJob]
+	{
+		for ( int iJob = iNextJob++; iJob<dJobs.GetLength(); iJob = iNextJob++ )
+			dOk[iJob] = dJobs[iJob]() ? 1 : 0;
+	};
+
+	CSphVector<SphThread_t> dThreads;
+	for ( int i=1; i<Min ( iThreads, dJobs.GetLength() ); i++ )
+	{
+		SphThread_t tThd;
+		if ( Threads::Create ( &tThd, fnWorker, false, "build_job", i ) )
+			dThreads.Add ( tThd );
+	}
+
+	fnWorker();
+
+	for ( auto & tThd : dThreads )
+		Threads::Join ( &tThd );
+
+	return !dOk.any_of ( [] ( BYTE uOk ) { return !uOk; } );
+}
+
+
 CSphString CSphIndex_VLN::GetIndexFileName ( ESphExt eExt, bool bTemp ) const
 {
 	CSphString sRes;
@@ -10413,7 +10556,7 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 				// sort hits
 				int iHits = pHits - dHits.Begin();
 				{
-					sphSort ( dHits.Begin(), iHits, CmpHit_fn() );
+					sphSortHits ( dHits.Begin(), iHits, g_iIndexerThreads );
 					m_pDict->HitblockPatch ( dHits.Begin(), iHits );
 				}
 				pHits = dHits.Begin();
@@ -10487,7 +10630,7 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 			int iHits = pHits - dHits.Begin();
 			if ( iDictSize && m_pDict->HitblockGetMemUse() && iHits )
 			{
-				sphSort ( dHits.Begin(), iHits, CmpHit_fn() );
+				sphSortHits ( dHits.Begin(), iHits, g_iIndexerThreads );
 				m_pDict->HitblockPatch ( dHits.Begin(), iHits );
 				pHits = dHits.Begin();
 				m_tProgress.m_iHitsTotal += iHits;
@@ -10518,7 +10661,7 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 
 				// store hits
 				int iStoredHits = pHits - dHits.Begin();
-				sphSort ( dHits.Begin(), iStoredHits, CmpHit_fn() );
+				sphSortHits ( dHits.Begin(), iStoredHits, g_iIndexerThreads );
 				m_pDict->HitblockPatch ( dHits.Begin(), iStoredHits );
 
 				pHits = dHits.Begin();
@@ -10549,7 +10692,7 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 	{
 		int iHits = pHits - dHits.Begin();
 		{
-			sphSort ( dHits.Begin(), iHits, CmpHit_fn() );
+			sphSortHits ( dHits.Begin(), iHits, g_iIndexerThreads );
 			m_pDict->HitblockPatch ( dHits.Begin(), iHits );
 		}
 		m_tProgress.m_iHitsTotal += iHits;
@@ -10643,6 +10786,9 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 	}
 #endif
 
+	if ( !WriteSecondaryIndexes ( sSPA, sSPB, GetIndexFileName(SPH_EXT_SPIDX), m_tSchema, (DWORD)m_tStats.m_iTotalDocuments, m_sLastError ) )
+		return 0;
+
 	if ( !WriteDeadRowMap ( GetIndexFileName(SPH_EXT_SPM), m_tStats.m_iTotalDocuments, m_sLastError ) )
 		return 0;
 
@@ -11453,7 +11599,7 @@ void CSphIndex_VLN::CreateRowMaps ( const CSphIndex_VLN * pDstIndex, const CSphI
 
 
 bool CSphIndex_VLN::MergeAttributes ( volatile bool * pLocalStop, const CSphIndex_VLN * pIndex, const CSphVector<RowID_t> & dRowMap, AttrIndexBuilder_c & tMinMax,
-	CSphWriter & tWriterSPA, BlobRowBuilder_i * pBlobRowBuilder, DocstoreBuilder_i * pDocstoreBuilder, RowID_t & tResultRowID )
+	CSphWriter & tWriterSPA, BlobRowBuilder_i * pBlobRowBuilder, RowID_t & tResultRowID )
 {
 	int iStride = pIndex->m_tSchema.GetRowSize();
 
@@ -11487,9 +11633,6 @@ bool CSphIndex_VLN::MergeAttributes ( volatile bool * pLocalStop, const CSphInde
 		} else
 			tWriterSPA.PutBytes ( pRow, iStrideBytes );
 
-		if ( pDocstoreBuilder )
-			pDocstoreBuilder->AddDoc ( tResultRowID, pIndex->m_pDocstore->GetDoc ( i, nullptr, -1, false ) );
-
 		tResultRowID++;
 	}
 
@@ -11497,6 +11640,22 @@ bool CSphIndex_VLN::MergeAttributes ( volatile bool * pLocalStop, const CSphInde
 }
 
 
+bool CSphIndex_VLN::MergeDocstore ( volatile bool * pLocalStop, const CSphIndex_VLN * pIndex, const CSphVector<RowID_t> & dRowMap, DocstoreBuilder_i & tDocstoreBuilder )
+{
+	// row maps already hold the resulting rowids
+	ARRAY_FOREACH ( i, dRowMap )
+	{
+		if ( sphInterrupted () || *pLocalStop )
+			return false;
+
+		if ( dRowMap[i]!=INVALID_ROWID )
+			tDocstoreBuilder.AddDoc ( dRowMap[i], pIndex->m_pDocstore->GetDoc ( i, nullptr, -1, false ) );
+	}
+
+	return true;
+}
+
+
 bool CSphIndex_VLN::DoMerge ( const CSphIndex_VLN * pDstIndex, const CSphIndex_VLN * pSrcIndex, ISphFilter * pFilter, CSphString & sError, CSphIndexProgress & tProgress, volatile bool * pLocalStop,
 	bool bSrcSettings, bool bSupressDstDocids )
 {
@@ -11533,24 +11692,39 @@ bool CSphIndex_VLN::DoMerge ( const CSphIndex_VLN * pDstIndex, const CSphIndex_V
 	CSphString sSPA = pDstIndex->GetIndexFileName ( SPH_EXT_SPA, true );
 	CSphString sSPT = pDstIndex->GetIndexFileName ( SPH_EXT_SPT, true );
 	CSphString sSPHI = pDstIndex->GetIndexFileName ( SPH_EXT_SPHI, true );
+
+	// attributes, docstore and dictionary with doclists/hitlists are written to separate files
+	// and only depend on row maps, so they are merged by independent jobs; each job (and the writers
+	// it uses) reports into its own error string, and those are collected after the jobs are done
+	CSphString sAttrError, sDocstoreError, sWordsError;
+
 	CSphWriter tWriterSPA;
-	if ( !tWriterSPA.OpenFile ( sSPA, sError ) )
+	if ( !tWriterSPA.OpenFile ( sSPA, sAttrError ) )
+	{
+		sError = sAttrError;
 		return false;
+	}
 
 	CSphScopedPtr<BlobRowBuilder_i> pBlobRowBuilder(nullptr);
 	if ( pSrcIndex->m_tSchema.HasBlobAttrs() )
 	{
-		pBlobRowBuilder = sphCreateBlobRowBuilder ( pSrcIndex->m_tSchema, pDstIndex->GetIndexFileName ( SPH_EXT_SPB, true ), pSrcIndex->GetSettings().m_tBlobUpdateSpace, sError );
+		pBlobRowBuilder = sphCreateBlobRowBuilder ( pSrcIndex->m_tSchema, pDstIndex->GetIndexFileName ( SPH_EXT_SPB, true ), pSrcIndex->GetSettings().m_tBlobUpdateSpace, sAttrError );
 		if ( !pBlobRowBuilder.Ptr() )
+		{
+			sError = sAttrError;
 			return false;
+		}
 	}
 
 	CSphScopedPtr<DocstoreBuilder_i> pDocstoreBuilder(nullptr);
 	if ( pDstIndex->m_pDocstore )
 	{
-		pDocstoreBuilder = CreateDocstoreBuilder ( pDstIndex->GetIndexFileName ( SPH_EXT_SPDS, true ), pDstIndex->m_pDocstore->GetDocstoreSettings(), sError );
+		pDocstoreBuilder = CreateDocstoreBuilder ( pDstIndex->GetIndexFileName ( SPH_EXT_SPDS, true ), pDstIndex->m_pDocstore->GetDocstoreSettings(), sDocstoreError );
 		if ( !pDocstoreBuilder.Ptr() )
+		{
+			sError = sDocstoreError;
 			return false;
+		}
 
 		for ( int i = 0; i < pDstIndex->m_tSchema.GetFieldsCount(); i++ )
 			if ( pDstIndex->m_tSchema.IsFieldStored(i) )
@@ -11565,33 +11739,55 @@ bool CSphIndex_VLN::DoMerge ( const CSphIndex_VLN * pDstIndex, const CSphIndex_V
 	CreateRowMaps ( pDstIndex, pSrcIndex, pFilter, dSrcRows, dDstRows, bSupressDstDocids );
 
 	RowID_t tResultRowID = 0;
-	if ( !MergeAttributes ( pLocalStop, pDstIndex, dDstRows, tMinMax, tWriterSPA, pBlobRowBuilder.Ptr(), pDocstoreBuilder.Ptr(), tResultRowID ) )
-		return false;
+	auto fnMergeAttrs = [&]() -> bool
+	{
+		if ( !MergeAttributes ( pLocalStop, pDstIndex, dDstRows, tMinMax, tWriterSPA, pBlobRowBuilder.Ptr(), tResultRowID ) )
+			return false;
 
-	if ( !bCompress && !MergeAttributes ( pLocalStop, pSrcIndex, dSrcRows, tMinMax, tWriterSPA, pBlobRowBuilder.Ptr(), pDocstoreBuilder.Ptr(), tResultRowID ) )
-		return false;
+		if ( !bCompress && !MergeAttributes ( pLocalStop, pSrcIndex, dSrcRows, tMinMax, tWriterSPA, pBlobRowBuilder.Ptr(), tResultRowID ) )
+			return false;
 
-	if ( tResultRowID )
-	{
-		tBuildHeader.m_iMinMaxIndex = tWriterSPA.GetPos() / sizeof(CSphRowitem);
+		if ( tResultRowID )
+		{
+			tBuildHeader.m_iMinMaxIndex = tWriterSPA.GetPos() / sizeof(CSphRowitem);
 
-		tMinMax.FinishCollect();
-		const CSphTightVector<CSphRowitem> & dMinMaxRows = tMinMax.GetCollected();
-		tWriterSPA.PutBytes ( dMinMaxRows.Begin(), dMinMaxRows.GetLength()*sizeof(CSphRowitem) );
+			tMinMax.FinishCollect();
+			const CSphTightVector<CSphRowitem> & dMinMaxRows = tMinMax.GetCollected();
+			tWriterSPA.PutBytes ( dMinMaxRows.Begin(), dMinMaxRows.GetLength()*sizeof(CSphRowitem) );
 
-		tBuildHeader.m_iDocinfo = tResultRowID;
-		tBuildHeader.m_iDocinfoIndex = ( dMinMaxRows.GetLength() / tDstSchema.GetRowSize() / 2 ) - 1;
-	}
+			tBuildHeader.m_iDocinfo = tResultRowID;
+			tBuildHeader.m_iDocinfoIndex = ( dMinMaxRows.GetLength() / tDstSchema.GetRowSize() / 2 ) - 1;
+		}
 
-	tWriterSPA.CloseFile();
-	if ( tWriterSPA.IsError() )
-		return false;
+		tWriterSPA.CloseFile();
+		if ( tWriterSPA.IsError() )
+			return false;
 
-	if ( pBlobRowBuilder.Ptr() && !pBlobRowBuilder->Done ( sError ) )
-		return false;
+		if ( pBlobRowBuilder.Ptr() && !pBlobRowBuilder->Done ( sAttrError ) )
+			return false;
 
-	if ( !CheckDocsCount ( tResultRowID, sError ) )
-		return false;
+		if ( !CheckDocsCount ( tResultRowID, sAttrError ) )
+			return false;
+
+		if ( !pDstIndex->WriteLookupAndHistograms ( sSPA.cstr(), sSPT.cstr(), sSPHI.cstr(), tResultRowID, sAttrError ) )
+			return false;
+
+		CSphString sSPB = pDstIndex->GetIndexFileName ( SPH_EXT_SPB, true );
+		CSphString sSPIDX = pDstIndex->GetIndexFileName ( SPH_EXT_SPIDX, true );
+		return WriteSecondaryIndexes ( sSPA, sSPB, sSPIDX, tDstSchema, tResultRowID, sAttrError );
+	};
+
+	auto fnMergeDocstore = [&]() -> bool
+	{
+		if ( !MergeDocstore ( pLocalStop, pDstIndex, dDstRows, *pDocstoreBuilder ) )
+			return false;
+
+		if ( !bCompress && !MergeDocstore ( pLocalStop, pSrcIndex, dSrcRows, *pDocstoreBuilder ) )
+			return false;
+
+		pDocstoreBuilder->Finalize();
+		return true;
+	};
 
 	CSphAutofile tTmpDict ( pDstIndex->GetIndexFileName("spi.tmp"), SPH_O_NEW, sError, true );
 	CSphAutofile tDict ( pDstIndex->GetIndexFileName ( SPH_EXT_SPI, true ), SPH_O_NEW, sError );
@@ -11603,54 +11799,68 @@ bool CSphIndex_VLN::DoMerge ( const CSphIndex_VLN * pDstIndex, const CSphIndex_V
 
 	int iHitBufferSize = 8 * 1024 * 1024;
 	CSphVector<SphWordID_t> dDummy;
-	CSphHitBuilder tHitBuilder ( pSettings->m_tSettings, dDummy, true, iHitBufferSize, pDict, &sError );
-
-	// FIXME? is this magic dict block constant any good?..
-	pDict->DictBegin ( tTmpDict, tDict, iHitBufferSize );
+	CSphHitBuilder tHitBuilder ( pSettings->m_tSettings, dDummy, true, iHitBufferSize, pDict, &sWordsError );
 
-	// merge dictionaries, doclists and hitlists
-	if ( pDict->GetSettings().m_bWordDict )
-	{
-		WITH_QWORD ( pDstIndex, false, QwordDst,
-			WITH_QWORD ( pSrcIndex, false, QwordSrc,
-				if ( !CSphIndex_VLN::MergeWords < QwordDst, QwordSrc > ( pDstIndex, pSrcIndex, pFilter, dDstRows, dSrcRows, &tHitBuilder, sError, tBuildHeader, tProgress, pLocalStop ) )
-					return false;
-		));
-	} else
+	auto fnMergeWords = [&]() -> bool
 	{
-		WITH_QWORD ( pDstIndex, true, QwordDst,
-			WITH_QWORD ( pSrcIndex, true, QwordSrc,
-				if ( !CSphIndex_VLN::MergeWords < QwordDst, QwordSrc > ( pDstIndex, pSrcIndex, pFilter, dDstRows, dSrcRows, &tHitBuilder, sError, tBuildHeader, tProgress, pLocalStop ) )
-					return false;
-		));
-	}
+		// FIXME? is this magic dict block constant any good?..
+		pDict->DictBegin ( tTmpDict, tDict, iHitBufferSize );
 
-	tBuildHeader.m_iTotalDocuments = tResultRowID;
+		// merge dictionaries, doclists and hitlists
+		if ( pDict->GetSettings().m_bWordDict )
+		{
+			WITH_QWORD ( pDstIndex, false, QwordDst,
+				WITH_QWORD ( pSrcIndex, false, QwordSrc,
+					if ( !CSphIndex_VLN::MergeWords < QwordDst, QwordSrc > ( pDstIndex, pSrcIndex, pFilter, dDstRows, dSrcRows, &tHitBuilder, sWordsError, tBuildHeader, tProgress, pLocalStop ) )
+						return false;
+			));
+		} else
+		{
+			WITH_QWORD ( pDstIndex, true, QwordDst,
+				WITH_QWORD ( pSrcIndex, true, QwordSrc,
+					if ( !CSphIndex_VLN::MergeWords < QwordDst, QwordSrc > ( pDstIndex, pSrcIndex, pFilter, dDstRows, dSrcRows, &tHitBuilder, sWordsError, tBuildHeader, tProgress, pLocalStop ) )
+						return false;
+			));
+		}
 
-	if ( !WriteDeadRowMap ( pDstIndex->GetIndexFileName ( SPH_EXT_SPM, true ), tResultRowID, sError ) )
-		return false;
+		if ( sphInterrupted () || *pLocalStop )
+			return false;
 
-	if ( sphInterrupted () || *pLocalStop )
-		return false;
+		// finalize
+		CSphAggregateHit tFlush;
+		tFlush.m_tRowID = INVALID_ROWID;
+		tFlush.m_uWordID = 0;
+		tFlush.m_sKeyword = (BYTE*)""; // tricky: assertion in cidxHit calls strcmp on this in case of empty index!
+		tFlush.m_iWordPos = EMPTY_HIT;
+		tFlush.m_dFieldMask.UnsetAll();
+		tHitBuilder.cidxHit ( &tFlush );
+
+		int iMinInfixLen = pSettings->m_tSettings.m_iMinInfixLen;
+		return tHitBuilder.cidxDone ( iHitBufferSize, iMinInfixLen, pSettings->m_pTokenizer->GetMaxCodepointLength(), &tBuildHeader );
+	};
+
+	// keywords go first as the longest one
+	CSphVector<std::function<bool()>> dJobs;
+	dJobs.Add ( fnMergeWords );
+	dJobs.Add ( fnMergeAttrs );
+	if ( pDocstoreBuilder.Ptr() )
+		dJobs.Add ( fnMergeDocstore );
+
+	bool bOk = RunBuildJobs ( dJobs, g_iIndexerThreads );
+	for ( const CSphString * pJobError : { &sWordsError, &sAttrError, &sDocstoreError } )
+		if ( sError.IsEmpty() )
+			sError = *pJobError;
 
-	// finalize
-	CSphAggregateHit tFlush;
-	tFlush.m_tRowID = INVALID_ROWID;
-	tFlush.m_uWordID = 0;
-	tFlush.m_sKeyword = (BYTE*)""; // tricky: assertion in cidxHit calls strcmp on this in case of empty index!
-	tFlush.m_iWordPos = EMPTY_HIT;
-	tFlush.m_dFieldMask.UnsetAll();
-	tHitBuilder.cidxHit ( &tFlush );
-
-	int iMinInfixLen = pSettings->m_tSettings.m_iMinInfixLen;
-	if ( !tHitBuilder.cidxDone ( iHitBufferSize, iMinInfixLen, pSettings->m_pTokenizer->GetMaxCodepointLength(), &tBuildHeader ) )
+	if ( !bOk )
 		return false;
 
-	if ( !pDstIndex->WriteLookupAndHistograms ( sSPA.cstr(), sSPT.cstr(), sSPHI.cstr(), tResultRowID, sError ) )
+	tBuildHeader.m_iTotalDocuments = tResultRowID;
+
+	if ( !WriteDeadRowMap ( pDstIndex->GetIndexFileName ( SPH_EXT_SPM, true ), tResultRowID, sError ) )
 		return false;
 
-	if ( pDocstoreBuilder.Ptr() )
-		pDocstoreBuilder->Finalize();
+	if ( sphInterrupted () || *pLocalStop )
+		return false;
 
 	CSphString sHeaderName = pDstIndex->GetIndexFileName ( SPH_EXT_SPH, true );
 
@@ -11946,6 +12156,24 @@ CSphFixedVector<SphAttr_t> CSphIndex_VLN::BuildDocList () const
 }
 
 
+CSphVector<DocID_t> CSphIndex_VLN::BuildAliveDocList () const
+{
+	CSphVector<DocID_t> dResult;
+	if ( !m_iDocinfo )
+		return dResult;
+
+	dResult.Reserve ( m_iDocinfo - m_tDeadRowMap.GetNumDeads() );
+
+	int iStride = m_tSchema.GetRowSize();
+	const CSphRowitem * pRow = m_tAttr.GetWritePtr();
+	for ( RowID_t tRowID = 0; tRowID<(RowID_t)m_iDocinfo; ++tRowID, pRow += iStride )
+		if ( !m_tDeadRowMap.IsSet ( tRowID ) )
+			dResult.Add ( sphGetDocID ( pRow ) );
+
+	return dResult;
+}
+
+
 RowID_t CSphIndex_VLN::GetRowidByDocid ( DocID_t tDocID ) const
 {
 	return m_tLookupReader.Find ( tDocID );
@@ -11958,6 +12186,7 @@ int	CSphIndex_VLN::Kill ( DocID_t tDocID )
 	if ( m_tDeadRowMap.Set ( GetRowidByDocid ( tDocID ) ) )
 	{
 		m_uAttrsStatus |= IndexUpdateHelper_c::ATTRS_ROWMAP_UPDATED;
+		NextGeneration();
 		return 1;
 	}
 
@@ -12047,6 +12276,48 @@ void CSphQueryContext::CalcSort ( CSphMatch & tMatch ) const
 }
 
 
+template <typename T, typename STORE>
+static void CalcContextItemBatch ( CSphMatch * const * ppMatches, int iCount, const CSphQueryContext::CalcItem_t & tCalc, STORE && fnStore )
+{
+	CSphFixedVector<T> dColumn ( iCount );
+	EvalExprBatch ( tCalc.m_pExpr, ppMatches, iCount, dColumn.Begin() );
+	for ( int i = 0; i < iCount; i++ )
+		fnStore ( *ppMatches[i], dColumn[i] );
+}
+
+
+// numeric items are evaluated column-wise over the whole batch, the rest fall back to per-match evaluation
+// items are processed in order, so later ones can refer to the results of earlier ones
+void CSphQueryContext::CalcSortBatch ( CSphMatch * const * ppMatches, int iCount ) const
+{
+	for ( auto & tCalc : m_dCalcSort )
+		switch ( tCalc.m_eType )
+		{
+		case SPH_ATTR_INTEGER:
+			CalcContextItemBatch<int> ( ppMatches, iCount, tCalc, [&tCalc] ( CSphMatch & tMatch, int iValue ) { tMatch.SetAttr ( tCalc.m_tLoc, iValue ); } );
+			break;
+
+		case SPH_ATTR_BIGINT:
+		case SPH_ATTR_JSON_FIELD:
+			CalcContextItemBatch<int64_t> ( ppMatches, iCount, tCalc, [&tCalc] ( CSphMatch & tMatch, int64_t iValue ) { tMatch.SetAttr ( tCalc.m_tLoc, iValue ); } );
+			break;
+
+		case SPH_ATTR_STRINGPTR:
+		case SPH_ATTR_FACTORS:
+		case SPH_ATTR_FACTORS_JSON:
+		case SPH_ATTR_INT64SET_PTR:
+		case SPH_ATTR_UINT32SET_PTR:
+			for ( int i = 0; i < iCount; i++ )
+				CalcContextItem ( *ppMatches[i], tCalc );
+			break;
+
+		default:
+			CalcContextItemBatch<float> ( ppMatches, iCount, tCalc, [&tCalc] ( CSphMatch & tMatch, float fValue ) { tMatch.SetAttrFloat ( tCalc.m_tLoc, fValue ); } );
+			break;
+		}
+}
+
+
 void CSphQueryContext::CalcFinal ( CSphMatch & tMatch ) const
 {
 	CalcContextItems ( tMatch, m_dCalcFinal );
@@ -12197,6 +12468,9 @@ void CSphIndex_VLN::MatchExtended ( CSphQueryContext& tCtx, const CSphQuery & tQ
 	if ( iCutoff<=0 )
 		iCutoff = -1;
 
+	// ranker may skip docs which can't get into the only sorter anyway
+	bool bPrune = tQuery.m_bPruneByWeight && !RANDOMIZE && dSorters.GetLength()==1 && iIndexWeight>0;
+
 	// do searching
 	CSphMatch * pMatch = pRanker->GetMatchesBuffer();
 	while (true)
@@ -12265,6 +12539,9 @@ void CSphIndex_VLN::MatchExtended ( CSphQueryContext& tCtx, const CSphQuery & tQ
 
 		if ( iCutoff==0 )
 			break;
+
+		if ( bPrune )
+			pRanker->SetWeightThreshold ( dSorters[0]->GetWeightThreshold() / iIndexWeight );
 	}
 }
 
@@ -12386,12 +12663,12 @@ public:
 	}
 
 private:
-	static const int MAX_COLLECTED = 128;
+	static const int MAX_COLLECTED = 1024;
 
 	RowID_t						m_tRowID {INVALID_ROWID};
 	RowID_t						m_tRowIdStart {INVALID_ROWID};
 	RowID_t						m_tRowIdEnd {INVALID_ROWID};
-	CSphFixedVector<RowID_t>	m_dCollected {MAX_COLLECTED+1};		// store 128 values + end marker (same as .spa attr block size)
+	CSphFixedVector<RowID_t>	m_dCollected {MAX_COLLECTED+1};		// store 1024 values + end marker (same as fullscan filter batch)
 	const DeadRowMap_Disk_c &	m_tDeadRowMap;
 };
 
@@ -12476,68 +12753,162 @@ private:
 
 //////////////////////////////////////////////////////////////////////////
 
+/// rows are filtered (and sort expressions computed) in batches of that size, i.e. one virtual call per filter per batch instead of per row
+static const int FULLSCAN_BATCH = 1024;
+
 template <bool HAS_FILTER_CALC, bool HAS_SORT_CALC, bool HAS_FILTER, bool HAS_RANDOMIZE, bool HAS_MAX_TIMER, bool HAS_CUTOFF, typename ITERATOR, typename TO_STATIC>
 void Fullscan ( ITERATOR & tIterator, TO_STATIC && fnToStatic, const CSphQueryContext & tCtx, CSphQueryResultMeta & tMeta, const VecTraits_T<ISphMatchSorter *>& dSorters, CSphMatch & tMatch,
 	int iCutoff, int iIndexWeight, int64_t tmMaxTimer, bool & bStop )
 {
-	RowIdBlock_t dRowIDs;
-	while ( !bStop && tIterator.GetNextRowIdBlock(dRowIDs) )
-		for ( auto & i : dRowIDs )
+	// push a match that passed the filters and has its sort expressions computed; returns false when scan should stop
+	auto fnPush = [&]( CSphMatch & tPushed ) -> bool
+	{
+		bool bNewMatch = false;
+		dSorters.Apply ( [&tPushed, &bNewMatch] ( ISphMatchSorter * p ) { bNewMatch |= p->Push ( tPushed ); } );
+
+		// stringptr expressions should be duplicated (or taken over) at this point
+		if_const ( HAS_FILTER_CALC )
+			tCtx.FreeDataFilter ( tPushed );
+
+		if_const ( HAS_SORT_CALC )
+			tCtx.FreeDataSort ( tPushed );
+
+		if_const ( HAS_CUTOFF )
 		{
-			tMatch.m_tRowID = i;
-			tMatch.m_pStatic = fnToStatic(i);
+			if ( bNewMatch && --iCutoff==0 )
+				return false;
+		}
 
-			// early filter only (no late filters in full-scan because of no @weight)
-			if_const ( HAS_FILTER_CALC )
-				tCtx.CalcFilter(tMatch);
+		// handle timer
+		if_const ( HAS_MAX_TIMER )
+		{
+			if ( sph::TimeExceeded ( tmMaxTimer ) )
+			{
+				tMeta.m_sWarning = "query time exceeded max_query_time";
+				return false;
+			}
+		}
 
-			if_const ( HAS_FILTER )
+		return true;
+	};
+
+	RowIdBlock_t dRowIDs;
+	if_const ( !HAS_FILTER_CALC && ( HAS_FILTER || HAS_SORT_CALC ) )
+	{
+		// filters only need static attributes here, so evaluate them over a whole batch of rows at once
+		CSphFixedVector<const CSphRowitem *> dRows ( FULLSCAN_BATCH );
+		CSphFixedVector<int> dSelected ( FULLSCAN_BATCH );
+
+		// sort expressions are computed over the batch of passed rows too, so each of those needs a match of its own
+		CSphFixedVector<CSphMatch> dMatches ( HAS_SORT_CALC ? FULLSCAN_BATCH : 0 );
+		CSphFixedVector<CSphMatch *> dBatch ( HAS_SORT_CALC ? FULLSCAN_BATCH : 0 );
+		int iDynamic = HAS_SORT_CALC ? dSorters[GetMaxSchemaIndexAndMatchCapacity ( dSorters ).first]->GetSchema()->GetDynamicSize() : 0;
+		int iPrepared = 0; // matches are set up lazily, as short row ranges never need the whole batch
+
+		while ( !bStop && tIterator.GetNextRowIdBlock(dRowIDs) )
+			for ( int iStart = 0; iStart<dRowIDs.GetLength() && !bStop; iStart += FULLSCAN_BATCH )
 			{
-				if ( !tCtx.m_pFilter->Eval(tMatch) )
+				const RowID_t * pRowIDs = dRowIDs.Begin() + iStart;
+				int iRows = Min ( FULLSCAN_BATCH, dRowIDs.GetLength()-iStart );
+				for ( int i = 0; i < iRows; i++ )
 				{
-					if_const ( HAS_FILTER_CALC )
-						tCtx.FreeDataFilter ( tMatch );
+					dRows[i] = fnToStatic ( pRowIDs[i] );
+					dSelected[i] = i;
+				}
+
+				int iPassed = iRows;
+				if_const ( HAS_FILTER )
+					iPassed = tCtx.m_pFilter->EvalBatch ( tMatch, pRowIDs, dRows.Begin(), dSelected.Begin(), iRows );
+
+				if_const ( !HAS_SORT_CALC )
+				{
+					for ( int i = 0; i < iPassed; i++ )
+					{
+						int iRow = dSelected[i];
+						tMatch.m_tRowID = pRowIDs[iRow];
+						tMatch.m_pStatic = dRows[iRow];
+						if_const ( HAS_RANDOMIZE )
+							tMatch.m_iWeight = ( sphRand() & 0xffff ) * iIndexWeight;
+
+						if ( !fnPush ( tMatch ) )
+						{
+							bStop = true;
+							break;
+						}
+					}
 
 					continue;
 				}
-			}
-
-			if_const ( HAS_RANDOMIZE )
-				tMatch.m_iWeight = ( sphRand() & 0xffff ) * iIndexWeight;
 
-			if_const ( HAS_SORT_CALC )
-				tCtx.CalcSort(tMatch);
+				for ( ; iPrepared < iPassed; iPrepared++ )
+				{
+					dMatches[iPrepared].Reset ( iDynamic );
+					dMatches[iPrepared].m_iTag = tMatch.m_iTag;
+					dMatches[iPrepared].m_iWeight = tMatch.m_iWeight;
+				}
 
-			bool bNewMatch = false;
-			dSorters.Apply ( [&tMatch, &bNewMatch] ( ISphMatchSorter * p ) { bNewMatch |= p->Push ( tMatch ); } );
+				for ( int i = 0; i < iPassed; i++ )
+				{
+					int iRow = dSelected[i];
+					CSphMatch & tBatched = dMatches[i];
+					tBatched.m_tRowID = pRowIDs[iRow];
+					tBatched.m_pStatic = dRows[iRow];
+					if_const ( HAS_RANDOMIZE )
+						tBatched.m_iWeight = ( sphRand() & 0xffff ) * iIndexWeight;
+
+					dBatch[i] = &tBatched;
+				}
 
-			// stringptr expressions should be duplicated (or taken over) at this point
-			if_const ( HAS_FILTER_CALC )
-				tCtx.FreeDataFilter ( tMatch );
+				tCtx.CalcSortBatch ( dBatch.Begin(), iPassed );
 
-			if_const ( HAS_SORT_CALC )
-				tCtx.FreeDataSort ( tMatch );
+				for ( int i = 0; i < iPassed; i++ )
+					if ( !fnPush ( *dBatch[i] ) )
+					{
+						// the rest of the batch is not going to be pushed, but its sort data was already computed
+						for ( int j = i+1; j < iPassed; j++ )
+							tCtx.FreeDataSort ( *dBatch[j] );
 
-			if_const ( HAS_CUTOFF )
+						bStop = true;
+						break;
+					}
+			}
+	}
+	else
+	{
+		while ( !bStop && tIterator.GetNextRowIdBlock(dRowIDs) )
+			for ( auto & i : dRowIDs )
 			{
-				if ( bNewMatch && --iCutoff==0 )
+				tMatch.m_tRowID = i;
+				tMatch.m_pStatic = fnToStatic(i);
+
+				// early filter only (no late filters in full-scan because of no @weight)
+				if_const ( HAS_FILTER_CALC )
+					tCtx.CalcFilter(tMatch);
+
+				if_const ( HAS_FILTER )
 				{
-					bStop = true;
-					break;
+					if ( !tCtx.m_pFilter->Eval(tMatch) )
+					{
+						if_const ( HAS_FILTER_CALC )
+							tCtx.FreeDataFilter ( tMatch );
+
+						continue;
+					}
 				}
-			}
 
-			// handle timer
-			if_const ( HAS_MAX_TIMER )
-			{
-				if ( sph::TimeExceeded ( tmMaxTimer ) )
+				if_const ( HAS_RANDOMIZE )
+					tMatch.m_iWeight = ( sphRand() & 0xffff ) * iIndexWeight;
+
+				if_const ( HAS_SORT_CALC )
+					tCtx.CalcSort(tMatch);
+
+				if ( !fnPush ( tMatch ) )
 				{
-					tMeta.m_sWarning = "query time exceeded max_query_time";
 					bStop = true;
 					break;
 				}
 			}
-		}
+	}
 
 	tMeta.m_tStats.m_iFetchedDocs = tIterator.GetNumProcessed();
 }
@@ -12669,20 +13040,31 @@ void CSphIndex_VLN::RunFullscanOnIterator ( RowidIterator_i * pIterator, const C
 }
 
 
-void CSphIndex_VLN::ScanByBlocks ( const CSphQueryContext & tCtx, CSphQueryResultMeta & tMeta, const VecTraits_T<ISphMatchSorter *> & dSorters, CSphMatch & tMatch, int iCutoff, bool bRandomize,
+void CSphIndex_VLN::ScanByBlocks ( RowID_t tStart, RowID_t tEnd, const CSphQueryContext & tCtx, CSphQueryResultMeta & tMeta, const VecTraits_T<ISphMatchSorter *> & dSorters, CSphMatch & tMatch, int iCutoff, bool bRandomize,
 	int iIndexWeight, int64_t tmMaxTimer ) const
 {
 	int iStride = m_tSchema.GetRowSize();
-	for ( int64_t iIndexEntry=0; iIndexEntry!=m_iDocinfoIndex; iIndexEntry++ )
+	int64_t iFirstEntry = tStart/DOCINFO_INDEX_FREQ;
+	int64_t iLastEntry = Min ( ( int64_t(tEnd)+DOCINFO_INDEX_FREQ-1 )/DOCINFO_INDEX_FREQ, m_iDocinfoIndex );
+	int64_t iIndexEntry = iFirstEntry;
+	while ( iIndexEntry<iLastEntry )
 	{
 		// block-level filtering
 		const DWORD * pMin = &m_pDocinfoIndex[ iIndexEntry*iStride*2 ];
 		const DWORD * pMax = pMin + iStride;
 		if ( tCtx.m_pFilter && !tCtx.m_pFilter->EvalBlock ( pMin, pMax ) )
+		{
+			iIndexEntry++;
 			continue;
+		}
+
+		// glue adjacent passing blocks together so that row filters get bigger batches
+		int64_t iRunStart = iIndexEntry++;
+		while ( iIndexEntry<iLastEntry && ( !tCtx.m_pFilter || tCtx.m_pFilter->EvalBlock ( &m_pDocinfoIndex[ iIndexEntry*iStride*2 ], &m_pDocinfoIndex[ iIndexEntry*iStride*2 ] + iStride ) ) )
+			iIndexEntry++;
 
-		RowID_t tBlockStart = iIndexEntry*DOCINFO_INDEX_FREQ;
-		RowID_t tBlockEnd = Min ( ( iIndexEntry+1 )*DOCINFO_INDEX_FREQ, m_iDocinfo );
+		RowID_t tBlockStart = Max ( RowID_t ( iRunStart*DOCINFO_INDEX_FREQ ), tStart );
+		RowID_t tBlockEnd = Min ( RowID_t ( Min ( iIndexEntry*DOCINFO_INDEX_FREQ, m_iDocinfo ) ), tEnd );
 
 		bool bStop = false;
 		RunFullscanOnAttrs ( tBlockStart, tBlockEnd, tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, iIndexWeight, tmMaxTimer, bStop );
@@ -12736,6 +13118,18 @@ RowidIterator_i * CSphIndex_VLN::CreateColumnarAnalyzerOrPrefilter ( const CSphV
 }
 #endif // USE_COLUMNAR
 
+static void AddAccessPlan ( QueryProfile_c * pProfile, const char * szIndex, const AccessPlan_t & tPlan )
+{
+	if ( !pProfile )
+		return;
+
+	StringBuilder_c sPlan;
+	sPlan << szIndex << ": ";
+	tPlan.Format ( sPlan );
+	pProfile->AddAccessPlan ( sPlan.cstr() );
+}
+
+
 bool CSphIndex_VLN::MultiScan ( CSphQueryResult & tResult, const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *> & dSorters, const CSphMultiQueryArgs & tArgs ) const
 {
 	assert ( tArgs.m_iTag>=0 );
@@ -12766,6 +13160,13 @@ bool CSphIndex_VLN::MultiScan ( CSphQueryResult & tResult, const CSphQuery & tQu
 	if ( m_bIsEmpty || m_iDocinfo<=0 )
 		return true;
 
+	// pseudo-shard scans only rows of its own range
+	RowID_t tStart = tArgs.m_tMinRowID;
+	RowID_t tEnd = RowID_t ( Min ( (int64_t)tArgs.m_tMaxRowID, m_iDocinfo ) );
+	bool bFirstShard = tStart==0;
+	if ( tStart>=tEnd )
+		return true;
+
 	// start counting
 	int64_t tmQueryStart = sphMicroTimer();
 	int64_t tmCpuQueryStart = sphTaskCpuTimer();
@@ -12856,7 +13257,12 @@ bool CSphIndex_VLN::MultiScan ( CSphQueryResult & tResult, const CSphQuery & tQu
 	// try to spawn an iterator from a secondary index
 	bool bFiltersChanged = false;
 	if ( m_pHistograms )
-		pIterator = CreateFilteredIterator ( tQuery.m_dFilters, dModifiedFilters, bFiltersChanged, tQuery.m_dFilterTree, tQuery.m_dIndexHints, *m_pHistograms, m_tDocidLookup.GetWritePtr() );
+	{
+		AccessPlan_t tPlan;
+		pIterator = CreateFilteredIterator ( tQuery.m_dFilters, dModifiedFilters, bFiltersChanged, tQuery.m_dFilterTree, tQuery.m_dIndexHints, *m_pHistograms, m_tDocidLookup.GetWritePtr(), &m_tSecondaryIndex, tQuery.m_eCollation, tPlan );
+		if ( bFirstShard )
+			AddAccessPlan ( tMeta.m_pProfile, GetName(), tPlan );
+	}
 
 #if USE_COLUMNAR
 	// try to spawn a columnar iterator
@@ -12870,12 +13276,14 @@ bool CSphIndex_VLN::MultiScan ( CSphQueryResult & tResult, const CSphQuery & tQu
 		// one or several filters got replaced by an iterator, need to re-create the remaining filters
 		if ( bFiltersChanged )
 		{
-			SafeDelete ( tCtx.m_pFilter );
+			tCtx.ResetFilters();
 			tFlx.m_pFilters = &dModifiedFilters;
 			tCtx.CreateFilters ( tFlx, tMeta.m_sError, tMeta.m_sWarning );
 		}
 
-		RunFullscanOnIterator ( pIterator.Ptr(), tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, tArgs.m_iIndexWeight, tmMaxTimer );
+		// iterators are not split into ranges; the first pseudo-shard runs the whole of it
+		if ( bFirstShard )
+			RunFullscanOnIterator ( pIterator.Ptr(), tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, tArgs.m_iIndexWeight, tmMaxTimer );
 	}
 	else
 	{
@@ -12887,10 +13295,10 @@ bool CSphIndex_VLN::MultiScan ( CSphQueryResult & tResult, const CSphQuery & tQu
 		if ( bAllColumnar )
 		{
 			bool bStop = false;
-			RunFullscanOnAttrs ( 0, m_iDocinfo, tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, tArgs.m_iIndexWeight, tmMaxTimer, bStop );
+			RunFullscanOnAttrs ( tStart, tEnd, tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, tArgs.m_iIndexWeight, tmMaxTimer, bStop );
 		}
 		else
-			ScanByBlocks ( tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, tArgs.m_iIndexWeight, tmMaxTimer );
+			ScanByBlocks ( tStart, tEnd, tCtx, tMeta, dSorters, tMatch, iCutoff, bRandomize, tArgs.m_iIndexWeight, tmMaxTimer );
 	}
 
 	SwitchProfile ( tMeta.m_pProfile, SPH_QSTATE_FINALIZE );
@@ -13004,39 +13412,47 @@ bool DiskIndexQwordSetup_c::Setup ( ISphQword * pWord ) const
 			return false;
 	}
 
-	const CSphWordlistCheckpoint * pCheckpoint = pIndex->m_tWordlist.FindCheckpoint ( sWord, iWordLen, tWord.m_uWordID, false );
-	if ( !pCheckpoint )
-		return false;
-
-	// decode wordlist chunk
-	const BYTE * pBuf = pIndex->m_tWordlist.AcquireDict ( pCheckpoint );
-	assert ( pBuf );
-
-	assert ( m_iSkiplistBlockSize>0 );
-
 	CSphDictEntry tRes;
-	if ( bWordDict )
+	if ( bWordDict && pIndex->m_tWordlist.IsPreloaded() )
 	{
-		KeywordsBlockReader_c tCtx ( pBuf, m_iSkiplistBlockSize );
-		while ( tCtx.UnpackWord() )
-		{
-			// block is sorted
-			// so once keywords are greater than the reference word, no more matches
-			assert ( tCtx.GetWordLen()>0 );
-			int iCmp = sphDictCmpStrictly ( sWord, iWordLen, tCtx.GetWord(), tCtx.GetWordLen() );
-			if ( iCmp<0 )
-				return false;
-			if ( iCmp==0 )
-				break;
-		}
-		if ( tCtx.GetWordLen()<=0 )
+		if ( !pIndex->m_tWordlist.FindWord ( sWord, iWordLen, tRes ) )
 			return false;
-		tRes = tCtx;
 
 	} else
 	{
-		if ( !pIndex->m_tWordlist.GetWord ( pBuf, tWord.m_uWordID, tRes ) )
+		const CSphWordlistCheckpoint * pCheckpoint = pIndex->m_tWordlist.FindCheckpoint ( sWord, iWordLen, tWord.m_uWordID, false );
+		if ( !pCheckpoint )
 			return false;
+
+		// decode wordlist chunk
+		const BYTE * pBuf = pIndex->m_tWordlist.AcquireDict ( pCheckpoint );
+		assert ( pBuf );
+
+		assert ( m_iSkiplistBlockSize>0 );
+
+		if ( bWordDict )
+		{
+			KeywordsBlockReader_c tCtx ( pBuf, m_iSkiplistBlockSize );
+			while ( tCtx.UnpackWord() )
+			{
+				// block is sorted
+				// so once keywords are greater than the reference word, no more matches
+				assert ( tCtx.GetWordLen()>0 );
+				int iCmp = sphDictCmpStrictly ( sWord, iWordLen, tCtx.GetWord(), tCtx.GetWordLen() );
+				if ( iCmp<0 )
+					return false;
+				if ( iCmp==0 )
+					break;
+			}
+			if ( tCtx.GetWordLen()<=0 )
+				return false;
+			tRes = tCtx;
+
+		} else
+		{
+			if ( !pIndex->m_tWordlist.GetWord ( pBuf, tWord.m_uWordID, tRes ) )
+				return false;
+		}
 	}
 
 	const ESphHitless eMode = pIndex->m_tSettings.m_eHitless;
@@ -13072,7 +13488,9 @@ bool DiskIndexQwordSetup_c::Setup ( ISphQword * pWord ) const
 			}
 		}
 
+		// start fetching the doclist now, so that all the query terms are read from disk in parallel
 		tWord.m_rdDoclist->SeekTo ( tRes.m_iDoclistOffset, tRes.m_iDoclistHint );
+		tWord.m_rdDoclist->ReadAhead ( tRes.m_iDoclistOffset, tRes.m_iDoclistHint );
 		tWord.SetHitReader ( m_pHitlist );
 	}
 
@@ -13190,6 +13608,7 @@ void CSphIndex_VLN::Dealloc ()
 	m_tWordlist.Reset ();
 	m_tDeadRowMap.Dealloc();
 	m_tDocidLookup.Reset();
+	m_tSecondaryIndex.Reset();
 	m_pDocstore.Reset();
 
 	m_iDocinfo = 0;
@@ -13657,6 +14076,9 @@ bool CSphIndex_VLN::PreallocWordlist()
 	if ( ( m_tWordlist.m_tBuf.GetLengthBytes()<=1 )!=( m_tWordlist.m_dCheckpoints.GetLength()==0 ) )
 		sphWarning ( "wordlist size mismatch (size=%zu, checkpoints=%d)", m_tWordlist.m_tBuf.GetLengthBytes(), m_tWordlist.m_dCheckpoints.GetLength() );
 
+	if ( bWordDict && m_tMutableSettings.m_bPreloadDict )
+		m_tWordlist.PreloadWords();
+
 	// make sure checkpoints are loadable
 	// pre-11 indices use different offset type (this is fixed up later during the loading)
 	assert ( m_tWordlist.m_iDictCheckpointsOffset>0 );
@@ -13742,6 +14164,28 @@ bool CSphIndex_VLN::PreallocHistograms ( StrVec_t & dWarnings )
 }
 
 
+bool CSphIndex_VLN::PreallocSecondaryIndex ( StrVec_t & dWarnings )
+{
+	if ( m_bIsEmpty || m_bDebugCheck )
+		return true;
+
+	bool bHaveIndexes = false;
+	for ( int i = 0; i < m_tSchema.GetAttrsCount() && !bHaveIndexes; i++ )
+		bHaveIndexes = IsSecondaryIndexAttr ( m_tSchema.GetAttr(i) );
+
+	CSphString sFile = GetIndexFileName(SPH_EXT_SPIDX);
+	if ( !bHaveIndexes || !sphIsReadable ( sFile.cstr() ) )
+		return true;
+
+	// secondary indexes are optional; fall back to fullscan if they are broken
+	CSphString sError;
+	if ( !m_tSecondaryIndex.Setup ( sFile, m_tSchema, (DWORD)m_iDocinfo, sError ) )
+		dWarnings.Add(sError);
+
+	return true;
+}
+
+
 bool CSphIndex_VLN::PreallocDocstore()
 {
 	if ( m_uVersion<57 )
@@ -13813,6 +14257,7 @@ bool CSphIndex_VLN::Prealloc ( bool bStripPath, FilenameBuilder_i * pFilenameBui
 	if ( !PreallocDocidLookup() )	return false;
 	if ( !PreallocKilllist() )		return false;
 	if ( !PreallocHistograms(dWarnings) ) return false;
+	if ( !PreallocSecondaryIndex(dWarnings) ) return false;
 	if ( !PreallocDocstore() )		return false;
 
 #if USE_COLUMNAR
@@ -13847,6 +14292,7 @@ void CSphIndex_VLN::Preread()
 	PrereadMapping ( m_sIndexName.cstr(), "skip-list", IsMlock ( m_tMutableSettings.m_tFileAccess.m_eAttr ), false, m_tSkiplists );
 	PrereadMapping ( m_sIndexName.cstr(), "dictionary", IsMlock ( m_tMutableSettings.m_tFileAccess.m_eAttr ), false, m_tWordlist.m_tBuf );
 	PrereadMapping ( m_sIndexName.cstr(), "docid-lookup", IsMlock ( m_tMutableSettings.m_tFileAccess.m_eAttr ), false, m_tDocidLookup );
+	PrereadMapping ( m_sIndexName.cstr(), "secondary-index", IsMlock ( m_tMutableSettings.m_tFileAccess.m_eAttr ), false, m_tSecondaryIndex.GetBuffer() );
 	m_tDeadRowMap.Preread ( m_sIndexName.cstr(), "kill-list", IsMlock ( m_tMutableSettings.m_tFileAccess.m_eAttr ) );
 
 	m_bPassedRead = true;
@@ -15358,6 +15804,100 @@ void sphTransformExtendedQuery ( XQNode_t ** ppNode, const CSphIndexSettings & t
 		sphOptimizeBoolean ( ppNode, pKeywords );
 }
 
+// don't bother splitting indexes smaller than that
+static const int64_t PSEUDO_SHARD_MIN_ROWS = 65536;
+
+int CSphIndex_VLN::GetPseudoShards ( const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *> & dSorters, const CSphMultiQueryArgs & tArgs ) const
+{
+	if ( tArgs.m_iConcurrency<=1 || m_bIsEmpty )
+		return 1;
+
+	// already a pseudo-shard
+	if ( tArgs.m_tMinRowID!=0 || tArgs.m_tMaxRowID!=INVALID_ROWID )
+		return 1;
+
+	// packed factors are stored in the ranker-owned pool and can't be moved between sorters
+	if ( tArgs.m_uPackedFactorFlags & SPH_FACTOR_ENABLE )
+		return 1;
+
+	// cutoff counts matches of the whole query in rowid order; every shard would apply it on its own
+	if ( tQuery.m_iCutoff>0 )
+		return 1;
+
+	if ( !dSorters.all_of ( [] ( const ISphMatchSorter * p ) { return p->CanBeCloned(); } ) )
+		return 1;
+
+	return (int)Max ( 1, Min ( (int64_t)tArgs.m_iConcurrency, m_iDocinfo/PSEUDO_SHARD_MIN_ROWS ) );
+}
+
+/// split the rowid space into ranges and search them in parallel, each one with its own clone of the sorters
+bool CSphIndex_VLN::PseudoShardedQuery ( CSphQueryResult & tResult, const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *> & dSorters, const CSphMultiQueryArgs & tArgs, int iShards ) const
+{
+	auto & tMeta = *tResult.m_pMeta;
+	int64_t tmStart = sphMicroTimer();
+
+	// align ranges to docinfo blocks so that block-level filtering still works in fullscan
+	int64_t iShardRows = ( m_iDocinfo+iShards-1 ) / iShards;
+	iShardRows = ( ( iShardRows+DOCINFO_INDEX_FREQ-1 ) / DOCINFO_INDEX_FREQ ) * DOCINFO_INDEX_FREQ;
+
+	VecTraits_T<ISphMatchSorter *> dShardSorters = dSorters;
+	Threads::ClonableCtx_T<SearchCtx_t, SearchCloneCtx_t> dCtx { dShardSorters, tMeta, true };
+	dCtx.LimitConcurrency ( iShards );
+
+	std::atomic<bool> bInterrupt {false};
+	std::atomic<int32_t> iCurShard { 0 };
+	Threads::CoExecuteN ( dCtx.Concurrency ( iShards ), tArgs.m_bNoYeld, [&]
+	{
+		auto iShard = iCurShard.fetch_add ( 1, std::memory_order_acq_rel );
+		if ( iShard>=iShards || bInterrupt )
+			return; // already nothing to do, early finish.
+
+		auto tCtx = dCtx.CloneNewContext();
+		while ( !bInterrupt )
+		{
+			CSphQueryResultMeta tShardMeta;
+			CSphQueryResult tShardResult;
+			tShardResult.m_pMeta = &tShardMeta;
+			tShardMeta.m_pProfile = tCtx.m_tMeta.m_pProfile;
+			tShardMeta.m_bHasPrediction = tCtx.m_tMeta.m_bHasPrediction;
+
+			CSphMultiQueryArgs tShardArgs ( tArgs.m_iIndexWeight );
+			tShardArgs.m_iTag = tArgs.m_iTag;
+			tShardArgs.m_uPackedFactorFlags = tArgs.m_uPackedFactorFlags;
+			tShardArgs.m_bLocalDF = tArgs.m_bLocalDF;
+			tShardArgs.m_pLocalDocs = tArgs.m_pLocalDocs;
+			tShardArgs.m_iTotalDocs = tArgs.m_iTotalDocs;
+			tShardArgs.m_bNoYeld = tArgs.m_bNoYeld;
+			tShardArgs.m_bModifySorterSchemas = false; // that is done once, after all the shards are merged
+			tShardArgs.m_tMinRowID = RowID_t ( iShard*iShardRows );
+			tShardArgs.m_tMaxRowID = RowID_t ( Min ( ( iShard+1 )*iShardRows, m_iDocinfo ) );
+
+			bInterrupt = !MultiQuery ( tShardResult, tQuery, tCtx.m_dSorters, tShardArgs );
+			tCtx.MergeMeta ( tShardMeta );
+
+			iShard = iCurShard.fetch_add ( 1, std::memory_order_acq_rel );
+			if ( iShard>=iShards )
+				return; // all is done
+		}
+	});
+	dCtx.Finalize();
+
+	if ( !tMeta.m_sError.IsEmpty() )
+		return false;
+
+	if ( tArgs.m_bModifySorterSchemas )
+	{
+		SwitchProfile ( tMeta.m_pProfile, SPH_QSTATE_DYNAMIC );
+		PooledAttrsToPtrAttrs ( dSorters, m_tBlobAttrs.GetWritePtr() );
+	}
+
+	tResult.m_pBlobPool = m_tBlobAttrs.GetWritePtr();
+	tResult.m_pDocstore = m_pDocstore.Ptr() ? this : nullptr;
+	tMeta.m_iQueryTime += (int)( ( sphMicroTimer()-tmStart )/1000 );
+	return true;
+}
+
+
 /// one regular query vs many sorters (like facets, or similar for common-tree optimization)
 bool CSphIndex_VLN::MultiQuery ( CSphQueryResult & tResult, const CSphQuery & tQuery, const VecTraits_T<ISphMatchSorter *> & dAllSorters, const CSphMultiQueryArgs & tArgs ) const
 {
@@ -15378,6 +15918,18 @@ bool CSphIndex_VLN::MultiQuery ( CSphQueryResult & tResult, const CSphQuery & tQ
 	// non-random at the start, random at the end
 	dSorters.Sort ( CmpPSortersByRandom_fn() );
 
+	// cached matches are only served to the whole rowid range, and replaying them is cheap anyway
+	// the found entry goes right to the ranker, so that it is not looked up again
+	int iShards = GetPseudoShards ( tQuery, dSorters, tArgs );
+	QcacheEntryRefPtr_t pCached;
+	if ( iShards>1 )
+		pCached = QcacheFind ( m_iIndexId, tQuery, *dSorters[GetMaxSchemaIndexAndMatchCapacity ( dSorters ).first]->GetSchema() );
+	if ( pCached )
+		iShards = 1;
+
+	if ( iShards>1 )
+		return PseudoShardedQuery ( tResult, tQuery, dSorters, tArgs, iShards );
+
 	const QueryParser_i * pQueryParser = tQuery.m_pQueryParser;
 	assert ( pQueryParser );
 
@@ -15456,7 +16008,7 @@ bool CSphIndex_VLN::MultiQuery ( CSphQueryResult & tResult, const CSphQuery & tQ
 	tParsed.m_bNeedSZlist = tQuery.m_bZSlist;
 
 	CSphQueryNodeCache tNodeCache ( iCommonSubtrees, m_iMaxCachedDocs, m_iMaxCachedHits );
-	bool bResult = ParsedMultiQuery ( tQuery, tResult, dSorters, tParsed, pDict, tArgs, &tNodeCache );
+	bool bResult = ParsedMultiQuery ( tQuery, tResult, dSorters, tParsed, pDict, tArgs, &tNodeCache, pCached );
 
 	if ( tArgs.m_bModifySorterSchemas )
 	{
@@ -15662,7 +16214,7 @@ bool CSphIndex_VLN::CheckEarlyReject ( const CSphVector<CSphFilterSettings> & dF
 
 
 bool CSphIndex_VLN::ParsedMultiQuery ( const CSphQuery & tQuery, CSphQueryResult & tResult, const VecTraits_T<ISphMatchSorter *> & dSorters, const XQQuery_t & tXQ, CSphDict * pDict,
-	const CSphMultiQueryArgs & tArgs, CSphQueryNodeCache * pNodeCache ) const
+	const CSphMultiQueryArgs & tArgs, CSphQueryNodeCache * pNodeCache, QcacheEntry_c * pCached ) const
 {
 	assert ( !tQuery.m_sQuery.IsEmpty() && tQuery.m_eMode!=SPH_MATCH_FULLSCAN ); // scans must go through MultiScan()
 	assert ( tArgs.m_iTag>=0 );
@@ -15702,6 +16254,12 @@ bool CSphIndex_VLN::ParsedMultiQuery ( const CSphQuery & tQuery, CSphQueryResult
 	tCtx.m_pLocalDocs = tArgs.m_pLocalDocs;
 	tCtx.m_iTotalDocs = ( tArgs.m_iTotalDocs ? tArgs.m_iTotalDocs : m_tStats.m_iTotalDocuments );
 	tCtx.m_pIndexSegment = this;
+	tCtx.m_pQcacheEntry = pCached;
+
+	// pseudo-shards only see a part of the matches, so they must not be cached as the whole result
+	bool bRowRange = tArgs.m_tMinRowID!=0 || tArgs.m_tMaxRowID!=INVALID_ROWID;
+	if ( bRowRange )
+		tCtx.m_bSkipQCache = true;
 
 #if USE_COLUMNAR
 	if ( !tCtx.SetupCalc ( tMeta, tMaxSorterSchema, m_tSchema, m_tBlobAttrs.GetWritePtr(), m_pColumnar.Ptr(), dSorterSchemas ) ) return false;
@@ -15821,6 +16379,42 @@ bool CSphIndex_VLN::ParsedMultiQuery ( const CSphQuery & tQuery, CSphQueryResult
 		return true;
 	}
 
+	// filters served by docid lookup or secondary indexes might be cheaper to push down into the full-text tree
+	// we don't modify the original filters because iterators may use some data from them (to avoid copying)
+	CSphVector<CSphFilterSettings> dModifiedFilters;
+	if ( m_pHistograms && pRanker->GetDocsEstimate()>=0 )
+	{
+		AccessPlan_t tPlan;
+		tPlan.m_iFulltextDocs = pRanker->GetDocsEstimate();
+
+		bool bFiltersChanged = false;
+		CSphScopedPtr<RowidIterator_i> pIterator ( CreateFilteredIterator ( tQuery.m_dFilters, dModifiedFilters, bFiltersChanged, tQuery.m_dFilterTree, tQuery.m_dIndexHints, *m_pHistograms, m_tDocidLookup.GetWritePtr(), &m_tSecondaryIndex, tQuery.m_eCollation, tPlan ) );
+		if ( pIterator.Ptr() && pRanker->PushRowidFilter ( pIterator.Ptr() ) )
+		{
+			// ranker owns the iterator now, and reads rows from it while matching
+			pIterator.LeakPtr();
+
+			// pushed down filters got replaced by the iterator, need to re-create the remaining filters
+			// (along with weight filter and user variables they refer to)
+			if ( bFiltersChanged )
+			{
+				tCtx.ResetFilters();
+				tFlx.m_pFilters = &dModifiedFilters;
+				if ( !tCtx.CreateFilters ( tFlx, tMeta.m_sError, tMeta.m_sWarning ) )
+					return false;
+			}
+		}
+		else
+			tPlan.m_ePath = AccessPath_e::FULLTEXT;
+
+		if ( !tArgs.m_tMinRowID )
+			AddAccessPlan ( pProfile, GetName(), tPlan );
+	}
+
+	// restrict pseudo-shard to its own row range; if ranker can't do that, only the first shard does the whole job
+	if ( bRowRange && !pRanker->SetRowRange ( tArgs.m_tMinRowID, tArgs.m_tMaxRowID ) && tArgs.m_tMinRowID )
+		return true;
+
 	for ( auto & i : dSorters )
 	{
 		i->SetBlobPool ( m_tBlobAttrs.GetWritePtr() );
@@ -15952,6 +16546,15 @@ void CSphIndex_VLN::CreateReader ( int64_t iSessionId ) const
 }
 
 
+void DocstoreReader_i::GetDocs ( const VecTraits_T<DocID_t> & dDocIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs, CSphBitvec & tFound ) const
+{
+	assert ( dDocIDs.GetLength()==dDocs.GetLength() && tFound.GetBits()>=dDocIDs.GetLength() );
+	ARRAY_FOREACH ( i, dDocIDs )
+		if ( GetDoc ( dDocs[i], dDocIDs[i], pFieldIds, iSessionId, bPack ) )
+			tFound.BitSet(i);
+}
+
+
 bool CSphIndex_VLN::GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const
 {
 	if ( !m_pDocstore.Ptr() )
@@ -15966,6 +16569,35 @@ bool CSphIndex_VLN::GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTrai
 }
 
 
+void CSphIndex_VLN::GetDocs ( const VecTraits_T<DocID_t> & dDocIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs, CSphBitvec & tFound ) const
+{
+	assert ( dDocIDs.GetLength()==dDocs.GetLength() && tFound.GetBits()>=dDocIDs.GetLength() );
+	if ( !m_pDocstore.Ptr() )
+		return;
+
+	CSphVector<RowID_t> dRowIDs;
+	CSphVector<int> dFetched;
+	ARRAY_FOREACH ( i, dDocIDs )
+	{
+		RowID_t tRowID = GetRowidByDocid ( dDocIDs[i] );
+		if ( tRowID==INVALID_ROWID || m_tDeadRowMap.IsSet(tRowID) )
+			continue;
+
+		dRowIDs.Add ( tRowID );
+		dFetched.Add(i);
+	}
+
+	CSphFixedVector<DocstoreDoc_t> dFetchedDocs ( dRowIDs.GetLength() );
+	m_pDocstore->GetDocs ( dRowIDs, pFieldIds, iSessionId, bPack, dFetchedDocs );
+
+	ARRAY_FOREACH ( i, dFetched )
+	{
+		dDocs[dFetched[i]] = std::move ( dFetchedDocs[i] );
+		tFound.BitSet ( dFetched[i] );
+	}
+}
+
+
 int CSphIndex_VLN::GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const
 {
 	if ( !m_pDocstore.Ptr() )
@@ -16015,7 +16647,8 @@ void CSphIndex_VLN::GetStatus ( CSphIndexStatus* pRes ) const
 		pRes->m_iMappedResident += pRes->m_iMappedResidentHits;
 	}
 
-	pRes->m_iRamUse = sizeof(CSphIndex_VLN) + m_dFieldLens.GetLengthBytes() + pRes->m_iMappedResident;
+	pRes->m_iPreloadedDict = m_tWordlist.GetPreloadedBytes();
+	pRes->m_iRamUse = sizeof(CSphIndex_VLN) + m_dFieldLens.GetLengthBytes() + pRes->m_iMappedResident + pRes->m_iPreloadedDict;
 	pRes->m_iDiskUse = 0;
 
 	CSphVector<IndexFileExt_t> dExts = sphGetExts();
@@ -16682,7 +17315,11 @@ void CSphIndex_VLN::CollectFiles ( StrVec_t & dFiles, StrVec_t & dExt ) const
 	if ( m_uVersion>=57 && m_tSchema.HasStoredFields() )
 		dFiles.Add ( GetIndexFileName ( SPH_EXT_SPDS ) );
 
-	CSphString sPath = GetIndexFileName ( SPH_EXT_SPK );
+	CSphString sPath = GetIndexFileName ( SPH_EXT_SPIDX );
+	if ( sphIsReadable ( sPath ) )
+		dFiles.Add ( sPath );
+
+	sPath = GetIndexFileName ( SPH_EXT_SPK );
 	if ( sphIsReadable ( sPath ) )
 		dFiles.Add ( sPath );
 }
@@ -20000,6 +20637,20 @@ public:
 		return 0;
 	}
 
+	SphWordID_t AddPackedKeyword ( const BYTE * pPacked ) final
+	{
+		int iLen = *pPacked;
+		BYTE sWord[SPH_MAX_WORD_LEN*3+1];
+		memcpy ( sWord, pPacked+1, iLen );
+		sWord[iLen] = '\0';
+
+		SphWordID_t tWordID = 0;
+		if ( m_bStoreID )
+			memcpy ( &tWordID, pPacked+1+iLen, sizeof(tWordID) );
+
+		return AddKeyword ( sWord, tWordID );
+	}
+
 	const BYTE * GetPackedKeywords () final { return m_dPackedKeywords.Begin(); }
 	int GetPackedLen () final { return m_dPackedKeywords.GetLength(); }
 	void ResetKeywords() final
@@ -21758,6 +22409,7 @@ void CSphSource::Setup ( const CSphSourceSettings & tSettings )
 	m_dStoredOnlyFields = tSettings.m_dStoredOnlyFields;
 	m_dColumnarAttrs = tSettings.m_dColumnarAttrs;
 	m_dColumnarStringsNoHash = tSettings.m_dColumnarStringsNoHash;
+	m_dSecondaryIndexes = tSettings.m_dSecondaryIndexes;
 	m_bIndexFieldLens = tSettings.m_bIndexFieldLens;
 
 	m_tSchema.SetupFlags ( *this );
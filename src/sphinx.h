@@ -142,6 +142,9 @@ void			sphSleepMsec ( int iMsec );
 /// set throttling options
 void			sphSetThrottling ( int iMaxIOps, int iMaxIOSize );
 
+/// set max threads for CPU-heavy index build stages (hit blocks sorting)
+void			sphSetIndexerThreads ( int iThreads );
+
 /// write blob to file honoring throttling
 bool			sphWriteThrottled ( int iFD, const void* pBuf, int64_t iCount, const char* sName, CSphString& sError );
 
@@ -1330,8 +1333,10 @@ struct CSphColumnInfo
 
 #if USE_COLUMNAR
 		ATTR_COLUMNAR			= 1<<0,
-		ATTR_COLUMNAR_HASHES	= 1<<1
+		ATTR_COLUMNAR_HASHES	= 1<<1,
 #endif
+
+		ATTR_SECONDARY_INDEX	= 1<<2		///< per-attribute secondary index (.spidx)
 	};
 
 
@@ -2656,6 +2661,7 @@ struct CSphQuery
 	bool			m_bStrict = false;			///< whether to warning or not about incompatible types
 	bool			m_bSync = false;			///< whether or not use synchronous operations (optimize, etc.)
 	bool			m_bNotOnlyAllowed = false;	///< whether allow single full-text not operator
+	bool			m_bPruneByWeight = false;	///< whether ranker may skip docs that can't get into the top matches (makes total_found approximate)
 	CSphString		m_sStore;					///< don't delete result, just store in given uservar by name
 
 	ISphTableFunc *	m_pTableFunc = nullptr;		///< post-query NOT OWNED, WILL NOT BE FREED in dtor.
@@ -2889,6 +2895,7 @@ struct CSphIndexStatus
 {
 	int64_t			m_iRamUse = 0;
 	int64_t			m_iRamRetired = 0;
+	int64_t			m_iPreloadedDict = 0; // RAM taken by preloaded dictionaries, part of m_iRamUse
 	int64_t			m_iMapped = 0; // total size of mmapped files
 	int64_t			m_iMappedResident = 0; // size of mmaped which are in core
 	int64_t			m_iMappedDocs = 0; // size of mmapped doclists
@@ -2903,6 +2910,10 @@ struct CSphIndexStatus
 	int64_t			m_iTID = 0;
 	int64_t			m_iSavedTID = 0;
 	int64_t 		m_iDead = 0;
+	int64_t			m_iMergesPending = 0; // not used for plain
+	int64_t			m_iMergesDone = 0; // not used for plain
+	int64_t			m_iMergedBytes = 0; // not used for plain
+	int64_t			m_iMergeTimeUs = 0; // not used for plain
 };
 
 
@@ -2916,6 +2927,9 @@ struct CSphMultiQueryArgs : public ISphNoncopyable
 	int64_t									m_iTotalDocs = 0;
 	bool									m_bModifySorterSchemas {true};
 	bool									m_bNoYeld = false;
+	int										m_iConcurrency = 1;				///< max threads a single index may split its search into (pseudo-sharding)
+	RowID_t									m_tMinRowID = 0;				///< pseudo-shard row range; only rows in [min,max) are searched
+	RowID_t									m_tMaxRowID = INVALID_ROWID;
 
 	CSphMultiQueryArgs ( int iIndexWeight );
 };
@@ -3073,6 +3087,10 @@ public:
 	virtual void	CreateReader ( int64_t iSessionId ) const {}
 	virtual bool	GetDoc ( DocstoreDoc_t & tDoc, DocID_t tDocID, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack ) const = 0;
 	virtual int		GetFieldId ( const CSphString & sName, DocstoreDataType_e eType ) const = 0;
+
+	/// fetch a batch of documents at once; tFound tells which ones were found
+	/// default implementation fetches them one by one
+	virtual void	GetDocs ( const VecTraits_T<DocID_t> & dDocIDs, const VecTraits_T<int> * pFieldIds, int64_t iSessionId, bool bPack, VecTraits_T<DocstoreDoc_t> & dDocs, CSphBitvec & tFound ) const;
 };
 
 bool IsMlock ( FileAccess_e eType );
@@ -3119,6 +3137,8 @@ public:
 	virtual int64_t *			GetFieldLens() const { return NULL; }
 	virtual bool				IsStarDict ( bool bWordDict ) const;
 	int64_t						GetIndexId() const { return m_iIndexId; }
+	int64_t						GetGeneration() const { return m_tGeneration.load ( std::memory_order_acquire ); }
+	void						NextGeneration() { m_tGeneration.fetch_add ( 1, std::memory_order_acq_rel ); }	///< any change visible to searches (data, kills, attrs, schema)
 	void						SetMutableSettings ( const MutableIndexSettings_c & tSettings );
 	const MutableIndexSettings_c & GetMutableSettings () const { return m_tMutableSettings; }
 
@@ -3230,6 +3250,9 @@ public:
 	/// internal make document id list from external docinfo, DO NOT USE
 	virtual CSphFixedVector<SphAttr_t> BuildDocList () const;
 
+	/// internal make list of ids of alive (not killed) documents, in rowid order
+	virtual CSphVector<DocID_t>	BuildAliveDocList () const { return CSphVector<DocID_t>(); }
+
 	virtual void				GetFieldFilterSettings ( CSphFieldFilterSettings & tSettings ) const;
 
 	// put external files (if any) into index folder
@@ -3247,6 +3270,7 @@ protected:
 	static std::atomic<long>	m_tIdGenerator;
 
 	int64_t						m_iIndexId;				///< internal (per daemon) unique index id, introduced for caching
+	std::atomic<int64_t>		m_tGeneration {0};		///< bumped on every visible change, used by result cache
 
 	CSphSchema					m_tSchema;
 	CSphString					m_sLastError;
@@ -154,6 +154,27 @@ const BYTE * ISphExpr::StringEvalPacked ( const CSphMatch & tMatch ) const
 }
 
 
+void ISphExpr::EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const
+{
+	for ( int i = 0; i < iCount; i++ )
+		pResult[i] = Eval ( *ppMatches[i] );
+}
+
+
+void ISphExpr::IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const
+{
+	for ( int i = 0; i < iCount; i++ )
+		pResult[i] = IntEval ( *ppMatches[i] );
+}
+
+
+void ISphExpr::Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const
+{
+	for ( int i = 0; i < iCount; i++ )
+		pResult[i] = Int64Eval ( *ppMatches[i] );
+}
+
+
 class Expr_WithLocator_c : public ISphExpr, public ExprLocatorTraits_t
 {
 public:
@@ -174,6 +195,29 @@ public:
 protected:
 	Expr_WithLocator_c ( const Expr_WithLocator_c& rhs )
 		: ExprLocatorTraits_t (rhs) {}
+
+	/// fetch attribute values for a batch of matches; plain 32-bit attributes are read directly from the rows
+	template <typename T, typename CONV>
+	void FetchBatch ( const CSphMatch * const * ppMatches, int iCount, T * pResult, CONV && fnConv ) const
+	{
+		if ( m_tLocator.m_iBitCount!=ROWITEM_BITS )
+		{
+			for ( int i = 0; i < iCount; i++ )
+				pResult[i] = fnConv ( ppMatches[i]->GetAttr ( m_tLocator ) );
+			return;
+		}
+
+		int iItem = m_tLocator.m_iBitOffset >> ROWITEM_SHIFT;
+		if ( m_tLocator.m_bDynamic )
+		{
+			for ( int i = 0; i < iCount; i++ )
+				pResult[i] = fnConv ( SphAttr_t ( ppMatches[i]->m_pDynamic[iItem] ) );
+		} else
+		{
+			for ( int i = 0; i < iCount; i++ )
+				pResult[i] = fnConv ( SphAttr_t ( ppMatches[i]->m_pStatic[iItem] ) );
+		}
+	}
 };
 
 
@@ -257,11 +301,22 @@ public:
 	float		Eval ( const CSphMatch & tMatch ) const override		{ return (float)FetchValue(tMatch); }
 	int			IntEval ( const CSphMatch & tMatch ) const override		{ return FetchValue(tMatch); }
 	int64_t		Int64Eval ( const CSphMatch & tMatch ) const override	{ return FetchValue(tMatch); }
+	void		EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const override			{ FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t tValue ){ return (float)tValue; } ); }
+	void		IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const override			{ FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t tValue ){ return (int)tValue; } ); }
+	void		Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const override	{ FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t tValue ){ return (int64_t)tValue; } ); }
 	uint64_t	GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final;
 	ISphExpr *	Clone() const final { return new Expr_GetColumnarInt_c ( m_sName, m_iLocator ); }
 
 protected:
 	inline SphAttr_t FetchValue ( const CSphMatch & tMatch ) const;
+
+	// rowids in a batch are ascending, so the iterator only moves forward
+	template <typename T, typename CONV>
+	void FetchBatch ( const CSphMatch * const * ppMatches, int iCount, T * pResult, CONV && fnConv ) const
+	{
+		for ( int i = 0; i < iCount; i++ )
+			pResult[i] = fnConv ( FetchValue ( *ppMatches[i] ) );
+	}
 };
 
 
@@ -289,6 +344,9 @@ public:
 	float		Eval ( const CSphMatch & tMatch ) const final		{ return sphDW2F(FetchValue(tMatch)); }
 	int			IntEval ( const CSphMatch & tMatch ) const final	{ return (int)sphDW2F(FetchValue(tMatch)); }
 	int64_t		Int64Eval ( const CSphMatch & tMatch ) const final	{ return (int64_t)sphDW2F(FetchValue(tMatch)); }
+	void		EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final			{ FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t tValue ){ return sphDW2F(tValue); } ); }
+	void		IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final			{ FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t tValue ){ return (int)sphDW2F(tValue); } ); }
+	void		Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final	{ FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t tValue ){ return (int64_t)sphDW2F(tValue); } ); }
 };
 
 
@@ -394,6 +452,10 @@ public:
 	int IntEval ( const CSphMatch & tMatch ) const final { return (int)tMatch.GetAttr ( m_tLocator ); }
 	int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return (int64_t)tMatch.GetAttr ( m_tLocator ); }
 
+	void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (float)v; } ); }
+	void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (int)v; } ); }
+	void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (int64_t)v; } ); }
+
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
 	{
 		EXPR_CLASS_NAME("Expr_GetInt_c");
@@ -418,6 +480,10 @@ public:
 	int IntEval ( const CSphMatch & tMatch ) const final { return (int)tMatch.GetAttr ( m_tLocator ); }
 	int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return (int64_t)tMatch.GetAttr ( m_tLocator ); }
 
+	void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (float)v; } ); }
+	void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (int)v; } ); }
+	void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (int64_t)v; } ); }
+
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
 	{
 		EXPR_CLASS_NAME("Expr_GetBits_c");
@@ -442,6 +508,10 @@ public:
 	int IntEval ( const CSphMatch & tMatch ) const final { return (int)tMatch.GetAttr ( m_tLocator ); }
 	int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return (int)tMatch.GetAttr ( m_tLocator ); }
 
+	void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (float)(int)v; } ); }
+	void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (int)v; } ); }
+	void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return (int64_t)(int)v; } ); }
+
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
 	{
 		EXPR_CLASS_NAME("Expr_GetSint_c");
@@ -463,6 +533,7 @@ class Expr_GetFloat_c : public Expr_WithLocator_c
 public:
 	Expr_GetFloat_c ( const CSphAttrLocator & tLocator, int iLocator ) : Expr_WithLocator_c ( tLocator, iLocator ) {}
 	float Eval ( const CSphMatch & tMatch ) const final { return tMatch.GetAttrFloat ( m_tLocator ); }
+	void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { FetchBatch ( ppMatches, iCount, pResult, []( SphAttr_t v ){ return sphDW2F ( (DWORD)v ); } ); }
 
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
 	{
@@ -626,7 +697,7 @@ public:
 		int iLen = 0;
 		DocID_t tDocID = sphGetDocID ( tMatch.m_pDynamic ? tMatch.m_pDynamic : tMatch.m_pStatic );
 		DocstoreDoc_t tDoc;
-		if ( m_tSession.m_pDocstore->GetDoc ( tDoc, tDocID, &m_dFieldIds, m_tSession.m_iSessionId, false ) )
+		if ( m_tSession.GetDoc ( tDoc, tDocID, &m_dFieldIds, false ) )
 		{
 			iLen = tDoc.m_dFields[0].GetLength();
 			assert(iLen>=0);
@@ -645,7 +716,7 @@ public:
 
 		DocID_t tDocID = sphGetDocID ( tMatch.m_pDynamic ? tMatch.m_pDynamic : tMatch.m_pStatic );
 		DocstoreDoc_t tDoc;
-		if ( m_tSession.m_pDocstore->GetDoc ( tDoc, tDocID, &m_dFieldIds, m_tSession.m_iSessionId, true ) )
+		if ( m_tSession.GetDoc ( tDoc, tDocID, &m_dFieldIds, true ) )
 			return tDoc.m_dFields[0].LeakData();
 		else
 			return nullptr;
@@ -697,6 +768,9 @@ public:
 	float Eval ( const CSphMatch & ) const final { return m_fValue; }
 	int IntEval ( const CSphMatch & ) const final { return (int)m_fValue; }
 	int64_t Int64Eval ( const CSphMatch & ) const final { return (int64_t)m_fValue; }
+	void EvalBatch ( const CSphMatch * const *, int iCount, float * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = m_fValue; }
+	void IntEvalBatch ( const CSphMatch * const *, int iCount, int * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = (int)m_fValue; }
+	void Int64EvalBatch ( const CSphMatch * const *, int iCount, int64_t * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = (int64_t)m_fValue; }
 	bool IsConst () const final { return true; }
 
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
@@ -728,6 +802,9 @@ public:
 	float Eval ( const CSphMatch & ) const final { return (float) m_iValue; } // no assert() here cause generic float Eval() needs to work even on int-evaluator tree
 	int IntEval ( const CSphMatch & ) const final { return m_iValue; }
 	int64_t Int64Eval ( const CSphMatch & ) const final { return m_iValue; }
+	void EvalBatch ( const CSphMatch * const *, int iCount, float * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = (float)m_iValue; }
+	void IntEvalBatch ( const CSphMatch * const *, int iCount, int * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = m_iValue; }
+	void Int64EvalBatch ( const CSphMatch * const *, int iCount, int64_t * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = m_iValue; }
 	bool IsConst () const final { return true; }
 	
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
@@ -759,6 +836,8 @@ public:
 	float Eval ( const CSphMatch & ) const final { return (float) m_iValue; } // no assert() here cause generic float Eval() needs to work even on int-evaluator tree
 	int IntEval ( const CSphMatch & ) const final { assert ( 0 ); return (int)m_iValue; }
 	int64_t Int64Eval ( const CSphMatch & ) const final { return m_iValue; }
+	void EvalBatch ( const CSphMatch * const *, int iCount, float * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = (float)m_iValue; }
+	void Int64EvalBatch ( const CSphMatch * const *, int iCount, int64_t * pResult ) const final { for ( int i = 0; i < iCount; i++ ) pResult[i] = m_iValue; }
 	bool IsConst () const final { return true; }
 	
 	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
@@ -1288,6 +1367,15 @@ protected:
 		, m_szExprName ( rhs.m_szExprName )
 	{}
 
+	/// evaluate the argument over a batch, then apply the operator column-wise in place
+	template <typename T, typename OP>
+	void UnaryBatch ( const CSphMatch * const * ppMatches, int iCount, T * pResult, OP && fnOp ) const
+	{
+		EvalExprBatch ( m_pFirst, ppMatches, iCount, pResult );
+		for ( int i = 0; i < iCount; i++ )
+			pResult[i] = fnOp ( pResult[i] );
+	}
+
 private:
 	const char *	m_szExprName {nullptr};
 };
@@ -1336,6 +1424,18 @@ protected:
 		, m_szExprName ( rhs.m_szExprName )
 	{}
 
+	/// evaluate both arguments over a batch, then combine them column-wise
+	/// plain loops over contiguous columns, so that the compiler can vectorize them
+	template <typename T, typename OP>
+	void BinaryBatch ( const CSphMatch * const * ppMatches, int iCount, T * pResult, OP && fnOp ) const
+	{
+		CSphFixedVector<T> dSecond ( iCount );
+		EvalExprBatch ( m_pFirst, ppMatches, iCount, pResult );
+		EvalExprBatch ( m_pSecond, ppMatches, iCount, dSecond.Begin() );
+		for ( int i = 0; i < iCount; i++ )
+			pResult[i] = fnOp ( pResult[i], dSecond[i] );
+	}
+
 private:
 	const char *	m_szExprName {nullptr};
 };
@@ -3193,10 +3293,25 @@ private:
 		int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return _expr3; } \
 	};
 
+/// unary operator that can also be evaluated over a batch; the argument is named 'a' in the operator expressions
+#define DECLARE_UNARY_OP(_classname,_op,_op2,_op3) \
+		DECLARE_UNARY_TRAITS ( _classname ) \
+		float Eval ( const CSphMatch & tMatch ) const final { return Op ( FIRST ); } \
+		int IntEval ( const CSphMatch & tMatch ) const final { return IntOp ( INTFIRST ); } \
+		int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return Int64Op ( INT64FIRST ); } \
+		void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { UnaryBatch ( ppMatches, iCount, pResult, Op ); } \
+		void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final { UnaryBatch ( ppMatches, iCount, pResult, IntOp ); } \
+		void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final { UnaryBatch ( ppMatches, iCount, pResult, Int64Op ); } \
+	private: \
+		static inline float Op ( float a ) { return _op; } \
+		static inline int IntOp ( int a ) { return _op2; } \
+		static inline int64_t Int64Op ( int64_t a ) { return _op3; } \
+	};
+
 #define IABS(_arg) ( (_arg)>0 ? (_arg) : (-_arg) )
 
-DECLARE_UNARY_INT ( Expr_Neg_c,		-FIRST,					-INTFIRST,			-INT64FIRST )
-DECLARE_UNARY_INT ( Expr_Abs_c,		fabs(FIRST),			IABS(INTFIRST),		IABS(INT64FIRST) )
+DECLARE_UNARY_OP ( Expr_Neg_c,		-a,						-a,					-a )
+DECLARE_UNARY_OP ( Expr_Abs_c,		float(fabs(a)),			IABS(a),			IABS(a) )
 DECLARE_UNARY_INT ( Expr_Ceil_c,	float(ceil(FIRST)),		int(ceil(FIRST)),	int64_t(ceil(FIRST)) )
 DECLARE_UNARY_INT ( Expr_Floor_c,	float(floor(FIRST)),	int(floor(FIRST)),	int64_t(floor(FIRST)) )
 
@@ -3273,14 +3388,45 @@ DECLARE_END()
 	DECLARE_BINARY_INT ( _classname##Int_c,		(float)IntEval(tMatch),		_expr2,					(int64_t)IntEval(tMatch) ) \
 	DECLARE_BINARY_INT ( _classname##Int64_c,	(float)Int64Eval(tMatch),	(int)Int64Eval(tMatch),	_expr3 )
 
+/// binary operator that can also be evaluated over a batch; the arguments are named 'a' and 'b' in the operator expressions
+#define DECLARE_BINARY_OP(_classname,_op,_op2,_op3) \
+		DECLARE_BINARY_TRAITS ( _classname ) \
+		float Eval ( const CSphMatch & tMatch ) const final { return Op ( FIRST, SECOND ); } \
+		int IntEval ( const CSphMatch & tMatch ) const final { return IntOp ( INTFIRST, INTSECOND ); } \
+		int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return Int64Op ( INT64FIRST, INT64SECOND ); } \
+		void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { BinaryBatch ( ppMatches, iCount, pResult, Op ); } \
+		void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final { BinaryBatch ( ppMatches, iCount, pResult, IntOp ); } \
+		void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final { BinaryBatch ( ppMatches, iCount, pResult, Int64Op ); } \
+	private: \
+		static inline float Op ( float a, float b ) { return _op; } \
+		static inline int IntOp ( int a, int b ) { return _op2; } \
+		static inline int64_t Int64Op ( int64_t a, int64_t b ) { return _op3; } \
+	};
+
+/// same for the typed flavours of comparisons; each one is batched in its own native type
+#define DECLARE_BINARY_CMP(_classname,_type,_native,_op) \
+		DECLARE_BINARY_TRAITS ( _classname ) \
+		float Eval ( const CSphMatch & tMatch ) const final { return (float)Op ( m_pFirst->_native(tMatch), m_pSecond->_native(tMatch) ); } \
+		int IntEval ( const CSphMatch & tMatch ) const final { return (int)Op ( m_pFirst->_native(tMatch), m_pSecond->_native(tMatch) ); } \
+		int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return (int64_t)Op ( m_pFirst->_native(tMatch), m_pSecond->_native(tMatch) ); } \
+		void _native##Batch ( const CSphMatch * const * ppMatches, int iCount, _type * pResult ) const final { BinaryBatch ( ppMatches, iCount, pResult, Op ); } \
+	private: \
+		static inline _type Op ( _type a, _type b ) { return _op; } \
+	};
+
+#define DECLARE_BINARY_POLY_OP(_classname,_op,_op2,_op3) \
+	DECLARE_BINARY_CMP ( _classname##Float_c,	float,		Eval,		_op ) \
+	DECLARE_BINARY_CMP ( _classname##Int_c,		int,		IntEval,	_op2 ) \
+	DECLARE_BINARY_CMP ( _classname##Int64_c,	int64_t,	Int64Eval,	_op3 )
+
 #define IFFLT(_expr)	( (_expr) ? 1.0f : 0.0f )
 #define IFINT(_expr)	( (_expr) ? 1 : 0 )
 
-DECLARE_BINARY_INT ( Expr_Add_c,	FIRST + SECOND,						(DWORD)INTFIRST + (DWORD)INTSECOND,				(uint64_t)INT64FIRST + (uint64_t)INT64SECOND )
-DECLARE_BINARY_INT ( Expr_Sub_c,	FIRST - SECOND,						(DWORD)INTFIRST - (DWORD)INTSECOND,				(uint64_t)INT64FIRST - (uint64_t)INT64SECOND )
-DECLARE_BINARY_INT ( Expr_Mul_c,	FIRST * SECOND,						(DWORD)INTFIRST * (DWORD)INTSECOND,				(uint64_t)INT64FIRST * (uint64_t)INT64SECOND )
-DECLARE_BINARY_INT ( Expr_BitAnd_c,	(float)(int(FIRST)&int(SECOND)),	INTFIRST & INTSECOND,				INT64FIRST & INT64SECOND )
-DECLARE_BINARY_INT ( Expr_BitOr_c,	(float)(int(FIRST)|int(SECOND)),	INTFIRST | INTSECOND,				INT64FIRST | INT64SECOND )
+DECLARE_BINARY_OP ( Expr_Add_c,		a + b,						(DWORD)a + (DWORD)b,	(uint64_t)a + (uint64_t)b )
+DECLARE_BINARY_OP ( Expr_Sub_c,		a - b,						(DWORD)a - (DWORD)b,	(uint64_t)a - (uint64_t)b )
+DECLARE_BINARY_OP ( Expr_Mul_c,		a * b,						(DWORD)a * (DWORD)b,	(uint64_t)a * (uint64_t)b )
+DECLARE_BINARY_OP ( Expr_BitAnd_c,	(float)(int(a)&int(b)),		a & b,					a & b )
+DECLARE_BINARY_OP ( Expr_BitOr_c,	(float)(int(a)|int(b)),		a | b,					a | b )
 DECLARE_BINARY_INT ( Expr_Mod_c,	(float)(int(FIRST)%int(SECOND)),	INTFIRST % INTSECOND,				INT64FIRST % INT64SECOND )
 
 DECLARE_BINARY_TRAITS ( Expr_Div_c )
@@ -3315,15 +3461,15 @@ DECLARE_BINARY_TRAITS ( Expr_Idiv_c )
 	}
 DECLARE_END()
 
-DECLARE_BINARY_POLY ( Expr_Lt,		IFFLT ( FIRST<SECOND ),					IFINT ( INTFIRST<INTSECOND ),		IFINT ( INT64FIRST<INT64SECOND ) )
-DECLARE_BINARY_POLY ( Expr_Gt,		IFFLT ( FIRST>SECOND ),					IFINT ( INTFIRST>INTSECOND ),		IFINT ( INT64FIRST>INT64SECOND ) )
-DECLARE_BINARY_POLY ( Expr_Lte,		IFFLT ( FIRST<=SECOND ),				IFINT ( INTFIRST<=INTSECOND ),		IFINT ( INT64FIRST<=INT64SECOND ) )
-DECLARE_BINARY_POLY ( Expr_Gte,		IFFLT ( FIRST>=SECOND ),				IFINT ( INTFIRST>=INTSECOND ),		IFINT ( INT64FIRST>=INT64SECOND ) )
-DECLARE_BINARY_POLY ( Expr_Eq,		IFFLT ( fabs ( FIRST-SECOND )<=1e-6 ),	IFINT ( INTFIRST==INTSECOND ),		IFINT ( INT64FIRST==INT64SECOND ) )
-DECLARE_BINARY_POLY ( Expr_Ne,		IFFLT ( fabs ( FIRST-SECOND )>1e-6 ),	IFINT ( INTFIRST!=INTSECOND ),		IFINT ( INT64FIRST!=INT64SECOND ) )
+DECLARE_BINARY_POLY_OP ( Expr_Lt,	IFFLT ( a<b ),					IFINT ( a<b ),		IFINT ( a<b ) )
+DECLARE_BINARY_POLY_OP ( Expr_Gt,	IFFLT ( a>b ),					IFINT ( a>b ),		IFINT ( a>b ) )
+DECLARE_BINARY_POLY_OP ( Expr_Lte,	IFFLT ( a<=b ),					IFINT ( a<=b ),		IFINT ( a<=b ) )
+DECLARE_BINARY_POLY_OP ( Expr_Gte,	IFFLT ( a>=b ),					IFINT ( a>=b ),		IFINT ( a>=b ) )
+DECLARE_BINARY_POLY_OP ( Expr_Eq,	IFFLT ( fabs ( a-b )<=1e-6 ),	IFINT ( a==b ),		IFINT ( a==b ) )
+DECLARE_BINARY_POLY_OP ( Expr_Ne,	IFFLT ( fabs ( a-b )>1e-6 ),	IFINT ( a!=b ),		IFINT ( a!=b ) )
 
-DECLARE_BINARY_INT ( Expr_Min_c,	Min ( FIRST, SECOND ),					Min ( INTFIRST, INTSECOND ),		Min ( INT64FIRST, INT64SECOND ) )
-DECLARE_BINARY_INT ( Expr_Max_c,	Max ( FIRST, SECOND ),					Max ( INTFIRST, INTSECOND ),		Max ( INT64FIRST, INT64SECOND ) )
+DECLARE_BINARY_OP ( Expr_Min_c,		Min ( a, b ),	Min ( a, b ),	Min ( a, b ) )
+DECLARE_BINARY_OP ( Expr_Max_c,		Max ( a, b ),	Max ( a, b ),	Max ( a, b ) )
 DECLARE_BINARY_FLT ( Expr_Pow_c,	float ( pow ( FIRST, SECOND ) ) )
 
 DECLARE_BINARY_POLY ( Expr_And,		FIRST!=0.0f && SECOND!=0.0f,		IFINT ( INTFIRST && INTSECOND ),	IFINT ( INT64FIRST && INT64SECOND ) )
@@ -3401,10 +3547,58 @@ protected:
         ISphExpr* Clone() const final { return new _classname(*this); } \
 	};
 
-DECLARE_TERNARY ( Expr_If_c,	( FIRST!=0.0f ) ? SECOND : THIRD,	INTFIRST ? INTSECOND : INTTHIRD,	INT64FIRST ? INT64SECOND : INT64THIRD )
 DECLARE_TERNARY ( Expr_Madd_c,	FIRST*SECOND+THIRD,					INTFIRST*INTSECOND + INTTHIRD,		INT64FIRST*INT64SECOND + INT64THIRD )
 DECLARE_TERNARY ( Expr_Mul3_c,	FIRST*SECOND*THIRD,					INTFIRST*INTSECOND*INTTHIRD,		INT64FIRST*INT64SECOND*INT64THIRD )
 
+
+class Expr_If_c : public ExprThreeway_c
+{
+public:
+	Expr_If_c ( ISphExpr * pFirst, ISphExpr * pSecond, ISphExpr * pThird )
+		: ExprThreeway_c ( "Expr_If_c", pFirst, pSecond, pThird )
+	{}
+
+	float Eval ( const CSphMatch & tMatch ) const final { return ( FIRST!=0.0f ) ? SECOND : THIRD; }
+	int IntEval ( const CSphMatch & tMatch ) const final { return INTFIRST ? INTSECOND : INTTHIRD; }
+	int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return INT64FIRST ? INT64SECOND : INT64THIRD; }
+	void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const final { IfBatch ( ppMatches, iCount, pResult ); }
+	void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const final { IfBatch ( ppMatches, iCount, pResult ); }
+	void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const final { IfBatch ( ppMatches, iCount, pResult ); }
+	ISphExpr * Clone() const final { return new Expr_If_c ( *this ); }
+
+private:
+	Expr_If_c ( const Expr_If_c & rhs ) : ExprThreeway_c ( rhs ) {}
+
+	// each branch is only evaluated over the matches that take it, as in per-match evaluation
+	// (so guards like IF(b!=0,a%b,0) keep working); matches keep their order within a branch
+	template <typename T>
+	void IfBatch ( const CSphMatch * const * ppMatches, int iCount, T * pResult ) const
+	{
+		CSphFixedVector<T> dValues ( iCount );
+		EvalExprBatch ( m_pFirst, ppMatches, iCount, dValues.Begin() );
+
+		CSphFixedVector<int> dOrder ( iCount );
+		int iTrue = 0;
+		for ( int i = 0; i < iCount; i++ )
+			if ( dValues[i]!=0 )
+				dOrder[iTrue++] = i;
+
+		int iOrdered = iTrue;
+		for ( int i = 0; i < iCount; i++ )
+			if ( dValues[i]==0 )
+				dOrder[iOrdered++] = i;
+
+		CSphFixedVector<const CSphMatch *> dOrdered ( iCount );
+		for ( int i = 0; i < iCount; i++ )
+			dOrdered[i] = ppMatches[dOrder[i]];
+
+		EvalExprBatch ( m_pSecond, dOrdered.Begin(), iTrue, dValues.Begin() );
+		EvalExprBatch ( m_pThird, dOrdered.Begin()+iTrue, iCount-iTrue, dValues.Begin()+iTrue );
+		for ( int i = 0; i < iCount; i++ )
+			pResult[dOrder[i]] = dValues[i];
+	}
+};
+
 //////////////////////////////////////////////////////////////////////////
 
 #define DECLARE_TIMESTAMP(_classname,_expr) \
@@ -104,6 +104,12 @@ public:
 	/// evaluate this expression for that match, using int64 math
 	virtual int64_t Int64Eval ( const CSphMatch & tMatch ) const { assert ( 0 ); return (int64_t) Eval ( tMatch ); }
 
+	/// evaluate this expression for a batch of matches into a column (one value per match)
+	/// per-match evaluation is the fallback; nodes that can evaluate a whole column at once override these
+	virtual void EvalBatch ( const CSphMatch * const * ppMatches, int iCount, float * pResult ) const;
+	virtual void IntEvalBatch ( const CSphMatch * const * ppMatches, int iCount, int * pResult ) const;
+	virtual void Int64EvalBatch ( const CSphMatch * const * ppMatches, int iCount, int64_t * pResult ) const;
+
 	/// Evaluate string attr.
 	/// Note, that sometimes this method returns pointer to a static buffer
 	/// and sometimes it allocates a new buffer, so aware of memory leaks.
@@ -165,6 +171,22 @@ protected:
 
 using ISphExprRefPtr_c = CSphRefcountedPtr<ISphExpr>;
 
+/// batch evaluation in the flavour (float, int or int64) matching the result column
+inline void EvalExprBatch ( const ISphExpr * pExpr, const CSphMatch * const * ppMatches, int iCount, float * pResult )
+{
+	pExpr->EvalBatch ( ppMatches, iCount, pResult );
+}
+
+inline void EvalExprBatch ( const ISphExpr * pExpr, const CSphMatch * const * ppMatches, int iCount, int * pResult )
+{
+	pExpr->IntEvalBatch ( ppMatches, iCount, pResult );
+}
+
+inline void EvalExprBatch ( const ISphExpr * pExpr, const CSphMatch * const * ppMatches, int iCount, int64_t * pResult )
+{
+	pExpr->Int64EvalBatch ( ppMatches, iCount, pResult );
+}
+
 inline ISphExpr* SafeClone ( ISphExpr * pRhs )
 {
 	if ( pRhs )
@@ -34,6 +34,23 @@ struct IFilter_Attr: virtual ISphFilter
 	{
 		m_tLocator = tLocator;
 	}
+
+	/// batch evaluation over static attribute values; computed attributes go through the generic path
+	template <typename FN>
+	int EvalStaticBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected, FN && fnEvalValue ) const
+	{
+		if ( m_tLocator.m_bDynamic )
+			return ISphFilter::EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+
+		// plain 32-bit attributes are the most common case; read them directly to let the compiler unroll the loop
+		if ( m_tLocator.m_iBitCount==ROWITEM_BITS )
+		{
+			int iItem = m_tLocator.m_iBitOffset >> ROWITEM_SHIFT;
+			return SelectRows ( pSelected, iSelected, [&]( int iRow ){ return fnEvalValue ( SphAttr_t ( ppRows[iRow][iItem] ) ); } );
+		}
+
+		return SelectRows ( pSelected, iSelected, [&]( int iRow ){ return fnEvalValue ( sphGetRowAttr ( ppRows[iRow], m_tLocator ) ); } );
+	}
 };
 
 /// values
@@ -131,6 +148,11 @@ public:
 		return EvalValues ( tMatch.GetAttr ( m_tLocator ) );
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		return EvalStaticBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected, [this]( SphAttr_t tValue ){ return EvalValues(tValue); } );
+	}
+
 	bool EvalBlock ( const DWORD * pMinDocinfo, const DWORD * pMaxDocinfo ) const final
 	{
 		if ( m_tLocator.m_bDynamic )
@@ -176,6 +198,12 @@ public:
 		return tMatch.GetAttr ( m_tLocator )==m_RefValue;
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const override
+	{
+		SphAttr_t tRefValue = m_RefValue;
+		return EvalStaticBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected, [tRefValue]( SphAttr_t tValue ){ return tValue==tRefValue; } );
+	}
+
 	bool EvalBlock ( const DWORD * pMinDocinfo, const DWORD * pMaxDocinfo ) const final
 	{
 		if ( m_tLocator.m_bDynamic )
@@ -225,6 +253,13 @@ public:
 		return tMatch.m_pStatic [ m_iIndex ]==m_RefValue;
 	}
 
+	int EvalBatch ( CSphMatch &, const RowID_t *, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		int iIndex = m_iIndex;
+		SphAttr_t tRefValue = m_RefValue;
+		return SelectRows ( pSelected, iSelected, [ppRows, iIndex, tRefValue]( int iRow ){ return ppRows[iRow][iIndex]==tRefValue; } );
+	}
+
 private:
 	int m_iIndex;
 };
@@ -241,6 +276,13 @@ struct Filter_Range : public IFilter_Attr, public IFilter_Range
 		return EvalRange<HAS_EQUAL_MIN,HAS_EQUAL_MAX,OPEN_LEFT,OPEN_RIGHT> ( tMatch.GetAttr ( m_tLocator ), m_iMinValue, m_iMaxValue );
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		SphAttr_t tMin = m_iMinValue;
+		SphAttr_t tMax = m_iMaxValue;
+		return EvalStaticBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected, [tMin, tMax]( SphAttr_t tValue ){ return EvalRange<HAS_EQUAL_MIN,HAS_EQUAL_MAX,OPEN_LEFT,OPEN_RIGHT> ( tValue, tMin, tMax ); } );
+	}
+
 	bool EvalBlock ( const DWORD * pMinDocinfo, const DWORD * pMaxDocinfo ) const final
 	{
 		if ( m_tLocator.m_bDynamic )
@@ -288,6 +330,13 @@ struct Filter_FloatRange : public IFilter_Attr
 		return EvalRange<HAS_EQUAL_MIN,HAS_EQUAL_MAX> ( tMatch.GetAttrFloat ( m_tLocator ), m_fMinValue, m_fMaxValue );
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		float fMin = m_fMinValue;
+		float fMax = m_fMaxValue;
+		return EvalStaticBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected, [fMin, fMax]( SphAttr_t tValue ){ return EvalRange<HAS_EQUAL_MIN,HAS_EQUAL_MAX> ( sphDW2F ( (DWORD)tValue ), fMin, fMax ); } );
+	}
+
 	bool EvalBlock ( const DWORD * pMinDocinfo, const DWORD * pMaxDocinfo ) const final
 	{
 		if ( m_tLocator.m_bDynamic )
@@ -580,6 +629,15 @@ struct Filter_And2 final : public ISphFilter
 		return m_pArg1->Eval ( tMatch ) && m_pArg2->Eval ( tMatch );
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		iSelected = m_pArg1->EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+		if ( !iSelected )
+			return 0;
+
+		return m_pArg2->EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+	}
+
 	bool EvalBlock ( const DWORD * pMin, const DWORD * pMax ) const final
 	{
 		return m_pArg1->EvalBlock ( pMin, pMax ) && m_pArg2->EvalBlock ( pMin, pMax );
@@ -630,6 +688,19 @@ struct Filter_And3 final : public ISphFilter
 		return m_pArg1->Eval ( tMatch ) && m_pArg2->Eval ( tMatch ) && m_pArg3->Eval ( tMatch );
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		iSelected = m_pArg1->EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+		if ( !iSelected )
+			return 0;
+
+		iSelected = m_pArg2->EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+		if ( !iSelected )
+			return 0;
+
+		return m_pArg3->EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+	}
+
 	bool EvalBlock ( const DWORD * pMin, const DWORD * pMax ) const final
 	{
 		return m_pArg1->EvalBlock ( pMin, pMax ) && m_pArg2->EvalBlock ( pMin, pMax ) && m_pArg3->EvalBlock ( pMin, pMax );
@@ -680,6 +751,18 @@ struct Filter_And final : public ISphFilter
 		return true;
 	}
 
+	int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const final
+	{
+		for ( auto pFilter: m_dFilters )
+		{
+			iSelected = pFilter->EvalBatch ( tMatch, pRowIDs, ppRows, pSelected, iSelected );
+			if ( !iSelected )
+				break;
+		}
+
+		return iSelected;
+	}
+
 	bool EvalBlock ( const DWORD * pMinDocinfo, const DWORD * pMaxDocinfo ) const final
 	{
 		for ( auto pFilter : m_dFilters )
@@ -827,6 +910,17 @@ ISphFilter * ISphFilter::Join ( ISphFilter * pFilter )
 	return pAnd;
 }
 
+
+int ISphFilter::EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const
+{
+	return SelectRows ( pSelected, iSelected, [&]( int iRow )
+	{
+		tMatch.m_tRowID = pRowIDs[iRow];
+		tMatch.m_pStatic = ppRows[iRow];
+		return Eval ( tMatch );
+	} );
+}
+
 /// helper functions
 
 CSphString FilterType2Str ( ESphFilter eFilterType )
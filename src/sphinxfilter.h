@@ -60,12 +60,32 @@ public:
 		return true;
 	}
 
+	/// evaluate filter for a batch of rows (used by fullscan when there are no computed filter expressions)
+	/// pSelected holds iSelected indexes into pRowIDs/ppRows; indexes of the rows that pass are compacted to its start
+	/// tMatch is a scratch match with the dynamic part already set up; returns the number of rows that passed
+	virtual int EvalBatch ( CSphMatch & tMatch, const RowID_t * pRowIDs, const CSphRowitem * const * ppRows, int * pSelected, int iSelected ) const;
+
 	/// returns true if the filter can handle exclude flag in settings
 	/// otherwise a NOT filter will be spawned on top of this filter
 	virtual bool CanExclude() const { return false; }
 	virtual ISphFilter * Join ( ISphFilter * pFilter );
 };
 
+/// branchless compaction of a selection vector; keeps the indexes for which fnTest returns true
+template <typename FN>
+inline int SelectRows ( int * pSelected, int iSelected, FN && fnTest )
+{
+	int iPassed = 0;
+	for ( int i = 0; i < iSelected; ++i )
+	{
+		int iRow = pSelected[i];
+		pSelected[iPassed] = iRow;
+		iPassed += fnTest(iRow) ? 1 : 0;
+	}
+
+	return iPassed;
+}
+
 // fwd
 using UservarIntSetValues_c = CSphVector<SphAttr_t>;
 using UservarIntSet_c = SharedPtr_t<UservarIntSetValues_c *>;
@@ -144,6 +144,7 @@ private:
 
 class ISphRanker;
 class ISphMatchSorter;
+class QcacheEntry_c;
 
 enum QueryDebug_e
 {
@@ -168,6 +169,7 @@ public:
 	ISphFilter *				m_pWeightFilter = nullptr;
 
 	bool						m_bSkipQCache = false;			///< whether do not cache this query
+	QcacheEntry_c *				m_pQcacheEntry = nullptr;		///< cached matches already found by the caller (non-owned)
 
 	struct CalcItem_t
 	{
@@ -206,6 +208,7 @@ public:
 
 	void	CalcFilter ( CSphMatch & tMatch ) const;
 	void	CalcSort ( CSphMatch & tMatch ) const;
+	void	CalcSortBatch ( CSphMatch * const * ppMatches, int iCount ) const;
 	void	CalcFinal ( CSphMatch & tMatch ) const;
 	void	CalcItem ( CSphMatch & tMatch, const CalcItem_t & tCalc ) const;
 
@@ -1152,6 +1155,19 @@ void			sphSetUnlinkOld ( bool bUnlink );
 bool			sphGetUnlinkOld ();
 void			sphUnlinkIndex ( const char * sName, bool bForce );
 
+/// disk wordlist expansions cache status
+struct ExpansionCacheStatus_t
+{
+	int64_t		m_iMaxBytes = 0;	///< max RAM bytes, 0 means disabled
+	int64_t		m_iUsedBytes = 0;	///< used RAM bytes
+	int			m_iShards = 0;		///< shards the memory limit is split between
+	int64_t		m_iHits = 0;		///< cache hits
+	int64_t		m_iMisses = 0;		///< cache misses
+};
+
+void					SetExpansionCacheSize ( int64_t iMaxBytes );	///< max bytes of disk wordlist expansions cache, 0 disables it
+ExpansionCacheStatus_t	GetExpansionCacheStatus();
+
 void			WriteSchema ( CSphWriter & fdInfo, const CSphSchema & tSchema );
 void			ReadSchema ( CSphReader & rdInfo, CSphSchema & m_tSchema, DWORD uVersion );
 void			SaveIndexSettings ( CSphWriter & tWriter, const CSphIndexSettings & tSettings );
@@ -1201,6 +1217,7 @@ enum ESphExt
 	SPH_EXT_SPT,
 	SPH_EXT_SPHI,
 	SPH_EXT_SPDS,
+	SPH_EXT_SPIDX,
 	SPH_EXT_SPL,
 	SPH_EXT_SETTINGS,
 
@@ -1369,6 +1386,9 @@ public:
 	virtual const BYTE *	GetPackedKeywords () = 0;
 	virtual int				GetPackedLen () = 0;
 
+	/// add keyword packed by another wrapper (len byte, word, optional id) as is, w/o base dict processing
+	virtual SphWordID_t		AddPackedKeyword ( const BYTE * pPacked ) = 0;
+
 	virtual void			ResetKeywords() = 0;
 
 	virtual const char *	GetLastWarning() const = 0;
@@ -1392,6 +1412,9 @@ struct ISphSubstringPayload
 };
 
 
+/// sort hits block by (word, row, pos) using up to iThreads threads
+void sphSortHits ( CSphWordHit * pHits, int iHits, int iThreads );
+
 void sphBuildNGrams ( const char * sWord, int iLen, char cDelimiter, CSphVector<char> & dNgrams );
 
 // levenstein distance for words
@@ -1949,6 +1972,28 @@ inline DWORD PrereadMappingCountingBits ( const char * sIndexName, const char *
 
 #endif // PARANOID
 
+/// max length of zipped value of given type
+template < typename T >
+constexpr int sphMaxZippedLen()
+{
+	return ( sizeof(T)*8+6 )/7;
+}
+
+/// decode zipped value which is entirely in memory, w/o per-byte bounds checks
+/// (caller ensures sphMaxZippedLen<T>() bytes are readable; broken data never makes it read beyond that)
+template < typename T >
+inline T sphUnzipInMemory ( const BYTE * & pBuf )
+{
+	DWORD b = *pBuf++;
+	T tRes = 0;
+	for ( int i=1; ( b & 0x80 ) && i<sphMaxZippedLen<T>(); ++i )
+	{
+		tRes = ( tRes<<7 ) + ( b & 0x7f );
+		b = *pBuf++;
+	}
+	return ( tRes<<7 ) + b;
+}
+
 // crash related code
 struct CrashQuery_t
 {
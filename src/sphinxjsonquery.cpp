@@ -1559,10 +1559,22 @@ CSphString sphEncodeResultJson ( const VecTraits_T<const AggrResult_t *> & dRes,
 	{
 		JsonEscapedBuilder sPlan;
 		FormatJsonPlanFromBson ( sPlan, bson::MakeHandle ( pProfile->m_dPlan ) );
-		if ( sPlan.IsEmpty() )
+		if ( sPlan.IsEmpty() && pProfile->m_sAccessPlan.IsEmpty() )
 			tOut << R"("profile":null)";
 		else
-			tOut.Sprintf ( R"("profile":{"query":%s})", sPlan.cstr () );
+		{
+			tOut.StartBlock ( ",", R"("profile":{)", "}" );
+			if ( !sPlan.IsEmpty() )
+				tOut.Sprintf ( R"("query":%s)", sPlan.cstr () );
+
+			if ( !pProfile->m_sAccessPlan.IsEmpty() )
+			{
+				JsonEscapedBuilder sAccessPlan;
+				sAccessPlan.AppendEscapedWithComma ( pProfile->m_sAccessPlan.cstr() );
+				tOut.Sprintf ( R"("access_plan":%s)", sAccessPlan.cstr () );
+			}
+			tOut.FinishBlock ( false );
+		}
 	}
 
 	tOut.FinishBlocks (); tOut.MoveTo ( sResult ); return sResult;
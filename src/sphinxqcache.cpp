@@ -34,6 +34,7 @@ private:
 	CSphVector<QcacheEntry_c*>	m_hData;			///< our little queries hash
 	int							m_iMaxQueries;		///< max load
 	int							m_iMruHead;			///< most recently used entry
+	CSphOrderedHash<int, int64_t, IdentityHash_fn, 256> m_hIndexEntries;	///< cached entries per index id; lets DeleteIndex() skip the scan
 
 public:
 								Qcache_c();
@@ -46,6 +47,7 @@ public:
 
 private:
 	static uint64_t				GetKey ( int64_t iIndexId, const CSphQuery & q );
+	int							FindEntry ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema );
 	bool						IsValidEntry ( int i ) { return m_hData[i]!=QCACHE_NO_ENTRY && m_hData[i]!=QCACHE_DEAD_ENTRY; }
 	void						EnforceLimits ( bool bSizeOnly ) EXCLUDES ( m_tLock );
 	void						MruToHead ( int iRes );
@@ -409,6 +411,12 @@ void Qcache_c::Add ( const CSphQuery & q, QcacheEntry_c * pResult, const ISphSch
 		j = ( j+1 ) & iLenMask;
 	m_hData[j] = pResult;
 
+	int * pIndexEntries = m_hIndexEntries ( pResult->m_iIndexId );
+	if ( pIndexEntries )
+		++*pIndexEntries;
+	else
+		m_hIndexEntries.Add ( 1, pResult->m_iIndexId );
+
 	m_iCachedQueries++;
 	m_iUsedBytes += pResult->GetSize();
 	MruToHead(j);
@@ -425,17 +433,29 @@ QcacheEntry_c * Qcache_c::Find ( int64_t iIndexId, const CSphQuery & q, const IS
 	if ( !CanCacheQuery(q) )
 		return nullptr;
 
+	ScopedMutex_t dLock (m_tLock);
+
+	int iRes = FindEntry ( iIndexId, q, tSorterSchema );
+	if ( iRes<0 )
+		return nullptr;
+
+	m_iHits++;
+	QcacheEntry_c * p = m_hData[iRes];
+	p->AddRef();
+	MruToHead(iRes);
+	return p;
+}
+
+int Qcache_c::FindEntry ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema )
+{
 	uint64_t k = GetKey ( iIndexId, q );
 
 	bool bFilterHashesCalculated = false;
 	CSphVector<uint64_t> dFilters;
-	
-	ScopedMutex_t dLock (m_tLock);
 
 	int64_t tmMin = sphMicroTimer() - int64_t( m_iTtlS)*1000000;
 	int iLenMask = m_hData.GetLength() - 1;
 	int iLoop = m_hData.GetLength();
-	int iRes = -1;
 	for ( int i = k & iLenMask; m_hData[i]!=QCACHE_NO_ENTRY && iLoop--!=0; i = ( i+1 ) & iLenMask )
 	{
 		// check that entry is alive
@@ -460,7 +480,7 @@ QcacheEntry_c * Qcache_c::Find ( int64_t iIndexId, const CSphQuery & q, const IS
 			bFilterHashesCalculated = true;
 
 			if ( !CalcFilterHashes ( dFilters, q, tSorterSchema ) )
-				return nullptr;	// this query can't be cached because of the nature of expressions in filters
+				return -1;	// this query can't be cached because of the nature of expressions in filters
 		}
 
 		int j = 0;
@@ -470,22 +490,10 @@ QcacheEntry_c * Qcache_c::Find ( int64_t iIndexId, const CSphQuery & q, const IS
 
 		// filters are good, return it
 		if ( j==e->m_dFilters.GetLength() )
-		{
-			iRes = i;
-			m_iHits++;
-			break;
-		}
-	}
-
-	QcacheEntry_c * p = nullptr;
-	if ( iRes>=0 )
-	{
-		p = m_hData[iRes];
-		p->AddRef();
-		MruToHead(iRes);
+			return i;
 	}
 
-	return p;
+	return -1;
 }
 
 uint64_t Qcache_c::GetKey ( int64_t iIndexId, const CSphQuery & q )
@@ -526,6 +534,11 @@ void Qcache_c::DeleteEntry ( int i )
 	m_iCachedQueries--;
 	m_iUsedBytes -= p->GetSize();
 
+	int * pIndexEntries = m_hIndexEntries ( p->m_iIndexId );
+	assert ( pIndexEntries && *pIndexEntries>0 );
+	if ( pIndexEntries && !--*pIndexEntries )
+		m_hIndexEntries.Delete ( p->m_iIndexId );
+
 	// release entry
 	p->Release();
 	m_hData[i] = QCACHE_DEAD_ENTRY;
@@ -572,9 +585,16 @@ void Qcache_c::EnforceLimits ( bool bSizeOnly )
 void Qcache_c::DeleteIndex ( int64_t iIndexId )
 {
 	ScopedMutex_t dLock ( m_tLock );
-	ARRAY_FOREACH ( i, m_hData )
+
+	// called on every attribute update, while most indexes have nothing cached; scan only as long as there are entries left
+	int * pIndexEntries = m_hIndexEntries ( iIndexId );
+	int iLeft = pIndexEntries ? *pIndexEntries : 0;
+	for ( int i = 0; i<m_hData.GetLength() && iLeft>0; ++i )
 		if ( IsValidEntry(i) && m_hData[i]->m_iIndexId==iIndexId )
+		{
 			DeleteEntry(i);
+			--iLeft;
+		}
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -35,6 +35,7 @@
 %token	TOK_BEGIN
 %token	TOK_BETWEEN
 %token	TOK_BIGINT
+%token	TOK_BULK
 %token	TOK_BY
 %token	TOK_CALL
 %token	TOK_CHARACTER
@@ -239,7 +240,7 @@ statement:
 ident_set_no_option:
 	TOK_IDENT
 	| TOK_AGENT | TOK_ALL | TOK_ANY | TOK_ASC | TOK_ATTACH | TOK_ATTRIBUTES
-	| TOK_AVG | TOK_BEGIN | TOK_BETWEEN | TOK_BIGINT | TOK_CALL
+	| TOK_AVG | TOK_BEGIN | TOK_BETWEEN | TOK_BIGINT | TOK_BULK | TOK_CALL
 	| TOK_CHARACTER | TOK_CHUNK | TOK_CLUSTER | TOK_COLLATION | TOK_COLUMN | TOK_COMMIT
 	| TOK_COMMITTED | TOK_COUNT | TOK_CREATE | TOK_DATABASES | TOK_DELETE
 	| TOK_DESC | TOK_DESCRIBE  | TOK_DISTINCT  | TOK_DOUBLE
@@ -1407,6 +1408,7 @@ transact_op:
 	TOK_COMMIT			{ pParser->m_pStmt->m_eStmt = STMT_COMMIT; }
 	| TOK_ROLLBACK			{ pParser->m_pStmt->m_eStmt = STMT_ROLLBACK; }
 	| start_transaction		{ pParser->m_pStmt->m_eStmt = STMT_BEGIN; }
+	| TOK_BEGIN TOK_BULK	{ pParser->m_pStmt->m_eStmt = STMT_BEGIN; pParser->m_pStmt->m_iIntParam = 1; }
 	;
 
 start_transaction:
@@ -29,6 +29,7 @@
 #include "indexsettings.h"
 #include "indexformat.h"
 #include "coroutine.h"
+#include "event.h"
 #include "mini_timer.h"
 #include "memio.h"
 #include "secondaryindex.h"
@@ -224,6 +225,17 @@ RtSegment_t::~RtSegment_t ()
 {
 	if ( m_pRAMCounter )
 		FixupRAMCounter ( -GetUsedRam() );
+
+	// these point into arena, which is freed wholesale
+	if ( m_dArena.GetLength() )
+	{
+		m_dWords.LeakData();
+		m_dWordCheckpoints.LeakData();
+		m_dInfixFilterCP.LeakData();
+		m_dDocs.LeakData();
+		m_dHits.LeakData();
+		m_dKeywordCheckpoints.LeakData();
+	}
 }
 
 
@@ -232,19 +244,77 @@ void RtSegment_t::UpdateUsedRam()
 	FixupRAMCounter ( -m_iUsedRam );
 
 	m_iUsedRam = 0;
-	m_iUsedRam += m_dWords.AllocatedBytes();
-	m_iUsedRam += m_dDocs.AllocatedBytes();
-	m_iUsedRam += m_dHits.AllocatedBytes();
+	if ( m_dArena.GetLength() )
+		m_iUsedRam += m_dArena.GetLengthBytes();
+	else
+	{
+		m_iUsedRam += m_dWords.AllocatedBytes();
+		m_iUsedRam += m_dDocs.AllocatedBytes();
+		m_iUsedRam += m_dHits.AllocatedBytes();
+		m_iUsedRam += m_dKeywordCheckpoints.AllocatedBytes();
+		m_iUsedRam += m_dInfixFilterCP.AllocatedBytes();
+	}
 	m_iUsedRam += m_dBlobs.AllocatedBytes();
-	m_iUsedRam += m_dKeywordCheckpoints.AllocatedBytes();
 	m_iUsedRam += m_dRows.AllocatedBytes();
-	m_iUsedRam += m_dInfixFilterCP.AllocatedBytes();
 	m_iUsedRam += m_pDocstore.Ptr() ? m_pDocstore->AllocatedBytes() : 0;
 
 	FixupRAMCounter ( m_iUsedRam );
 }
 
 
+template<typename VEC>
+static int64_t ArenaBytes ( const VEC & dVec )
+{
+	return ( dVec.GetLengthBytes64() + 7 ) & ~(int64_t)7;
+}
+
+template<typename VEC>
+static BYTE * MoveVectorToArena ( VEC & dVec, BYTE * pArena )
+{
+	using T = typename std::remove_reference<decltype ( dVec[0] )>::type;
+	int64_t iLen = dVec.GetLength();
+	if ( iLen )
+		memcpy ( pArena, dVec.Begin(), dVec.GetLengthBytes64() );
+	dVec.AdoptData ( (T *)pArena, iLen, iLen );
+	return pArena + ArenaBytes ( dVec );
+}
+
+// words, docs and hits never change once segment is built; so move them from grown (thus oversized) vectors
+// into one exactly sized block, which gives exact ram accounting and is returned to the system as a whole
+// rows and blobs stay in own vectors, as updates and alters replace them
+// called by the segment builder before writers get locked out, and never once segment is published
+void RtSegment_t::MoveToArena()
+{
+	if ( m_dArena.GetLength() )
+		return;
+
+	int64_t iBytes = ArenaBytes ( m_dWords ) + ArenaBytes ( m_dWordCheckpoints ) + ArenaBytes ( m_dInfixFilterCP )
+		+ ArenaBytes ( m_dDocs ) + ArenaBytes ( m_dHits ) + ArenaBytes ( m_dKeywordCheckpoints );
+	if ( !iBytes )
+		return;
+
+	m_dArena.Reset ( iBytes );
+	const char * pOldKeywords = (const char *)m_dKeywordCheckpoints.Begin();
+
+	BYTE * pArena = m_dArena.Begin();
+	pArena = MoveVectorToArena ( m_dWords, pArena );
+	pArena = MoveVectorToArena ( m_dWordCheckpoints, pArena );
+	pArena = MoveVectorToArena ( m_dInfixFilterCP, pArena );
+	pArena = MoveVectorToArena ( m_dDocs, pArena );
+	pArena = MoveVectorToArena ( m_dHits, pArena );
+	pArena = MoveVectorToArena ( m_dKeywordCheckpoints, pArena );
+	assert ( pArena==m_dArena.Begin()+iBytes );
+
+	// keywords checkpoints point to keywords
+	if ( m_dKeywordCheckpoints.GetLength() )
+	{
+		const char * pNewKeywords = (const char *)m_dKeywordCheckpoints.Begin();
+		for ( auto & tCheckpoint : m_dWordCheckpoints )
+			tCheckpoint.m_sWord = pNewKeywords + ( tCheckpoint.m_sWord - pOldKeywords );
+	}
+}
+
+
 int64_t RtSegment_t::GetUsedRam()
 {
 	if ( !m_iUsedRam )
@@ -679,7 +749,7 @@ struct BinlogIndexInfo_t
 {
 	CSphString	m_sName;				///< index name
 	int64_t		m_iMinTID = INT64_MAX;	///< min TID logged by this file
-	int64_t		m_iMaxTID = 0;			///< max TID logged by this file
+	int64_t		m_iMaxTID = 0;			///< max TID logged by this file (on replay, max TID actually applied)
 	int64_t		m_iFlushedTID = 0;		///< last flushed TID
 	int64_t		m_tmMin = INT64_MAX;	///< min TID timestamp
 	int64_t		m_tmMax = 0;			///< max TID timestamp
@@ -688,6 +758,11 @@ struct BinlogIndexInfo_t
 	RtIndex_c *	m_pRT = nullptr;		///< replay only; RT index handle (might be NULL if N/A or non-RT)
 	PercolateIndex_i *	m_pPQ = nullptr;		///< replay only; PQ index handle (might be NULL if N/A or non-PQ)
 	int64_t		m_iPreReplayTID = 0;	///< replay only; index TID at the beginning of this file replay
+	int			m_iReplayedTxns = 0;	///< replay only; transactions applied from this file
+	int64_t		m_iReplayedRows = 0;	///< replay only; rows applied from this file
+	int64_t		m_tmReplay = 0;			///< replay only; time spent applying transactions from this file
+	bool		m_bReplayFailed = false;	///< replay only; apply failed, rest of transactions from this file skipped
+	int64_t		m_iDecodedTID = 0;		///< replay only; max TID decoded from this file, applied or not yet
 };
 
 /// binlog file descriptor
@@ -698,6 +773,32 @@ struct BinlogFileDesc_t
 	CSphVector<BinlogIndexInfo_t>	m_dIndexInfos;
 };
 
+/// replay of a single blop, deferred until apply phase
+/// binlog is decoded sequentially, and then blops are applied to different indexes in parallel
+struct ReplayOp_i
+{
+	virtual			~ReplayOp_i () = default;
+	virtual bool	Apply ( BinlogIndexInfo_t & tIndex ) = 0;
+};
+
+template<typename FN>
+struct ReplayOp_T final : public ReplayOp_i
+{
+	FN				m_fnApply;
+
+	explicit		ReplayOp_T ( FN && fnApply ) : m_fnApply ( std::move ( fnApply ) ) {}
+	bool			Apply ( BinlogIndexInfo_t & tIndex ) final { return m_fnApply ( tIndex ); }
+};
+
+struct ReplayOpDesc_t
+{
+	int				m_iIndex;	///< index id in binlog file
+	int64_t			m_iTID;
+	int64_t			m_iTxnPos;
+	int				m_iRows;
+	ReplayOp_i *	m_pOp;
+};
+
 /// Bin Log Operation
 enum Blop_e
 {
@@ -728,6 +829,9 @@ public:
 	void			Fsync ();
 	bool			HasUnwrittenData () const { return m_iPoolUsed>0; }
 	bool			HasUnsyncedData () const { return m_iLastFsyncPos!=m_iLastWritePos; }
+	int				DupFD () const { return m_iFD<0 ? -1 : ::dup ( m_iFD ); } ///< for fsync outside of writer lock
+	void			SetSynced ( int64_t iPos ) { m_iLastFsyncPos = Max ( m_iLastFsyncPos, iPos ); } ///< data up to iPos was synced via dup of FD
+	void			SetSyncError ( const CSphString & sName, int iErrno );	///< sync via dup of FD failed
 
 	void			ResetCrc ();	///< restart checksumming
 	void			WriteCrc ();	///< finalize and write current checksum to output stream
@@ -765,7 +869,7 @@ public:
 	RtBinlog_c ();
 	~RtBinlog_c ();
 
-	void	BinlogCommit ( int64_t * pTID, const char * sIndexName, const RtSegment_t * pSeg, const CSphVector<DocID_t> & dKlist, bool bKeywordDict );
+	bool	BinlogCommit ( int64_t * pTID, const char * sIndexName, const RtSegment_t * pSeg, const CSphVector<DocID_t> & dKlist, bool bKeywordDict, CSphString & sError );
 	void	BinlogUpdateAttributes ( int64_t * pTID, const char * sIndexName, const CSphAttrUpdate & tUpd ) final;
 	void	BinlogReconfigure ( int64_t * pTID, const char * sIndexName, const CSphReconfigureSetup & tSetup ) override;
 	void	NotifyIndexFlush ( const char * sIndexName, int64_t iTID, bool bShutdown ) final;
@@ -783,15 +887,20 @@ public:
 	int64_t	NextFlushingTime() const;
 
 private:
-	struct BlopStartEnd_t
+	struct SCOPED_CAPABILITY BlopStartEnd_t
 	{
 		RtBinlog_c & m_tBinlog;
 
-		BlopStartEnd_t ( RtBinlog_c & tBinlog, int64_t * pTID, Blop_e eBlop, const char * szIndexName );
-		~BlopStartEnd_t();
+		bool m_bFinished = false;
+
+		BlopStartEnd_t ( RtBinlog_c & tBinlog, int64_t * pTID, Blop_e eBlop, const char * szIndexName ) ACQUIRE ( tBinlog.m_tWriteLock );
+		~BlopStartEnd_t() RELEASE();
+
+		bool Finish() RELEASE(); ///< returns false when the blop failed to sync
 	};
 
 	static const DWORD		BINLOG_VERSION = 10;
+	static const int64_t	REPLAY_BATCH_SIZE = 268435456;	///< apply decoded blops at least every 256M of binlog
 
 	static const DWORD		BINLOG_HEADER_MAGIC = 0x4c425053;	/// magic 'SPBL' header that marks binlog file
 	static const DWORD		BLOP_MAGIC = 0x214e5854;			/// magic 'TXN!' header that marks binlog entry
@@ -810,6 +919,13 @@ private:
 
 	CSphMutex				m_tWriteLock; // lock on operation
 
+	// group commit (binlog_flush=1): committers leave their blops in the shared write buffer,
+	// then first of them (leader) writes and syncs the whole batch while the rest wait on m_tSyncLock
+	CSphMutex				m_tSyncLock;
+	int64_t					m_iBlopSeq = 0;		///< number of finished blops, under m_tWriteLock
+	int64_t					m_iSyncedSeq = 0;	///< blops up to this one are synced, under m_tSyncLock
+	int64_t					m_iFailedSeq = 0;	///< blops up to this one are not known to be synced, under m_tSyncLock
+
 	int						m_iLockFD = -1;
 	CSphString				m_sWriterError;
 	BinlogWriter_c			m_tWriter;
@@ -826,6 +942,9 @@ private:
 	// replay stats
 	mutable int				m_iReplayedRows=0;
 
+	// decoded but not yet applied blops of currently replayed file
+	mutable CSphVector<ReplayOpDesc_t>	m_dReplayOps;
+
 private:
 
 	int 					GetWriteIndexID ( const char * sName, int64_t iTID, int64_t tmNow );
@@ -834,7 +953,8 @@ private:
 	void					LockFile ( bool bLock );
 	void					DoCacheWrite ();
 	void					CheckDoRestart ();
-	void					CheckDoFlush ();
+	int64_t					CheckDoFlush ();
+	bool					GroupFsync ( int64_t iSeq );
 	void					OpenNewLog ( int iLastState=0 );
 
 	int						ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, int iBinlog );
@@ -845,9 +965,17 @@ private:
 	bool					ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const;
 	bool					ReplayPqAdd ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const;
 	bool					ReplayPqDelete ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const;
+	void					ApplyReplayOps ( int iBinlog ) const;
+
+	template<typename FN>
+	void					AddReplayOp ( int iBinlog, const BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t iTxnPos, int iRows, FN && fnApply ) const
+	{
+		m_dReplayOps.Add ( { m_dLogFiles[iBinlog].m_dIndexInfos.Idx ( &tIndex ), iTID, iTxnPos, iRows, new ReplayOp_T<FN> ( std::forward<FN> ( fnApply ) ) } );
+	}
 
 	bool	PreOp ( Blop_e eOp, int64_t * pTID, const char * sIndexName ) TRY_ACQUIRE (true, m_tWriteLock);
-	void	PostOp () RELEASE (m_tWriteLock);
+	bool	PostOp () RELEASE (m_tWriteLock);
+	int64_t	FinishBlop () REQUIRES (m_tWriteLock);
 	bool	CheckCrc ( const char * sOp, const CSphString & sIndex, int64_t iTID, int64_t iTxnPos, BinlogReader_c & tReader ) const;
 	void	CheckTid ( const char * sOp, const BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t iTxnPos ) const;
 
@@ -855,7 +983,7 @@ private:
 	void	CheckTidSeq ( const char * sOp, const BinlogIndexInfo_t & tIndex, int64_t iTID, T * pIndexTID, int64_t iTxnPos ) const;
 	void	CheckTime ( BinlogIndexInfo_t & tIndex, const char * sOp, int64_t tmStamp, int64_t iTID, int64_t iTxnPos, DWORD uReplayFlags ) const;
 	bool	PerformChecks ( const char * szOp, BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t iTxnPos, int64_t tmStamp, DWORD uReplayFlags, BinlogReader_c & tReader ) const;
-	void	UpdateIndexInfo ( BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t tmStamp ) const;
+	void	UpdateIndexInfo ( BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t tmStamp, bool bApplyDeferred ) const;
 
 	void	WriteBlopHeader ( int64_t * pTID, Blop_e eBlop, const char * szIndexName );
 };
@@ -899,6 +1027,90 @@ struct ChunkStats_t
 	}
 };
 
+// RAM segments frozen by commit (they're in the double buffer now) which are about to be saved as disk chunk
+struct FrozenRamChunk_t
+{
+	SphChunkGuard_t		m_tGuard;
+	ChunkStats_t		m_tStats;
+	int64_t				m_iTID = 0;
+};
+
+/// docid filter of a single disk chunk (rt_docid_map=1)
+/// Bloom filter over alive docids of the chunk, about 1 byte per doc; false positive just costs a lookup in the chunk
+/// chunk never gets new docids, and killed ones just pass the filter and kill nothing
+struct DocidChunkFilter_t
+{
+	static const int			HASHES = 4;
+
+	int64_t						m_iChunkId;
+	CSphFixedVector<uint64_t>	m_dBits { 0 };
+	uint64_t					m_uMask = 0;
+
+	DocidChunkFilter_t ( int64_t iChunkId, const CSphVector<DocID_t> & dDocs )
+		: m_iChunkId ( iChunkId )
+	{
+		// 8 bits per doc, rounded up to power of 2
+		int64_t iBits = 64;
+		while ( iBits < (int64_t)dDocs.GetLength()*8 )
+			iBits <<= 1;
+
+		m_dBits.Reset ( iBits/64 );
+		m_dBits.ZeroVec();
+		m_uMask = iBits-1;
+
+		for ( DocID_t tDocID : dDocs )
+		{
+			uint64_t uHash = sphFNV64 ( &tDocID, sizeof(tDocID) );
+			uint64_t uStep = ( uHash>>32 ) | 1;
+			for ( int i=0; i<HASHES; ++i, uHash+=uStep )
+				m_dBits[( uHash & m_uMask )>>6] |= 1ULL << ( uHash & 63 );
+		}
+	}
+
+	bool MayContain ( DocID_t tDocID ) const
+	{
+		uint64_t uHash = sphFNV64 ( &tDocID, sizeof(tDocID) );
+		uint64_t uStep = ( uHash>>32 ) | 1;
+		for ( int i=0; i<HASHES; ++i, uHash+=uStep )
+			if ( !( m_dBits[( uHash & m_uMask )>>6] & ( 1ULL << ( uHash & 63 ) ) ) )
+				return false;
+
+		return true;
+	}
+
+	int64_t GetMemUsed () const { return sizeof(*this) + m_dBits.GetLengthBytes64(); }
+};
+
+/// docid filters of disk chunks (rt_docid_map=1); route REPLACE/DELETE kills only to the chunks which might hold the doc
+/// filters are built once per chunk; ones of gone (merged, dropped) chunks are just dropped on sync
+struct DocidChunkMap_t
+{
+	CSphVector<DocidChunkFilter_t *>	m_dFilters;	///< in m_dDiskChunks order after sync
+
+	~DocidChunkMap_t ()
+	{
+		for ( auto & pFilter : m_dFilters )
+			SafeDelete ( pFilter );
+	}
+
+	int Find ( int64_t iChunkId ) const
+	{
+		ARRAY_FOREACH ( i, m_dFilters )
+			if ( m_dFilters[i]->m_iChunkId==iChunkId )
+				return i;
+
+		return -1;
+	}
+
+	int64_t GetMemUsed () const
+	{
+		int64_t iRam = sizeof(*this) + m_dFilters.GetLengthBytes64();
+		for ( const auto * pFilter : m_dFilters )
+			iRam += pFilter->GetMemUsed();
+		return iRam;
+	}
+};
+
 template<typename IDX>
 CSphFixedVector<int> GetChunkNames ( const VecTraits_T<IDX> & dIndexes )
 {
@@ -943,6 +1155,9 @@ public:
 	bool				Commit ( int * pDeleted, RtAccum_t * pAccExt ) final;
 	void				RollBack ( RtAccum_t * pAccExt ) final;
 	bool				CommitReplayable ( RtSegment_t * pNewSeg, const CSphVector<DocID_t> & dAccKlist, int * pTotalKilled, bool bForceDump ) EXCLUDES (m_tChunkLock); // FIXME? protect?
+	bool				CommitBulk ( RtSegment_t * pNewSeg, const CSphVector<DocID_t> & dAccKlist, int * pTotalKilled ) EXCLUDES ( m_tWriting ) EXCLUDES ( m_tChunkLock );
+	void				MergeRamSegments () final EXCLUDES ( m_tWriting );
+	void				SaveFrozenRamChunk () final EXCLUDES ( m_tWriting );
 	void				ForceRamFlush ( const char * szReason ) EXCLUDES ( m_tFlushLock ) final;
 	bool				IsFlushNeed() const final;
 	bool				ForceDiskChunk() final;
@@ -1066,6 +1281,15 @@ private:
 	CSphVector<DocID_t>			m_dKillsWhileSaving GUARDED_BY ( m_tWriting );	///< documents killed in ram chunks while we were saving disk chunks (double-buffered)
 	CSphVector<DocID_t>			m_dKillsWhileOptimizing GUARDED_BY ( m_tOptimizingLock );
 
+	/// background merge of RAM segments (commit only appends new segment and schedules the merge)
+	CSphMutex					m_tMergeLock;		///< serializes background mergers of the same index
+	std::atomic<bool>			m_bMergeScheduled {false};	///< set and reset under m_tWriting
+	bool						m_bMergingNow GUARDED_BY ( m_tWriting ) = false;
+	CSphVector<DocID_t>			m_dKillsWhileMerging GUARDED_BY ( m_tWriting );	///< documents killed in RAM segments while they were being merged
+	std::atomic<int64_t>		m_iMergesDone {0};
+	std::atomic<int64_t>		m_iMergedBytes {0};
+	std::atomic<int64_t>		m_iMergeTimeUs {0};
+
 	/// double buffer stuff (allows to work with RAM chunk while future disk is being saved)
 	/// m_dSegments consists of two parts
 	/// segments with indexes < m_iDoubleBuffer are being saved now as a disk chunk
@@ -1074,7 +1298,12 @@ private:
 	CSphMutex					m_tOptimizingLock;
 	int							m_iDoubleBuffer = 0;
 	CSphMutex					m_tSaveFinished;
+	sph::Event_c				m_tSaveDone;		///< signalled under m_tSaveFinished when m_bDoubleDump gets reset
 	volatile bool				m_bDoubleDump = false;
+	CSphScopedPtr<FrozenRamChunk_t>	m_pFrozenChunk GUARDED_BY ( m_tWriting ) { nullptr };	///< passed from commit to background flush task
+	CSphMutex					m_tDocidMapLock;
+	CSphScopedPtr<DocidChunkMap_t>	m_pDocidMap GUARDED_BY ( m_tDocidMapLock ) { nullptr };	///< lazily synced with m_dDiskChunks
+	std::atomic<int64_t>		m_iDocidMapRam { 0 };
 
 	int64_t						m_iSoftRamLimit;
 	int64_t						m_iDoubleBufferLimit;
@@ -1122,6 +1351,9 @@ private:
 	void						SaveDiskData ( const char * szFilename, const SphChunkGuard_t & tGuard, const ChunkStats_t & tStats ) const;
 	bool						SaveDiskChunk ( int64_t iTID, const SphChunkGuard_t & tGuard, const ChunkStats_t & tStats, bool bForced, int * pSavedChunkId, StrVec_t & dWarnings )
 									EXCLUDES ( m_tWriting ) EXCLUDES ( m_tChunkLock );
+	void						FreezeRamChunk ( FrozenRamChunk_t & tFrozen, int64_t iTID ) REQUIRES ( m_tWriting );
+	bool						DumpFrozenRamChunk ( const FrozenRamChunk_t & tFrozen, bool bForced ) EXCLUDES ( m_tWriting );
+	void						GetSegmentFieldLens ( const RtSegment_t * pSeg, CSphVector<int64_t> & dLens ) const;
 
 	CSphIndex *					PreallocDiskChunk ( const char * szChunk, int iChunk, FilenameBuilder_i * pFilenameBuilder, StrVec_t & dWarnings, CSphString & sError, const char * sName=nullptr ) const;
 	bool						LoadRamChunk ( DWORD uVersion, bool bRebuildInfixes );
@@ -1146,6 +1378,9 @@ private:
 	RtSegmentRefPtf_t			AdoptSegment ( RtSegment_t * pNewSeg );
 
 	int							ApplyKillList ( const CSphVector<DocID_t> & dAccKlist );
+	int							KillInDiskChunks ( const CSphVector<DocID_t> & dAccKlist );
+	void						PrepareDocidMap ( const CSphVector<DocID_t> & dAccKlist );
+	void						SyncDocidMap () REQUIRES ( m_tDocidMapLock );
 
 	void						Update_CollectRowPtrs ( UpdateContext_t & tCtx, const SphChunkGuard_t & tGuard );
 	bool						Update_WriteBlobRow ( UpdateContext_t & tCtx, int iUpd, CSphRowitem * pDocinfo, const BYTE * pBlob, int iLength, int nBlobAttrs, bool & bCritical, CSphString & sError ) override;
@@ -1154,7 +1389,8 @@ private:
 	void						GetIndexFiles ( CSphVector<CSphString> & dFiles, const FilenameBuilder_i * pParentBuilder ) const override;
 	DocstoreBuilder_i::Doc_t *	FetchDocFields ( DocstoreBuilder_i::Doc_t & tStoredDoc, CSphSource_StringVector & tSrc ) const;
 
-	bool						MergeSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments, bool bForceDump, int64_t iMemLimit, bool bHasNewSegment );
+	bool						MergeSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments, bool bForceDump, int64_t iMemLimit, bool bHasNewSegment ) REQUIRES ( m_tWriting );
+	bool						MergeSegmentsStep () EXCLUDES ( m_tWriting );
 	RtSegmentRefPtf_t			MergeDoubleBufSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments ) const;
 	bool						NeedStoreWordID () const override;
 	int64_t						GetMemLimit() const final { return m_iSoftRamLimit; }
@@ -1629,6 +1865,17 @@ int RtAccum_t::GetPackedLen () const
 		return m_pDictRt->GetPackedLen();
 }
 
+int64_t RtAccum_t::GetUsedRam () const
+{
+	int64_t iUsed = m_dAccum.AllocatedBytes() + m_dAccumRows.AllocatedBytes() + m_dBlobs.AllocatedBytes() + m_dPerDocHitsCount.AllocatedBytes();
+	if ( m_pDocstore.Ptr() )
+		iUsed += m_pDocstore->AllocatedBytes();
+	if ( m_pDictRt )
+		iUsed += GetPackedLen();
+
+	return iUsed;
+}
+
 void RtAccum_t::Sort ()
 {
 	if ( !m_bKeywordDict )
@@ -1818,6 +2065,87 @@ void RtAccum_t::AddDocument ( ISphHits * pHits, const CSphMatch & tDoc, bool bRe
 }
 
 
+// move docs accumulated by another (per-worker) accumulator of the same index to the end of this one
+void RtAccum_t::Append ( RtAccum_t & tSrc )
+{
+	MEMORY ( MEM_RT_ACCUM );
+
+	assert ( m_pIndex && tSrc.m_pIndex==m_pIndex );
+	assert ( m_bKeywordDict==tSrc.m_bKeywordDict );
+	if ( !tSrc.m_uAccumDocs )
+		return;
+
+	const CSphSchema & tSchema = m_pIndex->GetInternalSchema();
+	int iRowSize = tSchema.GetRowSize();
+	auto tRowOff = (RowID_t)m_dPerDocHitsCount.GetLength();
+	auto tSrcRows = (RowID_t)tSrc.m_dPerDocHitsCount.GetLength();
+
+	// rows; blob locators are relative to the blob pool, so shift them
+	int iFirstRow = m_dAccumRows.GetLength();
+	m_dAccumRows.Append ( tSrc.m_dAccumRows );
+	const CSphColumnInfo * pBlobLoc = tSchema.GetAttr ( sphGetBlobLocatorName() );
+	if ( pBlobLoc && m_dBlobs.GetLength() )
+	{
+		CSphAttrLocator tLoc = pBlobLoc->m_tLocator;
+		for ( int i=iFirstRow; i<m_dAccumRows.GetLength(); i+=iRowSize )
+		{
+			CSphRowitem * pRow = &m_dAccumRows[i];
+			sphSetRowAttr ( pRow, tLoc, sphGetRowAttr ( pRow, tLoc ) + m_dBlobs.GetLength() );
+		}
+	}
+	m_dBlobs.Append ( tSrc.m_dBlobs );
+
+	// hits; keyword dict ids are offsets into the per-accum packed keywords, so remap them
+	int iFirstHit = m_dAccum.GetLength();
+	m_dAccum.Append ( tSrc.m_dAccum );
+	if ( m_bKeywordDict )
+	{
+		assert ( m_pDictRt );
+		const BYTE * pSrcKeywords = tSrc.GetPackedKeywords();
+		OpenHash_T<SphWordID_t, SphWordID_t> hWords ( 1024 );
+		SphWordID_t tLastSrc = 0, tLastDst = 0;
+		for ( int i=iFirstHit; i<m_dAccum.GetLength(); ++i )
+		{
+			CSphWordHit & tHit = m_dAccum[i];
+			tHit.m_tRowID += tRowOff;
+			if ( tHit.m_uWordID!=tLastSrc )
+			{
+				tLastSrc = tHit.m_uWordID;
+				SphWordID_t * pDst = hWords.Find ( tLastSrc );
+				if ( pDst )
+					tLastDst = *pDst;
+				else
+				{
+					tLastDst = m_pDictRt->AddPackedKeyword ( pSrcKeywords + tLastSrc );
+					hWords.Add ( tLastSrc, tLastDst );
+				}
+			}
+			tHit.m_uWordID = tLastDst;
+		}
+	} else
+	{
+		for ( int i=iFirstHit; i<m_dAccum.GetLength(); ++i )
+			m_dAccum[i].m_tRowID += tRowOff;
+	}
+
+	m_dPerDocHitsCount.Append ( tSrc.m_dPerDocHitsCount );
+
+	if ( tSrc.m_pDocstore.Ptr() )
+	{
+		SetupDocstore();
+		for ( RowID_t i=0; i<tSrcRows; ++i )
+			m_pDocstore->AddPackedDoc ( tRowOff+i, tSrc.m_pDocstore.Ptr(), i );
+	}
+
+	m_dAccumKlist.Append ( tSrc.m_dAccumKlist );
+	m_uAccumDocs += tSrc.m_uAccumDocs;
+	m_tNextRowID = tRowOff + tSrcRows;
+	m_bReplace = tSrc.m_bReplace;
+
+	tSrc.Cleanup();
+}
+
+
 // cook checkpoints - make NULL terminating strings from offsets
 static void FixupSegmentCheckpoints ( RtSegment_t * pSeg )
 {
@@ -2491,6 +2819,7 @@ RtSegment_t * RtIndex_c::MergeSegments ( const RtSegment_t * pSeg1, const RtSegm
 	BuildSegmentInfixes ( pSeg, bHasMorphology, m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ), m_tSettings.m_eHitless );
 
 	pSeg->BuildDocID2RowIDMap();
+	pSeg->MoveToArena();
 
 	assert ( pSeg->m_dRows.GetLength() );
 	assert ( pSeg->m_uRows );
@@ -2526,7 +2855,13 @@ bool RtIndex_c::Commit ( int * pDeleted, RtAccum_t * pAccExt )
 	assert ( !pNewSeg || pNewSeg->m_uRows>0 );
 	assert ( !pNewSeg || pNewSeg->m_tAliveRows>0 );
 
-	BuildSegmentInfixes ( pNewSeg, m_pDict->HasMorphology(), m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ), m_tSettings.m_eHitless );
+	// bulk segment goes straight to disk, and disk chunk builds its own infixes
+	// the others get packed here, as writers are not locked out yet
+	if ( !pAcc->m_bBulk && pNewSeg )
+	{
+		BuildSegmentInfixes ( pNewSeg, m_pDict->HasMorphology(), m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ), m_tSettings.m_eHitless );
+		pNewSeg->MoveToArena();
+	}
 
 	// clean up parts we no longer need
 	pAcc->CleanupPart();
@@ -2535,7 +2870,11 @@ bool RtIndex_c::Commit ( int * pDeleted, RtAccum_t * pAccExt )
 	pAcc->m_dAccumKlist.Uniq ();
 
 	// now on to the stuff that needs locking and recovery
-	bool bOk = CommitReplayable ( pNewSeg, pAcc->m_dAccumKlist, pDeleted, false );
+	bool bOk;
+	if ( pAcc->m_bBulk && pNewSeg )
+		bOk = CommitBulk ( pNewSeg, pAcc->m_dAccumKlist, pDeleted );
+	else
+		bOk = CommitReplayable ( pNewSeg, pAcc->m_dAccumKlist, pDeleted, false );
 
 	// done; cleanup accum
 	pAcc->Cleanup();
@@ -2577,9 +2916,11 @@ int RtIndex_c::ApplyKillList ( const CSphVector<DocID_t> & dAccKlist )
 	if ( m_bOptimizing )
 		m_dKillsWhileOptimizing.Append ( dAccKlist );
 
+	if ( m_bMergingNow )
+		m_dKillsWhileMerging.Append ( dAccKlist );
+
 	// chunks got checked under m_tWriting lock - should be safe to check chunks vectors itself
-	for ( auto & pChunk : m_dDiskChunks )
-		iKilled += pChunk->KillMulti ( dAccKlist );
+	iKilled += KillInDiskChunks ( dAccKlist );
 
 	// don't touch the chunks that are being saved
 	for ( int iChunk = m_iDoubleBuffer; iChunk < m_dRamChunks.GetLength(); iChunk++ )
@@ -2588,6 +2929,107 @@ int RtIndex_c::ApplyKillList ( const CSphVector<DocID_t> & dAccKlist )
 	return iKilled;
 }
 
+
+int RtIndex_c::KillInDiskChunks ( const CSphVector<DocID_t> & dAccKlist )
+{
+	int iKilled = 0;
+	ScopedMutex_t tMapLock ( m_tDocidMapLock );
+	if ( !m_tMutableSettings.m_bDocidMap || m_dDiskChunks.IsEmpty() )
+	{
+		m_pDocidMap.Reset();
+		m_iDocidMapRam.store ( 0, std::memory_order_relaxed );
+		for ( auto & pChunk : m_dDiskChunks )
+			iKilled += pChunk->KillMulti ( dAccKlist );
+		return iKilled;
+	}
+
+	SyncDocidMap ();
+
+	// split the kill list by chunks; order is kept, so every part stays sorted
+	// docs passing no filter are not on disk at all
+	const auto & dFilters = m_pDocidMap->m_dFilters;
+	CSphFixedVector<CSphVector<DocID_t>> dChunkKlists { m_dDiskChunks.GetLength() };
+	for ( DocID_t tDocID : dAccKlist )
+		ARRAY_FOREACH ( i, dFilters )
+			if ( dFilters[i]->MayContain ( tDocID ) )
+				dChunkKlists[i].Add ( tDocID );
+
+	ARRAY_FOREACH ( i, dChunkKlists )
+		if ( !dChunkKlists[i].IsEmpty() )
+			iKilled += m_dDiskChunks[i]->KillMulti ( dChunkKlists[i] );
+
+	return iKilled;
+}
+
+
+// builds filters of the disk chunks which have none yet out of the writer lock, so that commit only routes kills
+void RtIndex_c::PrepareDocidMap ( const CSphVector<DocID_t> & dAccKlist )
+{
+	if ( !m_tMutableSettings.m_bDocidMap || dAccKlist.IsEmpty() )
+		return;
+
+	RlChunkGuard_t tGuard ( m_tReading );
+	GetReaderChunks ( tGuard );
+
+	CSphVector<const CSphIndex *> dMissed;
+	{
+		ScopedMutex_t tMapLock ( m_tDocidMapLock );
+		for ( const CSphIndex * pChunk : tGuard.m_dDiskChunks )
+			if ( !m_pDocidMap || m_pDocidMap->Find ( pChunk->GetIndexId() )<0 )
+				dMissed.Add ( pChunk );
+	}
+
+	for ( const CSphIndex * pChunk : dMissed )
+	{
+		auto * pFilter = new DocidChunkFilter_t ( pChunk->GetIndexId(), pChunk->BuildAliveDocList() );
+
+		ScopedMutex_t tMapLock ( m_tDocidMapLock );
+		if ( !m_pDocidMap )
+			m_pDocidMap = new DocidChunkMap_t;
+
+		// concurrent commit might build it meanwhile
+		if ( m_pDocidMap->Find ( pFilter->m_iChunkId )>=0 )
+		{
+			SafeDelete ( pFilter );
+			continue;
+		}
+
+		m_pDocidMap->m_dFilters.Add ( pFilter );
+		m_iDocidMapRam.store ( m_pDocidMap->GetMemUsed(), std::memory_order_relaxed );
+	}
+}
+
+
+void RtIndex_c::SyncDocidMap ()
+{
+	if ( !m_pDocidMap )
+		m_pDocidMap = new DocidChunkMap_t;
+
+	auto & dFilters = m_pDocidMap->m_dFilters;
+
+	// order filters as the chunks; build ones of chunks appeared after prepare (rare)
+	CSphVector<DocidChunkFilter_t *> dSynced;
+	dSynced.Reserve ( m_dDiskChunks.GetLength() );
+	for ( const CSphIndex * pChunk : m_dDiskChunks )
+	{
+		int iFilter = m_pDocidMap->Find ( pChunk->GetIndexId() );
+		if ( iFilter>=0 )
+		{
+			dSynced.Add ( dFilters[iFilter] );
+			dFilters.RemoveFast ( iFilter );
+		} else
+			dSynced.Add ( new DocidChunkFilter_t ( pChunk->GetIndexId(), pChunk->BuildAliveDocList() ) );
+	}
+
+	// left ones belong to merged, dropped or truncated chunks
+	for ( auto & pFilter : dFilters )
+		SafeDelete ( pFilter );
+
+	dFilters.SwapData ( dSynced );
+	m_iDocidMapRam.store ( m_pDocidMap->GetMemUsed(), std::memory_order_relaxed );
+}
+
+
 static void RemoveEmptySegments ( CSphVector<RtSegmentRefPtf_t> & dSegments )
 {
 	ARRAY_FOREACH ( i, dSegments )
@@ -2602,6 +3044,85 @@ static void RemoveEmptySegments ( CSphVector<RtSegmentRefPtf_t> & dSegments )
 	}
 }
 
+static RtMergeSegmentsHook_fn g_pfnScheduleMergeSegments = nullptr;
+
+void SetRtMergeSegmentsHook ( RtMergeSegmentsHook_fn fnHook )
+{
+	g_pfnScheduleMergeSegments = fnHook;
+}
+
+static RtSaveDiskChunkHook_fn g_pfnScheduleSaveDiskChunk = nullptr;
+
+void SetRtSaveDiskChunkHook ( RtSaveDiskChunkHook_fn fnHook )
+{
+	g_pfnScheduleSaveDiskChunk = fnHook;
+}
+
+static const int MAX_SEGMENTS = 32;
+static const int MAX_PROGRESSION_SEGMENT = 8;
+static const int64_t MAX_SEGMENT_VECTOR_LEN = INT_MAX;
+
+enum class SegmentsMerge_e
+{
+	NONE,	// policy is kept, nothing to merge
+	MERGE,	// two last (smallest) segments have to be merged
+	DUMP	// can't merge anymore, ram chunk has to be saved
+};
+
+// sorts segments (large first, smallest last) and checks whether the last two should be merged now
+// merge is unconditional if there's too much segments, and conditional if smallest segment has grown too large
+static SegmentsMerge_e CheckMergeSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments, int64_t iRamLeft, int iMinSegments )
+{
+	dSegments.Sort ( Lesser (
+			[] ( RtSegment_t * a, RtSegment_t * b ) { return a->GetMergeFactor ()>b->GetMergeFactor (); } ) );
+
+	const int iLen = dSegments.GetLength();
+	if ( iLen < iMinSegments )
+		return SegmentsMerge_e::NONE;
+	assert ( iLen>=2 );
+	// exit if progression is kept AND lesser MAX_SEGMENTS limit
+	if ( dSegments[iLen-2]->GetMergeFactor() > dSegments[iLen-1]->GetMergeFactor()*2 && iLen < MAX_SEGMENTS )
+		return SegmentsMerge_e::NONE;
+
+	// check whether we have enough RAM
+#define LOC_ESTIMATE1(_seg,_vec) (int64_t)( ( (int64_t)(_seg)->_vec.GetLength() ) * (_seg)->m_tAliveRows / (_seg)->m_uRows )
+#define LOC_ESTIMATE0(_vec) ( LOC_ESTIMATE1 ( dSegments[iLen-1], _vec ) + LOC_ESTIMATE1 ( dSegments[iLen-2], _vec ) )
+#define LOC_ESTIMATE(_vec) ( dSegments[iLen-1]->_vec.Relimit( 0, LOC_ESTIMATE0 ( _vec ) ) )
+
+	using namespace sph;
+	int64_t iWordsRelimit =	LOC_ESTIMATE ( m_dWords );
+	int64_t iDocsRelimit =	LOC_ESTIMATE ( m_dDocs );
+	int64_t iHitsRelimit =	LOC_ESTIMATE ( m_dHits );
+	int64_t iBlobsRelimit = LOC_ESTIMATE ( m_dBlobs );
+	int64_t iKeywordsRelimit = LOC_ESTIMATE ( m_dKeywordCheckpoints );
+	int64_t iRowsRelimit =	LOC_ESTIMATE ( m_dRows );
+
+#undef LOC_ESTIMATE
+#undef LOC_ESTIMATE0
+#undef LOC_ESTIMATE1
+
+	int64_t iEstimate = iWordsRelimit + iDocsRelimit + iHitsRelimit + iBlobsRelimit + iKeywordsRelimit + iRowsRelimit;
+	if ( iEstimate>iRamLeft )
+	{
+		// dump case: can't merge any more AND segments count limit's reached
+		return ( iLen>=MAX_SEGMENTS ) ? SegmentsMerge_e::DUMP : SegmentsMerge_e::NONE;
+	}
+
+	// we have to dump if we can't merge even smallest segments without breaking vector constrain ( len<INT_MAX )
+	// split this way to avoid superlong string after macro expansion that kills gcov
+	int64_t iMaxLen = Max (
+		Max ( iWordsRelimit, iDocsRelimit ),
+		Max ( iHitsRelimit, iBlobsRelimit ) );
+	iMaxLen = Max (
+		Max ( iRowsRelimit, iKeywordsRelimit ),
+		iMaxLen );
+
+	if ( MAX_SEGMENT_VECTOR_LEN<iMaxLen )
+		return SegmentsMerge_e::DUMP;
+
+	return SegmentsMerge_e::MERGE;
+}
+
 // returns bool meaning 'can't merge, need to flush ramchunk'.
 bool RtIndex_c::MergeSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments, bool bForceDump, int64_t iMemLimit, bool bHasNewSegment )
 {
@@ -2622,64 +3143,18 @@ bool RtIndex_c::MergeSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments, bool
 		return bDump;
 	}
 
-	bool bHasMorphology = m_pDict->HasMorphology();
+	// with background merger commit only keeps hard limit of segments, the rest is merged by the task
+	bool bBackground = ( g_pfnScheduleMergeSegments!=nullptr );
+	int iMinSegments = bBackground ? MAX_SEGMENTS : MAX_SEGMENTS - MAX_PROGRESSION_SEGMENT;
 
-	const int MAX_SEGMENTS = 32;
-	const int MAX_PROGRESSION_SEGMENT = 8;
-	const int64_t MAX_SEGMENT_VECTOR_LEN = INT_MAX;
+	bool bHasMorphology = m_pDict->HasMorphology();
 	while ( iRamLeft>0 )
 	{
-		// segments sort order: large first, smallest last
-		// merge last smallest segments
-		dSegments.Sort ( Lesser (
-				[] ( RtSegment_t * a, RtSegment_t * b ) { return a->GetMergeFactor ()>b->GetMergeFactor (); } ) );
-
-		// unconditionally merge if there's too much segments now
-		// conditionally merge if smallest segment has grown too large
-		// otherwise, we're done
-		const int iLen = dSegments.GetLength();
-		if ( iLen < ( MAX_SEGMENTS - MAX_PROGRESSION_SEGMENT ) )
-			break;
-		assert ( iLen>=2 );
-		// exit if progression is kept AND lesser MAX_SEGMENTS limit
-		if ( dSegments[iLen-2]->GetMergeFactor() > dSegments[iLen-1]->GetMergeFactor()*2 && iLen < MAX_SEGMENTS )
-			break;
-
-		// check whether we have enough RAM
-#define LOC_ESTIMATE1(_seg,_vec) (int64_t)( ( (int64_t)(_seg)->_vec.GetLength() ) * (_seg)->m_tAliveRows / (_seg)->m_uRows )
-#define LOC_ESTIMATE0(_vec) ( LOC_ESTIMATE1 ( dSegments[iLen-1], _vec ) + LOC_ESTIMATE1 ( dSegments[iLen-2], _vec ) )
-#define LOC_ESTIMATE(_vec) ( dSegments[iLen-1]->_vec.Relimit( 0, LOC_ESTIMATE0 ( _vec ) ) )
-
-		using namespace sph;
-		int64_t iWordsRelimit =	LOC_ESTIMATE ( m_dWords );
-		int64_t iDocsRelimit =	LOC_ESTIMATE ( m_dDocs );
-		int64_t iHitsRelimit =	LOC_ESTIMATE ( m_dHits );
-		int64_t iBlobsRelimit = LOC_ESTIMATE ( m_dBlobs );
-		int64_t iKeywordsRelimit = LOC_ESTIMATE ( m_dKeywordCheckpoints );
-		int64_t iRowsRelimit =	LOC_ESTIMATE ( m_dRows );
-
-#undef LOC_ESTIMATE
-#undef LOC_ESTIMATE0
-#undef LOC_ESTIMATE1
-
-		int64_t iEstimate = iWordsRelimit + iDocsRelimit + iHitsRelimit + iBlobsRelimit + iKeywordsRelimit + iRowsRelimit;
-		if ( iEstimate>iRamLeft )
-		{
-			// dump case: can't merge any more AND segments count limit's reached
-			bDump = ( iRamLeft<=iEstimate ) && ( iLen>=MAX_SEGMENTS );
+		SegmentsMerge_e eMerge = CheckMergeSegments ( dSegments, iRamLeft, iMinSegments );
+		if ( eMerge==SegmentsMerge_e::NONE )
 			break;
-		}
-
-		// we have to dump if we can't merge even smallest segments without breaking vector constrain ( len<INT_MAX )
-		// split this way to avoid superlong string after macro expansion that kills gcov
-		int64_t iMaxLen = Max (
-			Max ( iWordsRelimit, iDocsRelimit ),
-			Max ( iHitsRelimit, iBlobsRelimit ) );
-		iMaxLen = Max (
-			Max ( iRowsRelimit, iKeywordsRelimit ),
-			iMaxLen );
 
-		if ( MAX_SEGMENT_VECTOR_LEN<iMaxLen )
+		if ( eMerge==SegmentsMerge_e::DUMP )
 		{
 			bDump = true;
 			break;
@@ -2698,26 +3173,145 @@ bool RtIndex_c::MergeSegments ( CSphVector<RtSegmentRefPtf_t> & dSegments, bool
 
 	RemoveEmptySegments ( dSegments );
 
+	if ( !bDump && bBackground && !m_bMergeScheduled
+		&& CheckMergeSegments ( dSegments, iRamLeft, MAX_SEGMENTS - MAX_PROGRESSION_SEGMENT )==SegmentsMerge_e::MERGE )
+	{
+		m_bMergeScheduled = true;
+		g_pfnScheduleMergeSegments ( m_sIndexName );
+	}
+
 	return bDump;
 }
 
+// merges one pair of RAM segments without holding writers; returns false when there is nothing to merge
+bool RtIndex_c::MergeSegmentsStep ()
+{
+	RtSegmentRefPtf_t pA, pB;
+	{
+		ScopedMutex_t tWriting ( m_tWriting );
+
+		// segments behind double buffer are saving now, these will be merged by SaveDiskChunk
+		if ( m_bSaveDisabled || m_iDoubleBuffer>0 )
+		{
+			m_bMergeScheduled = false;
+			return false;
+		}
+
+		CSphVector<RtSegmentRefPtf_t> dSegments;
+		dSegments.Reserve ( m_dRamChunks.GetLength() );
+		for ( auto & pSeg : m_dRamChunks )
+			if ( pSeg->m_tAliveRows.load ( std::memory_order_relaxed ) )
+				dSegments.Add ( pSeg );
+
+		if ( CheckMergeSegments ( dSegments, SegmentsGetRamLeft ( dSegments, m_iSoftRamLimit ), MAX_SEGMENTS - MAX_PROGRESSION_SEGMENT )!=SegmentsMerge_e::MERGE )
+		{
+			m_bMergeScheduled = false;
+			return false;
+		}
+
+		pA = dSegments[dSegments.GetLength()-1];
+		pB = dSegments[dSegments.GetLength()-2];
+
+		// from now on commits collect their kills, as merge reads dead rows of the sources
+		m_bMergingNow = true;
+		m_dKillsWhileMerging.Reset();
+	}
+
+	int64_t tmMerge = sphMicroTimer();
+	int64_t iSrcBytes = pA->GetUsedRam() + pB->GetUsedRam();
+	RtSegmentRefPtf_t pMerged { MergeSegments ( pA, pB, m_pDict->HasMorphology() ) };
+	tmMerge = sphMicroTimer() - tmMerge;
+
+	ScopedMutex_t tWriting ( m_tWriting );
+	m_bMergingNow = false;
+
+	// sources might be frozen by disk chunk save or merged by commit in the meantime; then the result is useless
+	int iA = -1, iB = -1;
+	for ( int i = m_iDoubleBuffer; i<m_dRamChunks.GetLength(); ++i )
+	{
+		if ( m_dRamChunks[i]==pA )
+			iA = i;
+		else if ( m_dRamChunks[i]==pB )
+			iB = i;
+	}
+
+	if ( iA<0 || iB<0 )
+	{
+		m_dKillsWhileMerging.Reset();
+		return true;
+	}
+
+	// apply kills that merged segment missed
+	if ( pMerged && m_dKillsWhileMerging.GetLength() )
+	{
+		m_dKillsWhileMerging.Uniq();
+		pMerged->KillMulti ( m_dKillsWhileMerging );
+	}
+	m_dKillsWhileMerging.Reset();
+
+	CSphVector<RtSegmentRefPtf_t> dSegments;
+	dSegments.Reserve ( m_dRamChunks.GetLength() );
+	ARRAY_FOREACH ( i, m_dRamChunks )
+		if ( i!=iA && i!=iB )
+			dSegments.Add ( m_dRamChunks[i] );
+	if ( pMerged && pMerged->m_tAliveRows.load ( std::memory_order_relaxed ) )
+		dSegments.Add ( AdoptSegment ( pMerged ) );
+
+	pA = nullptr;
+	pB = nullptr;
+
+	// go live!
+	{
+		ScWL_t tChunksWLock ( m_tChunkLock );
+		m_dRamChunks.Resize ( 0 );
+		m_dRamChunks.Append ( dSegments );
+		m_dRamChunks.ZeroTail ();
+	}
+
+	m_iMergesDone.fetch_add ( 1, std::memory_order_relaxed );
+	m_iMergedBytes.fetch_add ( iSrcBytes, std::memory_order_relaxed );
+	m_iMergeTimeUs.fetch_add ( tmMerge, std::memory_order_relaxed );
+	return true;
+}
+
+void RtIndex_c::MergeRamSegments ()
+{
+	ScopedMutex_t tMergeLock ( m_tMergeLock );
+	while ( MergeSegmentsStep() )
+		if ( sphInterrupted() )
+		{
+			// let the next commit schedule the merge again
+			ScopedMutex_t tWriting ( m_tWriting );
+			m_bMergeScheduled = false;
+			return;
+		}
+}
+
+void RtIndex_c::GetSegmentFieldLens ( const RtSegment_t * pSeg, CSphVector<int64_t> & dLens ) const
+{
+	int iFirstFieldLenAttr = m_tSchema.GetAttrId_FirstFieldLen();
+	if ( !pSeg || iFirstFieldLenAttr<0 )
+		return;
+
+	assert ( pSeg->GetStride()==m_iStride );
+	int iFields = m_tSchema.GetFieldsCount(); // shortcut
+	dLens.Resize ( iFields );
+	dLens.Fill ( 0 );
+	for ( DWORD i=0; i<pSeg->m_uRows; ++i )
+		for ( int j=0; j<iFields; ++j )
+			dLens[j] += sphGetRowAttr ( pSeg->GetDocinfoByRowID(i), m_tSchema.GetAttr ( j+iFirstFieldLenAttr ).m_tLocator );
+}
+
 bool RtIndex_c::CommitReplayable ( RtSegment_t * pNewSeg, const CSphVector<DocID_t> & dAccKlist, int * pTotalKilled, bool bForceDump )
 {
 	// store statistics, because pNewSeg just might get merged
 	int iNewDocs = pNewSeg ? pNewSeg->m_uRows : 0;
 
 	CSphVector<int64_t> dLens;
-	int iFirstFieldLenAttr = m_tSchema.GetAttrId_FirstFieldLen();
-	if ( pNewSeg && iFirstFieldLenAttr>=0 )
-	{
-		assert ( pNewSeg->GetStride()==m_iStride );
-		int iFields = m_tSchema.GetFieldsCount(); // shortcut
-		dLens.Resize ( iFields );
-		dLens.Fill ( 0 );
-		for ( DWORD i=0; i<pNewSeg->m_uRows; ++i )
-			for ( int j=0; j<iFields; ++j )
-				dLens[j] += sphGetRowAttr ( pNewSeg->GetDocinfoByRowID(i), m_tSchema.GetAttr ( j+iFirstFieldLenAttr ).m_tLocator );
-	}
+	GetSegmentFieldLens ( pNewSeg, dLens );
+
+	// heavy part of docid map goes before writers are locked out
+	PrepareDocidMap ( dAccKlist );
 
 	// phase 1, lock out other writers (but not readers yet)
 	// concurrent readers are ok during merges, as existing segments won't be modified yet
@@ -2729,18 +3323,26 @@ bool RtIndex_c::CommitReplayable ( RtSegment_t * pNewSeg, const CSphVector<DocID
 	if ( m_iDoubleBuffer>0 && m_bDoubleDump )
 	{
 		Verify ( m_tWriting.Unlock() );
-		bool bSaving = m_bDoubleDump;
-		while ( bSaving )
 		{
+			// background flush task might be not yet started and so pit-stop isn't yet raised
+			// then sleep till the task signals save done
 			ScopedMutex_t tLock ( m_tSaveFinished );
-			bSaving = m_bDoubleDump;
+			while ( m_bDoubleDump )
+			{
+				m_tSaveDone.Clear ( tLock );
+				m_tSaveDone.Wait ( tLock );
+			}
 		}
 
 		Verify ( m_tWriting.Lock() );
 	}
 
 	// first of all, binlog txn data for recovery
-	g_pRtBinlog->BinlogCommit ( &m_iTID, m_sIndexName.cstr(), pNewSeg, dAccKlist, m_bKeywordDict );
+	if ( !g_pRtBinlog->BinlogCommit ( &m_iTID, m_sIndexName.cstr(), pNewSeg, dAccKlist, m_bKeywordDict, m_sLastError ) )
+	{
+		Verify ( m_tWriting.Unlock() );
+		return false;
+	}
 	int64_t iTID = m_iTID;
 
 	auto dDoubleChunks = m_dRamChunks.Slice ( m_iDoubleBuffer ); // shortcut to slice on doublebuffer
@@ -2789,6 +3391,9 @@ bool RtIndex_c::CommitReplayable ( RtSegment_t * pNewSeg, const CSphVector<DocID
 			m_dFieldLens[i] = m_dFieldLensRam[i] + m_dFieldLensDisk[i];
 		}
 
+	// new data and stats are visible now, stale cached results must miss
+	NextGeneration();
+
 	// tell about DELETE affected_rows
 	if ( pTotalKilled )
 		*pTotalKilled = iTotalKilled;
@@ -2806,43 +3411,59 @@ bool RtIndex_c::CommitReplayable ( RtSegment_t * pNewSeg, const CSphVector<DocID
 		return true;
 	}
 
-	// scope for guard for released segments to clean up
-	bool bSavedOk = false;
-	while ( true )
+	// freeze RAM chunk; from now on all commits go into double buffer
+	CSphScopedPtr<FrozenRamChunk_t> pFrozen ( new FrozenRamChunk_t );
+	FreezeRamChunk ( *pFrozen, iTID );
+
+	// with background flush writer returns right now, and the task saves frozen segments as disk chunk
+	// forced dumps (flush ramchunk, attach, etc.) still expect disk chunk ready on return
+	if ( g_pfnScheduleSaveDiskChunk && !bForceDump )
 	{
-		// copy stats for disk chunk
-		SphChunkGuard_t tGuard;
-		ChunkStats_t tStat2Dump;
+		m_pFrozenChunk = pFrozen.LeakPtr();
+		Verify ( m_tWriting.Unlock() );
+		g_pfnScheduleSaveDiskChunk ( m_sIndexName );
+		return true;
+	}
 
-		{
-			ScRL_t tReading ( m_tReading );
-			GetReaderChunks ( tGuard );
-			tStat2Dump.Init ( m_tStats, m_dFieldLensRam );
-			m_iDoubleBuffer = m_dRamChunks.GetLength ();
-			// can not use tGuard.m_dDiskChunks in SaveDiskChunk after tGuard.m_pReading unlocked below
-			// due to race with Optimize that modified disk chunks
-			// need release m_tReading lock to prevent deadlock - commit vs SaveDiskChunk
-			// chunks will keep till this scope end
-		}
+	Verify ( m_tWriting.Unlock() );
 
-		Verify ( m_tWriting.Unlock() );
+	// create pit-stop for further clients these overflows double-buffer
+	// but need release them only after ram chunk guard will free segments
+	// otherwise there will be another save of tiny disk chunk
+	// as segments these released still count as used memory till readers release them
+	m_tSaveFinished.Lock();
+	return DumpFrozenRamChunk ( *pFrozen, bForceDump );
+}
 
-		// create pit-stop for further clients these overflows double-buffer
-		// but need release them only after ram chunk guard will free segments
-		// otherwise there will be another save of tiny disk chunk
-		// as segments these released still count as used memory till readers release them
-		m_tSaveFinished.Lock();
+void RtIndex_c::FreezeRamChunk ( FrozenRamChunk_t & tFrozen, int64_t iTID )
+{
+	ScRL_t tReading ( m_tReading );
+	GetReaderChunks ( tFrozen.m_tGuard );
+	tFrozen.m_tStats.Init ( m_tStats, m_dFieldLensRam );
+	tFrozen.m_iTID = iTID;
+	m_iDoubleBuffer = m_dRamChunks.GetLength ();
+	// can not use tGuard.m_dDiskChunks in SaveDiskChunk after tGuard.m_pReading unlocked below
+	// due to race with Optimize that modified disk chunks
+	// need release m_tReading lock to prevent deadlock - commit vs SaveDiskChunk
+	// chunks will keep till frozen chunk is destroyed
+}
 
+// expects m_tSaveFinished locked, and releases it when done
+bool RtIndex_c::DumpFrozenRamChunk ( const FrozenRamChunk_t & tFrozen, bool bForced )
+{
+	bool bSavedOk = false;
+	while ( true )
+	{
 		int iSavedChunkId = -1;
 		// fixme! report warnings
 		StrVec_t dWarnings;
-		if ( !SaveDiskChunk ( iTID, tGuard, tStat2Dump, bForceDump, &iSavedChunkId, dWarnings ) )
+		if ( !SaveDiskChunk ( tFrozen.m_iTID, tFrozen.m_tGuard, tFrozen.m_tStats, bForced, &iSavedChunkId, dWarnings ) )
 		{
 			bSavedOk = false;
 			break;
 		}
 
-		g_pBinlog->NotifyIndexFlush ( m_sIndexName.cstr(), iTID, false );
+		g_pBinlog->NotifyIndexFlush ( m_sIndexName.cstr(), tFrozen.m_iTID, false );
 
 		// notify the disk chunk that we were saving of the documents that were killed while we were saving it
 		ScopedMutex_t tWriteLock ( m_tWriting );
@@ -2869,12 +3490,37 @@ bool RtIndex_c::CommitReplayable ( RtSegment_t * pNewSeg, const CSphVector<DocID
 	}
 
 	// release all clients waiting commit
-	m_bDoubleDump = false;
-	m_tSaveFinished.Unlock();
+	{
+		ScopedMutex_t tLock ( m_tSaveFinished, ScopedMutex_t::adopt_lock );
+		m_bDoubleDump = false;
+		m_tSaveDone.SignalAll ( tLock );
+	}
 
 	return bSavedOk;
 }
 
+void RtIndex_c::SaveFrozenRamChunk ()
+{
+	// same order as in commit: first pit-stop for writers, then writing lock
+	m_tSaveFinished.Lock();
+
+	CSphScopedPtr<FrozenRamChunk_t> pFrozen { nullptr };
+	{
+		ScopedMutex_t tWriteLock ( m_tWriting );
+		pFrozen = m_pFrozenChunk.LeakPtr();
+	}
+
+	// already saved by forced dump
+	if ( !pFrozen )
+	{
+		m_tSaveFinished.Unlock();
+		return;
+	}
+
+	if ( !DumpFrozenRamChunk ( *pFrozen, false ) )
+		sphWarning ( "rt: index %s: background save of disk chunk FAILED! (error=%s)", m_sIndexName.cstr(), m_sLastError.cstr() );
+}
+
 void RtIndex_c::RollBack ( RtAccum_t * pAccExt )
 {
 	assert ( g_bRTChangesAllowed );
@@ -2922,6 +3568,9 @@ bool RtIndex_c::ForceDiskChunk()
 	if ( m_dRamChunks.IsEmpty() || m_bSaveDisabled )
 		return true;
 
+	// finish RAM chunk frozen by previous commit first (if the task didn't yet), otherwise force gets lost in double buffer
+	SaveFrozenRamChunk();
+
 	CSphVector<DocID_t> dTmp;
 	return CommitReplayable ( nullptr, dTmp, nullptr, true );
 }
@@ -2968,7 +3617,7 @@ struct SaveDiskDataContext_t
 
 bool RtIndex_c::WriteAttributes ( SaveDiskDataContext_t & tCtx, CSphString & sError ) const
 {
-	CSphString sSPA, sSPB, sSPT, sSPHI, sSPDS;
+	CSphString sSPA, sSPB, sSPT, sSPHI, sSPDS, sSPIDX;
 	CSphWriter tWriterSPA;
 
 	sSPA.SetSprintf ( "%s%s", tCtx.m_szFilename, sphGetExt(SPH_EXT_SPA).cstr() );
@@ -2976,6 +3625,7 @@ bool RtIndex_c::WriteAttributes ( SaveDiskDataContext_t & tCtx, CSphString & sEr
 	sSPT.SetSprintf ( "%s%s", tCtx.m_szFilename, sphGetExt(SPH_EXT_SPT).cstr() );
 	sSPHI.SetSprintf ( "%s%s", tCtx.m_szFilename, sphGetExt(SPH_EXT_SPHI).cstr() );
 	sSPDS.SetSprintf ( "%s%s", tCtx.m_szFilename, sphGetExt(SPH_EXT_SPDS).cstr() );
+	sSPIDX.SetSprintf ( "%s%s", tCtx.m_szFilename, sphGetExt(SPH_EXT_SPIDX).cstr() );
 
 	if ( !tWriterSPA.OpenFile ( sSPA.cstr(), sError ) )
 		return false;
@@ -3007,6 +3657,9 @@ bool RtIndex_c::WriteAttributes ( SaveDiskDataContext_t & tCtx, CSphString & sEr
 
 	CSphFixedVector<DocidRowidPair_t> dLookup ( tCtx.m_iTotalDocs );
 
+	// secondary indexes are collected from the very rows that go to .spa, as updates might change segments meanwhile
+	SecondaryIndexBuilder_c tSecondaryIndex ( m_tSchema );
+
 	RowID_t tNextRowID = 0;
 	int iStride = m_tSchema.GetRowSize();
 	CSphFixedVector<CSphRowitem> dRow ( iStride );
@@ -3020,13 +3673,23 @@ bool RtIndex_c::WriteAttributes ( SaveDiskDataContext_t & tCtx, CSphString & sEr
 		const CSphRowitem * pRow;
 		while ( !!(pRow=tIt.GetNextAliveRow()) )
 		{
+			if ( !tSecondaryIndex.IsEmpty() )
+			{
+				memcpy ( pNewRow, pRow, iStride*sizeof(CSphRowitem) );
+				pRow = pNewRow;
+
+				// the copy still points to segment blob pool
+				tSecondaryIndex.Collect ( tNextRowID, pRow, pSeg->m_dBlobs.Begin() );
+			}
+
 			tMinMaxBuilder.Collect(pRow);
 			if ( pBlobLocatorAttr )
 			{
 				SphAttr_t tBlobOffset = sphGetRowAttr ( pRow, pBlobLocatorAttr->m_tLocator );
 				SphOffset_t tOffset = pBlobRowBuilder->Flush ( pSeg->m_dBlobs.Begin() + tBlobOffset );
 
-				memcpy ( pNewRow, pRow, iStride*sizeof(CSphRowitem) );
+				if ( pRow!=pNewRow )
+					memcpy ( pNewRow, pRow, iStride*sizeof(CSphRowitem) );
 				sphSetRowAttr ( pNewRow, pBlobLocatorAttr->m_tLocator, tOffset );
 				tWriterSPA.PutBytes ( pNewRow, iStride*sizeof(CSphRowitem) );
 			} else
@@ -3095,6 +3758,9 @@ bool RtIndex_c::WriteAttributes ( SaveDiskDataContext_t & tCtx, CSphString & sEr
 	if ( !tHistogramContainer.Save ( sSPHI, sError ) )
 		return false;
 
+	if ( !tSecondaryIndex.IsEmpty() && tNextRowID && !tSecondaryIndex.Save ( sSPIDX, sError ) )
+		return false;
+
 	tCtx.m_tMinMaxPos = tWriterSPA.GetPos();
 	tCtx.m_uRows = tNextRowID;
 	tCtx.m_iDocinfoIndex = ( dMinMaxRows.GetLength() / m_tSchema.GetRowSize() / 2 ) - 1;
@@ -3674,6 +4340,7 @@ bool RtIndex_c::SaveDiskChunk ( int64_t iTID, const SphChunkGuard_t & tGuard, co
 	}
 
 	Verify ( m_tChunkLock.Unlock() );
+	NextGeneration();
 
 	// abandon .ram file
 	CSphString sChunk;
@@ -4195,6 +4862,7 @@ bool RtIndex_c::LoadRamChunk ( DWORD uVersion, bool bRebuildInfixes )
 			BuildSegmentInfixes ( pSeg, bHasMorphology, m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ), m_tSettings.m_eHitless );
 
 		pSeg->BuildDocID2RowIDMap();
+		pSeg->MoveToArena();
 		dRamChunk = AdoptSegment ( pSeg );
 	}
 
@@ -5903,117 +6571,31 @@ void RtIndex_c::GetReaderChunks ( SphChunkGuard_t & tGuard, const VecTraits_T<in
 		{
 			++iRamSelected;
 			return false;
-		}
-		return true;
-	});
-
-	tGuard.m_dDiskChunks.Reset ( iDiskSelected );
-	for ( int i = 0; i<iDiskSelected; ++i )
-		tGuard.m_dDiskChunks[i] = m_dDiskChunks[dOrderedChunks[i]];
-
-	tGuard.m_dRamChunks.Reset ( iRamSelected );
-	for ( int i = 0; i<iRamSelected; ++i )
-		tGuard.m_dRamChunks[i] = m_dRamChunks[dOrderedChunks[iDiskSelected+i]-iDiskBound];
-}
-
-RlChunkGuard_t::RlChunkGuard_t ( CSphRwlock& tReading )
-	: m_tReading ( tReading )
-{
-	tReading.ReadLock ();
-}
-
-RlChunkGuard_t::~RlChunkGuard_t ()
-{
-	m_tReading.Unlock ();
-}
-
-namespace { // nameless namespace instead of 'static' modifier
-
-struct DiskChunkSearcherCtx_t
-{
-	using Sorters_t = VecTraits_T<ISphMatchSorter *>;
-
-	Sorters_t&			m_dSorters;
-	CSphQueryResultMeta&	m_tMeta;
-
-	DiskChunkSearcherCtx_t ( Sorters_t & dSorters, CSphQueryResultMeta & tMeta )
-		: m_dSorters ( dSorters )
-		, m_tMeta ( tMeta )
-	{}
-
-	// called from finalize.
-	void MergeChild ( DiskChunkSearcherCtx_t dChild ) const
-	{
-		// sorting results
-		ARRAY_CONSTFOREACH ( i, m_dSorters )
-			if ( dChild.m_dSorters[i] )
-				dChild.m_dSorters[i]->MoveTo ( m_dSorters[i] );
-
-		auto& dChildRes = dChild.m_tMeta;
-
-		// word statistics
-		if ( m_tMeta.m_hWordStats.GetLength ())
-			for ( auto & tStat : m_tMeta.m_hWordStats )
-			{
-				const auto * pDstStat = dChildRes.m_hWordStats ( tStat.first );
-				if ( pDstStat )
-					m_tMeta.AddStat ( tStat.first, pDstStat->first, pDstStat->second );
-			}
-		else
-			m_tMeta.m_hWordStats = dChildRes.m_hWordStats;
-
-		// other data (warnings, errors, etc.)
-		// errors
-		if ( !dChildRes.m_sError.IsEmpty ())
-			m_tMeta.m_sError = dChildRes.m_sError;
-
-		// warnings
-		if ( !dChildRes.m_sWarning.IsEmpty ())
-			m_tMeta.m_sWarning = dChildRes.m_sWarning;
-
-		// prediction counters
-		if ( m_tMeta.m_bHasPrediction )
-			m_tMeta.m_tStats.Add ( dChildRes.m_tStats );
+		}
+		return true;
+	});
 
-		// profiling
-		if ( dChildRes.m_pProfile )
-			m_tMeta.m_pProfile->AddMetric ( *dChildRes.m_pProfile );
-	}
+	tGuard.m_dDiskChunks.Reset ( iDiskSelected );
+	for ( int i = 0; i<iDiskSelected; ++i )
+		tGuard.m_dDiskChunks[i] = m_dDiskChunks[dOrderedChunks[i]];
 
-	inline bool IsClonable () const
-	{
-		return m_dSorters.all_of ( [] ( const ISphMatchSorter * p ) { return p->CanBeCloned (); } );
-	}
-};
+	tGuard.m_dRamChunks.Reset ( iRamSelected );
+	for ( int i = 0; i<iRamSelected; ++i )
+		tGuard.m_dRamChunks[i] = m_dRamChunks[dOrderedChunks[iDiskSelected+i]-iDiskBound];
+}
 
-struct DiskChunkSearcherCloneCtx_t
+RlChunkGuard_t::RlChunkGuard_t ( CSphRwlock& tReading )
+	: m_tReading ( tReading )
 {
-	CSphVector<ISphMatchSorter *>	m_dSorters;
-	CSphQueryResultMeta				m_tMeta;
-
-	explicit DiskChunkSearcherCloneCtx_t ( const DiskChunkSearcherCtx_t& dParent )
-	{
-		m_dSorters.Resize ( dParent.m_dSorters.GetLength ());
-		ARRAY_FOREACH ( i, m_dSorters )
-			m_dSorters[i] = dParent.m_dSorters[i]->Clone ();
-
-		m_tMeta.m_bHasPrediction = dParent.m_tMeta.m_bHasPrediction;
-		if ( dParent.m_tMeta.m_pProfile )
-			m_tMeta.m_pProfile = new QueryProfile_c;
-	}
-
-	~DiskChunkSearcherCloneCtx_t()
-	{
-		m_dSorters.Apply ( [] ( ISphMatchSorter *& pSorter ) { SafeDelete ( pSorter ); } );
-		SafeDelete ( m_tMeta.m_pProfile );
-	}
+	tReading.ReadLock ();
+}
 
-	explicit operator DiskChunkSearcherCtx_t()
-	{
-		return { m_dSorters, m_tMeta };
-	}
-};
+RlChunkGuard_t::~RlChunkGuard_t ()
+{
+	m_tReading.Unlock ();
+}
 
+namespace { // nameless namespace instead of 'static' modifier
 
 void QueryDiskChunks ( const CSphQuery & tQuery, CSphQueryResultMeta & tResult, const CSphMultiQueryArgs & tArgs, SphChunkGuard_t & tGuard, VecTraits_T<ISphMatchSorter *> & dSorters,
 		QueryProfile_c * pProfiler, bool bGotLocalDF, const SmallStringHash_T<int64_t> * pLocalDocs, int64_t iTotalDocs, const char * szIndexName, VecTraits_T<const BYTE*> & dDiskBlobPools,
@@ -6028,13 +6610,16 @@ void QueryDiskChunks ( const CSphQuery & tQuery, CSphQueryResultMeta & tResult,
 	int iJobs = tGuard.m_dDiskChunks.GetLength ();
 
 	// the context
-	ClonableCtx_T<DiskChunkSearcherCtx_t, DiskChunkSearcherCloneCtx_t> dCtx { dSorters, tResult };
+	ClonableCtx_T<SearchCtx_t, SearchCloneCtx_t> dCtx { dSorters, tResult };
 
 	auto iConcurrency = tQuery.m_iCouncurrency;
 	if ( !iConcurrency )
 		iConcurrency = GetEffectiveDistThreads ();
 	dCtx.LimitConcurrency ( iConcurrency );
 
+	// threads left when there are fewer disk chunks than allowed concurrency go to pseudo-sharding
+	int iChunkConcurrency = tQuery.m_iCouncurrency ? Max ( 1, iConcurrency / iJobs ) : 1;
+
 	auto iStart = sphMicroTimer ();
 	sphLogDebugv ( "Started: " INT64_FMT, sphMicroTimer()-iStart );
 
@@ -6069,6 +6654,7 @@ void QueryDiskChunks ( const CSphQuery & tQuery, CSphQueryResultMeta & tResult,
 			tMultiArgs.m_bLocalDF = bGotLocalDF;
 			tMultiArgs.m_pLocalDocs = pLocalDocs;
 			tMultiArgs.m_iTotalDocs = iTotalDocs;
+			tMultiArgs.m_iConcurrency = iChunkConcurrency;
 
 			// we use sorters in both disk chunks and ram chunks,
 			// that's why we don't want to move to a new schema before we searched ram chunks
@@ -6303,6 +6889,8 @@ void PerformFullTextSearch ( const VecTraits_T<RtSegmentRefPtf_t> & dRamChunks,
 		CSphQueryContext & tCtx, VecTraits_T<ISphMatchSorter*> & dSorters )
 {
 	bool bRandomize = dSorters[0]->m_bRandomize;
+	bool bPrune = tCtx.m_tQuery.m_bPruneByWeight && !bRandomize && dSorters.GetLength()==1 && iIndexWeight>0;
+
 	// query matching
 	ARRAY_FOREACH ( iSeg, dRamChunks )
 	{
@@ -6379,6 +6967,9 @@ void PerformFullTextSearch ( const VecTraits_T<RtSegmentRefPtf_t> & dRamChunks,
 				iSeg = dRamChunks.GetLength();
 				break;
 			}
+
+			if ( bPrune )
+				pRanker->SetWeightThreshold ( dSorters[0]->GetWeightThreshold() / iIndexWeight );
 		}
 	}
 }
@@ -6614,9 +7205,8 @@ bool RtIndex_c::MultiQuery ( CSphQueryResult & tResult, const CSphQuery & tQuery
 
 	CSphScopedPayload tPayloads;
 
-	// FIXME!!! add proper
-	// - qcache invalidation after INSERT \ DELETE \ UPDATE and for plain index afte UPDATE #256
-	// - qcache duplicates removal from killed document at segment #263
+	// RAM segments change with every commit, so they are always searched; disk chunks were already served
+	// from the query cache by their own ids (kills applied via dead-row maps, updates drop the chunk entries)
 	tCtx.m_bSkipQCache = true;
 
 	int iStackNeed = -1;
@@ -7037,6 +7627,9 @@ int RtIndex_c::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, bool
 	if ( !Update_DiskChunks ( tCtx, tGuard, iUpdated, sError ) )
 		sphWarn ( "INTERNAL ERROR: index %s update failure: %s", m_sIndexName.cstr(), sError.cstr() );
 
+	if ( iUpdated )
+		NextGeneration();
+
 	// bump the counter, binlog the update!
 	assert ( iIndex<0 );
 	g_pBinlog->BinlogUpdateAttributes ( &m_iTID, m_sIndexName.cstr(), tUpd );
@@ -7137,6 +7730,7 @@ bool RtIndex_c::AddRemoveAttribute ( bool bAdd, const CSphString & sAttrName, ES
 		return false;
 
 	m_tSchema = tNewSchema;
+	NextGeneration();
 
 	int iOldStride = m_iStride;
 	m_iStride = m_tSchema.GetRowSize();
@@ -7198,6 +7792,113 @@ bool RtIndex_c::AddRemoveAttribute ( bool bAdd, const CSphString & sAttrName, ES
 	return true;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// BULK LOAD
+//////////////////////////////////////////////////////////////////////////
+
+bool RtIndex_c::CommitBulk ( RtSegment_t * pNewSeg, const CSphVector<DocID_t> & dAccKlist, int * pTotalKilled )
+{
+	assert ( pNewSeg );
+	if ( m_bSaveDisabled )
+	{
+		m_sLastError = "bulk load requires index saving enabled";
+		return false;
+	}
+
+	int64_t tmSave = sphMicroTimer ();
+	MEMORY ( MEM_INDEX_RT );
+
+	CSphVector<int64_t> dLens;
+	GetSegmentFieldLens ( pNewSeg, dLens );
+
+	// chunk names are also taken by optimize and by RAM chunk saves
+	SphOptimizeGuard_t tStopOptimize ( m_tOptimizingLock, m_bOptimizeStop );
+	int iChunk;
+	{
+		ScopedMutex_t tSaveLock ( m_tSaveFinished );
+		iChunk = GetNextChunkName();
+	}
+
+	// new segment goes right into disk chunk, no RAM chunk merges
+	CSphString sNewChunk;
+	sNewChunk.SetSprintf ( "%s.%d", m_sPath.cstr(), iChunk );
+	{
+		SphChunkGuard_t tGuard;
+		tGuard.m_dRamChunks.Reset ( 1 );
+		tGuard.m_dRamChunks[0] = pNewSeg;
+		ChunkStats_t tStats ( m_tStats, m_dFieldLensRam );
+		ARRAY_FOREACH ( i, dLens )
+			tStats.m_dFieldLens[i] = dLens[i];
+
+		SaveDiskData ( sNewChunk.cstr(), tGuard, tStats );
+	}
+
+	CreateFilenameBuilder_fn fnCreateFilenameBuilder = GetIndexFilenameBuilder();
+	CSphScopedPtr<FilenameBuilder_i> pFilenameBuilder ( fnCreateFilenameBuilder ? fnCreateFilenameBuilder ( m_sIndexName.cstr() ) : nullptr );
+	StrVec_t dWarnings;
+	CSphIndex * pDiskChunk = PreallocDiskChunk ( sNewChunk.cstr(), iChunk, pFilenameBuilder.Ptr(), dWarnings, m_sLastError );
+	if ( !pDiskChunk )
+	{
+		sphWarning ( "rt: index %s failed to load disk chunk after bulk save: %s", m_sIndexName.cstr(), m_sLastError.cstr() );
+		return false;
+	}
+
+	PrepareDocidMap ( dAccKlist );
+
+	// bulk docs are not in binlog; so flush RAM chunk first (same as ATTACH does),
+	// otherwise replayed txns might kill docs in the new chunk after crash
+	while (true)
+	{
+		if ( !ForceDiskChunk() )
+		{
+			SafeDelete ( pDiskChunk );
+			return false;
+		}
+
+		Verify ( m_tWriting.Lock() );
+		if ( m_dRamChunks.IsEmpty() )
+			break;
+
+		// concurrent commit sneaked in, take another round
+		Verify ( m_tWriting.Unlock() );
+	}
+
+	// kill and publish at once, so readers never see both old and new copy of replaced doc
+	Verify ( m_tChunkLock.WriteLock() );
+	int iTotalKilled = ApplyKillList ( dAccKlist );
+	m_dDiskChunks.Add ( pDiskChunk );
+	SaveMeta ( m_iTID );
+
+	m_tStats.m_iTotalDocuments += pNewSeg->m_uRows - iTotalKilled;
+	ARRAY_FOREACH ( i, dLens )
+	{
+		m_dFieldLensDisk[i] += dLens[i];
+		m_dFieldLens[i] = m_dFieldLensRam[i] + m_dFieldLensDisk[i];
+	}
+
+	int iSavedChunkId = pDiskChunk->GetIndexId();
+	Verify ( m_tChunkLock.Unlock() );
+	NextGeneration();
+
+	// these kills are not in binlog either
+	if ( iTotalKilled )
+		for ( const auto & pChunk : m_dDiskChunks )
+			pChunk->FlushDeadRowMap ( true );
+
+	Verify ( m_tWriting.Unlock() );
+
+	if ( pTotalKilled )
+		*pTotalKilled = iTotalKilled;
+
+	tmSave = sphMicroTimer () - tmSave;
+	sphInfo ( "rt: index %s: diskchunk %d(%d), %u docs bulk saved in %d.%03d sec",
+			  m_sIndexName.cstr (), iSavedChunkId, m_dDiskChunks.GetLength(), pNewSeg->m_uRows,
+			  ( int ) ( tmSave / 1000000 ), ( int ) (( tmSave / 1000 ) % 1000 ));
+
+	return true;
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 // MAGIC CONVERSIONS
 //////////////////////////////////////////////////////////////////////////
@@ -7305,6 +8006,7 @@ bool RtIndex_c::AttachDiskIndex ( CSphIndex * pIndex, bool bTruncate, bool & bFa
 
 	// all done, reset cache
 	QcacheDeleteIndex ( GetIndexId() );
+	NextGeneration();
 	return true;
 }
 
@@ -7317,6 +8019,18 @@ bool RtIndex_c::Truncate ( CSphString & )
 	// TRUNCATE needs an exclusive lock, should be write-locked at daemon, conflicts only with optimize
 	SphOptimizeGuard_t tStopOptimize ( m_tOptimizingLock, m_bOptimizeStop );
 
+	// wait for the disk chunk being saved right now (it is killed below with the rest)
+	// and drop the frozen one still waiting for the background task, so that it is not saved after truncate
+	ScopedMutex_t tSaveLock ( m_tSaveFinished );
+	{
+		ScopedMutex_t tWriteLock ( m_tWriting );
+		m_pFrozenChunk = nullptr;
+		m_iDoubleBuffer = 0;
+		m_bDoubleDump = false;
+		m_dKillsWhileSaving.Reset();
+	}
+	m_tSaveDone.SignalAll ( tSaveLock );
+
 	// update and save meta
 	// indicate 0 disk chunks, we are about to kill them anyway
 	// current TID will be saved, so replay will properly skip preceding txns
@@ -7354,6 +8068,7 @@ bool RtIndex_c::Truncate ( CSphString & )
 
 	// reset cache
 	QcacheDeleteIndex ( GetIndexId() );
+	NextGeneration();
 	return true;
 }
 
@@ -7424,6 +8139,7 @@ void RtIndex_c::DropDiskChunk ( int iChunk )
 		m_dDiskChunks.Remove ( iChunk );
 		SaveMeta ( m_iTID );
 		Verify ( m_tChunkLock.Unlock () );
+		NextGeneration();
 		ScWL_t ReaderWlock ( m_tReading );
 		SafeDelete ( pToDelete );
 	}
@@ -7567,6 +8283,7 @@ bool RtIndex_c::CompressOneChunk ( int iChunk )
 	SaveMeta ( m_iTID );
 
 	Verify ( m_tChunkLock.Unlock () );
+	NextGeneration();
 	Verify ( m_tWriting.Unlock () );
 
 	if ( m_bOptimizeStop || sphInterrupted () )
@@ -7751,6 +8468,7 @@ bool RtIndex_c::SplitOneChunk ( int iChunk, const char* szUvarFilter )
 	SaveMeta ( m_iTID );
 
 	Verify ( m_tChunkLock.Unlock () );
+	NextGeneration();
 	Verify ( m_tWriting.Unlock () );
 
 	// exclusive reader (to make sure that disk chunks not used any more) and writer lock here
@@ -7874,6 +8592,7 @@ bool RtIndex_c::MergeTwoChunks ( int iA, int iB )
 	SaveMeta ( m_iTID );
 
 	Verify ( m_tChunkLock.Unlock() );
+	NextGeneration();
 	Verify ( m_tWriting.Unlock() );
 
 	if ( m_bOptimizeStop || sphInterrupted () )
@@ -8086,7 +8805,7 @@ void RtIndex_c::GetStatus ( CSphIndexStatus * pRes ) const
 	pRes->m_iDead = SegmentsGetDeadRows ( tGuard.m_dRamChunks );
 
 	pRes->m_iRamChunkSize = iUsedRam + tGuard.m_dRamChunks.GetLength()*int(sizeof(RtSegment_t));
-	pRes->m_iRamUse = sizeof( RtIndex_c ) + pRes->m_iRamChunkSize;
+	pRes->m_iRamUse = sizeof( RtIndex_c ) + pRes->m_iRamChunkSize + m_iDocidMapRam.load ( std::memory_order_relaxed );
 	pRes->m_iRamRetired = m_iRamChunksAllocatedRAM.load(std::memory_order_relaxed) - iUsedRam;
 
 	pRes->m_iMemLimit = m_iSoftRamLimit;
@@ -8107,6 +8826,7 @@ void RtIndex_c::GetStatus ( CSphIndexStatus * pRes ) const
 	{
 		tGuard.m_dDiskChunks[i]->GetStatus ( &tDisk );
 		pRes->m_iRamUse += tDisk.m_iRamUse;
+		pRes->m_iPreloadedDict += tDisk.m_iPreloadedDict;
 		pRes->m_iDiskUse += tDisk.m_iDiskUse;
 		pRes->m_iMapped += tDisk.m_iMapped;
 		pRes->m_iMappedResident += tDisk.m_iMappedResident;
@@ -8122,6 +8842,12 @@ void RtIndex_c::GetStatus ( CSphIndexStatus * pRes ) const
 
 	pRes->m_iTID = m_iTID;
 	pRes->m_iSavedTID = m_iSavedTID;
+
+	if ( m_bMergeScheduled.load ( std::memory_order_relaxed ) )
+		pRes->m_iMergesPending = Max ( 1, pRes->m_iNumRamChunks - ( MAX_SEGMENTS - MAX_PROGRESSION_SEGMENT ) + 1 );
+	pRes->m_iMergesDone = m_iMergesDone.load ( std::memory_order_relaxed );
+	pRes->m_iMergedBytes = m_iMergedBytes.load ( std::memory_order_relaxed );
+	pRes->m_iMergeTimeUs = m_iMergeTimeUs.load ( std::memory_order_relaxed );
 //	sphWarning ( "Chunks: %d, RAM: %d, DISK: %d", pRes->m_iNumChunks, (int) pRes->m_iRamUse, (int) pRes->m_iDiskUse );
 }
 
@@ -8282,6 +9008,7 @@ bool RtIndex_c::Reconfigure ( CSphReconfigureSetup & tSetup )
 	if ( pIndexing )
 		m_pTokenizerIndexing = pIndexing;
 
+	NextGeneration();
 	return true;
 }
 
@@ -8692,6 +9419,14 @@ void BinlogWriter_c::Fsync ()
 	m_iLastFsyncPos = GetPos();
 }
 
+
+void BinlogWriter_c::SetSyncError ( const CSphString & sName, int iErrno )
+{
+	m_bError = true;
+	if ( m_pError )
+		m_pError->SetSprintf ( "failed to sync %s: %s", sName.cstr(), strerrorm(iErrno) );
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 BinlogReader_c::BinlogReader_c()
@@ -8746,18 +9481,28 @@ void BinlogReader_c::HashCollected ()
 RtBinlog_c::BlopStartEnd_t::BlopStartEnd_t ( RtBinlog_c & tBinlog, int64_t * pTID, Blop_e eBlop, const char * szIndexName )
 	: m_tBinlog ( tBinlog )
 {
+	Verify ( m_tBinlog.m_tWriteLock.Lock() );
 	m_tBinlog.WriteBlopHeader ( pTID, eBlop, szIndexName );
 }
 
 
 RtBinlog_c::BlopStartEnd_t::~BlopStartEnd_t()
 {
-	// checksum
-	m_tBinlog.m_tWriter.WriteCrc ();
+	if ( !m_bFinished )
+		Finish();
+}
 
-	// finalize
-	m_tBinlog.CheckDoFlush();
-	m_tBinlog.CheckDoRestart();
+
+bool RtBinlog_c::BlopStartEnd_t::Finish()
+{
+	assert ( !m_bFinished );
+	m_bFinished = true;
+
+	int64_t iSeq = m_tBinlog.FinishBlop();
+	Verify ( m_tBinlog.m_tWriteLock.Unlock() );
+
+	// wait for our blop to became durable (no-op unless binlog_flush=1)
+	return m_tBinlog.GroupFsync ( iSeq );
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -8779,13 +9524,12 @@ RtBinlog_c::~RtBinlog_c ()
 	}
 }
 
-void RtBinlog_c::BinlogCommit ( int64_t * pTID, const char * szIndexName, const RtSegment_t * pSeg, const CSphVector<DocID_t> & dKlist, bool bKeywordDict )
+bool RtBinlog_c::BinlogCommit ( int64_t * pTID, const char * szIndexName, const RtSegment_t * pSeg, const CSphVector<DocID_t> & dKlist, bool bKeywordDict, CSphString & sError )
 {
 	if ( m_bReplayMode || m_bDisabled )
-		return;
+		return true;
 
 	MEMORY ( MEM_BINLOG );
-	ScopedMutex_t tWriteLock ( m_tWriteLock );
 	BlopStartEnd_t tStartEnd ( *this, pTID, BLOP_COMMIT, szIndexName );
 
 	// save txn data
@@ -8829,6 +9573,13 @@ void RtBinlog_c::BinlogCommit ( int64_t * pTID, const char * szIndexName, const
 	}
 
 	SaveVector ( m_tWriter, dKlist );
+
+	if ( tStartEnd.Finish() )
+		return true;
+
+	ScopedMutex_t tWriteLock ( m_tWriteLock );
+	sError.SetSprintf ( "binlog: %s", m_sWriterError.cstr() );
+	return false;
 }
 
 
@@ -8838,7 +9589,6 @@ void RtBinlog_c::BinlogUpdateAttributes ( int64_t * pTID, const char * szIndexNa
 		return;
 
 	MEMORY ( MEM_BINLOG );
-	ScopedMutex_t tWriteLock ( m_tWriteLock );
 	BlopStartEnd_t tStartEnd ( *this, pTID, BLOP_UPDATE_ATTRS, szIndexName );
 
 	// update data
@@ -8863,7 +9613,6 @@ void RtBinlog_c::BinlogReconfigure ( int64_t * pTID, const char * szIndexName, c
 		return;
 
 	MEMORY ( MEM_BINLOG );
-	ScopedMutex_t tWriteLock ( m_tWriteLock );
 	BlopStartEnd_t tStartEnd ( *this, pTID, BLOP_RECONFIGURE, szIndexName );
 
 	// reconfigure data
@@ -8931,7 +9680,8 @@ void RtBinlog_c::NotifyIndexFlush ( const char * sIndexName, int64_t iTID, bool
 			}
 
 			// if max logged TID is greater than last flushed TID, log file still has needed recovery data
-			if ( tIndex.m_iFlushedTID < tIndex.m_iMaxTID )
+			// file with transactions failed to replay keeps them for manual recovery
+			if ( tIndex.m_iFlushedTID < tIndex.m_iMaxTID || tIndex.m_bReplayFailed )
 				bUsed = true;
 		}
 
@@ -9317,27 +10067,93 @@ void RtBinlog_c::CheckDoRestart ()
 
 		assert ( m_dLogFiles.GetLength() );
 
+		// blops waiting for group commit must get durable before the log is closed
+		if ( m_eOnCommit==ACTION_FSYNC )
+			m_tWriter.Flush();
+
 		DoCacheWrite();
 		m_tWriter.CloseFile();
 		OpenNewLog();
 	}
 }
 
-void RtBinlog_c::CheckDoFlush ()
+// returns sequence number of just finished blop if it has to be synced by group commit, 0 otherwise
+int64_t RtBinlog_c::CheckDoFlush ()
 {
 	if ( m_eOnCommit==ACTION_NONE )
-		return;
+		return 0;
 
 	if ( m_eOnCommit==ACTION_WRITE && m_tWriter.HasUnwrittenData() )
 		m_tWriter.Write();
 
-	if ( m_eOnCommit==ACTION_FSYNC && m_tWriter.HasUnsyncedData() )
+	// on fsync blop stays in write buffer, it will be written and synced with others by group commit leader
+	if ( m_eOnCommit==ACTION_FSYNC )
+		return ++m_iBlopSeq;
+
+	return 0;
+}
+
+bool RtBinlog_c::GroupFsync ( int64_t iSeq )
+{
+	if ( !iSeq )
+		return true;
+
+	ScopedMutex_t tSyncLock ( m_tSyncLock );
+
+	// leader failed to sync batch with our blop; it is in the log, but might be lost
+	if ( m_iFailedSeq>=iSeq )
+		return false;
+
+	// previous leader already synced our blop in its batch
+	if ( m_iSyncedSeq>=iSeq )
+		return true;
+
+	// we're the leader: write out all blops collected so far and sync them at once;
+	// writers keep appending to buffer meanwhile, and their blops will go with the next batch
+	int64_t iBatchSeq;
+	int64_t iSyncPos = 0;
+	int iLogExt = 0;
+	int iFD = -1;
+	CSphString sLogName;
 	{
+		ScopedMutex_t tWriteLock ( m_tWriteLock );
 		if ( m_tWriter.HasUnwrittenData() )
 			m_tWriter.Write();
+		iBatchSeq = m_iBlopSeq;
+		// log might be rotated and closed while we're syncing, so sync own descriptor of it
+		// (rotation syncs the closing log by itself)
+		if ( m_tWriter.HasUnsyncedData() && m_dLogFiles.GetLength() )
+		{
+			iFD = m_tWriter.DupFD();
+			iSyncPos = m_tWriter.GetPos();
+			iLogExt = m_dLogFiles.Last().m_iExt;
+			sLogName = m_tWriter.GetFilename();
+		}
+	}
 
-		m_tWriter.Fsync();
+	if ( iFD>=0 )
+	{
+		bool bSynced = ( fsync ( iFD )==0 );
+		int iErrno = errno;
+		::close ( iFD );
+
+		ScopedMutex_t tWriteLock ( m_tWriteLock );
+		if ( !bSynced )
+		{
+			// fail the whole batch; retrying fsync might report success while dirty pages were already dropped
+			m_tWriter.SetSyncError ( sLogName, iErrno );
+			sphWarning ( "binlog: %s", m_sWriterError.cstr() );
+			m_iFailedSeq = iBatchSeq;
+			return false;
+		}
+
+		// so that next flush doesn't sync the same range again
+		if ( m_dLogFiles.GetLength() && m_dLogFiles.Last().m_iExt==iLogExt )
+			m_tWriter.SetSynced ( iSyncPos );
 	}
+
+	m_iSyncedSeq = iBatchSeq;
+	return true;
 }
 
 int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, int iBinlog )
@@ -9395,10 +10211,19 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 
 	m_iReplayedRows = 0;
 	int64_t tmReplay = sphMicroTimer();
+	int64_t iBatchStart = tReader.GetPos();
 
 	while ( iFileSize!=tReader.GetPos() && !tReader.GetErrorFlag() && bReplayOK )
 	{
+		// keep decoded and not yet applied data bounded
 		iPos = tReader.GetPos();
+		if ( iPos-iBatchStart>=REPLAY_BATCH_SIZE )
+		{
+			ApplyReplayOps ( iBinlog );
+			iBatchStart = iPos;
+			sphInfo ( "binlog: replaying log %s: %d%% done", sLog.cstr(), (int)( iPos*100/iFileSize ) );
+		}
+
 		if ( tReader.GetDword()!=BLOP_MAGIC )
 		{
 			sphDie ( "binlog: log missing txn marker at pos=" INT64_FMT " (corrupted?)", iPos );
@@ -9453,6 +10278,9 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 		dTotal [ BLOP_TOTAL ]++;
 	}
 
+	// decoded blops are applied even if decoding stopped on error
+	ApplyReplayOps ( iBinlog );
+
 	tmReplay = sphMicroTimer() - tmReplay;
 
 	if ( tReader.GetErrorFlag() )
@@ -9467,13 +10295,14 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 		const BinlogIndexInfo_t & tIndex = tLog.m_dIndexInfos[i];
 		if ( tIndex.m_iPreReplayTID < tIndex.m_iMaxTID )
 		{
-			sphInfo ( "binlog: index %s: recovered from tid " INT64_FMT " to tid " INT64_FMT,
-				tIndex.m_sName.cstr(), tIndex.m_iPreReplayTID, tIndex.m_iMaxTID );
+			sphInfo ( "binlog: index %s: recovered from tid " INT64_FMT " to tid " INT64_FMT "; %d txns, " INT64_FMT " rows in %d.%03d sec",
+				tIndex.m_sName.cstr(), tIndex.m_iPreReplayTID, tIndex.m_iMaxTID, tIndex.m_iReplayedTxns, tIndex.m_iReplayedRows,
+				(int)(tIndex.m_tmReplay/1000000), (int)((tIndex.m_tmReplay/1000)%1000) );
 
 		} else
 		{
 			sphInfo ( "binlog: index %s: skipped at tid " INT64_FMT " and max binlog tid " INT64_FMT,
-				tIndex.m_sName.cstr(), tIndex.m_iPreReplayTID, tIndex.m_iMaxTID );
+				tIndex.m_sName.cstr(), tIndex.m_iPreReplayTID, tIndex.m_iDecodedTID );
 		}
 	}
 
@@ -9491,6 +10320,67 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 }
 
 
+void RtBinlog_c::ApplyReplayOps ( int iBinlog ) const
+{
+	if ( m_dReplayOps.IsEmpty() )
+		return;
+
+	BinlogFileDesc_t & tLog = m_dLogFiles[iBinlog];
+
+	// fan out blops into per-index streams; within stream blops keep binlog order, i.e. TID order
+	CSphVector<CSphVector<int>> dStreams;
+	dStreams.Resize ( tLog.m_dIndexInfos.GetLength() );
+	ARRAY_FOREACH ( i, m_dReplayOps )
+		dStreams[m_dReplayOps[i].m_iIndex].Add ( i );
+
+	CSphVector<int> dIndexes;
+	ARRAY_FOREACH ( i, dStreams )
+		if ( !dStreams[i].IsEmpty() )
+			dIndexes.Add ( i );
+
+	// each index is applied by single worker, but different indexes go concurrently
+	std::atomic<int> iNextStream { 0 };
+	Threads::CallCoroutine ( [&]
+	{
+		Threads::CoExecuteN ( Min ( dIndexes.GetLength(), Threads::NThreads() ), false, [&]
+		{
+			while ( true )
+			{
+				int iStream = iNextStream.fetch_add ( 1, std::memory_order_relaxed );
+				if ( iStream>=dIndexes.GetLength() )
+					return;
+
+				BinlogIndexInfo_t & tIndex = tLog.m_dIndexInfos[dIndexes[iStream]];
+				int64_t tmStart = sphMicroTimer();
+				for ( int iOp : dStreams[dIndexes[iStream]] )
+				{
+					if ( tIndex.m_bReplayFailed )
+						break;
+
+					const ReplayOpDesc_t & tOp = m_dReplayOps[iOp];
+					if ( !tOp.m_pOp->Apply ( tIndex ) )
+					{
+						sphWarning ( "binlog: replay error at pos=" INT64_FMT " (index=%s), rest of its transactions in this log skipped",
+							tOp.m_iTxnPos, tIndex.m_sName.cstr() );
+						tIndex.m_bReplayFailed = true;
+						break;
+					}
+
+					tIndex.m_iMaxTID = Max ( tIndex.m_iMaxTID, tOp.m_iTID );
+					++tIndex.m_iReplayedTxns;
+					tIndex.m_iReplayedRows += tOp.m_iRows;
+				}
+				tIndex.m_tmReplay += sphMicroTimer() - tmStart;
+			}
+		});
+	});
+
+	for ( auto & tOp : m_dReplayOps )
+		SafeDelete ( tOp.m_pOp );
+	m_dReplayOps.Reset();
+}
+
+
 static BinlogIndexInfo_t & ReplayIndexID ( BinlogReader_c & tReader, BinlogFileDesc_t & tLog, const char * sPlace )
 {
 	const int64_t iTxnPos = tReader.GetPos();
@@ -9559,32 +10449,40 @@ bool RtBinlog_c::ReplayCommit ( int iBinlog, DWORD uReplayFlags, BinlogReader_c
 	if ( !PerformChecks ( "commit", tIndex, iTID, iTxnPos, tmStamp, uReplayFlags, tReader ) )
 		return false;
 
-	// only replay transaction when index exists and does not have it yet (based on TID)
-	if ( tIndex.m_pRT && iTID > tIndex.m_pRT->m_iTID )
-	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		CheckTidSeq ( "commit", tIndex, iTID, tIndex.m_pRT, iTxnPos );
-
-		// in case dict=keywords
-		// + cook checkpoint
-		// + build infixes
-		if ( tIndex.m_pRT->IsWordDict() && pSeg )
+	if ( tIndex.m_pRT )
+		AddReplayOp ( iBinlog, tIndex, iTID, iTxnPos, (int)uRows, [this, pSeg, dKlist = std::move ( dKlist ), iTID, iTxnPos] ( BinlogIndexInfo_t & tIndex )
 		{
-			FixupSegmentCheckpoints ( pSeg );
-			BuildSegmentInfixes ( pSeg, tIndex.m_pRT->GetDictionary()->HasMorphology(),
-				tIndex.m_pRT->IsWordDict(), tIndex.m_pRT->GetSettings().m_iMinInfixLen, tIndex.m_pRT->GetWordCheckoint(), ( tIndex.m_pRT->GetMaxCodepointLength()>1 ), tIndex.m_pRT->GetSettings().m_eHitless );
-		}
+			// only replay transaction when index does not have it yet (based on TID)
+			if ( iTID<=tIndex.m_pRT->m_iTID )
+				return true;
 
-		// actually replay
-		if ( !tIndex.m_pRT->CommitReplayable ( pSeg, dKlist, NULL, false ) )
-			return false;
+			// we normally expect per-index TIDs to be sequential
+			// but let's be graceful about that
+			CheckTidSeq ( "commit", tIndex, iTID, tIndex.m_pRT, iTxnPos );
 
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pRT->m_iTID = iTID;
-	}
+			// in case dict=keywords
+			// + cook checkpoint
+			// + build infixes
+			if ( tIndex.m_pRT->IsWordDict() && pSeg )
+			{
+				FixupSegmentCheckpoints ( pSeg );
+				BuildSegmentInfixes ( pSeg, tIndex.m_pRT->GetDictionary()->HasMorphology(),
+					tIndex.m_pRT->IsWordDict(), tIndex.m_pRT->GetSettings().m_iMinInfixLen, tIndex.m_pRT->GetWordCheckoint(), ( tIndex.m_pRT->GetMaxCodepointLength()>1 ), tIndex.m_pRT->GetSettings().m_eHitless );
+			}
+
+			if ( pSeg )
+				pSeg->MoveToArena();
+
+			// actually replay
+			if ( !tIndex.m_pRT->CommitReplayable ( pSeg, dKlist, NULL, false ) )
+				return false;
+
+			// update committed tid on replay in case of unexpected / mismatched tid
+			tIndex.m_pRT->m_iTID = iTID;
+			return true;
+		});
 
-	UpdateIndexInfo ( tIndex, iTID, tmStamp );
+	UpdateIndexInfo ( tIndex, iTID, tmStamp, tIndex.m_pRT!=nullptr );
 
 	return true;
 }
@@ -9675,35 +10573,37 @@ bool RtBinlog_c::ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader
 	}
 
 	// check TID, time order in log
-	if ( iTID<tIndex.m_iMaxTID )
+	if ( iTID<tIndex.m_iDecodedTID )
 		sphDie ( "binlog: update: descending tid (index=%s, lasttid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-			tIndex.m_sName.cstr(), tIndex.m_iMaxTID, iTID, iTxnPos );
+			tIndex.m_sName.cstr(), tIndex.m_iDecodedTID, iTID, iTxnPos );
 	if ( tmStamp<tIndex.m_tmMax )
 		sphDie ( "binlog: update: descending time (index=%s, lasttime=" INT64_FMT ", logtime=" INT64_FMT ", pos=" INT64_FMT ")",
 			tIndex.m_sName.cstr(), tIndex.m_tmMax, tmStamp, iTxnPos );
 
-	if ( tIndex.m_pIndex && iTID > tIndex.m_pIndex->m_iTID )
-	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		if ( iTID!=tIndex.m_pIndex->m_iTID+1 )
-			sphWarning ( "binlog: update: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-				tIndex.m_sName.cstr(), tIndex.m_pIndex->m_iTID, iTID, iTxnPos );
+	if ( tIndex.m_pIndex )
+		AddReplayOp ( iBinlog, tIndex, iTID, iTxnPos, 0, [tUpd = std::move ( tUpd ), iTID, iTxnPos] ( BinlogIndexInfo_t & tIndex )
+		{
+			if ( iTID<=tIndex.m_pIndex->m_iTID )
+				return true;
 
-		CSphString sError, sWarning;
-		bool bCritical = false;
-		tIndex.m_pIndex->UpdateAttributes ( tUpd, -1, bCritical, nullptr, sError, sWarning ); // FIXME! check for errors
-		assert ( !bCritical ); // fixme! handle this
+			// we normally expect per-index TIDs to be sequential
+			// but let's be graceful about that
+			if ( iTID!=tIndex.m_pIndex->m_iTID+1 )
+				sphWarning ( "binlog: update: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
+					tIndex.m_sName.cstr(), tIndex.m_pIndex->m_iTID, iTID, iTxnPos );
 
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pIndex->m_iTID = iTID;
-	}
+			CSphString sError, sWarning;
+			bool bCritical = false;
+			tIndex.m_pIndex->UpdateAttributes ( tUpd, -1, bCritical, nullptr, sError, sWarning ); // FIXME! check for errors
+			assert ( !bCritical ); // fixme! handle this
+
+			// update committed tid on replay in case of unexpected / mismatched tid
+			tIndex.m_pIndex->m_iTID = iTID;
+			return true;
+		});
 
 	// update info
-	tIndex.m_iMinTID = Min ( tIndex.m_iMinTID, iTID );
-	tIndex.m_iMaxTID = Max ( tIndex.m_iMaxTID, iTID );
-	tIndex.m_tmMin = Min ( tIndex.m_tmMin, tmStamp );
-	tIndex.m_tmMax = Max ( tIndex.m_tmMax, tmStamp );
+	UpdateIndexInfo ( tIndex, iTID, tmStamp, tIndex.m_pIndex!=nullptr );
 	return true;
 }
 
@@ -9751,12 +10651,12 @@ bool RtBinlog_c::ReplayCacheAdd ( int iBinlog, BinlogReader_c & tReader ) const
 			continue;
 		}
 
-		if ( tCache.m_iMinTID!=tIndex.m_iMinTID || tCache.m_iMaxTID!=tIndex.m_iMaxTID )
+		if ( tCache.m_iMinTID!=tIndex.m_iMinTID || tCache.m_iMaxTID!=tIndex.m_iDecodedTID )
 		{
 			sphWarning ( "binlog: cache mismatch: index %s tid ranges mismatch "
 				"(cached " INT64_FMT " to " INT64_FMT ", replayed " INT64_FMT " to " INT64_FMT ")",
 				tCache.m_sName.cstr(),
-				tCache.m_iMinTID, tCache.m_iMaxTID, tIndex.m_iMinTID, tIndex.m_iMaxTID );
+				tCache.m_iMinTID, tCache.m_iMaxTID, tIndex.m_iMinTID, tIndex.m_iDecodedTID );
 		}
 	}
 
@@ -9786,7 +10686,7 @@ bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogRead
 	LoadIndexSettings ( tSettings.m_tIndex, tReader, INDEX_FORMAT_VERSION );
 	if ( !tSettings.m_tTokenizer.Load ( pFilenameBuilder.Ptr(), tReader, tEmbeddedFiles, sError ) )
 		sphDie ( "binlog: reconfigure: failed to load settings (index=%s, lasttid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ", error=%s)",
-			tIndex.m_sName.cstr(), tIndex.m_iMaxTID, iTID, iTxnPos, sError.cstr() );
+			tIndex.m_sName.cstr(), tIndex.m_iDecodedTID, iTID, iTxnPos, sError.cstr() );
 
 	tSettings.m_tDict.Load ( tReader, tEmbeddedFiles, sError );
 	tSettings.m_tFieldFilter.Load(tReader);
@@ -9794,35 +10694,40 @@ bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogRead
 	if ( !PerformChecks ( "reconfigure", tIndex, iTID, iTxnPos, tmStamp, uReplayFlags, tReader ) )
 		return false;
 
-	// only replay transaction when index exists and does not have it yet (based on TID)
-	if ( tIndex.m_pRT && iTID > tIndex.m_pRT->m_iTID )
-	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		if ( iTID!=tIndex.m_pRT->m_iTID+1 )
-			sphWarning ( "binlog: reconfigure: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-				tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos );
+	if ( tIndex.m_pRT )
+		AddReplayOp ( iBinlog, tIndex, iTID, iTxnPos, 0, [tSettings = std::move ( tSettings ), iTID, iTxnPos] ( BinlogIndexInfo_t & tIndex ) mutable
+		{
+			// only replay transaction when index does not have it yet (based on TID)
+			if ( iTID<=tIndex.m_pRT->m_iTID )
+				return true;
 
-		sError = "";
-		CSphReconfigureSetup tSetup;
-		StrVec_t dWarnings;
-		bool bSame = tIndex.m_pRT->IsSameSettings ( tSettings, tSetup, dWarnings, sError );
+			// we normally expect per-index TIDs to be sequential
+			// but let's be graceful about that
+			if ( iTID!=tIndex.m_pRT->m_iTID+1 )
+				sphWarning ( "binlog: reconfigure: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
+					tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos );
+
+			CSphString sError;
+			CSphReconfigureSetup tSetup;
+			StrVec_t dWarnings;
+			bool bSame = tIndex.m_pRT->IsSameSettings ( tSettings, tSetup, dWarnings, sError );
 
-		if ( !sError.IsEmpty() )
-			sphWarning ( "binlog: reconfigure: wrong settings (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ", error=%s)",
-				tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos, sError.cstr() );
+			if ( !sError.IsEmpty() )
+				sphWarning ( "binlog: reconfigure: wrong settings (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ", error=%s)",
+					tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos, sError.cstr() );
 
-		if ( !bSame )
-		{
-			if ( !tIndex.m_pRT->Reconfigure ( tSetup ) )
-				return false;
-		}
+			if ( !bSame )
+			{
+				if ( !tIndex.m_pRT->Reconfigure ( tSetup ) )
+					return false;
+			}
 
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pRT->m_iTID = iTID;
-	}
+			// update committed tid on replay in case of unexpected / mismatched tid
+			tIndex.m_pRT->m_iTID = iTID;
+			return true;
+		});
 
-	UpdateIndexInfo ( tIndex, iTID, tmStamp );
+	UpdateIndexInfo ( tIndex, iTID, tmStamp, tIndex.m_pRT!=nullptr );
 
 	return true;
 }
@@ -9851,9 +10756,9 @@ bool RtBinlog_c::CheckCrc ( const char * sOp, const CSphString & sIndex, int64_t
 
 void RtBinlog_c::CheckTid ( const char * sOp, const BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t iTxnPos ) const
 {
-	if ( iTID<tIndex.m_iMaxTID )
+	if ( iTID<tIndex.m_iDecodedTID )
 		sphDie ( "binlog: %s: descending tid (index=%s, lasttid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-			sOp, tIndex.m_sName.cstr(), tIndex.m_iMaxTID, iTID, iTxnPos );
+			sOp, tIndex.m_sName.cstr(), tIndex.m_iDecodedTID, iTID, iTxnPos );
 }
 
 
@@ -9897,10 +10802,14 @@ bool RtBinlog_c::PerformChecks ( const char * szOp, BinlogIndexInfo_t & tIndex,
 }
 
 
-void RtBinlog_c::UpdateIndexInfo ( BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t tmStamp ) const
+// max TID of the blop queued for apply advances only once it is applied;
+// blop with nothing to apply (index not served) stays in the file as before
+void RtBinlog_c::UpdateIndexInfo ( BinlogIndexInfo_t & tIndex, int64_t iTID, int64_t tmStamp, bool bApplyDeferred ) const
 {
 	tIndex.m_iMinTID = Min ( tIndex.m_iMinTID, iTID );
-	tIndex.m_iMaxTID = Max ( tIndex.m_iMaxTID, iTID );
+	tIndex.m_iDecodedTID = Max ( tIndex.m_iDecodedTID, iTID );
+	if ( !bApplyDeferred )
+		tIndex.m_iMaxTID = Max ( tIndex.m_iMaxTID, iTID );
 	tIndex.m_tmMin = Min ( tIndex.m_tmMin, tmStamp );
 	tIndex.m_tmMax = Max ( tIndex.m_tmMax, tmStamp );
 }
@@ -9936,15 +10845,23 @@ bool RtBinlog_c::PreOp ( Blop_e eOp, int64_t * pTID, const char * sIndexName )
 	return true;
 }
 
-void RtBinlog_c::PostOp()
+bool RtBinlog_c::PostOp()
+{
+	int64_t iSeq = FinishBlop();
+	Verify ( m_tWriteLock.Unlock() );
+	return GroupFsync ( iSeq );
+}
+
+// returns sequence number of the blop to be passed to GroupFsync
+int64_t RtBinlog_c::FinishBlop()
 {
 	// checksum
 	m_tWriter.WriteCrc();
 
 	// finalize
-	CheckDoFlush();
+	int64_t iSeq = CheckDoFlush();
 	CheckDoRestart();
-	Verify ( m_tWriteLock.Unlock() );
+	return iSeq;
 }
 
 void RtBinlog_c::BinlogPqAdd ( int64_t * pTID, const char * sIndexName, const StoredQueryDesc_t & tStored )
@@ -9976,32 +10893,37 @@ bool RtBinlog_c::ReplayPqAdd ( int iBinlog, DWORD uReplayFlags, BinlogReader_c &
 	if ( !PerformChecks ( "pq-add", tIndex, iTID, iTxnPos, tmStamp, uReplayFlags, tReader ) )
 		return false;
 
-	// only replay transaction when index exists and does not have it yet (based on TID)
-	if ( tIndex.m_pPQ && iTID>tIndex.m_pPQ->m_iTID )
-	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		CheckTidSeq ( "pq-add", tIndex, iTID, tIndex.m_pPQ, iTxnPos );
+	if ( tIndex.m_pPQ )
+		AddReplayOp ( iBinlog, tIndex, iTID, iTxnPos, 0, [this, tStored = std::move ( tStored ), iTID, tmStamp, iTxnPos] ( BinlogIndexInfo_t & tIndex )
+		{
+			// only replay transaction when index does not have it yet (based on TID)
+			if ( iTID<=tIndex.m_pPQ->m_iTID )
+				return true;
 
-		CSphString sError;
-		PercolateQueryArgs_t tArgs ( tStored );
-		// at binlog query already passed replace checks
-		tArgs.m_bReplace = true;
+			// we normally expect per-index TIDs to be sequential
+			// but let's be graceful about that
+			CheckTidSeq ( "pq-add", tIndex, iTID, tIndex.m_pPQ, iTxnPos );
 
-		// actually replay
-		StoredQuery_i * pQuery = tIndex.m_pPQ->CreateQuery ( tArgs, sError );
-		if ( !pQuery )
-			sphDie ( "binlog: pq-add: apply error (index=%s, lasttime=" INT64_FMT ", logtime=" INT64_FMT ", pos=" INT64_FMT ", '%s')",
-				tIndex.m_sName.cstr(), tIndex.m_tmMax, tmStamp, iTxnPos, sError.cstr() );
+			CSphString sError;
+			PercolateQueryArgs_t tArgs ( tStored );
+			// at binlog query already passed replace checks
+			tArgs.m_bReplace = true;
 
-		tIndex.m_pPQ->ReplayCommit ( pQuery );
+			// actually replay
+			StoredQuery_i * pQuery = tIndex.m_pPQ->CreateQuery ( tArgs, sError );
+			if ( !pQuery )
+				sphDie ( "binlog: pq-add: apply error (index=%s, lasttime=" INT64_FMT ", logtime=" INT64_FMT ", pos=" INT64_FMT ", '%s')",
+					tIndex.m_sName.cstr(), tIndex.m_tmMax, tmStamp, iTxnPos, sError.cstr() );
 
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pPQ->m_iTID = iTID;
-	}
+			tIndex.m_pPQ->ReplayCommit ( pQuery );
+
+			// update committed tid on replay in case of unexpected / mismatched tid
+			tIndex.m_pPQ->m_iTID = iTID;
+			return true;
+		});
 
 	// update info
-	UpdateIndexInfo ( tIndex, iTID, tmStamp );
+	UpdateIndexInfo ( tIndex, iTID, tmStamp, tIndex.m_pPQ!=nullptr );
 
 	return true;
 }
@@ -10036,23 +10958,28 @@ bool RtBinlog_c::ReplayPqDelete ( int iBinlog, DWORD uReplayFlags, BinlogReader_
 	if ( !PerformChecks ( "pq-delete", tIndex, iTID, iTxnPos, tmStamp, uReplayFlags, tReader ) )
 		return false;
 
-	// only replay transaction when index exists and does not have it yet (based on TID)
-	if ( tIndex.m_pPQ && iTID>tIndex.m_pPQ->m_iTID )
-	{
-		CheckTidSeq ( "pq-delete", tIndex, iTID, tIndex.m_pPQ, iTxnPos );
+	if ( tIndex.m_pPQ )
+		AddReplayOp ( iBinlog, tIndex, iTID, iTxnPos, 0, [this, dQueries = std::move ( dQueries ), sTags, iTID, iTxnPos] ( BinlogIndexInfo_t & tIndex )
+		{
+			// only replay transaction when index does not have it yet (based on TID)
+			if ( iTID<=tIndex.m_pPQ->m_iTID )
+				return true;
 
-		// actually replay
-		if ( dQueries.GetLength() )
-			tIndex.m_pPQ->ReplayDeleteQueries ( dQueries );
-		else
-			tIndex.m_pPQ->ReplayDeleteQueries ( sTags.cstr() );
+			CheckTidSeq ( "pq-delete", tIndex, iTID, tIndex.m_pPQ, iTxnPos );
 
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pPQ->m_iTID = iTID;
-	}
+			// actually replay
+			if ( dQueries.GetLength() )
+				tIndex.m_pPQ->ReplayDeleteQueries ( dQueries );
+			else
+				tIndex.m_pPQ->ReplayDeleteQueries ( sTags.cstr() );
+
+			// update committed tid on replay in case of unexpected / mismatched tid
+			tIndex.m_pPQ->m_iTID = iTID;
+			return true;
+		});
 
 	// update info
-	UpdateIndexInfo ( tIndex, iTID, tmStamp );
+	UpdateIndexInfo ( tIndex, iTID, tmStamp, tIndex.m_pPQ!=nullptr );
 
 	return true;
 }
@@ -97,6 +97,12 @@ public:
 
 	virtual bool	NeedStoreWordID () const = 0;
 	virtual	int64_t	GetMemLimit() const = 0;
+
+	/// merge RAM segments outside of commit path (called from background merge task)
+	virtual void	MergeRamSegments () {}
+
+	/// save RAM chunk frozen by commit as a new disk chunk (called from background flush task)
+	virtual void	SaveFrozenRamChunk () {}
 };
 
 /// initialize subsystem
@@ -115,6 +121,16 @@ RtIndex_i * sphCreateIndexRT ( const CSphSchema & tSchema, const char * sIndexNa
 
 typedef void ProgressCallbackSimple_t ();
 
+/// hook to offload merging of RAM segments into the daemon's task manager
+/// if not set (indexer, tools, tests), segments are merged right on commit
+using RtMergeSegmentsHook_fn = void ( * ) ( const CSphString & sIndex );
+void SetRtMergeSegmentsHook ( RtMergeSegmentsHook_fn fnHook );
+
+/// hook to offload saving of RAM chunk as disk chunk into the daemon's task manager
+/// if not set, commit which overflows rt_mem_limit saves the disk chunk by itself
+using RtSaveDiskChunkHook_fn = void ( * ) ( const CSphString & sIndex );
+void SetRtSaveDiskChunkHook ( RtSaveDiskChunkHook_fn fnHook );
+
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -211,9 +227,11 @@ public:
 
 	void					SetupDocstore ( const CSphSchema * pSchema );
 	void					BuildDocID2RowIDMap();
+	void					MoveToArena();				// pack built words, docs and hits into single block
 
 private:
 	int64_t					m_iUsedRam = 0;			///< ram usage counter
+	CSphFixedVector<BYTE>	m_dArena { 0 };			///< backs immutable word/doc/hit lists once segment is built
 
 							~RtSegment_t () final;
 
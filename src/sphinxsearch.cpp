@@ -17,6 +17,7 @@
 #include "sphinxplugin.h"
 #include "sphinxqcache.h"
 #include "attribute.h"
+#include "secondaryindex.h"
 
 #include <math.h>
 
@@ -119,6 +120,11 @@ public:
 	virtual bool				InitState ( const CSphQueryContext &, CSphString & )	{ return true; }
 
 	virtual void				FinalizeCache ( const ISphSchema & tSorterSchema );
+	void						SetWeightThreshold ( int iWeight ) final { m_iWeightThreshold = iWeight; }
+	int64_t						GetDocsEstimate() const final { return m_iDocsEstimate; }
+	bool						PushRowidFilter ( RowidIterator_i * pIterator ) final;
+	bool						SetRowRange ( RowID_t tMinRowID, RowID_t tMaxRowID ) final;
+	void						SetupWeightPruning ( ESphRankMode eRanker, int iMaxQpos );
 
 public:
 	// FIXME? hide and friend?
@@ -131,6 +137,7 @@ public:
 	DWORD						m_uPayloadMask = 0;					///< exposed for ranker state functors
 	int							m_iQwords = 0;						///< exposed for ranker state functors
 	int							m_iMaxQpos = 0;						///< max in-query pos among all keywords, including dupes; for ranker state functors
+	int64_t						m_iDocsEstimate = -1;				///< estimated full-text matches before filtering; set by factory
 
 protected:
 	ExtNode_i *					m_pRoot = nullptr;
@@ -144,6 +151,11 @@ protected:
 
 	int64_t *					m_pNanoBudget = nullptr;
 	QcacheEntry_c *				m_pQcacheEntry = nullptr;			///< data to cache if we decide that the current query is worth caching
+	int							m_iWeightThreshold = 0;				///< min weight to get into the sorter (if known); docs below that are skipped
+	int							m_iMaxFieldRank = 0;				///< max rank per unit of matched field weight; 0 means no pruning
+	int64_t						m_iMaxRankBonus = 0;				///< max weight added over bm25 when doc fields mask can't tell
+
+	int64_t						GetMaxRankBonus ( DWORD uDocFields ) const;
 
 	CSphVector<CSphString>		m_dZones;
 	CSphVector<ExtNode_i*>		m_dZoneStartTerm;
@@ -638,6 +650,42 @@ ExtRanker_c::~ExtRanker_c ()
 }
 
 
+bool ExtRanker_c::PushRowidFilter ( RowidIterator_i * pIterator )
+{
+	if ( !m_pRoot )
+		return false;
+
+	assert ( pIterator );
+	if ( pIterator->IsSorted() )
+	{
+		m_pRoot = CreateRowidFilterNode ( m_pRoot, pIterator );
+		return true;
+	}
+
+	// docid lookups return rows in docid order; these have to be collected and sorted
+	CSphVector<RowID_t> dRowIDs;
+	RowIdBlock_t dBlock;
+	while ( pIterator->GetNextRowIdBlock ( dBlock ) )
+		for ( auto tRowID : dBlock )
+			dRowIDs.Add ( tRowID );
+
+	SafeDelete ( pIterator );
+	dRowIDs.Uniq();
+	m_pRoot = CreateRowidFilterNode ( m_pRoot, dRowIDs );
+	return true;
+}
+
+
+bool ExtRanker_c::SetRowRange ( RowID_t tMinRowID, RowID_t tMaxRowID )
+{
+	if ( !m_pRoot )
+		return false;
+
+	m_pRoot = CreateRowRangeNode ( m_pRoot, tMinRowID, tMaxRowID );
+	return true;
+}
+
+
 void ExtRanker_c::Reset ( const ISphQwordSetup & tSetup )
 {
 	if ( m_pRoot )
@@ -690,6 +738,45 @@ void ExtRanker_c::FinalizeCache ( const ISphSchema & tSorterSchema )
 }
 
 
+void ExtRanker_c::SetupWeightPruning ( ESphRankMode eRanker, int iMaxQpos )
+{
+	// bm25 ranker sums weights of the lower 32 matched fields (or gives 1 if none)
+	// proximity_bm25 gives lcs*weight per field, and lcs can't exceed the query length (and it is a byte anyway)
+	// everything else (payloads included) is not bound
+	switch ( eRanker )
+	{
+	case SPH_RANK_BM25:				m_iMaxFieldRank = 1; break;
+	case SPH_RANK_PROXIMITY_BM25:	m_iMaxFieldRank = m_uPayloadMask ? 0 : Min ( Max ( iMaxQpos, 1 ), 255 ); break;
+	default:						m_iMaxFieldRank = 0; break;
+	}
+
+	int iWeights = m_pCtx->m_iWeights;
+	if ( eRanker==SPH_RANK_BM25 )
+		iWeights = Min ( iWeights, 32 );
+
+	int64_t iTotal = 0;
+	for ( int i=0; i<iWeights; i++ )
+		iTotal += Max ( m_pCtx->m_dWeights[i], 0 );
+
+	m_iMaxRankBonus = Max ( iTotal, 1 )*m_iMaxFieldRank*SPH_BM25_SCALE;
+}
+
+
+int64_t ExtRanker_c::GetMaxRankBonus ( DWORD uDocFields ) const
+{
+	// doc fields mask only covers the lower 32 fields
+	if ( !uDocFields || m_pCtx->m_iWeights>32 )
+		return m_iMaxRankBonus;
+
+	int64_t iRank = 0;
+	for ( int i=0; i<m_pCtx->m_iWeights; i++ )
+		if ( uDocFields & (1u<<i) )
+			iRank += Max ( m_pCtx->m_dWeights[i], 0 );
+
+	return iRank*m_iMaxFieldRank*SPH_BM25_SCALE;
+}
+
+
 void ExtRanker_c::CleanupZones ( RowID_t tMaxRowID )
 {
 	if ( tMaxRowID==INVALID_ROWID )
@@ -1063,12 +1150,21 @@ const ExtDoc_t * ExtRanker_T<USE_BM25>::GetFilteredDocs ()
 				continue;
 			}
 
-			tMaxRowID = pCand->m_tRowID;
-			m_dMyDocs[iDocs] = *pCand;
-
 			if_const ( USE_BM25 )
+			{
 				m_tTestMatch.m_iWeight = (int)( (pCand->m_fTFIDF+0.5f)*SPH_BM25_SCALE );
 
+				// bm25 is already known; if even the best possible rank can't beat the sorter, don't bother fetching hits
+				if ( m_iMaxFieldRank && m_tTestMatch.m_iWeight+GetMaxRankBonus ( pCand->m_uDocFields ) < m_iWeightThreshold )
+				{
+					pCand++;
+					continue;
+				}
+			}
+
+			tMaxRowID = pCand->m_tRowID;
+			m_dMyDocs[iDocs] = *pCand;
+
 			Swap ( m_tTestMatch, m_dMyMatches[iDocs] );
 			iDocs++;
 			pCand++;
@@ -4164,6 +4260,40 @@ static bool HasQwordDupes ( XQNode_t * pNode )
 }
 
 
+/// rough upper estimate of documents matched by a (sub)tree, based on per-keyword doc counts
+static int64_t EstimateNodeDocs ( const XQNode_t * pNode, ExtQwordsHash_t & hQwords, int64_t iTotalDocs )
+{
+	bool bUnion = false;
+	switch ( pNode->GetOp() )
+	{
+	case SPH_QUERY_NULL:	return 0;
+	case SPH_QUERY_NOT:
+	case SPH_QUERY_SCAN:	return iTotalDocs;
+	case SPH_QUERY_MAYBE:
+	case SPH_QUERY_ANDNOT:
+	case SPH_QUERY_NOTNEAR:	return pNode->m_dChildren.GetLength() ? EstimateNodeDocs ( pNode->m_dChildren[0], hQwords, iTotalDocs ) : iTotalDocs;
+	case SPH_QUERY_OR:
+	case SPH_QUERY_QUORUM:	bUnion = true; break;
+	default:				break;
+	}
+
+	// intersections can't match more than their rarest argument, unions more than all arguments together
+	int64_t iDocs = bUnion ? 0 : iTotalDocs;
+	auto fnAdd = [&iDocs, bUnion] ( int64_t iArgDocs ) { iDocs = bUnion ? iDocs+iArgDocs : Min ( iDocs, iArgDocs ); };
+
+	for ( const auto & tWord : pNode->m_dWords )
+	{
+		const ExtQword_t * pQword = hQwords ( tWord.m_sWord );
+		fnAdd ( pQword ? pQword->m_iDocs : iTotalDocs );
+	}
+
+	for ( const auto * pChild : pNode->m_dChildren )
+		fnAdd ( EstimateNodeDocs ( pChild, hQwords, iTotalDocs ) );
+
+	return Min ( iDocs, iTotalDocs );
+}
+
+
 ISphRanker * sphCreateRanker ( const XQQuery_t & tXQ, const CSphQuery & tQuery, CSphQueryResultMeta & tMeta,
 	const ISphQwordSetup & tTermSetup, const CSphQueryContext & tCtx, const ISphSchema & tSorterSchema )
 {
@@ -4178,13 +4308,20 @@ ISphRanker * sphCreateRanker ( const XQQuery_t & tXQ, const CSphQuery & tQuery,
 	bool bGotDupes = HasQwordDupes ( tXQ.m_pRoot );
 	bool bSkipQCache = tCtx.m_bSkipQCache;
 
-	// can we serve this from cache?
+	// can we serve this from cache? caller might have looked it up already
+	if ( tCtx.m_pQcacheEntry )
+		return QcacheRanker ( tCtx.m_pQcacheEntry, tTermSetup );
+
 	QcacheEntryRefPtr_t pCached;
 	if ( !bSkipQCache )
 		pCached = QcacheFind ( pIndex->GetIndexId(), tQuery, tSorterSchema );
 	if ( pCached )
 		return QcacheRanker ( pCached, tTermSetup );
 
+	// pruned docs would be missing from the cached result
+	if ( tQuery.m_bPruneByWeight )
+		bSkipQCache = true;
+
 	// setup eval-tree
 	ExtRanker_c * pRanker = nullptr;
 	switch ( tQuery.m_eRanker )
@@ -4371,6 +4508,9 @@ ISphRanker * sphCreateRanker ( const XQQuery_t & tXQ, const CSphQuery & tQuery,
 	}
 
 	pRanker->m_iMaxQpos = iMaxQpos;
+	pRanker->m_iDocsEstimate = EstimateNodeDocs ( tXQ.m_pRoot, hQwords, pIndex->GetStats().m_iTotalDocuments );
+	if ( tQuery.m_bPruneByWeight )
+		pRanker->SetupWeightPruning ( tQuery.m_eRanker, iMaxQpos );
 	pRanker->SetQwordsIDF ( hQwords );
 	if ( bGotDupes )
 		pRanker->SetTermDupes ( hQwords, iMaxQpos );
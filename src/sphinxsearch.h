@@ -128,6 +128,8 @@ public:
 	virtual ISphQword *					ScanSpawn() const = 0;
 };
 
+class RowidIterator_i;
+
 /// generic ranker interface
 class ISphRanker : public ISphExtra
 {
@@ -138,6 +140,18 @@ public:
 	virtual void				Reset ( const ISphQwordSetup & tSetup ) = 0;
 	virtual bool				IsCache() const { return false; }
 	virtual void				FinalizeCache ( const ISphSchema & ) {}
+
+	/// matches weighted below this can't get into the result set anymore; ranker may skip them early
+	virtual void				SetWeightThreshold ( int ) {}
+
+	/// estimated full-text matches before filtering; -1 if unknown
+	virtual int64_t				GetDocsEstimate() const { return -1; }
+
+	/// only evaluate full-text tree over the rows from a given iterator; takes ownership of it, returns false if not supported
+	virtual bool				PushRowidFilter ( RowidIterator_i * ) { return false; }
+
+	/// only evaluate full-text tree over [min,max) rowid range; returns false if not supported
+	virtual bool				SetRowRange ( RowID_t, RowID_t ) { return false; }
 };
 
 /// factory
@@ -577,6 +577,8 @@ struct InvCompareIndex_fn
 #define LOG_LEVEL_DIAG false
 
 #define KMQ LOC(DIAG,KMQ)
+struct MatchRelevanceLt_fn;
+
 /// heap sorter
 /// plain binary heap based PQ
 template < typename COMP, bool NOTIFICATIONS >
@@ -606,6 +608,18 @@ public:
 		return m_dIData.IsEmpty () ? nullptr : Root ();
 	}
 
+	int GetWeightThreshold() const final
+	{
+		if ( Used()<m_iSize )
+			return 0;
+
+		// weight must be the primary key, descending
+		bool bByWeight = std::is_same<COMP, MatchRelevanceLt_fn>::value
+			|| ( m_tState.m_eKeypart[0]==SPH_KEYPART_WEIGHT && ( m_tState.m_uAttrDesc & 1 ) );
+
+		return bByWeight ? Max ( Root()->m_iWeight, 0 ) : 0;
+	}
+
 	/// add entry to the queue
 	bool Push ( const CSphMatch & tEntry ) final
 	{
@@ -7022,4 +7036,80 @@ void sphCreateMultiQueue ( const SphQueueSettings_t & tQueue, const VecTraits_T<
 	RawVector_T<QueueCreator_c> dCreators;
 	CreateMultiQueue ( dCreators, tQueue, dQueries, dSorters, dErrors, tRes, pExtra );
 	CreateSorters ( dQueries, dSorters, dCreators, dErrors, tRes );
-}
\ No newline at end of file
+}
+//////////////////////////////////////////////////////////////////////////
+// PARALLEL SEARCH CONTEXTS
+//////////////////////////////////////////////////////////////////////////
+
+void SearchCtx_t::MergeMeta ( const CSphQueryResultMeta & tOther ) const
+{
+	// word statistics
+	if ( m_bSharedDict || !m_tMeta.m_hWordStats.GetLength() )
+	{
+		if ( !m_tMeta.m_hWordStats.GetLength() )
+			m_tMeta.m_hWordStats = tOther.m_hWordStats;
+	} else
+	{
+		for ( auto & tStat : m_tMeta.m_hWordStats )
+		{
+			const auto * pDstStat = tOther.m_hWordStats ( tStat.first );
+			if ( pDstStat )
+				m_tMeta.AddStat ( tStat.first, pDstStat->first, pDstStat->second );
+		}
+	}
+
+	// errors
+	if ( !tOther.m_sError.IsEmpty() )
+		m_tMeta.m_sError = tOther.m_sError;
+
+	// warnings
+	if ( !tOther.m_sWarning.IsEmpty() )
+		m_tMeta.m_sWarning = tOther.m_sWarning;
+
+	// prediction counters
+	if ( m_tMeta.m_bHasPrediction )
+		m_tMeta.m_tStats.Add ( tOther.m_tStats );
+
+	m_tMeta.m_iCpuTime += tOther.m_iCpuTime;
+}
+
+
+void SearchCtx_t::MergeChild ( SearchCtx_t dChild ) const
+{
+	// sorting results
+	ARRAY_CONSTFOREACH ( i, m_dSorters )
+		if ( dChild.m_dSorters[i] )
+			dChild.m_dSorters[i]->MoveTo ( m_dSorters[i] );
+
+	MergeMeta ( dChild.m_tMeta );
+
+	// profiling
+	if ( dChild.m_tMeta.m_pProfile )
+		m_tMeta.m_pProfile->AddMetric ( *dChild.m_tMeta.m_pProfile );
+}
+
+
+bool SearchCtx_t::IsClonable () const
+{
+	return m_dSorters.all_of ( [] ( const ISphMatchSorter * p ) { return p->CanBeCloned(); } );
+}
+
+
+SearchCloneCtx_t::SearchCloneCtx_t ( const SearchCtx_t & dParent )
+	: m_bSharedDict ( dParent.m_bSharedDict )
+{
+	m_dSorters.Resize ( dParent.m_dSorters.GetLength() );
+	ARRAY_FOREACH ( i, m_dSorters )
+		m_dSorters[i] = dParent.m_dSorters[i]->Clone();
+
+	m_tMeta.m_bHasPrediction = dParent.m_tMeta.m_bHasPrediction;
+	if ( dParent.m_tMeta.m_pProfile )
+		m_tMeta.m_pProfile = new QueryProfile_c;
+}
+
+
+SearchCloneCtx_t::~SearchCloneCtx_t()
+{
+	m_dSorters.Apply ( [] ( ISphMatchSorter *& pSorter ) { SafeDelete ( pSorter ); } );
+	SafeDelete ( m_tMeta.m_pProfile );
+}
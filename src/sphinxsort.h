@@ -99,6 +99,9 @@ public:
 	/// get a pointer to the worst element, NULL if there is no fixed location
 	virtual const CSphMatch * GetWorst() const { return nullptr; }
 
+	/// min weight a new match must reach to get into the queue; 0 if unknown (not full, or not sorted by weight)
+	virtual int			GetWeightThreshold() const { return 0; }
+
 
 	/// returns whether the sorter can be cloned to distribute processing over multi threads
 	/// (delete and update sorters are too complex by side effects and can't be cloned)
@@ -143,6 +146,42 @@ struct CmpPSortersByRandom_fn
 	}
 };
 
+/// search context for parallel jobs (disk chunks, pseudo-shards) that fill the same set of sorters
+struct SearchCtx_t
+{
+	using Sorters_t = VecTraits_T<ISphMatchSorter *>;
+
+	Sorters_t &				m_dSorters;
+	CSphQueryResultMeta &	m_tMeta;
+	bool					m_bSharedDict;	///< all jobs look up the same dictionary, so word stats are copied rather than summed
+
+	SearchCtx_t ( Sorters_t & dSorters, CSphQueryResultMeta & tMeta, bool bSharedDict = false )
+		: m_dSorters ( dSorters )
+		, m_tMeta ( tMeta )
+		, m_bSharedDict ( bSharedDict )
+	{}
+
+	void	MergeMeta ( const CSphQueryResultMeta & tOther ) const;
+	void	MergeChild ( SearchCtx_t dChild ) const;	///< called from finalize
+	bool	IsClonable () const;
+};
+
+/// per-thread clone of the search context with its own sorters and meta
+struct SearchCloneCtx_t
+{
+	CSphVector<ISphMatchSorter *>	m_dSorters;
+	CSphQueryResultMeta				m_tMeta;
+	bool							m_bSharedDict;
+
+	explicit SearchCloneCtx_t ( const SearchCtx_t & dParent );
+	~SearchCloneCtx_t();
+
+	explicit operator SearchCtx_t()
+	{
+		return { m_dSorters, m_tMeta, m_bSharedDict };
+	}
+};
+
 
 class BlobPool_c
 {
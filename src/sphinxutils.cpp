@@ -744,6 +744,7 @@ static KeyDesc_t g_dKeysIndex[] =
 	{ "html_index_attrs",		0, NULL },
 	{ "html_remove_elements",	0, NULL },
 	{ "preopen",				0, NULL },
+	{ "preload_dict",			0, NULL },
 	{ "inplace_enable",			0, NULL },
 	{ "inplace_hit_gap",		0, NULL },
 	{ "inplace_docinfo_gap",	KEY_REMOVED, NULL },
@@ -768,6 +769,7 @@ static KeyDesc_t g_dKeysIndex[] =
 	{ "rt_attr_json",			KEY_LIST, NULL },
 	{ "rt_attr_bool",			KEY_LIST, NULL },
 	{ "rt_mem_limit",			0, NULL },
+	{ "rt_docid_map",			0, NULL },
 	{ "dict",					0, NULL },
 	{ "index_sp",				0, NULL },
 	{ "index_zones",			0, NULL },
@@ -794,6 +796,7 @@ static KeyDesc_t g_dKeysIndex[] =
 	{ "access_hitlists",		0, nullptr },
 	{ "stored_fields",			0, nullptr },
 	{ "stored_only_fields",		0, nullptr },
+	{ "secondary_indexes",		0, nullptr },
 	{ "docstore_block_size",	0, nullptr },
 	{ "docstore_compression",	0, nullptr },
 	{ "docstore_compression_level",	0, nullptr },
@@ -824,6 +827,7 @@ static KeyDesc_t g_dKeysIndexer[] =
 	{ "json_autoconv_keynames",	KEY_DEPRECATED, "json_autoconv_keynames in common{..} section" },
 	{ "lemmatizer_cache",		0, NULL },
 	{ "ignore_non_plain",		0, NULL },
+	{ "threads",				0, NULL },
 	{ NULL,						0, NULL }
 };
 
@@ -871,6 +875,7 @@ static KeyDesc_t g_dKeysSearchd[] =
 	{ "binlog_max_log_size",	0, NULL },
 	{ "thread_stack",			0, NULL },
 	{ "expansion_limit",		0, NULL },
+	{ "expansion_cache_size",	0, nullptr },
 	{ "rt_flush_period",		0, NULL },
 	{ "query_log_format",		0, NULL },
 	{ "mysql_version_string",	0, NULL },
@@ -903,6 +908,8 @@ static KeyDesc_t g_dKeysSearchd[] =
 	{ "qcache_ttl_sec",			0, NULL },
 	{ "qcache_max_bytes",		0, NULL },
 	{ "qcache_thresh_msec",		0, NULL },
+	{ "qcache_result_max_bytes",	0, NULL },
+	{ "qcache_result_thresh_msec",	0, NULL },
 	{ "sphinxql_timeout",		0, NULL },
 	{ "hostname_lookup",		0, NULL },
 	{ "grouping_in_utc",		0, NULL },
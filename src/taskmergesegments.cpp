@@ -0,0 +1,48 @@
+//
+// Copyright (c) 2017-2021, Manticore Software LTD (https://manticoresearch.com)
+// Copyright (c) 2001-2016, Andrew Aksyonoff
+// Copyright (c) 2008-2016, Sphinx Technologies Inc
+// All rights reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License. You should have
+// received a copy of the GPL license along with this program; if you
+// did not, you can find it at http://www.gnu.org/
+//
+#include "taskmergesegments.h"
+#include "searchdtask.h"
+#include "searchdaemon.h"
+
+/////////////////////////////////////////////////////////////////////////////
+// merging of RT RAM segments
+/////////////////////////////////////////////////////////////////////////////
+void ScheduleMergeSegments ( const CSphString & sIndex )
+{
+	// hook is called from concurrent commits, so rely on thread-safe static init here
+	static TaskID iMergeTask = TaskManager::RegisterGlobal ( "Merge RAM segments",
+			[] ( void* pName ) // worker
+			{
+				CSphString sName;
+				sName.Adopt (( char* ) pName );
+
+				auto pServed = GetServed ( sName );
+				if ( !pServed ) // index went out.
+					return;
+
+				ServedDescRPtr_c dRlocked ( pServed );
+				if ( !ServedDesc_t::IsMutable ( dRlocked ) || !dRlocked->m_pIndex )
+					return;
+
+				auto pDesc = PublishSystemInfo ( "MERGE SEGMENTS" );
+				static_cast<RtIndex_i*>( dRlocked->m_pIndex )->MergeRamSegments();
+			},
+			[] ( void* pName ) // deleter
+			{
+				CSphString sFoo;
+				sFoo.Adopt (( char* ) pName );
+			},
+		2 );
+
+	CSphString sName = sIndex;
+	TaskManager::StartJob ( iMergeTask, sName.Leak() );
+}
@@ -0,0 +1,24 @@
+//
+// Copyright (c) 2017-2021, Manticore Software LTD (https://manticoresearch.com)
+// Copyright (c) 2001-2016, Andrew Aksyonoff
+// Copyright (c) 2008-2016, Sphinx Technologies Inc
+// All rights reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License. You should have
+// received a copy of the GPL license along with this program; if you
+// did not, you can find it at http://www.gnu.org/
+//
+/// @file taskmergesegments.h
+/// Background merging of RT RAM segments
+
+#ifndef MANTICORE_TASKMERGESEGMENTS_H
+#define MANTICORE_TASKMERGESEGMENTS_H
+
+#include "sphinxstd.h"
+
+/* this cb is set as RT merge hook. Commit calls it when RAM segments need merging,
+ * and the merge itself is performed by the task manager, outside of commit path.*/
+void ScheduleMergeSegments ( const CSphString & sIndex );
+
+#endif //MANTICORE_TASKMERGESEGMENTS_H
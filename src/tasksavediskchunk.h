@@ -0,0 +1,24 @@
+//
+// Copyright (c) 2017-2021, Manticore Software LTD (https://manticoresearch.com)
+// Copyright (c) 2001-2016, Andrew Aksyonoff
+// Copyright (c) 2008-2016, Sphinx Technologies Inc
+// All rights reserved
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License. You should have
+// received a copy of the GPL license along with this program; if you
+// did not, you can find it at http://www.gnu.org/
+//
+/// @file tasksavediskchunk.h
+/// Background saving of RT RAM chunk as disk chunk
+
+#ifndef MANTICORE_TASKSAVEDISKCHUNK_H
+#define MANTICORE_TASKSAVEDISKCHUNK_H
+
+#include "sphinxstd.h"
+
+/* this cb is set as RT save hook. Commit calls it when RAM chunk overflows rt_mem_limit and got frozen,
+ * and the disk chunk is written by the task manager, so that committing writer doesn't wait for it.*/
+void ScheduleSaveDiskChunk ( const CSphString & sIndex );
+
+#endif //MANTICORE_TASKSAVEDISKCHUNK_H